@@ -1,12 +1,36 @@
 #include "AbstractNetworkInterface.h"
+#include "BatchValidation.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Tracing.h"
 #include "emitter.h"
 #include "pe.h"
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
-#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <exception>
 #include <stdexcept>
 
+namespace {
+// Smaller frames rarely shrink enough to be worth the CPU
+constexpr std::size_t kMinCompressedFrame = 64;
+
+// Keep the entries whose bit is set in a validity mask, preserving order
+template <typename T>
+std::vector<T> keepValid(const std::vector<T>& items, const ValidityMask& mask) {
+    std::vector<T> valid;
+    valid.reserve(BatchValidation::countValid(mask, items.size()));
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (BatchValidation::isValid(mask, i)) {
+            valid.push_back(items[i]);
+        }
+    }
+    return valid;
+}
+}
+
 /*!
     \class NetworkImplementation
     \brief Implements network communication for PE and Emitter data transfer.
@@ -29,12 +53,43 @@ NetworkImplementation::NetworkImplementation()
     \brief Initializes the network connection.
     \param address The IP address to connect to.
     \param port The port number to connect to.
+
+    If compression is already enabled, the hello naming its dictionary is the
+    first frame sent on the new connection, and frames stay uncompressed until
+    the new peer acknowledges it. Dead reckoning and update scheduling start
+    afresh, as the new peer has seen none of the earlier updates and the new
+    link's capacity is unknown.
 */
 void NetworkImplementation::initialise(const std::string& address, unsigned short port) {
-    std::lock_guard<std::mutex> lock(std::mutex);
+    std::lock_guard<std::mutex> lock(sendMutex);
     try {
+        {
+            // A connection shut down by close() keeps its descriptor until it is reconnected
+            std::lock_guard<std::mutex> state(stateMutex);
+            if (shutDown) {
+                boost::system::error_code ec;
+                socket->close(ec);
+                shutDown = false;
+            }
+        }
         boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address::from_string(address), port);
         socket->connect(endpoint);
+        if (deadReckoning) {
+            deadReckoning->reset();
+        }
+        if (scheduler) {
+            scheduler->reset();
+        }
+        {
+            // Compression is negotiated afresh with each peer
+            std::lock_guard<std::mutex> dictionaryLock(dictionaryMutex);
+            acknowledgedDictionary.reset();
+            pendingAck.reset();
+        }
+        compressionAnnounced = false;
+        if (compression) {
+            announceCompression();
+        }
     } catch (const std::exception& e) {
         logError("Failed to initialize connection: " + std::string(e.what()));
         throw;
@@ -44,13 +99,20 @@ void NetworkImplementation::initialise(const std::string& address, unsigned shor
 /*!
     \fn void NetworkImplementation::close()
     \brief Closes the network connection.
+
+    The socket is shut down in both directions, which wakes a send or receive
+    blocked on another thread with an error, so close() never waits for them.
+    That is what lets NetworkWorker and QueuedSubscriber stop a link whose
+    peer has stopped reading. The descriptor itself is released when the
+    interface is destroyed or reconnected.
 */
 void NetworkImplementation::close() {
-    std::lock_guard<std::mutex> lock(std::mutex);
-    if (socket->is_open()) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (socket->is_open() && !shutDown) {
         boost::system::error_code ec;
-        socket->close(ec);
-        if (ec) {
+        socket->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+        shutDown = true;
+        if (ec && ec != boost::asio::error::not_connected) {
             logError("Failed to close socket: " + ec.message());
         }
     }
@@ -66,16 +128,466 @@ boost::asio::ip::tcp::socket* NetworkImplementation::getSocket() {
 }
 
 /*!
-    \fn void NetworkImplementation::validateAndPrintDataBufferSize(std::string dataBuff, std::string funcName)
-    \brief Validates and prints the size of the data buffer.
-    \param dataBuff The data buffer to validate.
+    \fn std::string NetworkImplementation::readTransportFrame()
+    \brief Reads the next newline delimited frame from the socket.
+    \return The frame contents without the trailing newline.
+
+    Any bytes received beyond the end of the frame stay in the read buffer,
+    so messages that arrive back to back are not lost between receives.
+    Subclasses override this and writeTransportFrame() to carry frames over
+    something other than TCP.
+*/
+std::string NetworkImplementation::readTransportFrame() {
+    std::size_t length = boost::asio::read_until(*socket, readBuffer, '\n');
+    std::string frame{boost::asio::buffers_begin(readBuffer.data()),
+                      boost::asio::buffers_begin(readBuffer.data()) + length - 1};
+    readBuffer.consume(length);
+    return frame;
+}
+
+/*!
+    \fn void NetworkImplementation::writeTransportFrame(const std::string& data)
+    \brief Writes one frame, including its trailing newline, to the socket.
+*/
+void NetworkImplementation::writeTransportFrame(const std::string& data) {
+    boost::asio::write(*socket, boost::asio::buffer(data));
+}
+
+/*!
+    \fn void NetworkImplementation::writeTransportFrame(const std::vector<boost::asio::const_buffer>& parts)
+    \brief Writes one frame gathered from several buffers, the last ending with its newline, to the socket.
+*/
+void NetworkImplementation::writeTransportFrame(const std::vector<boost::asio::const_buffer>& parts) {
+    boost::asio::write(*socket, parts);
+}
+
+/*!
+    \fn void NetworkImplementation::writeTransportBytes(const std::vector<boost::asio::const_buffer>& parts)
+    \brief Writes the raw bytes of a blob stream to the socket in one gathered write.
+*/
+void NetworkImplementation::writeTransportBytes(const std::vector<boost::asio::const_buffer>& parts) {
+    boost::asio::write(*socket, parts);
+}
+
+/*!
+    \fn std::size_t NetworkImplementation::readTransportBytes(char* destination, std::size_t size)
+    \brief Reads up to size raw bytes of a blob stream.
+    \return The number of bytes copied to destination, at least one.
+
+    Bytes already in the read buffer, read past the stream's header frame,
+    are returned first. After that the socket reads straight into
+    destination.
+*/
+std::size_t NetworkImplementation::readTransportBytes(char* destination, std::size_t size) {
+    if (readBuffer.size() > 0) {
+        const std::size_t count = boost::asio::buffer_copy(boost::asio::buffer(destination, size), readBuffer.data());
+        readBuffer.consume(count);
+        return count;
+    }
+    return socket->read_some(boost::asio::buffer(destination, size));
+}
+
+/*!
+    \fn std::string NetworkImplementation::readFrame()
+    \brief Reads the next frame from the transport.
+    \return The frame contents without the trailing newline.
+
+    A blob stream is collected and returned whole, as if it had been sent as
+    one frame. Streams longer than kMaxCollectedBlob are read and discarded,
+    then reported with std::runtime_error. The frame is recorded to the
+    capture, if one is set.
+*/
+std::string NetworkImplementation::readFrame() {
+    ANI_TRACE_SPAN("NetworkImplementation::readFrame");
+    std::string frame = nextFrame();
+    std::uint64_t length;
+    if (MessageCodec::decodeBlobStreamHeader(frame, length)) {
+        if (length > kMaxCollectedBlob) {
+            readBlobStream(length, kBlobChunkBytes, [](std::string_view) {});
+            throw std::runtime_error("Discarded a " + std::to_string(length)
+                                     + " byte blob stream, receive it with receiveBlobStream()");
+        }
+        frame.clear();
+        frame.reserve(length);
+        readBlobStream(length, kBlobChunkBytes, [&frame](std::string_view chunk) { frame.append(chunk); });
+    }
+    if (capture) {
+        capture->append(frame);
+    }
+    return frame;
+}
+
+/*!
+    \fn std::string NetworkImplementation::nextFrame()
+    \brief Reads the next frame from the transport, without collecting blob streams.
+    \return The frame contents without the trailing newline.
+
+    Compression hellos and their acknowledgements are handled here and never
+    returned. Compressed frames are returned decompressed.
+*/
+std::string NetworkImplementation::nextFrame() {
+    std::string frame = readTransportFrame();
+    std::uint32_t dictionaryId;
+    for (;;) {
+        if (FrameCompression::decodeHello(frame, dictionaryId)) {
+            acceptHello(dictionaryId);
+        } else if (FrameCompression::decodeHelloAck(frame, dictionaryId)) {
+            acceptHelloAck(dictionaryId);
+        } else {
+            break;
+        }
+        frame = readTransportFrame();
+    }
+    if (peerCompresses && FrameCompression::isCompressed(frame)) {
+        if (!peerDictionary) {
+            throw std::runtime_error("Received a compressed frame but the sender's dictionary is unknown");
+        }
+        frame = FrameCompression::decompress(frame, *peerDictionary);
+    }
+    return frame;
+}
+
+/*!
+    \fn void NetworkImplementation::readBlobStream(std::uint64_t length, std::size_t chunkBytes, const std::function<void(std::string_view)>& consumer)
+    \brief Reads the raw bytes of a blob stream and passes them to consumer in chunks.
+    \param length The length from the stream's header.
+    \param chunkBytes The largest chunk to pass at once.
+    \param consumer Called with each chunk, which is only valid during the call.
+
+    If consumer throws, the rest of the stream is still read, so the next
+    receive starts at the next frame, and the exception is then rethrown.
+*/
+void NetworkImplementation::readBlobStream(std::uint64_t length, std::size_t chunkBytes,
+                                           const std::function<void(std::string_view)>& consumer) {
+    ANI_TRACE_SPAN("NetworkImplementation::readBlobStream");
+    std::vector<char> chunk(static_cast<std::size_t>(std::max<std::uint64_t>(1, std::min<std::uint64_t>(chunkBytes, length))));
+    std::exception_ptr consumerError;
+    while (length > 0) {
+        const std::size_t wanted = static_cast<std::size_t>(std::min<std::uint64_t>(chunk.size(), length));
+        std::size_t filled = 0;
+        // Fill the chunk before handing it on, so consumers see few, large views
+        while (filled < wanted) {
+            filled += readTransportBytes(chunk.data() + filled, wanted - filled);
+        }
+        length -= filled;
+        if (!consumerError) {
+            try {
+                consumer(std::string_view(chunk.data(), filled));
+            } catch (...) {
+                consumerError = std::current_exception();
+            }
+        }
+    }
+    if (consumerError) {
+        std::rethrow_exception(consumerError);
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::writeFrame(const std::string& data, NetworkMessage::Kind kind)
+    \brief Writes one encoded frame to the transport and records it in the metrics.
+    \param data The frame, including its trailing newline.
+    \param kind The kind of message the frame holds.
+
+    Batch frames are compressed once the peer has acknowledged the hello for
+    the dictionary, and sent as they are until then. An acknowledgement owed
+    to the peer is written first. Throws boost::system::system_error if the
+    write fails. The caller holds sendMutex.
+*/
+void NetworkImplementation::writeFrame(const std::string& data, NetworkMessage::Kind kind) {
+    ANI_TRACE_SPAN("NetworkImplementation::writeFrame");
+    sendPendingAck();
+    const std::string* wire = &data;
+    std::string compressed;
+    const bool batched = kind == NetworkMessage::Kind::PEBatch || kind == NetworkMessage::Kind::EmitterBatch
+                         || kind == NetworkMessage::Kind::Snapshot || kind == NetworkMessage::Kind::SettingBatch;
+    if (compression && batched && data.size() > kMinCompressedFrame) {
+        if (!compressionAnnounced) {
+            announceCompression();
+        }
+        if (compressionAcknowledged()) {
+            compressed = FrameCompression::compress(data.substr(0, data.size() - 1), *compression) + "\n";
+            if (compressed.size() < data.size()) {
+                wire = &compressed;
+            }
+        }
+    }
+    MetricsTimer writeTimer(MetricHistogram::WriteNs);
+    const auto startedAt = DeadReckoning::Clock::now();
+    writeTransportFrame(*wire);
+    writeTimer.stop();
+    reportWrite(wire->size(), startedAt);
+    Metrics::countSent(kind, wire->size());
+}
+
+/*!
+    \fn void NetworkImplementation::reportWrite(std::size_t bytes, DeadReckoning::Clock::time_point startedAt)
+    \brief Tells the update scheduler, if enabled, how long a write took. The caller holds sendMutex.
+*/
+void NetworkImplementation::reportWrite(std::size_t bytes, DeadReckoning::Clock::time_point startedAt) {
+    if (scheduler) {
+        const auto now = DeadReckoning::Clock::now();
+        scheduler->recordWrite(bytes, now - startedAt, now);
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::announceCompression()
+    \brief Sends the hello naming the compression dictionary. The caller holds sendMutex.
+*/
+void NetworkImplementation::announceCompression() {
+    writeTransportFrame(FrameCompression::encodeHello(*compression) + "\n");
+    compressionAnnounced = true;
+}
+
+/*!
+    \fn bool NetworkImplementation::compressionAcknowledged()
+    \brief Returns true if the peer has acknowledged the dictionary this end compresses with. The caller holds sendMutex.
+
+    An acknowledgement of an earlier dictionary does not count, so frames stay
+    uncompressed after a change of dictionary until the new one is acknowledged.
+*/
+bool NetworkImplementation::compressionAcknowledged() {
+    std::lock_guard<std::mutex> lock(dictionaryMutex);
+    return compression && acknowledgedDictionary == compression->id();
+}
+
+/*!
+    \fn void NetworkImplementation::acceptHello(std::uint32_t dictionaryId)
+    \brief Picks the dictionary to decompress the peer's frames with. The caller holds receiveMutex.
+    \param dictionaryId The id named in the peer's hello.
+
+    A dictionary this end holds is acknowledged, so the peer starts
+    compressing with it. A dictionary this end does not hold is logged and not
+    acknowledged, so the peer keeps sending plain frames, and any compressed
+    frame fails to receive rather than being misread.
+
+    The acknowledgement is written at once if no send is in progress, and
+    otherwise before the next frame this end sends. The receive never waits on
+    sendMutex, as a send blocked on a peer that is itself waiting to send its
+    acknowledgement would never finish.
+*/
+void NetworkImplementation::acceptHello(std::uint32_t dictionaryId) {
+    peerCompresses = true;
+    peerDictionary.reset();
+    {
+        std::lock_guard<std::mutex> lock(dictionaryMutex);
+        if (ownDictionary && ownDictionary->id() == dictionaryId) {
+            peerDictionary = ownDictionary;
+        }
+    }
+    if (!peerDictionary && FrameDictionary::standard()->id() == dictionaryId) {
+        peerDictionary = FrameDictionary::standard();
+    }
+    if (!peerDictionary) {
+        char id[9];
+        std::snprintf(id, sizeof(id), "%08x", dictionaryId);
+        logError("Peer compresses with unknown dictionary " + std::string(id));
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(dictionaryMutex);
+        pendingAck = dictionaryId;
+    }
+    std::unique_lock<std::mutex> send(sendMutex, std::try_to_lock);
+    if (send.owns_lock()) {
+        try {
+            sendPendingAck();
+        } catch (const std::exception& e) {
+            // The link is broken, which the next send or receive reports
+            logError("Failed to acknowledge compression hello: " + std::string(e.what()));
+        }
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::acceptHelloAck(std::uint32_t dictionaryId)
+    \brief Records that the peer holds the dictionary it acknowledged. The caller holds receiveMutex.
+*/
+void NetworkImplementation::acceptHelloAck(std::uint32_t dictionaryId) {
+    std::lock_guard<std::mutex> lock(dictionaryMutex);
+    acknowledgedDictionary = dictionaryId;
+}
+
+/*!
+    \fn void NetworkImplementation::sendPendingAck()
+    \brief Writes the acknowledgement owed for the peer's hello, if any. The caller holds sendMutex.
+*/
+void NetworkImplementation::sendPendingAck() {
+    std::optional<std::uint32_t> ack;
+    {
+        std::lock_guard<std::mutex> lock(dictionaryMutex);
+        ack.swap(pendingAck);
+    }
+    if (ack) {
+        writeTransportFrame(FrameCompression::encodeHelloAck(*ack) + "\n");
+    }
+}
+
+/*!
+    \fn void NetworkImplementation::validateAndPrintDataBufferSize(const std::string& dataBuff, const char* funcName)
+    \brief Logs the size of a received data buffer at debug level.
+    \param dataBuff The data buffer received.
     \param funcName The name of the function calling this method.
 */
-void NetworkImplementation::validateAndPrintDataBufferSize(std::string dataBuff, std::string funcName) {
-    dataBuff.data() ? std::cout << funcName << " - Received intact data buffer of length: "
-                                << dataBuff.length() << std::endl
-                    : std::cerr << "Received invalid data buffer of length: "
-                                << dataBuff.length() << std::endl;
+void NetworkImplementation::validateAndPrintDataBufferSize(const std::string& dataBuff, const char* funcName) {
+    ANI_LOG_DEBUG("NetworkImplementation", std::string(funcName) + " - Received data buffer of length: "
+                                           + std::to_string(dataBuff.length()));
+}
+
+/*!
+    \fn void NetworkImplementation::enableDeadReckoning(const DeadReckoningConfig& config)
+    \brief Enables sender-side dead reckoning for sendPE and sendEmitter.
+    \param config The position, altitude and interval thresholds to apply.
+
+    Updates are only written when the receiver's extrapolation of the last sent
+    state has drifted past the thresholds, a non-kinematic field has changed, or
+    the maximum interval has passed. Receivers should use DeadReckoningReceiver
+    with the same speed units to display smooth positions between updates.
+*/
+void NetworkImplementation::enableDeadReckoning(const DeadReckoningConfig& config) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    deadReckoning = std::make_unique<DeadReckoningSender>(config);
+}
+
+/*!
+    \fn void NetworkImplementation::disableDeadReckoning()
+    \brief Disables dead reckoning, so every valid update is sent again.
+*/
+void NetworkImplementation::disableDeadReckoning() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    deadReckoning.reset();
+}
+
+/*!
+    \fn void NetworkImplementation::enableUpdateScheduling(const UpdateSchedulerConfig& config)
+    \brief Shares a saturated link between PEs and Emitters by priority and rate of change.
+    \param config The priority weights, target utilisation and intervals to apply.
+
+    Every write is timed to estimate the link's capacity. While the link keeps
+    up nothing changes, but once writes block, sendPE and sendEmitter updates
+    from entities over their budget are skipped and still reported as sent, so
+    high-priority entities keep their rate while low-priority ones slow down.
+    The latest skipped state of each entity is written once its budget allows,
+    or maxInterval after its last update, by a later sendPE or sendEmitter or
+    by flushDeferredUpdates(). See UpdateScheduler. Batches, snapshots and
+    settings are never deferred.
+*/
+void NetworkImplementation::enableUpdateScheduling(const UpdateSchedulerConfig& config) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    scheduler = std::make_unique<UpdateScheduler>(config);
+}
+
+/*!
+    \fn bool NetworkImplementation::flushDeferredUpdates()
+    \brief Writes the updates deferred by update scheduling that are now due.
+    \return False if a write failed.
+
+    sendPE and sendEmitter do this after every update, so only a sender that
+    may go quiet needs to call it, for example from a timer. NetworkWorker
+    calls it whenever its send queue has been idle for a while.
+*/
+bool NetworkImplementation::flushDeferredUpdates() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    return flushDeferredLocked(DeadReckoning::Clock::now());
+}
+
+/*!
+    \fn bool NetworkImplementation::flushDeferredLocked(DeadReckoning::Clock::time_point now)
+    \brief Writes the deferred updates the scheduler reports as due. The caller holds sendMutex.
+*/
+bool NetworkImplementation::flushDeferredLocked(DeadReckoning::Clock::time_point now) {
+    std::vector<PE> pes;
+    std::vector<Emitter> emitters;
+    if (!scheduler || !scheduler->takeDue(now, pes, emitters)) {
+        return true;
+    }
+    bool written = true;
+    for (const PE& pe : pes) {
+        // Dead reckoning forgot the state when it was deferred, so this records it as sent
+        if (deadReckoning && !deadReckoning->shouldSendPE(pe, now)) {
+            continue;
+        }
+        try {
+            writeFrame(MessageCodec::encodePE(pe), NetworkMessage::Kind::PE);
+        } catch (const std::exception& e) {
+            logError("Failed to send deferred PE: " + std::string(e.what()));
+            Metrics::count(MetricCounter::SendFailures);
+            if (deadReckoning) {
+                deadReckoning->forgetPE(pe.id);
+            }
+            written = false;
+        }
+    }
+    for (const Emitter& emitter : emitters) {
+        if (deadReckoning && !deadReckoning->shouldSendEmitter(emitter, now)) {
+            continue;
+        }
+        try {
+            writeFrame(MessageCodec::encodeEmitter(emitter), NetworkMessage::Kind::Emitter);
+        } catch (const std::exception& e) {
+            logError("Failed to send deferred Emitter: " + std::string(e.what()));
+            Metrics::count(MetricCounter::SendFailures);
+            if (deadReckoning) {
+                deadReckoning->forgetEmitter(emitter.id);
+            }
+            written = false;
+        }
+    }
+    return written;
+}
+
+/*!
+    \fn void NetworkImplementation::disableUpdateScheduling()
+    \brief Disables update scheduling, so every valid update is written again.
+*/
+void NetworkImplementation::disableUpdateScheduling() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    scheduler.reset();
+}
+
+/*!
+    \fn void NetworkImplementation::enableCompression(std::shared_ptr<const FrameDictionary> dictionary)
+    \brief Compresses PE batch, Emitter batch, setting batch and snapshot frames from now on.
+    \param dictionary The dictionary to compress against, the standard one by default.
+
+    The first batch frame is preceded by a hello naming the dictionary, or the
+    hello is sent by initialise() if compression is enabled before connecting.
+    Frames are only compressed once the peer's acknowledgement of the hello
+    has been received, which a receive on this end reads, and are sent as they
+    are until then, or for good if the peer does not hold the dictionary.
+    Frames that would not shrink are sent as they are. This end also accepts
+    dictionary from its peer, so to use a trained dictionary enable it on both
+    ends before any frames arrive.
+*/
+void NetworkImplementation::enableCompression(std::shared_ptr<const FrameDictionary> dictionary) {
+    {
+        std::lock_guard<std::mutex> lock(dictionaryMutex);
+        ownDictionary = dictionary;
+    }
+    std::lock_guard<std::mutex> lock(sendMutex);
+    compression = std::move(dictionary);
+    // A different dictionary needs a new hello before it is used
+    compressionAnnounced = false;
+}
+
+/*!
+    \fn void NetworkImplementation::disableCompression()
+    \brief Sends every frame uncompressed again. Compressed frames from the peer are still accepted.
+*/
+void NetworkImplementation::disableCompression() {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    compression.reset();
+}
+
+/*!
+    \fn void NetworkImplementation::setCapture(std::shared_ptr<TrafficCapture> capture)
+    \brief Records every frame this interface reads, whichever receive function reads it.
+    \param capture The capture to append to, shared with other interfaces, or nullptr to stop.
+*/
+void NetworkImplementation::setCapture(std::shared_ptr<TrafficCapture> capture) {
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    this->capture = std::move(capture);
 }
 
 /*!
@@ -85,7 +597,11 @@ void NetworkImplementation::validateAndPrintDataBufferSize(std::string dataBuff,
  * \return True if the fields are valid, false otherwise.
  */
 bool NetworkImplementation::validatePE(const PE& pe) {
-    return !pe.id.isEmpty() && pe.lat >= -90 && pe.lat <= 90 && pe.lon >= -180 && pe.lon <= 180 && pe.altitude >= 0;
+    const bool valid = !pe.id.isEmpty() && pe.lat >= -90 && pe.lat <= 90 && pe.lon >= -180 && pe.lon <= 180 && pe.altitude >= 0;
+    if (!valid) {
+        Metrics::count(MetricCounter::InvalidPEs);
+    }
+    return valid;
 }
 
 /*!
@@ -95,16 +611,20 @@ bool NetworkImplementation::validatePE(const PE& pe) {
  * \return True if the fields are valid, false otherwise.
  */
 bool NetworkImplementation::validateEmitter(const Emitter& emitter) {
-    return !emitter.id.isEmpty() && emitter.lat >= -90 && emitter.lat <= 90 && emitter.lon >= -180 && emitter.lon <= 180 && emitter.freqMin < emitter.freqMax;
+    const bool valid = !emitter.id.isEmpty() && emitter.lat >= -90 && emitter.lat <= 90 && emitter.lon >= -180 && emitter.lon <= 180 && emitter.freqMin < emitter.freqMax;
+    if (!valid) {
+        Metrics::count(MetricCounter::InvalidEmitters);
+    }
+    return valid;
 }
 
 /*!
  * \fn void NetworkImplementation::logError(const std::string& message)
- * \brief Logs a given string to std::cerr in a standardised format.
+ * \brief Logs a given string at error level through the asynchronous Logger.
  * \param message The string to log.
  */
 void NetworkImplementation::logError(const std::string& message) {
-    std::cerr << "NetworkImplementation Error: " << message << std::endl;
+    ANI_LOG_ERROR("NetworkImplementation", message);
 }
 
 /*!
@@ -116,21 +636,18 @@ void NetworkImplementation::logError(const std::string& message) {
     \return True if the setting was sent successfully, false otherwise.
 */
 bool NetworkImplementation::sendPESetting(const std::string& setting, const std::string& id, int updateVal) {
-    std::lock_guard<std::mutex> lock(std::mutex);
-    QJsonObject json;
-    json["type"] = "PE_SETTING";
-    json["id"] = QString::fromStdString(id);
-    json["setting"] = QString::fromStdString(setting);
-    json["value"] = updateVal;
-
-    QJsonDocument doc(json);
-    std::string data = doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+    ANI_TRACE_SPAN("NetworkImplementation::sendPESetting");
+    std::lock_guard<std::mutex> lock(sendMutex);
+    MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+    std::string data = MessageCodec::encodeSetting("PE_SETTING", setting, id, updateVal);
+    encodeTimer.stop();
 
     try {
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        writeFrame(data, NetworkMessage::Kind::Setting);
         return true;
     } catch (const std::exception& e) {
         logError("Failed to send PE setting: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
         return false;
     }
 }
@@ -144,21 +661,18 @@ bool NetworkImplementation::sendPESetting(const std::string& setting, const std:
     \return True if the setting was sent successfully, false otherwise.
 */
 bool NetworkImplementation::sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) {
-    std::lock_guard<std::mutex> lock(std::mutex);
-    QJsonObject json;
-    json["type"] = "EMITTER_SETTING";
-    json["id"] = QString::fromStdString(id);
-    json["setting"] = QString::fromStdString(setting);
-    json["value"] = updateVal;
-
-    QJsonDocument doc(json);
-    std::string data = doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+    ANI_TRACE_SPAN("NetworkImplementation::sendEmitterSetting");
+    std::lock_guard<std::mutex> lock(sendMutex);
+    MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+    std::string data = MessageCodec::encodeSetting("EMITTER_SETTING", setting, id, updateVal);
+    encodeTimer.stop();
 
     try {
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        writeFrame(data, NetworkMessage::Kind::Setting);
         return true;
     } catch (const std::exception& e) {
         logError("Failed to send Emitter setting: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
         return false;
     }
 }
@@ -168,10 +682,143 @@ bool NetworkImplementation::sendEmitterSetting(const std::string& setting, const
     \brief Sends a generic blob of data.
     \param blobString The blob data to send.
     \return True if the blob was sent successfully, false otherwise.
+
+    A blob that cannot go out as one plain frame is sent as a blob stream
+    instead and still received whole. See needsBlobStream(). That includes
+    streamed blobs recorded by a capture and sent again by TrafficReplay.
 */
 bool NetworkImplementation::sendBlob(const std::string& blobString) {
-    boost::asio::write(*socket, boost::asio::buffer(blobString + "\n"));
-    return true;
+    ANI_TRACE_SPAN("NetworkImplementation::sendBlob");
+    std::lock_guard<std::mutex> lock(sendMutex);
+    try {
+        sendPendingAck();
+        if (needsBlobStream(blobString)) {
+            writeBlobStream({boost::asio::buffer(blobString)});
+            return true;
+        }
+        // Gathered with the newline rather than copied to append it
+        static const char newline = '\n';
+        MetricsTimer writeTimer(MetricHistogram::WriteNs);
+        const auto startedAt = DeadReckoning::Clock::now();
+        writeTransportFrame({boost::asio::buffer(blobString), boost::asio::buffer(&newline, 1)});
+        writeTimer.stop();
+        reportWrite(blobString.size() + 1, startedAt);
+        Metrics::countSent(NetworkMessage::Kind::Blob, blobString.size() + 1);
+        return true;
+    } catch (const std::exception& e) {
+        logError("Failed to send blob: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkImplementation::sendBlobStream(const std::vector<boost::asio::const_buffer>& parts)
+    \brief Sends one blob made of several caller-owned buffers, without copying them.
+    \param parts The buffers, concatenated in order to form the blob.
+    \return True if the blob was sent successfully, false otherwise.
+
+    A BLOB_STREAM header frame gives the total length, and the bytes follow
+    it unframed in one gathered write. The blob can therefore hold any bytes,
+    newlines included, and need not be joined into one string first. The
+    buffers must stay valid until the call returns. Blobs are never
+    compressed.
+*/
+bool NetworkImplementation::sendBlobStream(const std::vector<boost::asio::const_buffer>& parts) {
+    ANI_TRACE_SPAN("NetworkImplementation::sendBlobStream");
+    std::lock_guard<std::mutex> lock(sendMutex);
+    try {
+        writeBlobStream(parts);
+        return true;
+    } catch (const std::exception& e) {
+        logError("Failed to send blob stream: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkImplementation::needsBlobStream(const std::string& blob)
+    \brief Returns true if a blob sent as one frame would be misread by the receiver.
+
+    A newline would end the frame early. A blob that reads as a blob stream
+    header would make the receiver take the frames after it as stream bytes.
+    One starting with the compression marker would be decompressed, and one
+    that reads as a compression hello or acknowledgement would be consumed
+    as one. The bytes of a stream are never parsed as frames, so all of these
+    are safe sent as a stream.
+*/
+bool NetworkImplementation::needsBlobStream(const std::string& blob) {
+    std::uint64_t length;
+    std::uint32_t dictionaryId;
+    return blob.find('\n') != std::string::npos || MessageCodec::decodeBlobStreamHeader(blob, length)
+           || FrameCompression::isCompressed(blob) || FrameCompression::decodeHello(blob, dictionaryId)
+           || FrameCompression::decodeHelloAck(blob, dictionaryId);
+}
+
+/*!
+    \fn void NetworkImplementation::writeBlobStream(const std::vector<boost::asio::const_buffer>& parts)
+    \brief Writes a BLOB_STREAM header and the blob's bytes. Called with sendMutex held, throws if the write fails.
+*/
+void NetworkImplementation::writeBlobStream(const std::vector<boost::asio::const_buffer>& parts) {
+    const std::uint64_t length = boost::asio::buffer_size(parts);
+    const std::string header = MessageCodec::encodeBlobStreamHeader(length);
+    sendPendingAck();
+    MetricsTimer writeTimer(MetricHistogram::WriteNs);
+    const auto startedAt = DeadReckoning::Clock::now();
+    writeTransportFrame(header);
+    writeTransportBytes(parts);
+    writeTimer.stop();
+    reportWrite(header.size() + length, startedAt);
+    Metrics::countSent(NetworkMessage::Kind::Blob, header.size() + length);
+}
+
+/*!
+    \fn std::uint64_t NetworkImplementation::receiveBlobStream(const std::function<void(std::string_view)>& consumer, std::size_t chunkBytes)
+    \brief Receives the next blob in chunks, so memory use is bounded by chunkBytes whatever the blob's size.
+    \param consumer Called with each chunk in order. A chunk is only valid during the call.
+    \param chunkBytes The largest chunk to pass to consumer at once.
+    \return The length of the blob.
+
+    A blob sent with sendBlobStream() is read straight from the transport
+    into one reused buffer of chunkBytes. Any other frame, such as a blob
+    sent with sendBlob(), is passed to consumer whole as a single chunk.
+    Streamed blobs are not recorded to the capture. If consumer throws, the
+    rest of the blob is discarded and the exception rethrown, leaving the
+    link ready for the next frame.
+*/
+std::uint64_t NetworkImplementation::receiveBlobStream(const std::function<void(std::string_view)>& consumer,
+                                                       std::size_t chunkBytes) {
+    ANI_TRACE_SPAN("NetworkImplementation::receiveBlobStream");
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    std::string frame;
+    try {
+        frame = nextFrame();
+    } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
+        logError("Failed to receive blob stream: " + std::string(e.what()));
+        throw;
+    }
+    std::uint64_t length;
+    if (MessageCodec::decodeBlobStreamHeader(frame, length)) {
+        try {
+            readBlobStream(length, chunkBytes, consumer);
+        } catch (const boost::system::system_error& e) {
+            // Exceptions from consumer are the caller's own and pass straight through
+            Metrics::count(MetricCounter::ReceiveFailures);
+            logError("Failed to receive blob stream: " + std::string(e.what()));
+            throw;
+        }
+        Metrics::countReceived(NetworkMessage::Kind::Blob, frame.size() + 1 + length);
+        return length;
+    }
+    if (capture) {
+        capture->append(frame);
+    }
+    validateAndPrintDataBufferSize(frame, "receiveBlobStream");
+    Metrics::countReceived(NetworkMessage::Kind::Blob, frame.size() + 1);
+    consumer(frame);
+    return frame.size();
 }
 
 /*!
@@ -179,19 +826,44 @@ bool NetworkImplementation::sendBlob(const std::string& blobString) {
     \brief Sends a PE object.
     \param pe The PE object to send.
     \return True if the PE was sent successfully, false otherwise.
+
+    With dead reckoning enabled, an update the receiver can predict is skipped
+    and still reported as sent, as is an update over its entity's budget with
+    update scheduling enabled.
 */
 bool NetworkImplementation::sendPE(const PE& pe) {
-    std::lock_guard<std::mutex> lock(std::mutex);
+    ANI_TRACE_SPAN("NetworkImplementation::sendPE");
+    std::lock_guard<std::mutex> lock(sendMutex);
     if (!validatePE(pe)) {
         logError("Invalid PE data");
         return false;
     }
+    const auto now = DeadReckoning::Clock::now();
+    if (deadReckoning && !deadReckoning->shouldSendPE(pe, now)) {
+        return true;
+    }
     try {
-        std::string data = serializePE(pe);
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+        std::string data = MessageCodec::encodePE(pe);
+        encodeTimer.stop();
+        if (scheduler && !scheduler->shouldSendPE(pe, data.size(), now)) {
+            // Not written, so dead reckoning must not predict from it
+            if (deadReckoning) {
+                deadReckoning->forgetPE(pe.id);
+            }
+        } else {
+            writeFrame(data, NetworkMessage::Kind::PE);
+        }
+        // Failures are logged, and are for other entities' updates rather than this one
+        flushDeferredLocked(now);
         return true;
     } catch (const std::exception& e) {
         logError("Failed to send PE: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
+        // Never reached the receiver, so the next update must not be predicted from it
+        if (deadReckoning) {
+            deadReckoning->forgetPE(pe.id);
+        }
         return false;
     }
 }
@@ -201,19 +873,44 @@ bool NetworkImplementation::sendPE(const PE& pe) {
     \brief Sends an Emitter object.
     \param emitter The Emitter object to send.
     \return True if the Emitter was sent successfully, false otherwise.
+
+    With dead reckoning enabled, an update the receiver can predict is skipped
+    and still reported as sent, as is an update over its entity's budget with
+    update scheduling enabled.
 */
 bool NetworkImplementation::sendEmitter(const Emitter& emitter) {
-    std::lock_guard<std::mutex> lock(std::mutex);
+    ANI_TRACE_SPAN("NetworkImplementation::sendEmitter");
+    std::lock_guard<std::mutex> lock(sendMutex);
     if (!validateEmitter(emitter)) {
         logError("Invalid Emitter data");
         return false;
     }
+    const auto now = DeadReckoning::Clock::now();
+    if (deadReckoning && !deadReckoning->shouldSendEmitter(emitter, now)) {
+        return true;
+    }
     try {
-        std::string data = serializeEmitter(emitter);
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+        std::string data = MessageCodec::encodeEmitter(emitter);
+        encodeTimer.stop();
+        if (scheduler && !scheduler->shouldSendEmitter(emitter, data.size(), now)) {
+            // Not written, so dead reckoning must not predict from it
+            if (deadReckoning) {
+                deadReckoning->forgetEmitter(emitter.id);
+            }
+        } else {
+            writeFrame(data, NetworkMessage::Kind::Emitter);
+        }
+        // Failures are logged, and are for other entities' updates rather than this one
+        flushDeferredLocked(now);
         return true;
     } catch (const std::exception& e) {
         logError("Failed to send Emitter: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
+        // Never reached the receiver, so the next update must not be predicted from it
+        if (deadReckoning) {
+            deadReckoning->forgetEmitter(emitter.id);
+        }
         return false;
     }
 }
@@ -227,12 +924,17 @@ bool NetworkImplementation::sendEmitter(const Emitter& emitter) {
     \return True if the complex blob was sent successfully, false otherwise.
 */
 bool NetworkImplementation::sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) {
-    std::string data = serializeComplexBlob(pe, emitter, doubleMap);
+    ANI_TRACE_SPAN("NetworkImplementation::sendComplexBlob");
+    std::lock_guard<std::mutex> lock(sendMutex);
+    MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+    std::string data = MessageCodec::encodeComplexBlob(pe, emitter, doubleMap);
+    encodeTimer.stop();
     try {
-        boost::asio::write(*socket, boost::asio::buffer(data));
+        writeFrame(data, NetworkMessage::Kind::ComplexBlob);
         return true;
     } catch (const std::exception& e){
-        std::cerr << "Write to socket except while sending complex blob: " << e.what() << std::endl;
+        logError("Failed to send complex blob: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
         return false;
     }
 }
@@ -243,14 +945,13 @@ bool NetworkImplementation::sendComplexBlob(const PE& pe, const Emitter& emitter
     \return A tuple containing the type of setting, ID, setting name, and new value.
 */
 std::tuple<std::string, std::string, std::string, int> NetworkImplementation::receiveSetting() {
-    std::lock_guard<std::mutex> lock(std::mutex);
+    ANI_TRACE_SPAN("NetworkImplementation::receiveSetting");
+    std::lock_guard<std::mutex> lock(receiveMutex);
     try {
-        boost::asio::streambuf buf;
-        boost::asio::read_until(*socket, buf, '\n');
-        std::string data{boost::asio::buffers_begin(buf.data()),
-                         boost::asio::buffers_end(buf.data())};
-        buf.consume(buf.size());
+        std::string data = readFrame();
         validateAndPrintDataBufferSize(data, "receiveSetting");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        Metrics::countReceived(NetworkMessage::Kind::Setting, data.size() + 1);
 
         QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
         if (doc.isNull()) {
@@ -265,6 +966,7 @@ std::tuple<std::string, std::string, std::string, int> NetworkImplementation::re
 
         return std::make_tuple(type, id, setting, value);
     } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
         logError("Failed to receive Setting: " + std::string(e.what()));
         throw;
     }
@@ -276,16 +978,16 @@ std::tuple<std::string, std::string, std::string, int> NetworkImplementation::re
     \return The deserialized PE object.
 */
 PE NetworkImplementation::receivePE() {
-    std::lock_guard<std::mutex> lock(std::mutex);
+    ANI_TRACE_SPAN("NetworkImplementation::receivePE");
+    std::lock_guard<std::mutex> lock(receiveMutex);
     try {
-        boost::asio::streambuf buf;
-        boost::asio::read_until(*socket, buf, '\n');
-        std::string data{boost::asio::buffers_begin(buf.data()),
-                         boost::asio::buffers_end(buf.data())};
-        buf.consume(buf.size());
+        std::string data = readFrame();
         validateAndPrintDataBufferSize(data, "receivePE");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        Metrics::countReceived(NetworkMessage::Kind::PE, data.size() + 1);
         return deserializePE(data);
     } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
         logError("Failed to receive PE: " + std::string(e.what()));
         throw;
     }
@@ -297,16 +999,16 @@ PE NetworkImplementation::receivePE() {
     \return The deserialized Emitter object.
 */
 Emitter NetworkImplementation::receiveEmitter() {
-    std::lock_guard<std::mutex> lock(std::mutex);
+    ANI_TRACE_SPAN("NetworkImplementation::receiveEmitter");
+    std::lock_guard<std::mutex> lock(receiveMutex);
     try {
-        boost::asio::streambuf buf;
-        boost::asio::read_until(*socket, buf, '\n');
-        std::string data{boost::asio::buffers_begin(buf.data()),
-                         boost::asio::buffers_end(buf.data())};
-        buf.consume(buf.size());
+        std::string data = readFrame();
         validateAndPrintDataBufferSize(data, "receiveEmitter");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        Metrics::countReceived(NetworkMessage::Kind::Emitter, data.size() + 1);
         return deserializeEmitter(data);
     } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
         logError("Failed to receive Emitter: " + std::string(e.what()));
         throw;
     }
@@ -318,18 +1020,18 @@ Emitter NetworkImplementation::receiveEmitter() {
     \return A vector of strings containing the received blob data.
 */
 std::vector<std::string> NetworkImplementation::receiveBlob() {
-    std::lock_guard<std::mutex> lock(std::mutex);
+    ANI_TRACE_SPAN("NetworkImplementation::receiveBlob");
+    std::lock_guard<std::mutex> lock(receiveMutex);
     try {
-        boost::asio::streambuf buf;
-        boost::asio::read_until(*socket, buf, '\n');
-        std::string data{boost::asio::buffers_begin(buf.data()),
-                         boost::asio::buffers_end(buf.data())};
-        buf.consume(buf.size());
+        std::string data = readFrame();
         validateAndPrintDataBufferSize(data, "receiveEmitter");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        Metrics::countReceived(NetworkMessage::Kind::Blob, data.size() + 1);
         std::vector<std::string> result;
         result.push_back(data);
         return result;
     } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
         logError("Failed to receive Emitter: " + std::string(e.what()));
         throw;
     }
@@ -341,93 +1043,379 @@ std::vector<std::string> NetworkImplementation::receiveBlob() {
     \return A tuple containing the received PE, Emitter, and map of doubles.
 */
 std::tuple<PE, Emitter, std::map<std::string, double>> NetworkImplementation::receiveComplexBlob() {
-    boost::asio::streambuf buf;
-    boost::asio::read_until(*socket, buf, '\n');
-    std::string data{boost::asio::buffers_begin(buf.data()),
-                     boost::asio::buffers_begin(buf.data()) + buf.size() - 1}; // Remove the trailing newline
-    buf.consume(buf.size()); // Consume the read data
-    std::cout << "RECEIVED COMPLEX BLOB:\n" << data << std::endl;
+    ANI_TRACE_SPAN("NetworkImplementation::receiveComplexBlob");
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    std::string data = readFrame();
+    ANI_LOG_TRACE("NetworkImplementation", "Received complex blob: " + data);
     validateAndPrintDataBufferSize(data, "receiveComplexBlob");
+    MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+    Metrics::countReceived(NetworkMessage::Kind::ComplexBlob, data.size() + 1);
     return deserializeComplexBlob(data);
 }
 
 /*!
-    \fn std::string NetworkImplementation::serializePE(const PE& pe)
-    \brief Serializes a PE object to a JSON string.
-    \param pe The PE object to serialize.
-    \return A JSON string representation of the PE object.
-*/
-std::string NetworkImplementation::serializePE(const PE& pe) {
-    QJsonObject json;
-    json["id"] = QString::fromStdString(pe.id.toStdString());
-    json["type"] = QString::fromStdString(pe.type.toStdString());
-    json["lat"] = pe.lat;
-    json["lon"] = pe.lon;
-    json["altitude"] = pe.altitude;
-    json["speed"] = pe.speed;
-    json["heading"] = pe.heading;
-    json["apd"] = QString::fromStdString(pe.apd.toStdString());
-    json["priority"] = QString::fromStdString(pe.priority.toStdString());
-    json["jam"] = pe.jam;
-    json["ghost"] = pe.ghost;
-    json["category"] = static_cast<int>(pe.category);
-    json["state"] = QString::fromStdString(pe.state.toStdString());
-    QJsonDocument doc(json);
-    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
-}
-
-/*!
-    \fn std::string NetworkImplementation::serializeEmitter(const Emitter& emitter)
-    \brief Serializes an Emitter object to a JSON string.
-    \param emitter The Emitter object to serialize.
-    \return A JSON string representation of the Emitter object.
-*/
-std::string NetworkImplementation::serializeEmitter(const Emitter& emitter) {
-    QJsonObject json;
-    json["id"] = QString::fromStdString(emitter.id.toStdString());
-    json["type"] = QString::fromStdString(emitter.type.toStdString());
-    json["category"] = QString::fromStdString(emitter.category.toStdString());
-    json["lat"] = emitter.lat;
-    json["lon"] = emitter.lon;
-    json["altitude"] = emitter.altitude;
-    json["heading"] = emitter.heading;
-    json["speed"] = emitter.speed;
-    json["freqMin"] = emitter.freqMin;
-    json["freqMax"] = emitter.freqMax;
-    json["active"] = emitter.active;
-    json["eaPriority"] = QString::fromStdString(emitter.eaPriority.toStdString());
-    json["esPriority"] = QString::fromStdString(emitter.esPriority.toStdString());
-    json["jamResponsible"] = emitter.jamResponsible;
-    json["reactiveEligible"] = emitter.reactiveEligible;
-    json["preemptiveEligible"] = emitter.preemptiveEligible;
-    json["consentRequired"] = emitter.consentRequired;
-    json["operatorManaged"] = emitter.operatorManaged;
-    json["jam"] = emitter.jam;
-    json["jamIneffective"] = emitter.jamIneffective;
-    json["jamEffective"] = emitter.jamEffective;
-    QJsonDocument doc(json);
-    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
-}
-
-/*!
-    \fn std::string NetworkImplementation::serializeComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap)
-    \brief Serializes a complex blob containing a PE, an Emitter, and a map of doubles to a JSON string.
-    \param pe The PE object to include in the blob.
-    \param emitter The Emitter object to include in the blob.
-    \param doubleMap A map of string keys to double values to include in the blob.
-    \return A JSON string representation of the complex blob.
+    \fn bool NetworkImplementation::sendPEBatch(const std::vector<PE>& pes)
+    \brief Sends a batch of PE objects as a single frame.
+    \param pes The PE objects to send.
+    \return True if the batch was written successfully, false otherwise.
+
+    The whole batch is validated in one pass by BatchValidation. Invalid
+    entries are dropped and logged; the remaining entries are still sent.
+*/
+bool NetworkImplementation::sendPEBatch(const std::vector<PE>& pes) {
+    ANI_TRACE_SPAN("NetworkImplementation::sendPEBatch");
+    std::lock_guard<std::mutex> lock(sendMutex);
+    std::vector<PE> valid = keepValid(pes, BatchValidation::validatePEs(pes));
+    if (valid.size() != pes.size()) {
+        logError("Dropped " + std::to_string(pes.size() - valid.size()) + " invalid PEs from batch");
+        Metrics::count(MetricCounter::InvalidPEs, pes.size() - valid.size());
+    }
+    try {
+        MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+        std::string data = MessageCodec::encodePEBatch(valid);
+        encodeTimer.stop();
+        writeFrame(data, NetworkMessage::Kind::PEBatch);
+        return true;
+    } catch (const std::exception& e) {
+        logError("Failed to send PE batch: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkImplementation::sendEmitterBatch(const std::vector<Emitter>& emitters)
+    \brief Sends a batch of Emitter objects as a single frame.
+    \param emitters The Emitter objects to send.
+    \return True if the batch was written successfully, false otherwise.
+
+    The whole batch is validated in one pass by BatchValidation. Invalid
+    entries are dropped and logged; the remaining entries are still sent.
+*/
+bool NetworkImplementation::sendEmitterBatch(const std::vector<Emitter>& emitters) {
+    ANI_TRACE_SPAN("NetworkImplementation::sendEmitterBatch");
+    std::lock_guard<std::mutex> lock(sendMutex);
+    std::vector<Emitter> valid = keepValid(emitters, BatchValidation::validateEmitters(emitters));
+    if (valid.size() != emitters.size()) {
+        logError("Dropped " + std::to_string(emitters.size() - valid.size()) + " invalid Emitters from batch");
+        Metrics::count(MetricCounter::InvalidEmitters, emitters.size() - valid.size());
+    }
+    try {
+        MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+        std::string data = MessageCodec::encodeEmitterBatch(valid);
+        encodeTimer.stop();
+        writeFrame(data, NetworkMessage::Kind::EmitterBatch);
+        return true;
+    } catch (const std::exception& e) {
+        logError("Failed to send Emitter batch: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
+        return false;
+    }
+}
+
+/*!
+    \fn std::vector<PE> NetworkImplementation::receivePEBatch()
+    \brief Receives a batch of PE objects sent with sendPEBatch.
+    \return The valid PEs of the batch, in the order they were sent.
+*/
+std::vector<PE> NetworkImplementation::receivePEBatch() {
+    ANI_TRACE_SPAN("NetworkImplementation::receivePEBatch");
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    try {
+        std::string data = readFrame();
+        validateAndPrintDataBufferSize(data, "receivePEBatch");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        Metrics::countReceived(NetworkMessage::Kind::PEBatch, data.size() + 1);
+        std::vector<PE> pes = MessageCodec::decodePEBatch(data);
+        std::vector<PE> valid = keepValid(pes, BatchValidation::validatePEs(pes));
+        if (valid.size() != pes.size()) {
+            logError("Dropped " + std::to_string(pes.size() - valid.size()) + " invalid PEs from received batch");
+            Metrics::count(MetricCounter::InvalidPEs, pes.size() - valid.size());
+        }
+        return valid;
+    } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
+        logError("Failed to receive PE batch: " + std::string(e.what()));
+        throw;
+    }
+}
+
+/*!
+    \fn std::vector<Emitter> NetworkImplementation::receiveEmitterBatch()
+    \brief Receives a batch of Emitter objects sent with sendEmitterBatch.
+    \return The valid Emitters of the batch, in the order they were sent.
+*/
+std::vector<Emitter> NetworkImplementation::receiveEmitterBatch() {
+    ANI_TRACE_SPAN("NetworkImplementation::receiveEmitterBatch");
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    try {
+        std::string data = readFrame();
+        validateAndPrintDataBufferSize(data, "receiveEmitterBatch");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        Metrics::countReceived(NetworkMessage::Kind::EmitterBatch, data.size() + 1);
+        std::vector<Emitter> emitters = MessageCodec::decodeEmitterBatch(data);
+        std::vector<Emitter> valid = keepValid(emitters, BatchValidation::validateEmitters(emitters));
+        if (valid.size() != emitters.size()) {
+            logError("Dropped " + std::to_string(emitters.size() - valid.size()) + " invalid Emitters from received batch");
+            Metrics::count(MetricCounter::InvalidEmitters, emitters.size() - valid.size());
+        }
+        return valid;
+    } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
+        logError("Failed to receive Emitter batch: " + std::string(e.what()));
+        throw;
+    }
+}
+
+/*!
+    \fn bool NetworkImplementation::sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings)
+    \brief Sends many PE and Emitter setting updates as a single frame.
+    \param settings (type, id, setting, value) tuples, with type PE_SETTING or EMITTER_SETTING.
+    \return True if the batch was written successfully, false otherwise.
+
+    Replaces one sendPESetting or sendEmitterSetting call, and one frame, per
+    setting. The batch is meant to be applied as a unit, so if any tuple has an
+    unknown type or an empty id or setting name nothing is sent.
+*/
+bool NetworkImplementation::sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) {
+    ANI_TRACE_SPAN("NetworkImplementation::sendSettingBatch");
+    const auto invalid = std::count_if(settings.begin(), settings.end(), [](const auto& setting) {
+        return !MessageCodec::isValidSetting(setting);
+    });
+    if (invalid > 0) {
+        const auto& setting = *std::find_if_not(settings.begin(), settings.end(), MessageCodec::isValidSetting);
+        logError("Refusing to send setting batch with malformed setting " + std::get<0>(setting) + " "
+                 + std::get<1>(setting) + " " + std::get<2>(setting));
+        Metrics::count(MetricCounter::InvalidSettings, static_cast<std::uint64_t>(invalid));
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(sendMutex);
+    try {
+        MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+        std::string data = MessageCodec::encodeSettingBatch(settings);
+        encodeTimer.stop();
+        writeFrame(data, NetworkMessage::Kind::SettingBatch);
+        return true;
+    } catch (const std::exception& e) {
+        logError("Failed to send setting batch: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
+        return false;
+    }
+}
+
+/*!
+    \fn std::vector<std::tuple<std::string, std::string, std::string, int>> NetworkImplementation::receiveSettingBatch()
+    \brief Receives a batch of setting updates sent with sendSettingBatch.
+    \return The (type, id, setting, value) tuples, in the order they were sent.
+
+    Throws std::runtime_error, having consumed the frame, if any row of the
+    batch is malformed, so a caller never applies part of a batch.
+*/
+std::vector<std::tuple<std::string, std::string, std::string, int>> NetworkImplementation::receiveSettingBatch() {
+    ANI_TRACE_SPAN("NetworkImplementation::receiveSettingBatch");
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    try {
+        std::string data = readFrame();
+        validateAndPrintDataBufferSize(data, "receiveSettingBatch");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        Metrics::countReceived(NetworkMessage::Kind::SettingBatch, data.size() + 1);
+        return MessageCodec::decodeSettingBatch(data);
+    } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
+        logError("Failed to receive setting batch: " + std::string(e.what()));
+        throw;
+    }
+}
+
+/*!
+    \fn bool NetworkImplementation::sendSnapshot(const EntitySnapshot& snapshot)
+    \brief Sends a snapshot of current PEs and Emitters as a single batch frame.
+    \param snapshot The snapshot to send.
+    \return True if the snapshot was sent successfully, false otherwise.
+
+    Used to bring a late joining subscriber up to date in one write instead of
+    resending every entity individually. Entries that fail validation are
+    dropped and logged rather than failing the whole snapshot.
+*/
+bool NetworkImplementation::sendSnapshot(const EntitySnapshot& snapshot) {
+    ANI_TRACE_SPAN("NetworkImplementation::sendSnapshot");
+    std::lock_guard<std::mutex> lock(sendMutex);
+    EntitySnapshot valid;
+    valid.sequence = snapshot.sequence;
+    valid.pes = keepValid(snapshot.pes, BatchValidation::validatePEs(snapshot.pes));
+    valid.emitters = keepValid(snapshot.emitters, BatchValidation::validateEmitters(snapshot.emitters));
+    if (valid.pes.size() != snapshot.pes.size() || valid.emitters.size() != snapshot.emitters.size()) {
+        logError("Dropped " + std::to_string(snapshot.pes.size() - valid.pes.size()) + " invalid PEs and "
+                 + std::to_string(snapshot.emitters.size() - valid.emitters.size()) + " invalid Emitters from snapshot");
+        Metrics::count(MetricCounter::InvalidPEs, snapshot.pes.size() - valid.pes.size());
+        Metrics::count(MetricCounter::InvalidEmitters, snapshot.emitters.size() - valid.emitters.size());
+    }
+    try {
+        MetricsTimer encodeTimer(MetricHistogram::EncodeNs);
+        std::string data = MessageCodec::encodeSnapshot(valid);
+        encodeTimer.stop();
+        writeFrame(data, NetworkMessage::Kind::Snapshot);
+        return true;
+    } catch (const std::exception& e) {
+        logError("Failed to send snapshot: " + std::string(e.what()));
+        Metrics::count(MetricCounter::SendFailures);
+        return false;
+    }
+}
+
+/*!
+    \fn EntitySnapshot NetworkImplementation::receiveSnapshot()
+    \brief Receives a snapshot of current PEs and Emitters.
+    \return The decoded snapshot.
+*/
+EntitySnapshot NetworkImplementation::receiveSnapshot() {
+    ANI_TRACE_SPAN("NetworkImplementation::receiveSnapshot");
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    try {
+        std::string data = readFrame();
+        validateAndPrintDataBufferSize(data, "receiveSnapshot");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        Metrics::countReceived(NetworkMessage::Kind::Snapshot, data.size() + 1);
+        EntitySnapshot snapshot = MessageCodec::decodeSnapshot(data);
+        const std::size_t peCount = snapshot.pes.size();
+        const std::size_t emitterCount = snapshot.emitters.size();
+        snapshot.pes = keepValid(snapshot.pes, BatchValidation::validatePEs(snapshot.pes));
+        snapshot.emitters = keepValid(snapshot.emitters, BatchValidation::validateEmitters(snapshot.emitters));
+        if (snapshot.pes.size() != peCount || snapshot.emitters.size() != emitterCount) {
+            logError("Dropped " + std::to_string(peCount - snapshot.pes.size()) + " invalid PEs and "
+                     + std::to_string(emitterCount - snapshot.emitters.size()) + " invalid Emitters from received snapshot");
+            Metrics::count(MetricCounter::InvalidPEs, peCount - snapshot.pes.size());
+            Metrics::count(MetricCounter::InvalidEmitters, emitterCount - snapshot.emitters.size());
+        }
+        return snapshot;
+    } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
+        logError("Failed to receive snapshot: " + std::string(e.what()));
+        throw;
+    }
+}
+
+/*!
+    \fn NetworkMessage NetworkImplementation::receiveMessage()
+    \brief Receives the next message, whatever kind it is.
+    \return The decoded message, with its kind set and the matching fields filled.
+
+    Used by continuous receive loops that cannot know in advance which kind of
+    message arrives next. The frame is decoded by decodeMessage().
 */
-std::string NetworkImplementation::serializeComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) {
-    QJsonObject json;
-    json["pe"] = QJsonObject{{"data", QString::fromStdString(serializePE(pe))}};
-    json["emitter"] = QJsonObject{{"data", QString::fromStdString(serializeEmitter(emitter))}};
-    QJsonObject mapJson;
-    for (const auto& pair : doubleMap) {
-        mapJson[QString::fromStdString(pair.first)] = pair.second;
+NetworkMessage NetworkImplementation::receiveMessage() {
+    ANI_TRACE_SPAN("NetworkImplementation::receiveMessage");
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    try {
+        std::string data = readFrame();
+        validateAndPrintDataBufferSize(data, "receiveMessage");
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        NetworkMessage message = decodeMessage(data);
+        Metrics::countReceived(message.kind, data.size() + 1);
+        return message;
+    } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
+        logError("Failed to receive message: " + std::string(e.what()));
+        throw;
     }
-    json["doubleMap"] = mapJson;
-    QJsonDocument doc(json);
-    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn std::string NetworkImplementation::receiveFrame()
+    \brief Receives the next frame without decoding it.
+    \return The frame, without its trailing newline.
+
+    Pass the frame to decodeMessage() to get what receiveMessage() would have
+    returned. This lets the decoding happen on another thread. Throws
+    boost::system::system_error if the read fails.
+*/
+std::string NetworkImplementation::receiveFrame() {
+    ANI_TRACE_SPAN("NetworkImplementation::receiveFrame");
+    std::lock_guard<std::mutex> lock(receiveMutex);
+    try {
+        std::string data = readFrame();
+        validateAndPrintDataBufferSize(data, "receiveFrame");
+        return data;
+    } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
+        logError("Failed to receive frame: " + std::string(e.what()));
+        throw;
+    }
+}
+
+/*!
+    \fn NetworkMessage NetworkImplementation::decodeMessage(const std::string& data)
+    \brief Decodes one frame of any kind.
+    \param data The frame, without its trailing newline.
+    \return The decoded message, with its kind set and the matching fields filled.
+
+    Batches and snapshots are validated the same way as by their dedicated
+    receive functions. Frames that are not a known message are returned
+    unchanged as a Blob. Throws std::runtime_error if a PE, Emitter, complex
+    blob or setting batch frame is malformed or invalid.
+*/
+NetworkMessage NetworkImplementation::decodeMessage(const std::string& data) {
+    NetworkMessage message;
+    message.kind = MessageCodec::classify(data);
+    switch (message.kind) {
+    case NetworkMessage::Kind::PE:
+        message.pes.push_back(deserializePE(data));
+        break;
+    case NetworkMessage::Kind::Emitter:
+        message.emitters.push_back(deserializeEmitter(data));
+        break;
+    case NetworkMessage::Kind::Setting: {
+        QJsonObject json = QJsonDocument::fromJson(QByteArray::fromStdString(data)).object();
+        message.setting = std::make_tuple(json["type"].toString().toStdString(), json["id"].toString().toStdString(),
+                                          json["setting"].toString().toStdString(), json["value"].toInt());
+        break;
+    }
+    case NetworkMessage::Kind::ComplexBlob: {
+        auto [pe, emitter, doubleMap] = deserializeComplexBlob(data);
+        message.pes.push_back(pe);
+        message.emitters.push_back(emitter);
+        message.doubleMap = doubleMap;
+        break;
+    }
+    case NetworkMessage::Kind::PEBatch: {
+        std::vector<PE> pes = MessageCodec::decodePEBatch(data);
+        message.pes = keepValid(pes, BatchValidation::validatePEs(pes));
+        if (message.pes.size() != pes.size()) {
+            logError("Dropped " + std::to_string(pes.size() - message.pes.size()) + " invalid PEs from received batch");
+            Metrics::count(MetricCounter::InvalidPEs, pes.size() - message.pes.size());
+        }
+        break;
+    }
+    case NetworkMessage::Kind::EmitterBatch: {
+        std::vector<Emitter> emitters = MessageCodec::decodeEmitterBatch(data);
+        message.emitters = keepValid(emitters, BatchValidation::validateEmitters(emitters));
+        if (message.emitters.size() != emitters.size()) {
+            logError("Dropped " + std::to_string(emitters.size() - message.emitters.size()) + " invalid Emitters from received batch");
+            Metrics::count(MetricCounter::InvalidEmitters, emitters.size() - message.emitters.size());
+        }
+        break;
+    }
+    case NetworkMessage::Kind::SettingBatch:
+        message.settings = MessageCodec::decodeSettingBatch(data);
+        break;
+    case NetworkMessage::Kind::Snapshot: {
+        EntitySnapshot snapshot = MessageCodec::decodeSnapshot(data);
+        message.sequence = snapshot.sequence;
+        message.pes = keepValid(snapshot.pes, BatchValidation::validatePEs(snapshot.pes));
+        message.emitters = keepValid(snapshot.emitters, BatchValidation::validateEmitters(snapshot.emitters));
+        if (message.pes.size() != snapshot.pes.size() || message.emitters.size() != snapshot.emitters.size()) {
+            logError("Dropped " + std::to_string(snapshot.pes.size() - message.pes.size()) + " invalid PEs and "
+                     + std::to_string(snapshot.emitters.size() - message.emitters.size()) + " invalid Emitters from received snapshot");
+            Metrics::count(MetricCounter::InvalidPEs, snapshot.pes.size() - message.pes.size());
+            Metrics::count(MetricCounter::InvalidEmitters, snapshot.emitters.size() - message.emitters.size());
+        }
+        break;
+    }
+    case NetworkMessage::Kind::Blob:
+        message.blob = data;
+        break;
+    }
+    return message;
 }
 
 /*!
@@ -437,10 +1425,11 @@ std::string NetworkImplementation::serializeComplexBlob(const PE& pe, const Emit
     \return A PE object created from the JSON data.
 */
 PE NetworkImplementation::deserializePE(const std::string& data) {
+    ANI_TRACE_SPAN("NetworkImplementation::deserializePE");
     QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
     if (doc.isNull()) {
         logError("Invalid JSON data for PE deserialization");
-        throw;
+        throw std::runtime_error("Invalid JSON data for PE deserialization");
     }
     QJsonObject json = doc.object();
 
@@ -449,30 +1438,16 @@ PE NetworkImplementation::deserializePE(const std::string& data) {
     for(auto& field : requiredFields) {
         if(!json.contains(field)){
             logError("JSON does not contain required field " + field.toStdString());
-            throw;
+            throw std::runtime_error("JSON does not contain required field " + field.toStdString());
         }
     }
 
-    PE pe(
-        json["id"].toString(),
-        json["type"].toString(),
-        json["lat"].toDouble(),
-        json["lon"].toDouble(),
-        json["altitude"].toDouble(),
-        json["speed"].toDouble(),
-        json["apd"].toString(),
-        json["priority"].toString(),
-        json["jam"].toBool(),
-        json["ghost"].toBool()
-    );
-    pe.heading = json["heading"].toDouble();
-    pe.category = static_cast<PE::PECategory>(json["category"].toInt());
-    pe.state = json["state"].toString();
+    PE pe = MessageCodec::peFromJson(json);
 
     if (validatePE(pe)) return pe;
     else {
         logError("Invalid PE object deserialized");
-        throw;
+        throw std::runtime_error("Invalid PE object deserialized");
     }
 }
 
@@ -483,10 +1458,11 @@ PE NetworkImplementation::deserializePE(const std::string& data) {
     \return An Emitter object created from the JSON data.
 */
 Emitter NetworkImplementation::deserializeEmitter(const std::string& data) {
+    ANI_TRACE_SPAN("NetworkImplementation::deserializeEmitter");
     QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
     if (doc.isNull()) {
-        logError("Invalid JSON data for PE deserialization");
-        throw;
+        logError("Invalid JSON data for Emitter deserialization");
+        throw std::runtime_error("Invalid JSON data for Emitter deserialization");
     }
     QJsonObject json = doc.object();
 
@@ -495,38 +1471,16 @@ Emitter NetworkImplementation::deserializeEmitter(const std::string& data) {
     for(auto& field : requiredFields) {
         if(!json.contains(field)){
             logError("JSON does not contain required field " + field.toStdString());
-            throw;
+            throw std::runtime_error("JSON does not contain required field " + field.toStdString());
         }
     }
 
-    Emitter emitter(
-        json["id"].toString(),
-        json["type"].toString(),
-        json["category"].toString(),
-        json["lat"].toDouble(),
-        json["lon"].toDouble(),
-        json["freqMin"].toDouble(),
-        json["freqMax"].toDouble(),
-        json["active"].toBool(),
-        json["eaPriority"].toString(),
-        json["esPriority"].toString(),
-        json["jamResponsible"].toBool(),
-        json["reactiveEligible"].toBool(),
-        json["preemptiveEligible"].toBool(),
-        json["consentRequired"].toBool(),
-        json["jam"].toBool()
-    );
-    emitter.altitude = json["altitude"].toDouble();
-    emitter.heading = json["heading"].toDouble();
-    emitter.speed = json["speed"].toDouble();
-    emitter.operatorManaged = json["operatorManaged"].toBool();
-    emitter.jamIneffective = json["jamIneffective"].toInt();
-    emitter.jamEffective = json["jamEffective"].toInt();
+    Emitter emitter = MessageCodec::emitterFromJson(json);
 
     if (validateEmitter(emitter)) return emitter;
     else {
         logError("Invalid Emitter object deserialized");
-        throw;
+        throw std::runtime_error("Invalid Emitter object deserialized");
     }
 }
 
@@ -537,6 +1491,7 @@ Emitter NetworkImplementation::deserializeEmitter(const std::string& data) {
     \return A tuple containing a PE object, an Emitter object, and a map of string keys to double values.
 */
 std::tuple<PE, Emitter, std::map<std::string, double>> NetworkImplementation::deserializeComplexBlob(const std::string& data) {
+    ANI_TRACE_SPAN("NetworkImplementation::deserializeComplexBlob");
     QJsonDocument doc = QJsonDocument::fromJson(QString::fromStdString(data).toUtf8());
     QJsonObject json = doc.object();
 
@@ -2,11 +2,20 @@
 
 #include <vector>
 #include <boost/asio.hpp>
+#include <functional>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <optional>
+#include <string_view>
 #include <tuple>
 #include "pe.h"
 #include "emitter.h"
+#include "MessageCodec.h"
+#include "DeadReckoning.h"
+#include "FrameCompression.h"
+#include "TrafficCapture.h"
+#include "UpdateScheduler.h"
 
 #ifndef ABSTRACTNETWORKINTERFACE_H
 #define ABSTRACTNETWORKINTERFACE_H
@@ -38,12 +47,38 @@ public:
     virtual std::vector<std::string> receiveBlob() = 0;
     // Receive complex blob (PE, Emitter, and map of doubles)
     virtual std::tuple<PE, Emitter, std::map<std::string, double>> receiveComplexBlob() = 0;
+    // Send a batch of PEs in one frame, invalid entries are dropped
+    virtual bool sendPEBatch(const std::vector<PE>& pes) = 0;
+    // Send a batch of Emitters in one frame, invalid entries are dropped
+    virtual bool sendEmitterBatch(const std::vector<Emitter>& emitters) = 0;
+    // Receive a batch of PEs, invalid entries are dropped
+    virtual std::vector<PE> receivePEBatch() = 0;
+    // Receive a batch of Emitters, invalid entries are dropped
+    virtual std::vector<Emitter> receiveEmitterBatch() = 0;
+    // Send many PE and Emitter settings in one frame, as (type, id, setting, value) tuples like those
+    // receiveSetting returns. Nothing is sent if any tuple is malformed.
+    virtual bool sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) = 0;
+    // Receive a batch of settings, which is decoded whole or not at all
+    virtual std::vector<std::tuple<std::string, std::string, std::string, int>> receiveSettingBatch() = 0;
+    // Send a snapshot of all current PEs and Emitters in one frame
+    virtual bool sendSnapshot(const EntitySnapshot& snapshot) = 0;
+    // Receive a snapshot of all current PEs and Emitters
+    virtual EntitySnapshot receiveSnapshot() = 0;
+    // Receive the next message whatever its kind, for continuous receive loops
+    virtual NetworkMessage receiveMessage() = 0;
+    // Write updates held back by update scheduling that are now due, for callers with nothing else to send
+    virtual bool flushDeferredUpdates() { return true; }
     // Close the connection
     virtual void close() = 0;
 };
 
 class NetworkImplementation : public AbstractNetworkInterface {
 public:
+    // Default chunk size for receiveBlobStream()
+    static constexpr std::size_t kBlobChunkBytes = 65536;
+    // Largest streamed blob that receiveBlob() and the other whole-frame receives will collect
+    static constexpr std::uint64_t kMaxCollectedBlob = 256ull << 20;
+
     NetworkImplementation();
     ~NetworkImplementation() override = default;
     boost::asio::ip::tcp::socket* getSocket();
@@ -59,21 +94,108 @@ public:
     Emitter receiveEmitter() override;
     std::vector<std::string> receiveBlob() override;
     std::tuple<PE, Emitter, std::map<std::string, double>> receiveComplexBlob() override;
-    void validateAndPrintDataBufferSize(std::string dataBuff, std::string funcName);
+    bool sendPEBatch(const std::vector<PE>& pes) override;
+    bool sendEmitterBatch(const std::vector<Emitter>& emitters) override;
+    std::vector<PE> receivePEBatch() override;
+    std::vector<Emitter> receiveEmitterBatch() override;
+    bool sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) override;
+    std::vector<std::tuple<std::string, std::string, std::string, int>> receiveSettingBatch() override;
+    bool sendSnapshot(const EntitySnapshot& snapshot) override;
+    EntitySnapshot receiveSnapshot() override;
+    NetworkMessage receiveMessage() override;
+    // Send one blob gathered from caller-owned buffers without copying them. It may hold any bytes,
+    // newlines included, and is received whole by receiveBlob() or in chunks by receiveBlobStream().
+    bool sendBlobStream(const std::vector<boost::asio::const_buffer>& parts);
+    // Receive the next blob as views of at most chunkBytes, each valid only during its consumer call,
+    // so memory use does not grow with the blob. Returns the blob's length.
+    std::uint64_t receiveBlobStream(const std::function<void(std::string_view)>& consumer,
+                                    std::size_t chunkBytes = kBlobChunkBytes);
+    // Read the next frame, without its newline, and leave decoding to the caller, as DecodePipeline does
+    std::string receiveFrame();
+    // Decode a frame of any kind as receiveMessage() would, throws on malformed PEs, Emitters and complex blobs
+    static NetworkMessage decodeMessage(const std::string& data);
+    void validateAndPrintDataBufferSize(const std::string& dataBuff, const char* funcName);
+    // The checks sendPE and sendEmitter apply before writing, for callers that must reject bad input first
+    static bool validatePE(const PE& pe);
+    static bool validateEmitter(const Emitter& emitter);
+    // Only send PE/Emitter updates that the receiver cannot extrapolate from speed and heading
+    void enableDeadReckoning(const DeadReckoningConfig& config);
+    void disableDeadReckoning();
+    // Once writes show the link is saturated, give each entity a share of it weighted by priority and
+    // rate of change, deferring sendPE and sendEmitter updates from entities over their budget
+    void enableUpdateScheduling(const UpdateSchedulerConfig& config = UpdateSchedulerConfig());
+    void disableUpdateScheduling();
+    bool flushDeferredUpdates() override;
+    // Compress batch and snapshot frames against dictionary. The receiver is told which dictionary
+    // in a hello frame, and can decompress with the standard dictionary or the one it compresses with.
+    // Frames stay uncompressed until this end has received the receiver's acknowledgement of it.
+    void enableCompression(std::shared_ptr<const FrameDictionary> dictionary = FrameDictionary::standard());
+    void disableCompression();
+    // Record every frame read from the socket, with its receive time, nullptr to stop
+    void setCapture(std::shared_ptr<TrafficCapture> capture);
     void close() override;
 
+protected:
+    // Transport hooks, TCP by default. Read one frame without its newline, or write one frame
+    // including it, throwing boost::system::system_error once the link is closed or broken.
+    // Called with receiveMutex or sendMutex held respectively.
+    virtual std::string readTransportFrame();
+    virtual void writeTransportFrame(const std::string& data);
+    // The same for a frame gathered from parts, the last of which ends with the newline
+    virtual void writeTransportFrame(const std::vector<boost::asio::const_buffer>& parts);
+    // The raw bytes of a blob stream, which follow its header frame. Reads block until at least one
+    // byte is available and return how many were copied to destination.
+    virtual void writeTransportBytes(const std::vector<boost::asio::const_buffer>& parts);
+    virtual std::size_t readTransportBytes(char* destination, std::size_t size);
+
 private:
-    std::string serializePE(const PE& pe);
-    std::string serializeEmitter(const Emitter& emitter);
-    std::string serializeComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap);
-    PE deserializePE(const std::string& data);
-    Emitter deserializeEmitter(const std::string& data);
-    std::tuple<PE, Emitter, std::map<std::string, double>> deserializeComplexBlob(const std::string& data);
+    std::string readFrame();
+    std::string nextFrame();
+    void readBlobStream(std::uint64_t length, std::size_t chunkBytes, const std::function<void(std::string_view)>& consumer);
+    void writeFrame(const std::string& data, NetworkMessage::Kind kind);
+    void writeBlobStream(const std::vector<boost::asio::const_buffer>& parts);
+    // Blobs that must go out as a stream, as one frame would be misread
+    static bool needsBlobStream(const std::string& blob);
+    void reportWrite(std::size_t bytes, DeadReckoning::Clock::time_point startedAt);
+    bool flushDeferredLocked(DeadReckoning::Clock::time_point now);
+    void announceCompression();
+    bool compressionAcknowledged();
+    void acceptHello(std::uint32_t dictionaryId);
+    void acceptHelloAck(std::uint32_t dictionaryId);
+    void sendPendingAck();
+    static PE deserializePE(const std::string& data);
+    static Emitter deserializeEmitter(const std::string& data);
+    static std::tuple<PE, Emitter, std::map<std::string, double>> deserializeComplexBlob(const std::string& data);
     boost::asio::io_context io_context;
     std::unique_ptr<boost::asio::ip::tcp::socket> socket;
-    bool validatePE(const PE& pe);
-    bool validateEmitter(const Emitter& emitter);
-    void logError(const std::string& message);
+    // Bytes read past the end of the last frame are kept here for the next receive
+    boost::asio::streambuf readBuffer;
+    std::unique_ptr<DeadReckoningSender> deadReckoning;
+    // Guarded by sendMutex, consulted after dead reckoning and told about every write
+    std::unique_ptr<UpdateScheduler> scheduler;
+    // Guarded by sendMutex, the hello goes out before the first compressed frame
+    std::shared_ptr<const FrameDictionary> compression;
+    bool compressionAnnounced = false;
+    // Guarded by receiveMutex, the dictionary named by the peer's hello, null if it was unknown
+    bool peerCompresses = false;
+    std::shared_ptr<const FrameDictionary> peerDictionary;
+    // The dictionary this end compresses with, which it also accepts from the peer. Has its own
+    // lock so enabling compression never waits on a blocked receive.
+    std::mutex dictionaryMutex;
+    std::shared_ptr<const FrameDictionary> ownDictionary;
+    // Guarded by dictionaryMutex. The dictionary the peer acknowledged on this connection, and the
+    // acknowledgement of the peer's hello waiting for the next write.
+    std::optional<std::uint32_t> acknowledgedDictionary;
+    std::optional<std::uint32_t> pendingAck;
+    // Guarded by receiveMutex
+    std::shared_ptr<TrafficCapture> capture;
+    // Writers and readers are serialised separately, so one thread can send while another receives
+    std::mutex sendMutex;
+    std::mutex receiveMutex;
+    // Guards only whether the socket has been shut down, so close() never waits on a blocked send or receive
+    std::mutex stateMutex;
+    bool shutDown = false;
+    static void logError(const std::string& message);
 };
 
 #endif // ABSTRACTNETWORKINTERFACE_H
@@ -0,0 +1,650 @@
+#include <benchmark/benchmark.h>
+#include "AbstractNetworkInterface.h"
+#include "FrameCompression.h"
+#include "InMemoryNetworkInterface.h"
+#include "MessageCodec.h"
+#include <QJsonDocument>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Heap allocations made by the current thread, so helper threads do not skew allocs/op.
+// On glibc malloc itself is wrapped, which also catches Qt containers that bypass operator new.
+namespace {
+thread_local std::uint64_t threadAllocations = 0;
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(std::size_t size) noexcept;
+void* __libc_calloc(std::size_t count, std::size_t size) noexcept;
+void* __libc_realloc(void* pointer, std::size_t size) noexcept;
+
+void* malloc(std::size_t size) noexcept {
+    ++threadAllocations;
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size) noexcept {
+    ++threadAllocations;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, std::size_t size) noexcept {
+    ++threadAllocations;
+    return __libc_realloc(pointer, size);
+}
+}
+#else
+void* operator new(std::size_t size) {
+    ++threadAllocations;
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+#endif
+
+namespace {
+
+PE makePE(int i) {
+    std::string id = "BenchPE" + std::to_string(i);
+    PE pe(id.c_str(), "F18", 10.0 + i * 0.001, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+    pe.heading = 90.0;
+    return pe;
+}
+
+Emitter makeEmitter(int i) {
+    std::string id = "BenchEmitter" + std::to_string(i);
+    return Emitter(id.c_str(), "RadarType", "Category", 15.0 + i * 0.001, 25.0, 8000.0, 12000.0, true);
+}
+
+std::map<std::string, double> makeDoubleMap() {
+    return {{"range", 1250.5}, {"bearing", 45.0}, {"closure", -320.25}, {"confidence", 0.92}};
+}
+
+// Reports the standard counters: bytes/op and allocs/op averaged over
+// iterations, and msgs/s as a rate over the measured time
+class Counters {
+public:
+    explicit Counters(benchmark::State& state) : state(state), startAllocations(threadAllocations) {}
+    ~Counters() {
+        const double allocations = static_cast<double>(threadAllocations - startAllocations);
+        state.counters["allocs/op"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+        state.counters["bytes/op"] = benchmark::Counter(static_cast<double>(bytes), benchmark::Counter::kAvgIterations);
+        state.counters["msgs/s"] = benchmark::Counter(static_cast<double>(messages), benchmark::Counter::kIsRate);
+        state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+        state.SetItemsProcessed(static_cast<std::int64_t>(messages));
+    }
+    void add(std::size_t frameBytes, std::size_t frameMessages = 1) {
+        bytes += frameBytes;
+        messages += frameMessages;
+    }
+
+private:
+    benchmark::State& state;
+    std::uint64_t startAllocations;
+    std::uint64_t bytes = 0;
+    std::uint64_t messages = 0;
+};
+
+// Two NetworkImplementations connected over 127.0.0.1 on an ephemeral port
+struct LoopbackPair {
+    NetworkImplementation client;
+    NetworkImplementation server;
+    LoopbackPair() {
+        boost::asio::io_context io_context;
+        boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        // The connect completes against the listen backlog, so no accept thread is needed
+        client.initialise("127.0.0.1", acceptor.local_endpoint().port());
+        acceptor.accept(*server.getSocket());
+        client.getSocket()->set_option(boost::asio::ip::tcp::no_delay(true));
+        server.getSocket()->set_option(boost::asio::ip::tcp::no_delay(true));
+    }
+    ~LoopbackPair() {
+        client.close();
+        server.close();
+    }
+};
+
+// Discards everything arriving at the server end, so client writes never block on a full socket
+class Drain {
+public:
+    explicit Drain(LoopbackPair& pair) : pair(pair), thread([&pair]() {
+        char buffer[65536];
+        boost::system::error_code ec;
+        while (!ec) {
+            pair.server.getSocket()->read_some(boost::asio::buffer(buffer), ec);
+        }
+    }) {}
+    ~Drain() {
+        pair.client.close();
+        thread.join();
+    }
+
+private:
+    LoopbackPair& pair;
+    std::thread thread;
+};
+
+// Keeps writing the same pre-encoded frames to the client end until the pair is closed
+class Feed {
+public:
+    Feed(LoopbackPair& pair, std::string frame) : frames(std::move(frame)), pair(pair) {
+        // Repeat small frames so each write hands the kernel a useful amount of data
+        while (frames.size() < 16384) {
+            frames += frames;
+        }
+        thread = std::thread([this]() {
+            boost::system::error_code ec;
+            while (!ec) {
+                boost::asio::write(*this->pair.client.getSocket(), boost::asio::buffer(frames), ec);
+            }
+        });
+    }
+    ~Feed() {
+        pair.server.close();
+        thread.join();
+    }
+
+private:
+    std::string frames;
+    LoopbackPair& pair;
+    std::thread thread;
+};
+
+// Encode and decode, no I/O
+
+void BM_EncodePE(benchmark::State& state) {
+    const PE pe = makePE(0);
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string frame = MessageCodec::encodePE(pe);
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_EncodePE);
+
+void BM_DecodePE(benchmark::State& state) {
+    const std::string frame = MessageCodec::encodePE(makePE(0));
+    Counters counters(state);
+    for (auto _ : state) {
+        PE pe = MessageCodec::peFromJson(QJsonDocument::fromJson(QByteArray::fromStdString(frame)).object());
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(pe);
+    }
+}
+BENCHMARK(BM_DecodePE);
+
+void BM_EncodeEmitter(benchmark::State& state) {
+    const Emitter emitter = makeEmitter(0);
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string frame = MessageCodec::encodeEmitter(emitter);
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_EncodeEmitter);
+
+void BM_DecodeEmitter(benchmark::State& state) {
+    const std::string frame = MessageCodec::encodeEmitter(makeEmitter(0));
+    Counters counters(state);
+    for (auto _ : state) {
+        Emitter emitter = MessageCodec::emitterFromJson(QJsonDocument::fromJson(QByteArray::fromStdString(frame)).object());
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(emitter);
+    }
+}
+BENCHMARK(BM_DecodeEmitter);
+
+void BM_EncodeSetting(benchmark::State& state) {
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string frame = MessageCodec::encodeSetting("PE_SETTING", "JAM", "BenchPE0", 1);
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_EncodeSetting);
+
+void BM_EncodeComplexBlob(benchmark::State& state) {
+    const PE pe = makePE(0);
+    const Emitter emitter = makeEmitter(0);
+    const std::map<std::string, double> doubleMap = makeDoubleMap();
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string frame = MessageCodec::encodeComplexBlob(pe, emitter, doubleMap);
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_EncodeComplexBlob);
+
+void BM_Classify(benchmark::State& state) {
+    const std::string frame = MessageCodec::encodeEmitter(makeEmitter(0));
+    Counters counters(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MessageCodec::classify(frame));
+        counters.add(frame.size());
+    }
+}
+BENCHMARK(BM_Classify);
+
+void BM_EncodePEBatch(benchmark::State& state) {
+    std::vector<PE> pes;
+    for (int i = 0; i < state.range(0); ++i) {
+        pes.push_back(makePE(i));
+    }
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string frame = MessageCodec::encodePEBatch(pes);
+        counters.add(frame.size(), pes.size());
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_EncodePEBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_DecodePEBatch(benchmark::State& state) {
+    std::vector<PE> pes;
+    for (int i = 0; i < state.range(0); ++i) {
+        pes.push_back(makePE(i));
+    }
+    const std::string frame = MessageCodec::encodePEBatch(pes);
+    Counters counters(state);
+    for (auto _ : state) {
+        std::vector<PE> decoded = MessageCodec::decodePEBatch(frame);
+        counters.add(frame.size(), decoded.size());
+        benchmark::DoNotOptimize(decoded);
+    }
+}
+BENCHMARK(BM_DecodePEBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_EncodeEmitterBatch(benchmark::State& state) {
+    std::vector<Emitter> emitters;
+    for (int i = 0; i < state.range(0); ++i) {
+        emitters.push_back(makeEmitter(i));
+    }
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string frame = MessageCodec::encodeEmitterBatch(emitters);
+        counters.add(frame.size(), emitters.size());
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_EncodeEmitterBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_DecodeEmitterBatch(benchmark::State& state) {
+    std::vector<Emitter> emitters;
+    for (int i = 0; i < state.range(0); ++i) {
+        emitters.push_back(makeEmitter(i));
+    }
+    const std::string frame = MessageCodec::encodeEmitterBatch(emitters);
+    Counters counters(state);
+    for (auto _ : state) {
+        std::vector<Emitter> decoded = MessageCodec::decodeEmitterBatch(frame);
+        counters.add(frame.size(), decoded.size());
+        benchmark::DoNotOptimize(decoded);
+    }
+}
+BENCHMARK(BM_DecodeEmitterBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+// Dictionary compression of batch frames, CPU cost per frame and ratio of compressed to original bytes
+
+void BM_CompressPEBatch(benchmark::State& state) {
+    std::vector<PE> pes;
+    for (int i = 0; i < state.range(0); ++i) {
+        pes.push_back(makePE(i));
+    }
+    std::string frame = MessageCodec::encodePEBatch(pes);
+    frame.pop_back();
+    const auto dictionary = FrameDictionary::standard();
+    std::size_t compressedBytes = 0;
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string compressed = FrameCompression::compress(frame, *dictionary);
+        compressedBytes = compressed.size();
+        counters.add(frame.size(), pes.size());
+        benchmark::DoNotOptimize(compressed);
+    }
+    state.counters["ratio"] = static_cast<double>(compressedBytes) / frame.size();
+}
+BENCHMARK(BM_CompressPEBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_DecompressPEBatch(benchmark::State& state) {
+    std::vector<PE> pes;
+    for (int i = 0; i < state.range(0); ++i) {
+        pes.push_back(makePE(i));
+    }
+    std::string frame = MessageCodec::encodePEBatch(pes);
+    frame.pop_back();
+    const auto dictionary = FrameDictionary::standard();
+    const std::string compressed = FrameCompression::compress(frame, *dictionary);
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string decompressed = FrameCompression::decompress(compressed, *dictionary);
+        counters.add(frame.size(), pes.size());
+        benchmark::DoNotOptimize(decompressed);
+    }
+    state.counters["ratio"] = static_cast<double>(compressed.size()) / frame.size();
+}
+BENCHMARK(BM_DecompressPEBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_CompressEmitterBatch(benchmark::State& state) {
+    std::vector<Emitter> emitters;
+    for (int i = 0; i < state.range(0); ++i) {
+        emitters.push_back(makeEmitter(i));
+    }
+    std::string frame = MessageCodec::encodeEmitterBatch(emitters);
+    frame.pop_back();
+    const auto dictionary = FrameDictionary::standard();
+    std::size_t compressedBytes = 0;
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string compressed = FrameCompression::compress(frame, *dictionary);
+        compressedBytes = compressed.size();
+        counters.add(frame.size(), emitters.size());
+        benchmark::DoNotOptimize(compressed);
+    }
+    state.counters["ratio"] = static_cast<double>(compressedBytes) / frame.size();
+}
+BENCHMARK(BM_CompressEmitterBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+void BM_DecompressEmitterBatch(benchmark::State& state) {
+    std::vector<Emitter> emitters;
+    for (int i = 0; i < state.range(0); ++i) {
+        emitters.push_back(makeEmitter(i));
+    }
+    std::string frame = MessageCodec::encodeEmitterBatch(emitters);
+    frame.pop_back();
+    const auto dictionary = FrameDictionary::standard();
+    const std::string compressed = FrameCompression::compress(frame, *dictionary);
+    Counters counters(state);
+    for (auto _ : state) {
+        std::string decompressed = FrameCompression::decompress(compressed, *dictionary);
+        counters.add(frame.size(), emitters.size());
+        benchmark::DoNotOptimize(decompressed);
+    }
+    state.counters["ratio"] = static_cast<double>(compressed.size()) / frame.size();
+}
+BENCHMARK(BM_DecompressEmitterBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+// Framed reads, the receive path including framing, parsing and validation
+
+void BM_ReadPE(benchmark::State& state) {
+    LoopbackPair pair;
+    const std::string frame = MessageCodec::encodePE(makePE(0));
+    Feed feed(pair, frame);
+    Counters counters(state);
+    for (auto _ : state) {
+        PE pe = pair.server.receivePE();
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(pe);
+    }
+}
+BENCHMARK(BM_ReadPE)->UseRealTime();
+
+void BM_ReadEmitter(benchmark::State& state) {
+    LoopbackPair pair;
+    const std::string frame = MessageCodec::encodeEmitter(makeEmitter(0));
+    Feed feed(pair, frame);
+    Counters counters(state);
+    for (auto _ : state) {
+        Emitter emitter = pair.server.receiveEmitter();
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(emitter);
+    }
+}
+BENCHMARK(BM_ReadEmitter)->UseRealTime();
+
+void BM_ReadSetting(benchmark::State& state) {
+    LoopbackPair pair;
+    const std::string frame = MessageCodec::encodeSetting("PE_SETTING", "JAM", "BenchPE0", 1);
+    Feed feed(pair, frame);
+    Counters counters(state);
+    for (auto _ : state) {
+        auto setting = pair.server.receiveSetting();
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(setting);
+    }
+}
+BENCHMARK(BM_ReadSetting)->UseRealTime();
+
+void BM_ReadComplexBlob(benchmark::State& state) {
+    LoopbackPair pair;
+    const std::string frame = MessageCodec::encodeComplexBlob(makePE(0), makeEmitter(0), makeDoubleMap());
+    Feed feed(pair, frame);
+    Counters counters(state);
+    for (auto _ : state) {
+        auto blob = pair.server.receiveComplexBlob();
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(blob);
+    }
+}
+BENCHMARK(BM_ReadComplexBlob)->UseRealTime();
+
+void BM_ReadMessage(benchmark::State& state) {
+    LoopbackPair pair;
+    const std::string frame = MessageCodec::encodePE(makePE(0));
+    Feed feed(pair, frame);
+    Counters counters(state);
+    for (auto _ : state) {
+        NetworkMessage message = pair.server.receiveMessage();
+        counters.add(frame.size());
+        benchmark::DoNotOptimize(message);
+    }
+}
+BENCHMARK(BM_ReadMessage)->UseRealTime();
+
+// Writes, the send path including validation and encoding, into a drained socket
+
+void BM_WritePE(benchmark::State& state) {
+    LoopbackPair pair;
+    Drain drain(pair);
+    const PE pe = makePE(0);
+    const std::size_t frameBytes = MessageCodec::encodePE(pe).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pair.client.sendPE(pe));
+        counters.add(frameBytes);
+    }
+}
+BENCHMARK(BM_WritePE)->UseRealTime();
+
+void BM_WriteComplexBlob(benchmark::State& state) {
+    LoopbackPair pair;
+    Drain drain(pair);
+    const PE pe = makePE(0);
+    const Emitter emitter = makeEmitter(0);
+    const std::map<std::string, double> doubleMap = makeDoubleMap();
+    const std::size_t frameBytes = MessageCodec::encodeComplexBlob(pe, emitter, doubleMap).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pair.client.sendComplexBlob(pe, emitter, doubleMap));
+        counters.add(frameBytes);
+    }
+}
+BENCHMARK(BM_WriteComplexBlob)->UseRealTime();
+
+void BM_WritePEBatch(benchmark::State& state) {
+    LoopbackPair pair;
+    Drain drain(pair);
+    std::vector<PE> pes;
+    for (int i = 0; i < state.range(0); ++i) {
+        pes.push_back(makePE(i));
+    }
+    const std::size_t frameBytes = MessageCodec::encodePEBatch(pes).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pair.client.sendPEBatch(pes));
+        counters.add(frameBytes, pes.size());
+    }
+}
+BENCHMARK(BM_WritePEBatch)->Arg(16)->Arg(256)->Arg(4096)->UseRealTime();
+
+void BM_WriteEmitterBatch(benchmark::State& state) {
+    LoopbackPair pair;
+    Drain drain(pair);
+    std::vector<Emitter> emitters;
+    for (int i = 0; i < state.range(0); ++i) {
+        emitters.push_back(makeEmitter(i));
+    }
+    const std::size_t frameBytes = MessageCodec::encodeEmitterBatch(emitters).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pair.client.sendEmitterBatch(emitters));
+        counters.add(frameBytes, emitters.size());
+    }
+}
+BENCHMARK(BM_WriteEmitterBatch)->Arg(16)->Arg(256)->Arg(4096)->UseRealTime();
+
+// Loopback round trips, one message there and back per iteration
+
+void BM_RoundTripPE(benchmark::State& state) {
+    LoopbackPair pair;
+    const PE pe = makePE(0);
+    const std::size_t frameBytes = MessageCodec::encodePE(pe).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        pair.client.sendPE(pe);
+        pair.server.sendPE(pair.server.receivePE());
+        benchmark::DoNotOptimize(pair.client.receivePE());
+        counters.add(2 * frameBytes, 2);
+    }
+}
+BENCHMARK(BM_RoundTripPE)->UseRealTime();
+
+void BM_RoundTripEmitter(benchmark::State& state) {
+    LoopbackPair pair;
+    const Emitter emitter = makeEmitter(0);
+    const std::size_t frameBytes = MessageCodec::encodeEmitter(emitter).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        pair.client.sendEmitter(emitter);
+        pair.server.sendEmitter(pair.server.receiveEmitter());
+        benchmark::DoNotOptimize(pair.client.receiveEmitter());
+        counters.add(2 * frameBytes, 2);
+    }
+}
+BENCHMARK(BM_RoundTripEmitter)->UseRealTime();
+
+void BM_RoundTripPEBatch(benchmark::State& state) {
+    LoopbackPair pair;
+    std::vector<PE> pes;
+    for (int i = 0; i < state.range(0); ++i) {
+        pes.push_back(makePE(i));
+    }
+    const std::size_t frameBytes = MessageCodec::encodePEBatch(pes).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        // Receive on a second thread, a large batch does not fit in the socket buffers
+        std::thread echo([&pair]() { pair.server.sendPEBatch(pair.server.receivePEBatch()); });
+        pair.client.sendPEBatch(pes);
+        benchmark::DoNotOptimize(pair.client.receivePEBatch());
+        echo.join();
+        counters.add(2 * frameBytes, 2 * pes.size());
+    }
+}
+BENCHMARK(BM_RoundTripPEBatch)->Arg(16)->Arg(256)->UseRealTime();
+
+// In-memory round trips, the same send and receive paths with no socket or kernel involved,
+// so these measure encoding, framing, validation and decoding alone
+
+void BM_InMemoryRoundTripPE(benchmark::State& state) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    const PE pe = makePE(0);
+    const std::size_t frameBytes = MessageCodec::encodePE(pe).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        client->sendPE(pe);
+        server->sendPE(server->receivePE());
+        benchmark::DoNotOptimize(client->receivePE());
+        counters.add(2 * frameBytes, 2);
+    }
+}
+BENCHMARK(BM_InMemoryRoundTripPE);
+
+void BM_InMemoryRoundTripEmitter(benchmark::State& state) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    const Emitter emitter = makeEmitter(0);
+    const std::size_t frameBytes = MessageCodec::encodeEmitter(emitter).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        client->sendEmitter(emitter);
+        server->sendEmitter(server->receiveEmitter());
+        benchmark::DoNotOptimize(client->receiveEmitter());
+        counters.add(2 * frameBytes, 2);
+    }
+}
+BENCHMARK(BM_InMemoryRoundTripEmitter);
+
+void BM_InMemoryRoundTripPEBatch(benchmark::State& state) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    std::vector<PE> pes;
+    for (int i = 0; i < state.range(0); ++i) {
+        pes.push_back(makePE(i));
+    }
+    const std::size_t frameBytes = MessageCodec::encodePEBatch(pes).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        // A whole batch is one slot in the channel, so no echo thread is needed
+        client->sendPEBatch(pes);
+        server->sendPEBatch(server->receivePEBatch());
+        benchmark::DoNotOptimize(client->receivePEBatch());
+        counters.add(2 * frameBytes, 2 * pes.size());
+    }
+}
+BENCHMARK(BM_InMemoryRoundTripPEBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+// A doctrine change of range(0) settings, sent one frame per setting or as one batch frame
+
+void BM_InMemorySettings(benchmark::State& state) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    const int count = static_cast<int>(state.range(0));
+    const std::size_t frameBytes = MessageCodec::encodeSetting("PE_SETTING", "JAM", "BenchPE0", 1).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        for (int i = 0; i < count; ++i) {
+            client->sendPESetting("JAM", "BenchPE" + std::to_string(i), 1);
+        }
+        for (int i = 0; i < count; ++i) {
+            benchmark::DoNotOptimize(server->receiveSetting());
+        }
+        counters.add(count * frameBytes, count);
+    }
+}
+BENCHMARK(BM_InMemorySettings)->Arg(16)->Arg(256);
+
+void BM_InMemorySettingBatch(benchmark::State& state) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    std::vector<std::tuple<std::string, std::string, std::string, int>> settings;
+    for (int i = 0; i < state.range(0); ++i) {
+        settings.emplace_back("PE_SETTING", "BenchPE" + std::to_string(i), "JAM", 1);
+    }
+    const std::size_t frameBytes = MessageCodec::encodeSettingBatch(settings).size();
+    Counters counters(state);
+    for (auto _ : state) {
+        client->sendSettingBatch(settings);
+        benchmark::DoNotOptimize(server->receiveSettingBatch());
+        counters.add(frameBytes, settings.size());
+    }
+}
+BENCHMARK(BM_InMemorySettingBatch)->Arg(16)->Arg(256);
+
+} // namespace
+
+BENCHMARK_MAIN();
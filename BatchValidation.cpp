@@ -0,0 +1,193 @@
+#include "BatchValidation.h"
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BATCHVALIDATION_SSE2
+#endif
+
+/*!
+    \class BatchValidation
+    \brief Validates whole batches of PEs and Emitters from column data.
+
+    Each rule is evaluated over a block of up to 64 entries at a time and reduced
+    to one 64 bit word, so a batch is checked with no per-entity branches. On x86
+    the range comparisons use AVX2 (four lanes) or SSE2 (two lanes), selected at
+    compile time, with a portable scalar loop elsewhere. NaN coordinates fail every
+    comparison and are reported invalid, matching the per-object checks.
+*/
+
+namespace {
+constexpr std::size_t kBlock = 64;
+constexpr double kInf = std::numeric_limits<double>::infinity();
+
+// Bit i set when low <= values[i] <= high, for n <= 64 entries
+std::uint64_t rangeBits(const double* values, std::size_t n, double low, double high) {
+    std::uint64_t bits = 0;
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256d lo = _mm256_set1_pd(low);
+    const __m256d hi = _mm256_set1_pd(high);
+    for (; i + 4 <= n; i += 4) {
+        const __m256d v = _mm256_loadu_pd(values + i);
+        const __m256d ok = _mm256_and_pd(_mm256_cmp_pd(v, lo, _CMP_GE_OQ), _mm256_cmp_pd(v, hi, _CMP_LE_OQ));
+        bits |= static_cast<std::uint64_t>(_mm256_movemask_pd(ok)) << i;
+    }
+#elif defined(BATCHVALIDATION_SSE2)
+    const __m128d lo = _mm_set1_pd(low);
+    const __m128d hi = _mm_set1_pd(high);
+    for (; i + 2 <= n; i += 2) {
+        const __m128d v = _mm_loadu_pd(values + i);
+        const __m128d ok = _mm_and_pd(_mm_cmpge_pd(v, lo), _mm_cmple_pd(v, hi));
+        bits |= static_cast<std::uint64_t>(_mm_movemask_pd(ok)) << i;
+    }
+#endif
+    for (; i < n; ++i) {
+        bits |= static_cast<std::uint64_t>(values[i] >= low && values[i] <= high) << i;
+    }
+    return bits;
+}
+
+// Bit i set when a[i] < b[i], for n <= 64 entries
+std::uint64_t lessBits(const double* a, const double* b, std::size_t n) {
+    std::uint64_t bits = 0;
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        const __m256d lt = _mm256_cmp_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _CMP_LT_OQ);
+        bits |= static_cast<std::uint64_t>(_mm256_movemask_pd(lt)) << i;
+    }
+#elif defined(BATCHVALIDATION_SSE2)
+    for (; i + 2 <= n; i += 2) {
+        const __m128d lt = _mm_cmplt_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+        bits |= static_cast<std::uint64_t>(_mm_movemask_pd(lt)) << i;
+    }
+#endif
+    for (; i < n; ++i) {
+        bits |= static_cast<std::uint64_t>(a[i] < b[i]) << i;
+    }
+    return bits;
+}
+
+// Bit i set when flags[i] is non-zero, for n <= 64 entries
+std::uint64_t flagBits(const std::uint8_t* flags, std::size_t n) {
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        bits |= static_cast<std::uint64_t>(flags[i] != 0) << i;
+    }
+    return bits;
+}
+}
+
+/*!
+    \fn ValidityMask BatchValidation::validatePEs(const PEColumns& columns)
+    \brief Validates a batch of PEs held as columns.
+    \param columns Pointers to the lat, lon, altitude and id presence columns.
+    \return A mask with one bit set per valid entry.
+*/
+ValidityMask BatchValidation::validatePEs(const PEColumns& columns) {
+    ValidityMask mask((columns.count + kBlock - 1) / kBlock, 0);
+    for (std::size_t base = 0, word = 0; base < columns.count; base += kBlock, ++word) {
+        const std::size_t n = std::min(kBlock, columns.count - base);
+        mask[word] = rangeBits(columns.lat + base, n, -90.0, 90.0)
+                   & rangeBits(columns.lon + base, n, -180.0, 180.0)
+                   & rangeBits(columns.altitude + base, n, 0.0, kInf)
+                   & flagBits(columns.hasId + base, n);
+    }
+    return mask;
+}
+
+/*!
+    \fn ValidityMask BatchValidation::validateEmitters(const EmitterColumns& columns)
+    \brief Validates a batch of Emitters held as columns.
+    \param columns Pointers to the lat, lon, freqMin, freqMax and id presence columns.
+    \return A mask with one bit set per valid entry.
+*/
+ValidityMask BatchValidation::validateEmitters(const EmitterColumns& columns) {
+    ValidityMask mask((columns.count + kBlock - 1) / kBlock, 0);
+    for (std::size_t base = 0, word = 0; base < columns.count; base += kBlock, ++word) {
+        const std::size_t n = std::min(kBlock, columns.count - base);
+        mask[word] = rangeBits(columns.lat + base, n, -90.0, 90.0)
+                   & rangeBits(columns.lon + base, n, -180.0, 180.0)
+                   & lessBits(columns.freqMin + base, columns.freqMax + base, n)
+                   & flagBits(columns.hasId + base, n);
+    }
+    return mask;
+}
+
+/*!
+    \fn ValidityMask BatchValidation::validatePEs(const std::vector<PE>& pes)
+    \brief Gathers a batch of PE objects into columns and validates them.
+    \param pes The PEs to validate.
+    \return A mask with one bit set per valid PE.
+*/
+ValidityMask BatchValidation::validatePEs(const std::vector<PE>& pes) {
+    std::vector<double> lat(pes.size()), lon(pes.size()), altitude(pes.size());
+    std::vector<std::uint8_t> hasId(pes.size());
+    for (std::size_t i = 0; i < pes.size(); ++i) {
+        lat[i] = pes[i].lat;
+        lon[i] = pes[i].lon;
+        altitude[i] = pes[i].altitude;
+        hasId[i] = !pes[i].id.isEmpty();
+    }
+    return validatePEs(PEColumns{lat.data(), lon.data(), altitude.data(), hasId.data(), pes.size()});
+}
+
+/*!
+    \fn ValidityMask BatchValidation::validateEmitters(const std::vector<Emitter>& emitters)
+    \brief Gathers a batch of Emitter objects into columns and validates them.
+    \param emitters The Emitters to validate.
+    \return A mask with one bit set per valid Emitter.
+*/
+ValidityMask BatchValidation::validateEmitters(const std::vector<Emitter>& emitters) {
+    std::vector<double> lat(emitters.size()), lon(emitters.size()), freqMin(emitters.size()), freqMax(emitters.size());
+    std::vector<std::uint8_t> hasId(emitters.size());
+    for (std::size_t i = 0; i < emitters.size(); ++i) {
+        lat[i] = emitters[i].lat;
+        lon[i] = emitters[i].lon;
+        freqMin[i] = emitters[i].freqMin;
+        freqMax[i] = emitters[i].freqMax;
+        hasId[i] = !emitters[i].id.isEmpty();
+    }
+    return validateEmitters(EmitterColumns{lat.data(), lon.data(), freqMin.data(), freqMax.data(), hasId.data(), emitters.size()});
+}
+
+/*!
+    \fn std::size_t BatchValidation::countValid(const ValidityMask& mask, std::size_t count)
+    \brief Counts the valid entries in a mask.
+    \param mask The mask returned by one of the validate functions.
+    \param count The number of entries in the batch.
+    \return The number of valid entries.
+*/
+std::size_t BatchValidation::countValid(const ValidityMask& mask, std::size_t count) {
+    std::size_t valid = 0;
+    for (std::size_t word = 0; word < mask.size(); ++word) {
+        std::uint64_t bits = mask[word];
+        const std::size_t remaining = count - word * kBlock;
+        if (remaining < kBlock) {
+            bits &= (std::uint64_t(1) << remaining) - 1;
+        }
+        for (; bits; bits &= bits - 1) {
+            ++valid;
+        }
+    }
+    return valid;
+}
+
+/*!
+    \fn const char* BatchValidation::kernelName()
+    \brief Returns the name of the comparison kernel compiled in.
+    \return "avx2", "sse2" or "scalar".
+*/
+const char* BatchValidation::kernelName() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(BATCHVALIDATION_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
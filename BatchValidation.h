@@ -0,0 +1,48 @@
+#ifndef BATCHVALIDATION_H
+#define BATCHVALIDATION_H
+
+#include <cstdint>
+#include <vector>
+#include "pe.h"
+#include "emitter.h"
+
+// One bit per batch entry, bit (i % 64) of word (i / 64) is set when entry i is valid
+using ValidityMask = std::vector<std::uint64_t>;
+
+// Column views over a batch of PEs, hasId[i] is non-zero when entry i has a non-empty id
+struct PEColumns {
+    const double* lat = nullptr;
+    const double* lon = nullptr;
+    const double* altitude = nullptr;
+    const std::uint8_t* hasId = nullptr;
+    std::size_t count = 0;
+};
+
+// Column views over a batch of Emitters, hasId[i] is non-zero when entry i has a non-empty id
+struct EmitterColumns {
+    const double* lat = nullptr;
+    const double* lon = nullptr;
+    const double* freqMin = nullptr;
+    const double* freqMax = nullptr;
+    const std::uint8_t* hasId = nullptr;
+    std::size_t count = 0;
+};
+
+class BatchValidation {
+public:
+    // Validate column data, same rules as NetworkImplementation::validatePE/validateEmitter
+    static ValidityMask validatePEs(const PEColumns& columns);
+    static ValidityMask validateEmitters(const EmitterColumns& columns);
+    // Gather object batches into columns and validate them
+    static ValidityMask validatePEs(const std::vector<PE>& pes);
+    static ValidityMask validateEmitters(const std::vector<Emitter>& emitters);
+    static bool isValid(const ValidityMask& mask, std::size_t index) {
+        return (mask[index >> 6] >> (index & 63)) & 1u;
+    }
+    // Number of set bits in the first count entries of a mask
+    static std::size_t countValid(const ValidityMask& mask, std::size_t count);
+    // Name of the kernel selected at compile time, for logs and benchmarks
+    static const char* kernelName();
+};
+
+#endif // BATCHVALIDATION_H
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include "BatchValidation.h"
+#include <cmath>
+#include <limits>
+#include <random>
+
+TEST(BatchValidationTest, PEMaskMatchesPerObjectRules) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> lat(-120.0, 120.0);
+    std::uniform_real_distribution<double> lon(-200.0, 200.0);
+    std::uniform_real_distribution<double> altitude(-1000.0, 40000.0);
+    std::vector<PE> pes;
+    for (int i = 0; i < 203; ++i) {
+        pes.emplace_back(i % 17 == 0 ? "" : "PE", "F18", lat(rng), lon(rng), altitude(rng), 500.0, "MED", "HIGH", false, false);
+    }
+    pes[5].lat = std::numeric_limits<double>::quiet_NaN();
+
+    ValidityMask mask = BatchValidation::validatePEs(pes);
+    ASSERT_EQ(mask.size(), 4u);
+    std::size_t expectedValid = 0;
+    for (std::size_t i = 0; i < pes.size(); ++i) {
+        const PE& pe = pes[i];
+        const bool expected = !pe.id.isEmpty() && pe.lat >= -90 && pe.lat <= 90 && pe.lon >= -180 && pe.lon <= 180 && pe.altitude >= 0;
+        EXPECT_EQ(BatchValidation::isValid(mask, i), expected) << "entry " << i;
+        expectedValid += expected;
+    }
+    EXPECT_EQ(BatchValidation::countValid(mask, pes.size()), expectedValid);
+}
+
+TEST(BatchValidationTest, EmitterMaskMatchesPerObjectRules) {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> lat(-120.0, 120.0);
+    std::uniform_real_distribution<double> lon(-200.0, 200.0);
+    std::uniform_real_distribution<double> freq(0.0, 20000.0);
+    std::vector<Emitter> emitters;
+    for (int i = 0; i < 131; ++i) {
+        emitters.emplace_back(i % 13 == 0 ? "" : "EM", "RadarType", "Category", lat(rng), lon(rng), freq(rng), freq(rng));
+    }
+
+    ValidityMask mask = BatchValidation::validateEmitters(emitters);
+    for (std::size_t i = 0; i < emitters.size(); ++i) {
+        const Emitter& emitter = emitters[i];
+        const bool expected = !emitter.id.isEmpty() && emitter.lat >= -90 && emitter.lat <= 90
+                              && emitter.lon >= -180 && emitter.lon <= 180 && emitter.freqMin < emitter.freqMax;
+        EXPECT_EQ(BatchValidation::isValid(mask, i), expected) << "entry " << i;
+    }
+}
+
+TEST(BatchValidationTest, EmptyBatchHasEmptyMask) {
+    EXPECT_TRUE(BatchValidation::validatePEs(std::vector<PE>{}).empty());
+    EXPECT_EQ(BatchValidation::countValid(ValidityMask{}, 0), 0u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
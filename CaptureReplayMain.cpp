@@ -0,0 +1,46 @@
+#include <QStringList>
+#include <iostream>
+#include "TrafficReplay.h"
+
+int main (int argc, char *argv[]) {
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) {
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    }
+
+    ReplayConfig config;
+    QString error;
+    QString helpText;
+    if (!ReplayConfig::parse(arguments, config, error, helpText)) {
+        if (!helpText.isEmpty()) {
+            std::cout << helpText.toStdString();
+            return 0;
+        }
+        std::cerr << error.toStdString() << std::endl;
+        return 1;
+    }
+
+    try {
+        CaptureReader reader(config.capture.toStdString());
+        if (config.info) {
+            std::cout << "segments " << reader.segmentCount() << "\n"
+                      << "frames   " << reader.frameCount() << "\n"
+                      << "duration " << (reader.lastTimestamp() - reader.firstTimestamp()) / 1e9 << " s" << std::endl;
+            return 0;
+        }
+
+        NetworkImplementation target;
+        target.initialise(config.address.toStdString(), config.port);
+        const ReplayStats stats = TrafficReplay(reader, target).run(config.options);
+        target.close();
+
+        std::cout << "frames  " << stats.frames << "\n"
+                  << "sent    " << stats.sent << "\n"
+                  << "failed  " << stats.failed << "\n"
+                  << "elapsed " << stats.elapsedSeconds << " s" << std::endl;
+        return stats.failed == 0 ? 0 : 2;
+    } catch (const std::exception& e) {
+        std::cerr << "Replay failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,229 @@
+#include "DeadReckoning.h"
+#include <algorithm>
+#include <cmath>
+
+/*!
+    \class DeadReckoning
+    \brief Shared extrapolation used by DeadReckoningSender and DeadReckoningReceiver.
+
+    An entity is moved along the great circle given by its heading (degrees
+    clockwise from north) at its speed. Altitude is held constant. Sender and
+    receiver use exactly the same extrapolation, so the sender knows what the
+    receiver is displaying without any feedback from it.
+*/
+
+namespace {
+constexpr double kEarthRadiusMetres = 6371008.8;
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+
+double secondsBetween(DeadReckoning::Clock::time_point from, DeadReckoning::Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+}
+
+/*!
+    \fn void DeadReckoning::extrapolate(double& lat, double& lon, double speed, double heading, double seconds, double speedToMetresPerSecond)
+    \brief Moves a position along its heading for a given time.
+    \param lat The latitude in degrees, updated in place.
+    \param lon The longitude in degrees, updated in place and normalised to [-180, 180).
+    \param speed The speed, in the units converted by speedToMetresPerSecond.
+    \param heading The heading in degrees clockwise from north.
+    \param seconds The time to extrapolate over.
+    \param speedToMetresPerSecond Factor converting speed to metres per second.
+*/
+void DeadReckoning::extrapolate(double& lat, double& lon, double speed, double heading, double seconds,
+                                double speedToMetresPerSecond) {
+    const double angular = speed * speedToMetresPerSecond * seconds / kEarthRadiusMetres;
+    if (angular == 0.0) {
+        return;
+    }
+    const double lat1 = lat * kDegToRad;
+    const double lon1 = lon * kDegToRad;
+    const double bearing = heading * kDegToRad;
+    const double lat2 = std::asin(std::sin(lat1) * std::cos(angular)
+                                  + std::cos(lat1) * std::sin(angular) * std::cos(bearing));
+    const double lon2 = lon1 + std::atan2(std::sin(bearing) * std::sin(angular) * std::cos(lat1),
+                                          std::cos(angular) - std::sin(lat1) * std::sin(lat2));
+    lat = lat2 * kRadToDeg;
+    lon = std::fmod(lon2 * kRadToDeg + 540.0, 360.0) - 180.0;
+}
+
+/*!
+    \fn double DeadReckoning::distanceMetres(double lat1, double lon1, double lat2, double lon2)
+    \brief Computes the horizontal great-circle distance between two points.
+    \return The distance in metres.
+*/
+double DeadReckoning::distanceMetres(double lat1, double lon1, double lat2, double lon2) {
+    const double dLat = (lat2 - lat1) * kDegToRad;
+    const double dLon = (lon2 - lon1) * kDegToRad;
+    const double a = std::sin(dLat / 2) * std::sin(dLat / 2)
+                   + std::cos(lat1 * kDegToRad) * std::cos(lat2 * kDegToRad) * std::sin(dLon / 2) * std::sin(dLon / 2);
+    return 2.0 * kEarthRadiusMetres * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+/*!
+    \fn bool DeadReckoning::sameAttributes(const PE& a, const PE& b)
+    \brief Compares the PE fields a receiver cannot predict, any change to these is always sent.
+*/
+bool DeadReckoning::sameAttributes(const PE& a, const PE& b) {
+    return a.type == b.type && a.apd == b.apd && a.priority == b.priority && a.jam == b.jam
+           && a.ghost == b.ghost && a.category == b.category && a.state == b.state;
+}
+
+/*!
+    \fn bool DeadReckoning::sameAttributes(const Emitter& a, const Emitter& b)
+    \brief Compares the Emitter fields a receiver cannot predict.
+*/
+bool DeadReckoning::sameAttributes(const Emitter& a, const Emitter& b) {
+    return a.type == b.type && a.category == b.category && a.freqMin == b.freqMin && a.freqMax == b.freqMax
+           && a.active == b.active && a.eaPriority == b.eaPriority && a.esPriority == b.esPriority
+           && a.jamResponsible == b.jamResponsible && a.reactiveEligible == b.reactiveEligible
+           && a.preemptiveEligible == b.preemptiveEligible && a.consentRequired == b.consentRequired
+           && a.operatorManaged == b.operatorManaged && a.jam == b.jam
+           && a.jamIneffective == b.jamIneffective && a.jamEffective == b.jamEffective;
+}
+
+/*!
+    \class DeadReckoningSender
+    \brief Decides which PE and Emitter updates a receiver could not have predicted.
+
+    For every entity the sender remembers the last state it actually sent. A new
+    update is only sent if the receiver's extrapolation of that state is now off by
+    more than the configured position or altitude threshold, if any field that cannot
+    be extrapolated has changed, or if the maximum interval has passed.
+*/
+
+/*!
+    \fn DeadReckoningSender::DeadReckoningSender(const DeadReckoningConfig& config)
+    \brief Constructs a sender with the given thresholds.
+*/
+DeadReckoningSender::DeadReckoningSender(const DeadReckoningConfig& config)
+    : settings(config) {}
+
+/*!
+    \fn bool DeadReckoningSender::shouldSendPE(const PE& pe, DeadReckoning::Clock::time_point now)
+    \brief Decides whether a PE update must be sent.
+    \param pe The current PE state.
+    \param now The time of the update.
+    \return True if the update must be sent. The PE is then recorded as the last sent state.
+*/
+bool DeadReckoningSender::shouldSendPE(const PE& pe, DeadReckoning::Clock::time_point now) {
+    auto found = lastPEs.constFind(pe.id);
+    if (found != lastPEs.constEnd() && predictionHolds(found.value().first, found.value().second, pe, now)) {
+        ++suppressed;
+        return false;
+    }
+    lastPEs.insert(pe.id, std::make_pair(pe, now));
+    return true;
+}
+
+/*!
+    \fn bool DeadReckoningSender::shouldSendEmitter(const Emitter& emitter, DeadReckoning::Clock::time_point now)
+    \brief Decides whether an Emitter update must be sent.
+    \param emitter The current Emitter state.
+    \param now The time of the update.
+    \return True if the update must be sent. The Emitter is then recorded as the last sent state.
+*/
+bool DeadReckoningSender::shouldSendEmitter(const Emitter& emitter, DeadReckoning::Clock::time_point now) {
+    auto found = lastEmitters.constFind(emitter.id);
+    if (found != lastEmitters.constEnd() && predictionHolds(found.value().first, found.value().second, emitter, now)) {
+        ++suppressed;
+        return false;
+    }
+    lastEmitters.insert(emitter.id, std::make_pair(emitter, now));
+    return true;
+}
+
+/*!
+    \fn void DeadReckoningSender::reset()
+    \brief Forgets every last sent state, for example after a reconnect.
+*/
+void DeadReckoningSender::reset() {
+    lastPEs.clear();
+    lastEmitters.clear();
+}
+
+template <typename Entity>
+bool DeadReckoningSender::predictionHolds(const Entity& last, DeadReckoning::Clock::time_point sentAt,
+                                          const Entity& current, DeadReckoning::Clock::time_point now) const {
+    if (now - sentAt >= settings.maxInterval || !DeadReckoning::sameAttributes(last, current)) {
+        return false;
+    }
+    if (std::abs(current.altitude - last.altitude) > settings.altitudeThreshold) {
+        return false;
+    }
+    double lat = last.lat;
+    double lon = last.lon;
+    DeadReckoning::extrapolate(lat, lon, last.speed, last.heading, secondsBetween(sentAt, now),
+                               settings.speedToMetresPerSecond);
+    return DeadReckoning::distanceMetres(lat, lon, current.lat, current.lon) <= settings.positionThresholdMetres;
+}
+
+/*!
+    \class DeadReckoningReceiver
+    \brief Extrapolates received PEs and Emitters between updates.
+
+    Pairs with DeadReckoningSender: displays that query predictPE() or
+    predictEmitter() at their frame time keep moving smoothly while the
+    sender is suppressing updates.
+*/
+
+/*!
+    \fn DeadReckoningReceiver::DeadReckoningReceiver(double speedToMetresPerSecond)
+    \brief Constructs a receiver using the same speed units as the sender.
+*/
+DeadReckoningReceiver::DeadReckoningReceiver(double speedToMetresPerSecond)
+    : speedFactor(speedToMetresPerSecond) {}
+
+/*!
+    \fn void DeadReckoningReceiver::updatePE(const PE& pe, DeadReckoning::Clock::time_point receivedAt)
+    \brief Records a received PE as the basis for prediction.
+*/
+void DeadReckoningReceiver::updatePE(const PE& pe, DeadReckoning::Clock::time_point receivedAt) {
+    pes.insert(pe.id, std::make_pair(pe, receivedAt));
+}
+
+/*!
+    \fn void DeadReckoningReceiver::updateEmitter(const Emitter& emitter, DeadReckoning::Clock::time_point receivedAt)
+    \brief Records a received Emitter as the basis for prediction.
+*/
+void DeadReckoningReceiver::updateEmitter(const Emitter& emitter, DeadReckoning::Clock::time_point receivedAt) {
+    emitters.insert(emitter.id, std::make_pair(emitter, receivedAt));
+}
+
+/*!
+    \fn std::optional<PE> DeadReckoningReceiver::predictPE(const QString& id, DeadReckoning::Clock::time_point at) const
+    \brief Extrapolates a PE to a point in time.
+    \param id The ID of the PE.
+    \param at The time to predict for, normally the current frame time.
+    \return The predicted PE, or an empty optional if the PE has never been received.
+*/
+std::optional<PE> DeadReckoningReceiver::predictPE(const QString& id, DeadReckoning::Clock::time_point at) const {
+    auto found = pes.constFind(id);
+    if (found == pes.constEnd()) {
+        return std::nullopt;
+    }
+    PE pe = found.value().first;
+    DeadReckoning::extrapolate(pe.lat, pe.lon, pe.speed, pe.heading, secondsBetween(found.value().second, at), speedFactor);
+    return pe;
+}
+
+/*!
+    \fn std::optional<Emitter> DeadReckoningReceiver::predictEmitter(const QString& id, DeadReckoning::Clock::time_point at) const
+    \brief Extrapolates an Emitter to a point in time.
+    \param id The ID of the Emitter.
+    \param at The time to predict for, normally the current frame time.
+    \return The predicted Emitter, or an empty optional if the Emitter has never been received.
+*/
+std::optional<Emitter> DeadReckoningReceiver::predictEmitter(const QString& id, DeadReckoning::Clock::time_point at) const {
+    auto found = emitters.constFind(id);
+    if (found == emitters.constEnd()) {
+        return std::nullopt;
+    }
+    Emitter emitter = found.value().first;
+    DeadReckoning::extrapolate(emitter.lat, emitter.lon, emitter.speed, emitter.heading,
+                               secondsBetween(found.value().second, at), speedFactor);
+    return emitter;
+}
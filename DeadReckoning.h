@@ -0,0 +1,75 @@
+#ifndef DEADRECKONING_H
+#define DEADRECKONING_H
+
+#include <QHash>
+#include <QString>
+#include <chrono>
+#include <optional>
+#include "pe.h"
+#include "emitter.h"
+
+struct DeadReckoningConfig {
+    // Send once the predicted horizontal position is off by more than this many metres
+    double positionThresholdMetres = 100.0;
+    // Send once the altitude differs from the last sent value by more than this, in altitude units
+    double altitudeThreshold = 100.0;
+    // Send at least this often even if the prediction is still good
+    std::chrono::milliseconds maxInterval{5000};
+    // Converts the speed field to metres per second, the default treats speed as knots
+    double speedToMetresPerSecond = 0.514444;
+};
+
+class DeadReckoning {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Move a position along its heading at its speed for a number of seconds
+    static void extrapolate(double& lat, double& lon, double speed, double heading, double seconds,
+                            double speedToMetresPerSecond);
+    // Horizontal great-circle distance in metres
+    static double distanceMetres(double lat1, double lon1, double lat2, double lon2);
+    // True if no field a receiver cannot extrapolate differs
+    static bool sameAttributes(const PE& a, const PE& b);
+    static bool sameAttributes(const Emitter& a, const Emitter& b);
+};
+
+class DeadReckoningSender {
+public:
+    explicit DeadReckoningSender(const DeadReckoningConfig& config = DeadReckoningConfig());
+    // True if the receiver's prediction is no longer good enough and the update must be sent
+    bool shouldSendPE(const PE& pe, DeadReckoning::Clock::time_point now);
+    bool shouldSendEmitter(const Emitter& emitter, DeadReckoning::Clock::time_point now);
+    // Forget the last sent states, so every entity is sent on its next update
+    void reset();
+    // Forget the last sent state of one entity, when the update shouldSend accepted was not written after all
+    void forgetPE(const QString& id) { lastPEs.remove(id); }
+    void forgetEmitter(const QString& id) { lastEmitters.remove(id); }
+    std::size_t suppressedCount() const { return suppressed; }
+    const DeadReckoningConfig& config() const { return settings; }
+
+private:
+    template <typename Entity>
+    bool predictionHolds(const Entity& last, DeadReckoning::Clock::time_point sentAt, const Entity& current,
+                         DeadReckoning::Clock::time_point now) const;
+    DeadReckoningConfig settings;
+    QHash<QString, std::pair<PE, DeadReckoning::Clock::time_point>> lastPEs;
+    QHash<QString, std::pair<Emitter, DeadReckoning::Clock::time_point>> lastEmitters;
+    std::size_t suppressed = 0;
+};
+
+class DeadReckoningReceiver {
+public:
+    explicit DeadReckoningReceiver(double speedToMetresPerSecond = DeadReckoningConfig().speedToMetresPerSecond);
+    // Record a received update as the new basis for prediction
+    void updatePE(const PE& pe, DeadReckoning::Clock::time_point receivedAt);
+    void updateEmitter(const Emitter& emitter, DeadReckoning::Clock::time_point receivedAt);
+    // The entity extrapolated to a point in time, empty if it has never been received
+    std::optional<PE> predictPE(const QString& id, DeadReckoning::Clock::time_point at) const;
+    std::optional<Emitter> predictEmitter(const QString& id, DeadReckoning::Clock::time_point at) const;
+
+private:
+    double speedFactor;
+    QHash<QString, std::pair<PE, DeadReckoning::Clock::time_point>> pes;
+    QHash<QString, std::pair<Emitter, DeadReckoning::Clock::time_point>> emitters;
+};
+
+#endif // DEADRECKONING_H
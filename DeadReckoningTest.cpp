@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "DeadReckoning.h"
+
+namespace {
+using Clock = DeadReckoning::Clock;
+
+// Straight-and-level track at 1 Hz, turning onto a new heading after turnAt seconds
+std::vector<PE> simulateTrack(int seconds, int turnAt, double newHeading) {
+    std::vector<PE> track;
+    PE pe("Track1", "F18", -33.9, 151.2, 30000.0, 480.0, "MED", "HIGH", false, false);
+    pe.heading = 45.0;
+    for (int t = 0; t < seconds; ++t) {
+        track.push_back(pe);
+        if (t + 1 == turnAt) {
+            pe.heading = newHeading;
+        }
+        DeadReckoning::extrapolate(pe.lat, pe.lon, pe.speed, pe.heading, 1.0, DeadReckoningConfig().speedToMetresPerSecond);
+    }
+    return track;
+}
+}
+
+TEST(DeadReckoningTest, StraightAndLevelTrafficIsMostlySuppressed) {
+    DeadReckoningConfig config;
+    config.maxInterval = std::chrono::seconds(30);
+    DeadReckoningSender sender(config);
+    const Clock::time_point start = Clock::now();
+
+    std::vector<PE> track = simulateTrack(120, 0, 0.0);
+    int sent = 0;
+    for (std::size_t t = 0; t < track.size(); ++t) {
+        sent += sender.shouldSendPE(track[t], start + std::chrono::seconds(t));
+    }
+    EXPECT_LE(sent, static_cast<int>(track.size()) / 10);
+    EXPECT_EQ(sender.suppressedCount(), track.size() - sent);
+}
+
+TEST(DeadReckoningTest, TurnAndAttributeChangesAreSent) {
+    DeadReckoningConfig config;
+    config.maxInterval = std::chrono::seconds(60);
+    DeadReckoningSender sender(config);
+    const Clock::time_point start = Clock::now();
+
+    std::vector<PE> track = simulateTrack(30, 10, 135.0);
+    std::vector<int> sentAt;
+    for (std::size_t t = 0; t < track.size(); ++t) {
+        if (sender.shouldSendPE(track[t], start + std::chrono::seconds(t))) {
+            sentAt.push_back(static_cast<int>(t));
+        }
+    }
+    ASSERT_GE(sentAt.size(), 2u);
+    EXPECT_EQ(sentAt[0], 0);
+    EXPECT_GE(sentAt[1], 10);
+    EXPECT_LE(sentAt[1], 12);
+
+    PE jammed = track.back();
+    jammed.jam = true;
+    EXPECT_TRUE(sender.shouldSendPE(jammed, start + std::chrono::seconds(30)));
+}
+
+TEST(DeadReckoningTest, ReceiverPredictionTracksSender) {
+    DeadReckoningReceiver receiver;
+    const Clock::time_point start = Clock::now();
+    std::vector<PE> track = simulateTrack(20, 0, 0.0);
+    receiver.updatePE(track[0], start);
+
+    std::optional<PE> predicted = receiver.predictPE("Track1", start + std::chrono::seconds(19));
+    ASSERT_TRUE(predicted.has_value());
+    EXPECT_LT(DeadReckoning::distanceMetres(predicted->lat, predicted->lon, track[19].lat, track[19].lon), 1.0);
+    EXPECT_FALSE(receiver.predictPE("Unknown", start).has_value());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,239 @@
+#include "DecodePipeline.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Tracing.h"
+#include <boost/asio/error.hpp>
+#include <boost/system/system_error.hpp>
+#include <algorithm>
+
+/*!
+    \class DecodePipeline
+    \brief Decodes the frames of one connection on several threads.
+
+    receiveMessage() reads and decodes each frame on the calling thread, so
+    one core bounds how fast a connection can be consumed, and most of that
+    core goes on QJson parsing rather than framing. Here a reader thread only
+    splits the stream into frames with NetworkImplementation::receiveFrame()
+    and numbers them. The frames are dealt round robin onto per-thread deques.
+    Each decoder works through its own deque and, once that is empty, steals
+    from the back of the others, so an expensive batch or snapshot on one
+    thread does not leave the rest idle.
+
+    Decoded messages go into a reorder buffer indexed by their number, and
+    next() hands them out strictly in the order they were read. This is
+    stronger than keeping each id's updates in order: settings, batches and
+    snapshots also stay in order relative to the updates around them, so a
+    consumer sees exactly what receiveMessage() would have returned. The
+    reader stops once window frames are waiting to be returned, which bounds
+    memory and applies back-pressure to the sender through the socket.
+
+    Decoding failures are returned from next() at the position of the bad
+    frame. Once the connection ends, next() returns every message still in
+    flight and then rethrows the read error.
+*/
+
+/*!
+    \fn DecodePipeline::DecodePipeline(NetworkImplementation& source, std::size_t threads, std::size_t window)
+    \brief Starts the reader and decoder threads on a connected interface.
+    \param source The interface to receive from, which must outlive the pipeline. Nothing else may receive from it.
+    \param threads The number of decoder threads, 0 for one per core.
+    \param window The number of frames that may be read ahead of next(), rounded up to a power of two.
+*/
+DecodePipeline::DecodePipeline(NetworkImplementation& source, std::size_t threads, std::size_t window)
+    : source(source) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t capacity = 1;
+    while (capacity < std::max<std::size_t>(window, 2)) {
+        capacity <<= 1;
+    }
+    results.resize(capacity);
+    mask = capacity - 1;
+
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers[i]->thread = std::thread(&DecodePipeline::decodeLoop, this, i);
+    }
+    reader = std::thread(&DecodePipeline::readLoop, this);
+}
+
+/*!
+    \fn DecodePipeline::~DecodePipeline()
+    \brief Stops the pipeline and joins its threads.
+*/
+DecodePipeline::~DecodePipeline() {
+    stop();
+}
+
+/*!
+    \fn NetworkMessage DecodePipeline::next()
+    \brief Returns the next message in the order the frames were received.
+    \return The decoded message.
+
+    Blocks until the message is decoded. Throws std::runtime_error if its
+    frame was malformed, as receiveMessage() does, and the read error, a
+    boost::system::system_error, once the connection has ended and every
+    earlier message has been returned. Only one thread may call next().
+*/
+NetworkMessage DecodePipeline::next() {
+    Result result;
+    {
+        std::unique_lock<std::mutex> lock(resultMutex);
+        resultReady.wait(lock, [this]() { return results[delivered & mask].ready || (readDone && delivered == read); });
+        Result& slot = results[delivered & mask];
+        if (!slot.ready) {
+            if (readError) {
+                std::rethrow_exception(readError);
+            }
+            throw boost::system::system_error(boost::asio::error::operation_aborted);
+        }
+        result = std::move(slot);
+        slot = Result();
+        ++delivered;
+    }
+    windowOpen.notify_one();
+    if (result.error) {
+        std::rethrow_exception(result.error);
+    }
+    return std::move(result.message);
+}
+
+/*!
+    \fn void DecodePipeline::stop()
+    \brief Closes the source and joins the reader and decoder threads.
+
+    Messages not yet returned are discarded, and later calls to next() throw.
+*/
+void DecodePipeline::stop() {
+    if (stopping.exchange(true)) {
+        return;
+    }
+    // Closing the source wakes a reader blocked in receiveFrame()
+    source.close();
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+    }
+    windowOpen.notify_all();
+    resultReady.notify_all();
+    if (reader.joinable()) {
+        reader.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+    }
+    workReady.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void DecodePipeline::readLoop() {
+    ANI_TRACE_THREAD_NAME("DecodePipeline reader");
+    std::exception_ptr error;
+    std::size_t target = 0;
+    try {
+        while (true) {
+            std::uint64_t sequence;
+            {
+                std::unique_lock<std::mutex> lock(resultMutex);
+                windowOpen.wait(lock, [this]() { return stopping || read - delivered <= mask; });
+                if (stopping) {
+                    break;
+                }
+                sequence = read;
+            }
+            std::string frame = source.receiveFrame();
+            {
+                std::lock_guard<std::mutex> lock(resultMutex);
+                ++read;
+            }
+            Worker& worker = *workers[target];
+            target = (target + 1) % workers.size();
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.tasks.push_back(Task{sequence, std::move(frame)});
+            }
+            queued.fetch_add(1);
+            {
+                std::lock_guard<std::mutex> lock(workMutex);
+            }
+            workReady.notify_one();
+        }
+    } catch (const std::exception&) {
+        error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        readDone = true;
+        readError = error;
+    }
+    resultReady.notify_all();
+}
+
+void DecodePipeline::decodeLoop(std::size_t index) {
+    ANI_TRACE_THREAD_NAME("DecodePipeline decoder");
+    Task task;
+    while (!stopping) {
+        if (takeTask(index, task)) {
+            decode(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(workMutex);
+        workReady.wait(lock, [this]() { return stopping || queued.load() > 0; });
+    }
+}
+
+bool DecodePipeline::takeTask(std::size_t index, Task& task) {
+    {
+        Worker& own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    for (std::size_t offset = 1; offset < workers.size(); ++offset) {
+        Worker& victim = *workers[(index + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            queued.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void DecodePipeline::decode(Task& task) {
+    ANI_TRACE_SPAN("DecodePipeline::decode");
+    Result result;
+    result.ready = true;
+    try {
+        MetricsTimer decodeTimer(MetricHistogram::DecodeNs);
+        result.message = NetworkImplementation::decodeMessage(task.frame);
+        Metrics::countReceived(result.message.kind, task.frame.size() + 1);
+    } catch (const std::exception& e) {
+        Metrics::count(MetricCounter::ReceiveFailures);
+        ANI_LOG_ERROR("DecodePipeline", "Failed to decode message: " + std::string(e.what()));
+        result.error = std::current_exception();
+    }
+
+    bool deliverable;
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        deliverable = task.sequence == delivered;
+        results[task.sequence & mask] = std::move(result);
+    }
+    // next() only ever waits for the oldest outstanding message
+    if (deliverable) {
+        resultReady.notify_one();
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef DECODEPIPELINE_H
+#define DECODEPIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+
+// Receives from one NetworkImplementation with framing on one thread and decoding spread over a
+// pool of threads. Messages come out of next() in wire order, so updates to an id are never reordered.
+class DecodePipeline {
+public:
+    // threads decoders, 0 for one per core. At most window frames are read ahead of next().
+    explicit DecodePipeline(NetworkImplementation& source, std::size_t threads = 0, std::size_t window = 1024);
+    ~DecodePipeline();
+    DecodePipeline(const DecodePipeline&) = delete;
+    DecodePipeline& operator=(const DecodePipeline&) = delete;
+    // The next message in wire order, throws as receiveMessage() would for a malformed frame, and
+    // boost::system::system_error once the source has closed and every earlier message has been returned
+    NetworkMessage next();
+    // Close the source and join every thread, called by the destructor
+    void stop();
+    std::size_t threadCount() const { return workers.size(); }
+
+private:
+    struct Task {
+        std::uint64_t sequence;
+        std::string frame;
+    };
+    // Each decoder takes from the front of its own deque and steals from the back of the others
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+    struct Result {
+        bool ready = false;
+        NetworkMessage message;
+        std::exception_ptr error;
+    };
+
+    void readLoop();
+    void decodeLoop(std::size_t index);
+    bool takeTask(std::size_t index, Task& task);
+    void decode(Task& task);
+
+    NetworkImplementation& source;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping{false};
+
+    // Frames queued across all deques, may dip below zero while a frame is taken before it is counted
+    std::atomic<std::int64_t> queued{0};
+    std::mutex workMutex;
+    std::condition_variable workReady;
+
+    // Reorder buffer, a result is stored at its sequence modulo the window size
+    std::mutex resultMutex;
+    std::condition_variable resultReady;
+    std::condition_variable windowOpen;
+    std::vector<Result> results;
+    std::uint64_t mask;
+    std::uint64_t delivered = 0;
+    std::uint64_t read = 0;
+    bool readDone = false;
+    std::exception_ptr readError;
+
+    std::thread reader;
+};
+
+#endif // DECODEPIPELINE_H
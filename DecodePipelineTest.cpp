@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "DecodePipeline.h"
+#include "InMemoryNetworkInterface.h"
+#include "MessageCodec.h"
+#include <thread>
+
+namespace {
+PE makePE(int i) {
+    // Ten ids updated in turn, the latitude records the send order
+    PE pe(QString("PE%1").arg(i % 10), "F18", i * 0.001, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+    return pe;
+}
+}
+
+TEST(DecodePipelineTest, MessagesComeOutInWireOrder) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    DecodePipeline pipeline(*server, 4);
+    EXPECT_EQ(pipeline.threadCount(), 4u);
+
+    const int count = 5000;
+    std::thread sender([&client = client]() {
+        for (int i = 0; i < count; ++i) {
+            if (i % 100 == 99) {
+                client->sendPEBatch({makePE(i), makePE(i)});
+            } else if (i % 10 == 5) {
+                client->sendPESetting("JAM", "PE5", i);
+            } else {
+                client->sendPE(makePE(i));
+            }
+        }
+    });
+    for (int i = 0; i < count; ++i) {
+        NetworkMessage message = pipeline.next();
+        if (i % 100 == 99) {
+            ASSERT_EQ(message.kind, NetworkMessage::Kind::PEBatch);
+            ASSERT_EQ(message.pes.size(), 2u);
+        } else if (i % 10 == 5) {
+            ASSERT_EQ(message.kind, NetworkMessage::Kind::Setting);
+            ASSERT_EQ(std::get<3>(message.setting), i);
+            continue;
+        } else {
+            ASSERT_EQ(message.kind, NetworkMessage::Kind::PE);
+        }
+        ASSERT_EQ(message.pes.front().id, QString("PE%1").arg(i % 10));
+        ASSERT_DOUBLE_EQ(message.pes.front().lat, i * 0.001);
+    }
+    sender.join();
+}
+
+TEST(DecodePipelineTest, MalformedFramesThrowAtTheirPosition) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    DecodePipeline pipeline(*server, 2);
+    PE invalid = makePE(2);
+    invalid.lat = 95.0;
+    std::string invalidFrame = MessageCodec::encodePE(invalid);
+    invalidFrame.pop_back();
+    ASSERT_TRUE(client->sendPE(makePE(1)));
+    ASSERT_TRUE(client->sendBlob(invalidFrame));
+    ASSERT_TRUE(client->sendBlob("plain text"));
+
+    EXPECT_EQ(pipeline.next().kind, NetworkMessage::Kind::PE);
+    EXPECT_THROW(pipeline.next(), std::runtime_error);
+    EXPECT_EQ(pipeline.next().blob, "plain text");
+}
+
+TEST(DecodePipelineTest, EverythingSentIsReturnedBeforeTheEndOfTheStream) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    // A window smaller than the thread count still makes progress
+    DecodePipeline pipeline(*server, 3, 2);
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_TRUE(client->sendPE(makePE(i)));
+    }
+    client->close();
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_DOUBLE_EQ(pipeline.next().pes.front().lat, i * 0.001);
+    }
+    EXPECT_THROW(pipeline.next(), boost::system::system_error);
+}
+
+TEST(DecodePipelineTest, StopWakesABlockedNext) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    DecodePipeline pipeline(*server, 2);
+    std::thread stopper([&pipeline]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pipeline.stop();
+    });
+    EXPECT_THROW(pipeline.next(), boost::system::system_error);
+    stopper.join();
+    EXPECT_THROW(pipeline.next(), boost::system::system_error);
+}
@@ -0,0 +1,501 @@
+#include "EntityCheckpoint.h"
+#include "Logger.h"
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+/*!
+    \class EntityCheckpoint
+    \brief Saves and restores the entity picture held in an EntityStore.
+
+    A checkpoint is the store's columns written one after another, each padded
+    to 8 bytes: numeric columns as raw arrays, flag columns as their packed
+    words, and string columns as an offset array followed by the UTF-16 text.
+    Each table's applied settings that have no dedicated column follow it as
+    named columns. The layout mirrors the store, so loading is a series of
+    bulk copies out of a read-only mapping, followed by rebuilding the id,
+    spatial and frequency indexes. Checkpoints are only read back on machines
+    of the same byte order.
+
+    Taking a checkpoint is split in two so it never stalls the receive path:
+    capture() copies the columns while the caller holds its lock, and the
+    encoding and file write happen afterwards, off the lock.
+*/
+
+static_assert(sizeof(CheckpointHeader) == 64, "Checkpoint header layout changed");
+static_assert(sizeof(int) == 4 && sizeof(QChar) == 2, "Checkpoint columns assume 32-bit ints and UTF-16 strings");
+
+namespace {
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+
+std::size_t padded(std::size_t size) {
+    return (size + 7) & ~std::size_t(7);
+}
+
+// The column order is the file format, any change needs a new CheckpointHeader::kVersion
+template <typename Table, typename Visit>
+void visitPEColumns(Table& table, Visit&& visit) {
+    visit(table.id);
+    visit(table.type);
+    visit(table.lat);
+    visit(table.lon);
+    visit(table.altitude);
+    visit(table.speed);
+    visit(table.heading);
+    visit(table.apd);
+    visit(table.priority);
+    visit(table.category);
+    visit(table.state);
+    visit(table.jam);
+    visit(table.ghost);
+}
+
+template <typename Table, typename Visit>
+void visitEmitterColumns(Table& table, Visit&& visit) {
+    visit(table.id);
+    visit(table.type);
+    visit(table.category);
+    visit(table.lat);
+    visit(table.lon);
+    visit(table.altitude);
+    visit(table.heading);
+    visit(table.speed);
+    visit(table.freqMin);
+    visit(table.freqMax);
+    visit(table.eaPriority);
+    visit(table.esPriority);
+    visit(table.jamIneffective);
+    visit(table.jamEffective);
+    visit(table.active);
+    visit(table.jamResponsible);
+    visit(table.reactiveEligible);
+    visit(table.preemptiveEligible);
+    visit(table.consentRequired);
+    visit(table.operatorManaged);
+    visit(table.jam);
+}
+
+class PayloadWriter {
+public:
+    explicit PayloadWriter(std::string& out) : out(out) {}
+    void bytes(const void* data, std::size_t size) {
+        out.append(static_cast<const char*>(data), size);
+        out.append(padded(size) - size, '\0');
+    }
+    void operator()(const std::vector<double>& column) { bytes(column.data(), column.size() * sizeof(double)); }
+    void operator()(const std::vector<int>& column) { bytes(column.data(), column.size() * sizeof(int)); }
+    void operator()(const BitColumn& column) { bytes(column.data().data(), column.data().size() * sizeof(std::uint64_t)); }
+    void operator()(const std::vector<QString>& column) {
+        std::vector<std::uint32_t> offsets(column.size() + 1, 0);
+        for (std::size_t i = 0; i < column.size(); ++i) {
+            offsets[i + 1] = offsets[i] + static_cast<std::uint32_t>(column[i].size());
+        }
+        bytes(offsets.data(), offsets.size() * sizeof(std::uint32_t));
+        const std::size_t start = out.size();
+        for (const QString& text : column) {
+            out.append(reinterpret_cast<const char*>(text.constData()), text.size() * sizeof(QChar));
+        }
+        out.append(padded(out.size() - start) - (out.size() - start), '\0');
+    }
+    void text(const std::string& value) {
+        const auto length = static_cast<std::uint32_t>(value.size());
+        bytes(&length, sizeof(length));
+        bytes(value.data(), value.size());
+    }
+
+private:
+    std::string& out;
+};
+
+// Reads columns of rows entries back, throwing std::runtime_error if the payload is too short
+class PayloadReader {
+public:
+    PayloadReader(const char* data, std::size_t size) : position(data), end(data + size) {}
+    std::size_t rows = 0;
+
+    const char* take(std::size_t size) {
+        if (size > static_cast<std::size_t>(end - position)) {
+            throw std::runtime_error("checkpoint is truncated");
+        }
+        const char* data = position;
+        position += std::min(padded(size), static_cast<std::size_t>(end - position));
+        return data;
+    }
+    // Takes count elements of size bytes, checked before anything sized by count is allocated
+    const char* take(std::size_t count, std::size_t size) {
+        if (count > static_cast<std::size_t>(end - position) / size) {
+            throw std::runtime_error("checkpoint is truncated");
+        }
+        return take(count * size);
+    }
+    template <typename T>
+    void copy(std::vector<T>& column) {
+        const char* data = take(rows, sizeof(T));
+        column.resize(rows);
+        if (rows > 0) {
+            std::memcpy(column.data(), data, rows * sizeof(T));
+        }
+    }
+    void operator()(std::vector<double>& column) { copy(column); }
+    void operator()(std::vector<int>& column) { copy(column); }
+    void operator()(BitColumn& column) {
+        const std::size_t words = (rows + 63) / 64;
+        const char* data = take(words, sizeof(std::uint64_t));
+        std::vector<std::uint64_t> packed(words);
+        if (words > 0) {
+            std::memcpy(packed.data(), data, words * sizeof(std::uint64_t));
+        }
+        column.assign(packed.data(), rows);
+    }
+    void operator()(std::vector<QString>& column) {
+        const char* data = take(rows + 1, sizeof(std::uint32_t));
+        std::vector<std::uint32_t> offsets(rows + 1);
+        std::memcpy(offsets.data(), data, offsets.size() * sizeof(std::uint32_t));
+        for (std::size_t i = 0; i < rows; ++i) {
+            if (offsets[i + 1] < offsets[i]) {
+                throw std::runtime_error("checkpoint has a corrupt string column");
+            }
+        }
+        const char* characters = take(std::size_t(offsets[rows]) * sizeof(QChar));
+        column.clear();
+        column.reserve(rows);
+        for (std::size_t i = 0; i < rows; ++i) {
+            column.emplace_back(reinterpret_cast<const QChar*>(characters + offsets[i] * sizeof(QChar)),
+                                static_cast<int>(offsets[i + 1] - offsets[i]));
+        }
+    }
+    std::string text() {
+        std::uint32_t length;
+        std::memcpy(&length, take(sizeof(length)), sizeof(length));
+        return std::string(take(length), length);
+    }
+
+private:
+    const char* position;
+    const char* end;
+};
+
+std::int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+}
+
+/*!
+    \fn EntityCheckpoint::State EntityCheckpoint::capture(const EntityStore& store, std::uint64_t sequence)
+    \brief Copies the columns and applied settings of a store.
+    \param store The store to copy, which the caller must keep from changing during the call.
+    \param sequence The update sequence the store has reached, restored by load().
+    \return A copy that can be encoded and written without holding the store's lock.
+*/
+EntityCheckpoint::State EntityCheckpoint::capture(const EntityStore& store, std::uint64_t sequence) {
+    State state;
+    state.sequence = sequence;
+    state.pes = store.peTable;
+    state.emitters = store.emitterTable;
+    for (const auto& column : store.peSettings) {
+        state.peSettings.emplace_back(column.name, column.values);
+    }
+    for (const auto& column : store.emitterSettings) {
+        state.emitterSettings.emplace_back(column.name, column.values);
+    }
+    return state;
+}
+
+/*!
+    \fn std::string EntityCheckpoint::encode(const State& state)
+    \brief Serialises a captured state.
+    \param state The state returned by capture().
+    \return The checkpoint file contents, a CheckpointHeader followed by the columns.
+*/
+std::string EntityCheckpoint::encode(const State& state) {
+    std::string out(sizeof(CheckpointHeader), '\0');
+    PayloadWriter writer(out);
+    visitPEColumns(state.pes, writer);
+    for (const auto& [name, values] : state.peSettings) {
+        writer.text(name);
+        writer(values);
+    }
+    visitEmitterColumns(state.emitters, writer);
+    for (const auto& [name, values] : state.emitterSettings) {
+        writer.text(name);
+        writer(values);
+    }
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, CheckpointHeader::kMagic, sizeof(header.magic));
+    header.version = CheckpointHeader::kVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.sequence = state.sequence;
+    header.createdNs = nowNs();
+    header.peRows = static_cast<std::uint32_t>(state.pes.size());
+    header.emitterRows = static_cast<std::uint32_t>(state.emitters.size());
+    header.peSettingColumns = static_cast<std::uint32_t>(state.peSettings.size());
+    header.emitterSettingColumns = static_cast<std::uint32_t>(state.emitterSettings.size());
+    header.payloadBytes = out.size() - sizeof(CheckpointHeader);
+    std::memcpy(&out[0], &header, sizeof(header));
+    return out;
+}
+
+/*!
+    \fn bool EntityCheckpoint::write(const State& state, const std::string& path)
+    \brief Writes a checkpoint file, replacing any previous one atomically.
+    \param state The state returned by capture().
+    \param path The checkpoint file.
+    \return True if the checkpoint was written and synced, false otherwise.
+
+    The file is written beside path and renamed over it once complete, so a
+    crash while writing leaves the previous checkpoint in place.
+*/
+bool EntityCheckpoint::write(const State& state, const std::string& path) {
+    const std::string data = encode(state);
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        ANI_LOG_ERROR("EntityCheckpoint", "Cannot create checkpoint " + temporary);
+        return false;
+    }
+    bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size() && std::fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+    written = written && ::fsync(::fileno(file)) == 0;
+#endif
+    written = std::fclose(file) == 0 && written;
+    std::error_code ec;
+    if (written) {
+        std::filesystem::rename(temporary, path, ec);
+    }
+    if (!written || ec) {
+        ANI_LOG_ERROR("EntityCheckpoint", "Failed to write checkpoint " + path);
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \fn bool EntityCheckpoint::load(const std::string& path, EntityStore& store, std::uint64_t& sequence)
+    \brief Replaces the contents of a store with a checkpoint.
+    \param path The checkpoint file.
+    \param store The store to fill, left unchanged if loading fails.
+    \param sequence Set to the sequence the checkpoint was captured at.
+    \return True if the checkpoint was loaded, false if it is missing, corrupt or from another version.
+
+    Every loaded row is marked changed, so a consumer's next takeChanges()
+    publishes the whole picture. Meant for start-up, before live updates are
+    applied: rows of the store that the checkpoint does not hold are dropped.
+*/
+bool EntityCheckpoint::load(const std::string& path, EntityStore& store, std::uint64_t& sequence) {
+    try {
+        boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region region(file, boost::interprocess::read_only);
+        const char* base = static_cast<const char*>(region.get_address());
+        const std::size_t size = region.get_size();
+
+        CheckpointHeader header;
+        if (size < sizeof(header)) {
+            throw std::runtime_error("file is too short");
+        }
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, CheckpointHeader::kMagic, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("not a checkpoint");
+        }
+        if (header.version != CheckpointHeader::kVersion || header.byteOrderMark != kByteOrderMark) {
+            throw std::runtime_error("written by an incompatible version or byte order");
+        }
+        if (header.payloadBytes != size - sizeof(header)) {
+            throw std::runtime_error("checkpoint is truncated");
+        }
+
+        EntityStore loaded;
+        PayloadReader reader(base + sizeof(header), header.payloadBytes);
+        reader.rows = header.peRows;
+        visitPEColumns(loaded.peTable, reader);
+        for (std::uint32_t i = 0; i < header.peSettingColumns; ++i) {
+            EntityStore::SettingColumn column{reader.text(), {}};
+            reader(column.values);
+            loaded.peSettings.push_back(std::move(column));
+        }
+        reader.rows = header.emitterRows;
+        visitEmitterColumns(loaded.emitterTable, reader);
+        for (std::uint32_t i = 0; i < header.emitterSettingColumns; ++i) {
+            EntityStore::SettingColumn column{reader.text(), {}};
+            reader(column.values);
+            loaded.emitterSettings.push_back(std::move(column));
+        }
+
+        loaded.peIndex.reserve(static_cast<int>(header.peRows));
+        loaded.peDirty.resize(header.peRows);
+        for (std::uint32_t row = 0; row < header.peRows; ++row) {
+            if (loaded.peIndex.contains(loaded.peTable.id[row])) {
+                throw std::runtime_error("duplicate PE id");
+            }
+            loaded.peIndex.insert(loaded.peTable.id[row], row);
+            loaded.peSpatial.update(row, loaded.peTable.lat[row], loaded.peTable.lon[row]);
+            loaded.markPEDirty(row);
+        }
+        const EmitterTable& emitters = loaded.emitterTable;
+        loaded.emitterIndex.reserve(static_cast<int>(header.emitterRows));
+        loaded.emitterDirty.resize(header.emitterRows);
+        for (std::uint32_t row = 0; row < header.emitterRows; ++row) {
+            if (loaded.emitterIndex.contains(emitters.id[row])) {
+                throw std::runtime_error("duplicate Emitter id");
+            }
+            loaded.emitterIndex.insert(emitters.id[row], row);
+            loaded.emitterSpatial.update(row, emitters.lat[row], emitters.lon[row]);
+            loaded.emitterFrequencies.update(row, emitters.freqMin[row], emitters.freqMax[row], emitters.active.test(row));
+            loaded.markEmitterDirty(row);
+        }
+
+        store = std::move(loaded);
+        sequence = header.sequence;
+        ANI_LOG_INFO("EntityCheckpoint", "Loaded " + std::to_string(header.peRows) + " PEs and "
+                                         + std::to_string(header.emitterRows) + " Emitters from " + path);
+        return true;
+    } catch (const std::exception& e) {
+        ANI_LOG_ERROR("EntityCheckpoint", "Failed to load checkpoint " + path + ": " + e.what());
+        return false;
+    }
+}
+
+/*!
+    \class CheckpointWriter
+    \brief Takes periodic checkpoints on a background thread.
+
+    Each interval the writer calls its capture function, which copies the
+    store under whatever lock the owner uses, then encodes and writes the
+    copy with no lock held. stop() writes one last checkpoint, so a clean
+    shutdown restarts from the latest state.
+
+    An owner whose store may only be read on its own thread, such as the GUI
+    thread, captures the state itself and post()s it instead, so only the
+    encoding, sync and rename happen on the writer thread.
+*/
+
+/*!
+    \fn CheckpointWriter::CheckpointWriter(const std::string& path, std::chrono::milliseconds interval, Capture capture)
+    \brief Creates a writer, nothing is written until start().
+    \param path The checkpoint file to keep replacing.
+    \param interval The time between checkpoints.
+    \param capture Returns the state to write, called on the writer thread.
+*/
+CheckpointWriter::CheckpointWriter(const std::string& path, std::chrono::milliseconds interval, Capture capture)
+    : path(path), interval(interval), capture(std::move(capture)) {}
+
+/*!
+    \fn CheckpointWriter::CheckpointWriter(const std::string& path)
+    \brief Creates a writer that only writes the states passed to post().
+    \param path The checkpoint file to keep replacing.
+*/
+CheckpointWriter::CheckpointWriter(const std::string& path)
+    : path(path), interval(0) {}
+
+/*!
+    \fn CheckpointWriter::~CheckpointWriter()
+    \brief Stops the writer if it is running, writing a final checkpoint.
+*/
+CheckpointWriter::~CheckpointWriter() {
+    stop();
+}
+
+/*!
+    \fn void CheckpointWriter::start()
+    \brief Starts the writer thread.
+*/
+void CheckpointWriter::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (thread.joinable()) {
+        return;
+    }
+    stopping = false;
+    thread = std::thread(&CheckpointWriter::run, this);
+}
+
+/*!
+    \fn void CheckpointWriter::stop()
+    \brief Joins the writer thread and writes a final checkpoint. Safe to call more than once.
+
+    A posted state not yet written is written first.
+*/
+void CheckpointWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!thread.joinable()) {
+            return;
+        }
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+    if (posted) {
+        writeState(*posted, std::chrono::steady_clock::now());
+        posted.reset();
+    }
+    writeOnce();
+}
+
+/*!
+    \fn void CheckpointWriter::post(EntityCheckpoint::State state)
+    \brief Queues a captured state to be written on the writer thread.
+    \param state The state to write, captured by the caller.
+
+    Returns at once. Only the latest posted state is kept, so posting faster
+    than states can be written skips the older ones. Failures are logged and
+    counted by failedCount().
+*/
+void CheckpointWriter::post(EntityCheckpoint::State state) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        posted = std::move(state);
+    }
+    wake.notify_all();
+}
+
+void CheckpointWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        const auto woken = [this]() { return stopping || posted.has_value(); };
+        if (capture) {
+            wake.wait_for(lock, interval, woken);
+        } else {
+            wake.wait(lock, woken);
+        }
+        if (stopping) {
+            return;
+        }
+        std::optional<EntityCheckpoint::State> state;
+        state.swap(posted);
+        lock.unlock();
+        if (state) {
+            writeState(*state, std::chrono::steady_clock::now());
+        } else {
+            writeOnce();
+        }
+        lock.lock();
+    }
+}
+
+void CheckpointWriter::writeOnce() {
+    if (!capture) {
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    writeState(capture(), start);
+}
+
+void CheckpointWriter::writeState(const EntityCheckpoint::State& state, std::chrono::steady_clock::time_point start) {
+    if (!EntityCheckpoint::write(state, path)) {
+        ++failed;
+        return;
+    }
+    ++written;
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ANI_LOG_DEBUG("CheckpointWriter", "Wrote " + std::to_string(state.pes.size()) + " PEs and "
+                                      + std::to_string(state.emitters.size()) + " Emitters to " + path
+                                      + " in " + std::to_string(elapsed.count()) + " ms");
+}
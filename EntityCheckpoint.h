@@ -0,0 +1,96 @@
+#ifndef ENTITYCHECKPOINT_H
+#define ENTITYCHECKPOINT_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "EntityStore.h"
+
+// Fixed header at the start of a checkpoint file, followed by payloadBytes of column data
+struct CheckpointHeader {
+    static constexpr char kMagic[8] = {'A', 'N', 'I', 'C', 'K', 'P', 'T', '1'};
+    // Bumped whenever a column is added, removed or reordered
+    static constexpr std::uint32_t kVersion = 1;
+    char magic[8];
+    std::uint32_t version;
+    // Detects a checkpoint written on a machine of the other byte order
+    std::uint32_t byteOrderMark;
+    std::uint64_t sequence;
+    std::int64_t createdNs;
+    std::uint32_t peRows;
+    std::uint32_t emitterRows;
+    std::uint32_t peSettingColumns;
+    std::uint32_t emitterSettingColumns;
+    std::uint64_t payloadBytes;
+    char reserved[8];
+};
+
+// Compact binary snapshot of an EntityStore's columns and applied settings
+class EntityCheckpoint {
+public:
+    // Column copies taken under the caller's lock, QString columns share their data so this is cheap
+    struct State {
+        std::uint64_t sequence = 0;
+        PETable pes;
+        EmitterTable emitters;
+        std::vector<std::pair<std::string, std::vector<int>>> peSettings;
+        std::vector<std::pair<std::string, std::vector<int>>> emitterSettings;
+    };
+
+    static State capture(const EntityStore& store, std::uint64_t sequence = 0);
+    // Serialise a state to the checkpoint file format
+    static std::string encode(const State& state);
+    // Write to path.tmp, sync and rename over path, so readers never see a partial file
+    static bool write(const State& state, const std::string& path);
+    // Map a checkpoint and replace the store's contents with it, every row is reported by the next takeChanges()
+    static bool load(const std::string& path, EntityStore& store, std::uint64_t& sequence);
+};
+
+// Writes a checkpoint on its own thread every interval, and once more when stopped, or writes the
+// states posted to it
+class CheckpointWriter {
+public:
+    // Called on the writer thread, must take whatever lock guards the store
+    using Capture = std::function<EntityCheckpoint::State()>;
+
+    CheckpointWriter(const std::string& path, std::chrono::milliseconds interval, Capture capture);
+    // Only writes posted states, for owners whose store can only be read on their own thread
+    explicit CheckpointWriter(const std::string& path);
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    void start();
+    // Write a final checkpoint and join the thread
+    void stop();
+    // Write state on the writer thread, replacing a posted state it has not started on yet
+    void post(EntityCheckpoint::State state);
+    const std::string& filePath() const { return path; }
+    std::uint64_t writtenCount() const { return written; }
+    std::uint64_t failedCount() const { return failed; }
+
+private:
+    void run();
+    void writeOnce();
+    void writeState(const EntityCheckpoint::State& state, std::chrono::steady_clock::time_point start);
+
+    std::string path;
+    std::chrono::milliseconds interval;
+    Capture capture;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::optional<EntityCheckpoint::State> posted;
+    std::atomic<std::uint64_t> written{0};
+    std::atomic<std::uint64_t> failed{0};
+    std::thread thread;
+};
+
+#endif // ENTITYCHECKPOINT_H
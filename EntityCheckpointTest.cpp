@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include "EntityCheckpoint.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace {
+std::string checkpointPath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("ani-checkpoint-" + name + ".bin")).string();
+}
+
+void fillStore(EntityStore& store, int pes, int emitters) {
+    for (int i = 0; i < pes; ++i) {
+        PE pe(QString("PE%1").arg(i), "F18", 10.0 + i * 0.01, 20.0 - i * 0.01, 30000.0, 500.0, "MED", "HIGH", i % 2 == 0, i % 3 == 0);
+        pe.heading = i % 360;
+        pe.state = "Tracked é";
+        store.applyPE(pe);
+    }
+    for (int i = 0; i < emitters; ++i) {
+        store.applyEmitter(Emitter(QString("EM%1").arg(i), "Radar", "Search", 15.0 + i * 0.01, 25.0, 8000.0 + i, 12000.0 + i, i % 2 == 0));
+    }
+}
+}
+
+TEST(EntityCheckpointTest, RoundTripRestoresEveryColumnAndSetting) {
+    const std::string path = checkpointPath("roundtrip");
+    EntityStore original;
+    fillStore(original, 50, 20);
+    original.applySetting(std::make_tuple("PE_SETTING", "PE3", "APD", 7));
+    original.applySetting(std::make_tuple("EMITTER_SETTING", "EM4", "JAM_EFFECTIVE", 2));
+    original.applySetting(std::make_tuple("EMITTER_SETTING", "EM5", "CUSTOM", 9));
+    ASSERT_TRUE(EntityCheckpoint::write(EntityCheckpoint::capture(original, 1234), path));
+
+    EntityStore restored;
+    std::uint64_t sequence = 0;
+    ASSERT_TRUE(EntityCheckpoint::load(path, restored, sequence));
+    EXPECT_EQ(sequence, 1234u);
+    ASSERT_EQ(restored.pes().size(), 50u);
+    ASSERT_EQ(restored.emitters().size(), 20u);
+
+    for (std::uint32_t row = 0; row < 50; ++row) {
+        const PE expected = original.pe(row);
+        const PE actual = restored.pe(row);
+        EXPECT_EQ(actual.id, expected.id);
+        EXPECT_EQ(actual.state, expected.state);
+        EXPECT_DOUBLE_EQ(actual.lat, expected.lat);
+        EXPECT_DOUBLE_EQ(actual.heading, expected.heading);
+        EXPECT_EQ(actual.jam, expected.jam);
+        EXPECT_EQ(actual.ghost, expected.ghost);
+    }
+    for (std::uint32_t row = 0; row < 20; ++row) {
+        EXPECT_EQ(restored.emitter(row).id, original.emitter(row).id);
+        EXPECT_EQ(restored.emitter(row).active, original.emitter(row).active);
+        EXPECT_DOUBLE_EQ(restored.emitter(row).freqMax, original.emitter(row).freqMax);
+    }
+    EXPECT_EQ(restored.emitters().jamEffective[4], 2);
+    ASSERT_NE(restored.peSetting("APD"), nullptr);
+    EXPECT_EQ((*restored.peSetting("APD"))[3], 7);
+    ASSERT_NE(restored.emitterSetting("CUSTOM"), nullptr);
+    EXPECT_EQ((*restored.emitterSetting("CUSTOM"))[5], 9);
+
+    // Lookups and indexes are rebuilt, and later updates land on the restored rows
+    EXPECT_EQ(restored.peRow("PE42"), 42);
+    EXPECT_EQ(restored.peLocations().size(), 50u);
+    EXPECT_EQ(restored.emitterBands().overlapping(8005.0, 8005.0).size(), original.emitterBands().overlapping(8005.0, 8005.0).size());
+    EXPECT_EQ(restored.applyPE(PE("PE7", "F35", 1.0, 2.0, 3.0, 4.0, "LOW", "LOW", false, false)), 7u);
+    std::filesystem::remove(path);
+}
+
+TEST(EntityCheckpointTest, LoadedRowsAreReportedAsChanges) {
+    const std::string path = checkpointPath("changes");
+    EntityStore original;
+    fillStore(original, 3, 2);
+    ASSERT_TRUE(EntityCheckpoint::write(EntityCheckpoint::capture(original), path));
+
+    EntityStore restored;
+    std::uint64_t sequence = 0;
+    ASSERT_TRUE(EntityCheckpoint::load(path, restored, sequence));
+    const EntityChangeSet changes = restored.takeChanges();
+    EXPECT_EQ(changes.pes, (std::vector<std::uint32_t>{0, 1, 2}));
+    EXPECT_EQ(changes.emitters, (std::vector<std::uint32_t>{0, 1}));
+    std::filesystem::remove(path);
+}
+
+TEST(EntityCheckpointTest, DamagedCheckpointsLeaveTheStoreUnchanged) {
+    const std::string path = checkpointPath("damaged");
+    EntityStore original;
+    fillStore(original, 10, 10);
+    const std::string data = EntityCheckpoint::encode(EntityCheckpoint::capture(original));
+
+    EntityStore target;
+    fillStore(target, 1, 0);
+    std::uint64_t sequence = 99;
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(data.data(), static_cast<std::streamsize>(data.size() / 2));
+    }
+    EXPECT_FALSE(EntityCheckpoint::load(path, target, sequence));
+    {
+        std::string wrongMagic = data;
+        wrongMagic[0] = 'X';
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(wrongMagic.data(), static_cast<std::streamsize>(wrongMagic.size()));
+    }
+    EXPECT_FALSE(EntityCheckpoint::load(path, target, sequence));
+    EXPECT_FALSE(EntityCheckpoint::load(checkpointPath("missing"), target, sequence));
+    EXPECT_EQ(target.pes().size(), 1u);
+    EXPECT_EQ(sequence, 99u);
+    std::filesystem::remove(path);
+}
+
+TEST(EntityCheckpointTest, HugeRowCountsAreRejectedBeforeAllocating) {
+    const std::string path = checkpointPath("rows");
+    EntityStore original;
+    fillStore(original, 2, 1);
+    std::string data = EntityCheckpoint::encode(EntityCheckpoint::capture(original));
+
+    // A header that claims far more rows than its payload holds
+    CheckpointHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    header.peRows = 0xFFFFFFF0u;
+    header.emitterRows = 0xFFFFFFF0u;
+    std::memcpy(&data[0], &header, sizeof(header));
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    EntityStore target;
+    fillStore(target, 1, 0);
+    std::uint64_t sequence = 99;
+    EXPECT_FALSE(EntityCheckpoint::load(path, target, sequence));
+    EXPECT_EQ(target.pes().size(), 1u);
+    EXPECT_EQ(sequence, 99u);
+    std::filesystem::remove(path);
+}
+
+TEST(EntityCheckpointTest, WriterCheckpointsPeriodicallyAndOnStop) {
+    const std::string path = checkpointPath("writer");
+    std::filesystem::remove(path);
+    EntityStore store;
+    fillStore(store, 5, 0);
+    std::mutex mutex;
+    CheckpointWriter writer(path, std::chrono::milliseconds(20), [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return EntityCheckpoint::capture(store, 5);
+    });
+    writer.start();
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (writer.writtenCount() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_GE(writer.writtenCount(), 2u);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fillStore(store, 8, 0);
+    }
+    writer.stop();
+    EntityStore restored;
+    std::uint64_t sequence = 0;
+    ASSERT_TRUE(EntityCheckpoint::load(path, restored, sequence));
+    EXPECT_EQ(restored.pes().size(), 8u);
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+    std::filesystem::remove(path);
+}
+
+TEST(EntityCheckpointTest, WriterWritesPostedStatesInTheBackground) {
+    const std::string path = checkpointPath("posted");
+    std::filesystem::remove(path);
+    EntityStore store;
+    fillStore(store, 3, 1);
+    CheckpointWriter writer(path);
+    writer.start();
+    writer.post(EntityCheckpoint::capture(store, 3));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (writer.writtenCount() < 1 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT_EQ(writer.writtenCount(), 1u);
+
+    // Nothing is captured on the writer thread, stop() only writes what was posted
+    fillStore(store, 6, 1);
+    writer.post(EntityCheckpoint::capture(store, 6));
+    writer.stop();
+    EXPECT_EQ(writer.writtenCount(), 2u);
+    EXPECT_EQ(writer.failedCount(), 0u);
+    EntityStore restored;
+    std::uint64_t sequence = 0;
+    ASSERT_TRUE(EntityCheckpoint::load(path, restored, sequence));
+    EXPECT_EQ(sequence, 6u);
+    EXPECT_EQ(restored.pes().size(), 6u);
+    EXPECT_EQ(restored.emitters().size(), 1u);
+    std::filesystem::remove(path);
+
+    CheckpointWriter unwritable((std::filesystem::temp_directory_path() / "ani-missing-dir" / "checkpoint.bin").string());
+    unwritable.start();
+    unwritable.post(EntityCheckpoint::capture(store));
+    unwritable.stop();
+    EXPECT_EQ(unwritable.writtenCount(), 0u);
+    EXPECT_EQ(unwritable.failedCount(), 1u);
+}
@@ -0,0 +1,248 @@
+#include "EntityModels.h"
+#include <algorithm>
+
+/*!
+    \class EntityListModel
+    \brief Base for list models that present one EntityStore table to QML.
+
+    Store rows are dense and never removed, so model rows map one to one onto
+    store rows and updates are applied in place. Rather than signalling every
+    update, the owner calls commitChanges() once per frame with the rows the
+    store reports as changed: rows the model has not seen yet are announced with
+    a single rowsInserted, and the remaining rows with a single dataChanged range
+    covering all of them.
+*/
+
+/*!
+    \fn EntityListModel::EntityListModel(const EntityStore* store, QObject *parent)
+    \brief Constructs a model over a store, which must outlive the model.
+*/
+EntityListModel::EntityListModel(const EntityStore* store, QObject *parent)
+    : QAbstractListModel(parent), m_store(store)
+{
+}
+
+/*!
+    \fn int EntityListModel::rowCount(const QModelIndex& parent) const
+    \brief Returns the number of rows announced so far.
+*/
+int EntityListModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rows;
+}
+
+/*!
+    \fn void EntityListModel::commitChanges(const std::vector<std::uint32_t>& rows)
+    \brief Announces the rows changed in the store since the last commit.
+    \param rows The changed rows, as returned by EntityStore::takeChanges().
+
+    Emits at most one rowsInserted and one dataChanged, however many rows changed.
+*/
+void EntityListModel::commitChanges(const std::vector<std::uint32_t>& rows)
+{
+    const int known = m_rows;
+    const int total = storeRowCount();
+    if (total > known) {
+        beginInsertRows(QModelIndex(), known, total - 1);
+        m_rows = total;
+        endInsertRows();
+    }
+
+    int first = known;
+    int last = -1;
+    for (std::uint32_t row : rows) {
+        if (static_cast<int>(row) < known) {
+            first = std::min(first, static_cast<int>(row));
+            last = std::max(last, static_cast<int>(row));
+        }
+    }
+    if (last >= first) {
+        emit dataChanged(index(first), index(last));
+    }
+}
+
+/*!
+    \class PEListModel
+    \brief List model over the PE rows of an EntityStore.
+
+    Roles are integers from the Roles enum, named after the PE fields for QML
+    delegates.
+*/
+
+/*!
+    \fn PEListModel::PEListModel(const EntityStore* store, QObject *parent)
+    \brief Constructs a PE model over a store, which must outlive the model.
+*/
+PEListModel::PEListModel(const EntityStore* store, QObject *parent)
+    : EntityListModel(store, parent)
+{
+}
+
+/*!
+    \fn QVariant PEListModel::data(const QModelIndex& index, int role) const
+    \brief Returns one field of a PE, read directly from the store columns.
+*/
+QVariant PEListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+    const PETable& table = m_store->pes();
+    const std::size_t row = static_cast<std::size_t>(index.row());
+    switch (role) {
+    case IdRole: return table.id[row];
+    case TypeRole: return table.type[row];
+    case LatRole: return table.lat[row];
+    case LonRole: return table.lon[row];
+    case AltitudeRole: return table.altitude[row];
+    case SpeedRole: return table.speed[row];
+    case HeadingRole: return table.heading[row];
+    case ApdRole: return table.apd[row];
+    case PriorityRole: return table.priority[row];
+    case JamRole: return table.jam.test(row);
+    case GhostRole: return table.ghost.test(row);
+    case CategoryRole: return table.category[row];
+    case StateRole: return table.state[row];
+    default: return QVariant();
+    }
+}
+
+/*!
+    \fn QHash<int, QByteArray> PEListModel::roleNames() const
+    \brief Returns the QML names of the PE roles, matching the QVariantMap keys used by the wrapper.
+*/
+QHash<int, QByteArray> PEListModel::roleNames() const
+{
+    static const QHash<int, QByteArray> names{
+        {IdRole, "id"},
+        {TypeRole, "type"},
+        {LatRole, "lat"},
+        {LonRole, "lon"},
+        {AltitudeRole, "altitude"},
+        {SpeedRole, "speed"},
+        {HeadingRole, "heading"},
+        {ApdRole, "apd"},
+        {PriorityRole, "priority"},
+        {JamRole, "jam"},
+        {GhostRole, "ghost"},
+        {CategoryRole, "category"},
+        {StateRole, "state"}
+    };
+    return names;
+}
+
+/*!
+    \fn int PEListModel::rowOf(const QString& id) const
+    \brief Returns the row of a PE, or -1 if it has not been announced yet.
+*/
+int PEListModel::rowOf(const QString& id) const
+{
+    const int row = m_store->peRow(id);
+    return row < rowCount() ? row : -1;
+}
+
+int PEListModel::storeRowCount() const
+{
+    return static_cast<int>(m_store->pes().size());
+}
+
+/*!
+    \class EmitterListModel
+    \brief List model over the Emitter rows of an EntityStore.
+
+    Roles are integers from the Roles enum, named after the Emitter fields for
+    QML delegates.
+*/
+
+/*!
+    \fn EmitterListModel::EmitterListModel(const EntityStore* store, QObject *parent)
+    \brief Constructs an Emitter model over a store, which must outlive the model.
+*/
+EmitterListModel::EmitterListModel(const EntityStore* store, QObject *parent)
+    : EntityListModel(store, parent)
+{
+}
+
+/*!
+    \fn QVariant EmitterListModel::data(const QModelIndex& index, int role) const
+    \brief Returns one field of an Emitter, read directly from the store columns.
+*/
+QVariant EmitterListModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+    const EmitterTable& table = m_store->emitters();
+    const std::size_t row = static_cast<std::size_t>(index.row());
+    switch (role) {
+    case IdRole: return table.id[row];
+    case TypeRole: return table.type[row];
+    case CategoryRole: return table.category[row];
+    case LatRole: return table.lat[row];
+    case LonRole: return table.lon[row];
+    case AltitudeRole: return table.altitude[row];
+    case HeadingRole: return table.heading[row];
+    case SpeedRole: return table.speed[row];
+    case FreqMinRole: return table.freqMin[row];
+    case FreqMaxRole: return table.freqMax[row];
+    case ActiveRole: return table.active.test(row);
+    case EaPriorityRole: return table.eaPriority[row];
+    case EsPriorityRole: return table.esPriority[row];
+    case JamResponsibleRole: return table.jamResponsible.test(row);
+    case ReactiveEligibleRole: return table.reactiveEligible.test(row);
+    case PreemptiveEligibleRole: return table.preemptiveEligible.test(row);
+    case ConsentRequiredRole: return table.consentRequired.test(row);
+    case OperatorManagedRole: return table.operatorManaged.test(row);
+    case JamRole: return table.jam.test(row);
+    case JamIneffectiveRole: return table.jamIneffective[row];
+    case JamEffectiveRole: return table.jamEffective[row];
+    default: return QVariant();
+    }
+}
+
+/*!
+    \fn QHash<int, QByteArray> EmitterListModel::roleNames() const
+    \brief Returns the QML names of the Emitter roles, matching the QVariantMap keys used by the wrapper.
+*/
+QHash<int, QByteArray> EmitterListModel::roleNames() const
+{
+    static const QHash<int, QByteArray> names{
+        {IdRole, "id"},
+        {TypeRole, "type"},
+        {CategoryRole, "category"},
+        {LatRole, "lat"},
+        {LonRole, "lon"},
+        {AltitudeRole, "altitude"},
+        {HeadingRole, "heading"},
+        {SpeedRole, "speed"},
+        {FreqMinRole, "freqMin"},
+        {FreqMaxRole, "freqMax"},
+        {ActiveRole, "active"},
+        {EaPriorityRole, "eaPriority"},
+        {EsPriorityRole, "esPriority"},
+        {JamResponsibleRole, "jamResponsible"},
+        {ReactiveEligibleRole, "reactiveEligible"},
+        {PreemptiveEligibleRole, "preemptiveEligible"},
+        {ConsentRequiredRole, "consentRequired"},
+        {OperatorManagedRole, "operatorManaged"},
+        {JamRole, "jam"},
+        {JamIneffectiveRole, "jamIneffective"},
+        {JamEffectiveRole, "jamEffective"}
+    };
+    return names;
+}
+
+/*!
+    \fn int EmitterListModel::rowOf(const QString& id) const
+    \brief Returns the row of an Emitter, or -1 if it has not been announced yet.
+*/
+int EmitterListModel::rowOf(const QString& id) const
+{
+    const int row = m_store->emitterRow(id);
+    return row < rowCount() ? row : -1;
+}
+
+int EmitterListModel::storeRowCount() const
+{
+    return static_cast<int>(m_store->emitters().size());
+}
@@ -0,0 +1,104 @@
+#ifndef ENTITYMODELS_H
+#define ENTITYMODELS_H
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QHash>
+#include <cstdint>
+#include <vector>
+#include "EntityStore.h"
+
+// Common row bookkeeping for list models over EntityStore tables, model row == store row
+class EntityListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit EntityListModel(const EntityStore* store, QObject *parent = nullptr);
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    // Announce the rows changed in the store since the last frame, new rows first then one dataChanged range
+    void commitChanges(const std::vector<std::uint32_t>& rows);
+
+protected:
+    virtual int storeRowCount() const = 0;
+    const EntityStore* m_store;
+
+private:
+    int m_rows = 0;
+};
+
+// List model over the PE rows of an EntityStore
+class PEListModel : public EntityListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        TypeRole,
+        LatRole,
+        LonRole,
+        AltitudeRole,
+        SpeedRole,
+        HeadingRole,
+        ApdRole,
+        PriorityRole,
+        JamRole,
+        GhostRole,
+        CategoryRole,
+        StateRole
+    };
+    Q_ENUM(Roles)
+
+    explicit PEListModel(const EntityStore* store, QObject *parent = nullptr);
+    QVariant data(const QModelIndex& index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    // Row of a PE by id, -1 if it has not been received
+    Q_INVOKABLE int rowOf(const QString& id) const;
+
+protected:
+    int storeRowCount() const override;
+};
+
+// List model over the Emitter rows of an EntityStore
+class EmitterListModel : public EntityListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1,
+        TypeRole,
+        CategoryRole,
+        LatRole,
+        LonRole,
+        AltitudeRole,
+        HeadingRole,
+        SpeedRole,
+        FreqMinRole,
+        FreqMaxRole,
+        ActiveRole,
+        EaPriorityRole,
+        EsPriorityRole,
+        JamResponsibleRole,
+        ReactiveEligibleRole,
+        PreemptiveEligibleRole,
+        ConsentRequiredRole,
+        OperatorManagedRole,
+        JamRole,
+        JamIneffectiveRole,
+        JamEffectiveRole
+    };
+    Q_ENUM(Roles)
+
+    explicit EmitterListModel(const EntityStore* store, QObject *parent = nullptr);
+    QVariant data(const QModelIndex& index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    // Row of an Emitter by id, -1 if it has not been received
+    Q_INVOKABLE int rowOf(const QString& id) const;
+
+protected:
+    int storeRowCount() const override;
+};
+
+#endif // ENTITYMODELS_H
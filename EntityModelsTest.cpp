@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "EntityModels.h"
+
+TEST(EntityModelsTest, CommitAnnouncesNewRowsOnce) {
+    EntityStore store;
+    PEListModel model(&store);
+    int inserts = 0;
+    int first = -1;
+    int last = -1;
+    QObject::connect(&model, &QAbstractItemModel::rowsInserted, [&](const QModelIndex&, int from, int to) {
+        ++inserts;
+        first = from;
+        last = to;
+    });
+
+    for (int i = 0; i < 100; ++i) {
+        store.applyPE(PE(QString("PE%1").arg(i), "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false));
+    }
+    EXPECT_EQ(model.rowCount(), 0);
+    model.commitChanges(store.takeChanges().pes);
+
+    EXPECT_EQ(inserts, 1);
+    EXPECT_EQ(first, 0);
+    EXPECT_EQ(last, 99);
+    EXPECT_EQ(model.rowCount(), 100);
+    EXPECT_EQ(model.rowOf("PE42"), 42);
+    EXPECT_EQ(model.data(model.index(42), PEListModel::IdRole).toString(), QString("PE42"));
+}
+
+TEST(EntityModelsTest, CommitCoalescesUpdatesIntoOneRange) {
+    EntityStore store;
+    EmitterListModel model(&store);
+    for (int i = 0; i < 10; ++i) {
+        store.applyEmitter(Emitter(QString("EM%1").arg(i), "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, false));
+    }
+    model.commitChanges(store.takeChanges().emitters);
+
+    int changes = 0;
+    int first = -1;
+    int last = -1;
+    QObject::connect(&model, &QAbstractItemModel::dataChanged, [&](const QModelIndex& topLeft, const QModelIndex& bottomRight) {
+        ++changes;
+        first = topLeft.row();
+        last = bottomRight.row();
+    });
+
+    for (int update = 0; update < 5; ++update) {
+        store.applyEmitter(Emitter("EM7", "RadarType", "Category", 15.0 + update, 25.0, 8000.0, 12000.0, true));
+        store.applySetting(std::make_tuple("EMITTER_SETTING", "EM2", "JAM", update % 2));
+    }
+    model.commitChanges(store.takeChanges().emitters);
+
+    EXPECT_EQ(changes, 1);
+    EXPECT_EQ(first, 2);
+    EXPECT_EQ(last, 7);
+    EXPECT_DOUBLE_EQ(model.data(model.index(7), EmitterListModel::LatRole).toDouble(), 19.0);
+    EXPECT_TRUE(model.data(model.index(7), EmitterListModel::ActiveRole).toBool());
+    EXPECT_EQ(model.roleNames().value(EmitterListModel::FreqMaxRole), QByteArray("freqMax"));
+}
@@ -0,0 +1,466 @@
+#include "EntityStore.h"
+#include "Logger.h"
+#include <unordered_map>
+
+/*!
+    \class EntityStore
+    \brief Structure-of-arrays store of the current PE and Emitter picture.
+
+    Each entity is given a dense row index the first time it is seen, and every
+    field lives in its own contiguous column, so iterating over one field for all
+    entities touches only that field's memory. Incoming PE, Emitter and setting
+    messages are applied in place and the touched rows are recorded, so consumers
+    can call takeChanges() once per frame and revisit only the dirty rows.
+    PE and Emitter positions are also kept in a SpatialIndex per table, so range
+    and nearest-neighbour queries never have to scan every row, and Emitter bands
+    are kept in a FrequencyIndex for band-overlap queries.
+
+    Rows are never removed, so a row index stays valid for the lifetime of the store.
+    The store is not internally synchronised; callers applying updates from several
+    threads must serialise access themselves.
+*/
+
+/*!
+    \fn std::uint32_t EntityStore::applyPE(const PE& pe)
+    \brief Inserts a new PE or updates an existing one in place.
+    \param pe The PE to apply.
+    \return The row index of the PE.
+*/
+std::uint32_t EntityStore::applyPE(const PE& pe) {
+    auto found = peIndex.constFind(pe.id);
+    const std::uint32_t row = found != peIndex.constEnd() ? found.value() : addPERow(pe.id);
+    peTable.type[row] = pe.type;
+    peTable.lat[row] = pe.lat;
+    peTable.lon[row] = pe.lon;
+    peTable.altitude[row] = pe.altitude;
+    peTable.speed[row] = pe.speed;
+    peTable.heading[row] = pe.heading;
+    peTable.apd[row] = pe.apd;
+    peTable.priority[row] = pe.priority;
+    peTable.category[row] = static_cast<int>(pe.category);
+    peTable.state[row] = pe.state;
+    peTable.jam.set(row, pe.jam);
+    peTable.ghost.set(row, pe.ghost);
+    peSpatial.update(row, pe.lat, pe.lon);
+    markPEDirty(row);
+    return row;
+}
+
+/*!
+    \fn std::uint32_t EntityStore::applyEmitter(const Emitter& emitter)
+    \brief Inserts a new Emitter or updates an existing one in place.
+    \param emitter The Emitter to apply.
+    \return The row index of the Emitter.
+*/
+std::uint32_t EntityStore::applyEmitter(const Emitter& emitter) {
+    auto found = emitterIndex.constFind(emitter.id);
+    const std::uint32_t row = found != emitterIndex.constEnd() ? found.value() : addEmitterRow(emitter.id);
+    emitterTable.type[row] = emitter.type;
+    emitterTable.category[row] = emitter.category;
+    emitterTable.lat[row] = emitter.lat;
+    emitterTable.lon[row] = emitter.lon;
+    emitterTable.altitude[row] = emitter.altitude;
+    emitterTable.heading[row] = emitter.heading;
+    emitterTable.speed[row] = emitter.speed;
+    emitterTable.freqMin[row] = emitter.freqMin;
+    emitterTable.freqMax[row] = emitter.freqMax;
+    emitterTable.eaPriority[row] = emitter.eaPriority;
+    emitterTable.esPriority[row] = emitter.esPriority;
+    emitterTable.jamIneffective[row] = emitter.jamIneffective;
+    emitterTable.jamEffective[row] = emitter.jamEffective;
+    emitterTable.active.set(row, emitter.active);
+    emitterTable.jamResponsible.set(row, emitter.jamResponsible);
+    emitterTable.reactiveEligible.set(row, emitter.reactiveEligible);
+    emitterTable.preemptiveEligible.set(row, emitter.preemptiveEligible);
+    emitterTable.consentRequired.set(row, emitter.consentRequired);
+    emitterTable.operatorManaged.set(row, emitter.operatorManaged);
+    emitterTable.jam.set(row, emitter.jam);
+    emitterSpatial.update(row, emitter.lat, emitter.lon);
+    emitterFrequencies.update(row, emitter.freqMin, emitter.freqMax, emitter.active);
+    markEmitterDirty(row);
+    return row;
+}
+
+/*!
+    \fn bool EntityStore::applySetting(const std::tuple<std::string, std::string, std::string, int>& setting)
+    \brief Applies a setting update to the entity it targets.
+    \param setting A (type, id, setting, value) tuple as returned by receiveSetting().
+    \return True if the setting was applied, false if the type or entity is unknown,
+    or if a FREQ_MIN or FREQ_MAX would leave the Emitter's band empty.
+
+    Settings naming a flag or counter of the entity (for example JAM or ACTIVE)
+    update that column. Any other setting is kept in a generic per-setting column,
+    readable through peSetting() and emitterSetting().
+
+    A lone FREQ_MIN or FREQ_MAX is checked against the other end of the current
+    band, so moving a band past itself needs both ends in one applySettings()
+    batch. Rejected bands are logged and counted by rejectedSettingCount().
+*/
+bool EntityStore::applySetting(const std::tuple<std::string, std::string, std::string, int>& setting) {
+    SettingTarget target;
+    if (!resolveTarget(setting, target)) {
+        return false;
+    }
+    const int value = std::get<3>(setting);
+    double freqMin = 0.0;
+    double freqMax = 0.0;
+    if (!target.isPE) {
+        freqMin = target.field == SettingField::EmitterFreqMin ? value : emitterTable.freqMin[target.row];
+        freqMax = target.field == SettingField::EmitterFreqMax ? value : emitterTable.freqMax[target.row];
+    }
+    if ((target.field == SettingField::EmitterFreqMin || target.field == SettingField::EmitterFreqMax)
+        && !validBand(std::get<1>(setting), freqMin, freqMax)) {
+        return false;
+    }
+    writeSetting(target, std::get<2>(setting), value);
+    return true;
+}
+
+/*!
+    \fn bool EntityStore::applySettings(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings)
+    \brief Applies every setting of a batch in order, or none of them.
+    \param settings (type, id, setting, value) tuples as returned by receiveSettingBatch().
+    \return True if the batch was applied, false if it was rejected and the store left unchanged.
+
+    The batch is checked before anything is written. It is rejected if any
+    setting has an unknown type or entity, or if any Emitter band it changes
+    would be empty once the whole batch is applied. Bands are checked in their
+    final state only, so a batch can move a band past its current range with
+    its FREQ_MIN and FREQ_MAX in either order. Rejections are logged and
+    counted by rejectedSettingCount().
+
+    Every row the batch touches is reported by the same takeChanges() call, so
+    models never publish part of a batch.
+*/
+bool EntityStore::applySettings(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) {
+    std::vector<SettingTarget> targets(settings.size());
+    // Final band of every Emitter row the batch moves, keyed by row
+    std::unordered_map<std::uint32_t, std::pair<double, double>> bands;
+    for (std::size_t i = 0; i < settings.size(); ++i) {
+        const auto& [type, id, name, value] = settings[i];
+        if (!resolveTarget(settings[i], targets[i])) {
+            ANI_LOG_WARN("EntityStore", "Rejected setting batch naming unknown " + type + " " + id);
+            ++rejectedSettings;
+            return false;
+        }
+        const std::uint32_t row = targets[i].row;
+        if (targets[i].field == SettingField::EmitterFreqMin || targets[i].field == SettingField::EmitterFreqMax) {
+            auto band = bands.try_emplace(row, emitterTable.freqMin[row], emitterTable.freqMax[row]).first;
+            (targets[i].field == SettingField::EmitterFreqMin ? band->second.first : band->second.second) = value;
+        }
+    }
+    for (const auto& [row, band] : bands) {
+        if (!validBand(emitterTable.id[row].toStdString(), band.first, band.second)) {
+            return false;
+        }
+    }
+    for (std::size_t i = 0; i < settings.size(); ++i) {
+        writeSetting(targets[i], std::get<2>(settings[i]), std::get<3>(settings[i]));
+    }
+    return true;
+}
+
+/*!
+    \fn void EntityStore::applySnapshot(const EntitySnapshot& snapshot)
+    \brief Applies every PE and Emitter held in a snapshot.
+    \param snapshot The snapshot to apply.
+*/
+void EntityStore::applySnapshot(const EntitySnapshot& snapshot) {
+    for (const auto& pe : snapshot.pes) {
+        applyPE(pe);
+    }
+    for (const auto& emitter : snapshot.emitters) {
+        applyEmitter(emitter);
+    }
+}
+
+/*!
+    \fn int EntityStore::peRow(const QString& id) const
+    \brief Looks up the row index of a PE.
+    \param id The ID of the PE.
+    \return The row index, or -1 if no PE with that ID has been applied.
+*/
+int EntityStore::peRow(const QString& id) const {
+    auto found = peIndex.constFind(id);
+    return found != peIndex.constEnd() ? static_cast<int>(found.value()) : -1;
+}
+
+/*!
+    \fn int EntityStore::emitterRow(const QString& id) const
+    \brief Looks up the row index of an Emitter.
+    \param id The ID of the Emitter.
+    \return The row index, or -1 if no Emitter with that ID has been applied.
+*/
+int EntityStore::emitterRow(const QString& id) const {
+    auto found = emitterIndex.constFind(id);
+    return found != emitterIndex.constEnd() ? static_cast<int>(found.value()) : -1;
+}
+
+/*!
+    \fn PE EntityStore::pe(std::uint32_t row) const
+    \brief Reassembles the PE stored at a row.
+    \param row A row index returned by applyPE() or peRow().
+    \return A PE object holding the current column values.
+*/
+PE EntityStore::pe(std::uint32_t row) const {
+    PE pe(
+        peTable.id[row],
+        peTable.type[row],
+        peTable.lat[row],
+        peTable.lon[row],
+        peTable.altitude[row],
+        peTable.speed[row],
+        peTable.apd[row],
+        peTable.priority[row],
+        peTable.jam.test(row),
+        peTable.ghost.test(row)
+    );
+    pe.heading = peTable.heading[row];
+    pe.category = static_cast<PE::PECategory>(peTable.category[row]);
+    pe.state = peTable.state[row];
+    return pe;
+}
+
+/*!
+    \fn Emitter EntityStore::emitter(std::uint32_t row) const
+    \brief Reassembles the Emitter stored at a row.
+    \param row A row index returned by applyEmitter() or emitterRow().
+    \return An Emitter object holding the current column values.
+*/
+Emitter EntityStore::emitter(std::uint32_t row) const {
+    Emitter emitter(
+        emitterTable.id[row],
+        emitterTable.type[row],
+        emitterTable.category[row],
+        emitterTable.lat[row],
+        emitterTable.lon[row],
+        emitterTable.freqMin[row],
+        emitterTable.freqMax[row],
+        emitterTable.active.test(row),
+        emitterTable.eaPriority[row],
+        emitterTable.esPriority[row],
+        emitterTable.jamResponsible.test(row),
+        emitterTable.reactiveEligible.test(row),
+        emitterTable.preemptiveEligible.test(row),
+        emitterTable.consentRequired.test(row),
+        emitterTable.jam.test(row)
+    );
+    emitter.altitude = emitterTable.altitude[row];
+    emitter.heading = emitterTable.heading[row];
+    emitter.speed = emitterTable.speed[row];
+    emitter.operatorManaged = emitterTable.operatorManaged.test(row);
+    emitter.jamIneffective = emitterTable.jamIneffective[row];
+    emitter.jamEffective = emitterTable.jamEffective[row];
+    return emitter;
+}
+
+/*!
+    \fn const std::vector<int>* EntityStore::peSetting(const std::string& setting) const
+    \brief Returns the generic column holding a PE setting.
+    \param setting The setting name, as passed to sendPESetting().
+    \return The column indexed by PE row, or nullptr if the setting has never been applied.
+*/
+const std::vector<int>* EntityStore::peSetting(const std::string& setting) const {
+    return findSettingColumn(peSettings, setting);
+}
+
+/*!
+    \fn const std::vector<int>* EntityStore::emitterSetting(const std::string& setting) const
+    \brief Returns the generic column holding an Emitter setting.
+    \param setting The setting name, as passed to sendEmitterSetting().
+    \return The column indexed by Emitter row, or nullptr if the setting has never been applied.
+*/
+const std::vector<int>* EntityStore::emitterSetting(const std::string& setting) const {
+    return findSettingColumn(emitterSettings, setting);
+}
+
+/*!
+    \fn EntityChangeSet EntityStore::takeChanges()
+    \brief Returns the rows changed since the previous call and clears the dirty state.
+    \return The dirty PE and Emitter rows, each listed once.
+
+    Newly inserted rows are included, and can be told apart by comparing
+    them against the table sizes seen at the previous call.
+*/
+EntityChangeSet EntityStore::takeChanges() {
+    EntityChangeSet result;
+    std::swap(result, changes);
+    peDirty.clear();
+    emitterDirty.clear();
+    return result;
+}
+
+bool EntityStore::resolveTarget(const std::tuple<std::string, std::string, std::string, int>& setting,
+                                SettingTarget& target) const {
+    const auto& [type, id, name, value] = setting;
+    target.isPE = type == "PE_SETTING";
+    if (!target.isPE && type != "EMITTER_SETTING") {
+        return false;
+    }
+    const int found = target.isPE ? peRow(QString::fromStdString(id)) : emitterRow(QString::fromStdString(id));
+    if (found < 0) {
+        return false;
+    }
+    target.row = static_cast<std::uint32_t>(found);
+    target.field = resolveSetting(target.isPE, name);
+    return true;
+}
+
+bool EntityStore::validBand(const std::string& id, double freqMin, double freqMax) {
+    if (freqMin < freqMax) {
+        return true;
+    }
+    ANI_LOG_WARN("EntityStore", "Rejected FREQ_MIN " + std::to_string(freqMin) + " and FREQ_MAX "
+                 + std::to_string(freqMax) + " for Emitter " + id + ", the band would be empty");
+    ++rejectedSettings;
+    return false;
+}
+
+void EntityStore::writeSetting(const SettingTarget& target, const std::string& name, int value) {
+    const std::uint32_t row = target.row;
+    switch (target.field) {
+    case SettingField::PEJam: peTable.jam.set(row, value != 0); break;
+    case SettingField::PEGhost: peTable.ghost.set(row, value != 0); break;
+    case SettingField::PECategory: peTable.category[row] = value; break;
+    case SettingField::EmitterActive: emitterTable.active.set(row, value != 0); break;
+    case SettingField::EmitterJam: emitterTable.jam.set(row, value != 0); break;
+    case SettingField::EmitterJamResponsible: emitterTable.jamResponsible.set(row, value != 0); break;
+    case SettingField::EmitterReactiveEligible: emitterTable.reactiveEligible.set(row, value != 0); break;
+    case SettingField::EmitterPreemptiveEligible: emitterTable.preemptiveEligible.set(row, value != 0); break;
+    case SettingField::EmitterConsentRequired: emitterTable.consentRequired.set(row, value != 0); break;
+    case SettingField::EmitterOperatorManaged: emitterTable.operatorManaged.set(row, value != 0); break;
+    case SettingField::EmitterJamIneffective: emitterTable.jamIneffective[row] = value; break;
+    case SettingField::EmitterJamEffective: emitterTable.jamEffective[row] = value; break;
+    case SettingField::EmitterFreqMin: emitterTable.freqMin[row] = value; break;
+    case SettingField::EmitterFreqMax: emitterTable.freqMax[row] = value; break;
+    case SettingField::Generic:
+        if (target.isPE) settingColumn(peSettings, name, peTable.size())[row] = value;
+        else settingColumn(emitterSettings, name, emitterTable.size())[row] = value;
+        break;
+    }
+
+    if (target.isPE) {
+        markPEDirty(row);
+    } else {
+        // Only the band and the active flag are indexed
+        if (target.field == SettingField::EmitterFreqMin || target.field == SettingField::EmitterFreqMax
+            || target.field == SettingField::EmitterActive) {
+            emitterFrequencies.update(row, emitterTable.freqMin[row], emitterTable.freqMax[row],
+                                      emitterTable.active.test(row));
+        }
+        markEmitterDirty(row);
+    }
+}
+
+EntityStore::SettingField EntityStore::resolveSetting(bool isPE, const std::string& setting) {
+    static const std::unordered_map<std::string, SettingField> peFields = {
+        {"JAM", SettingField::PEJam},
+        {"GHOST", SettingField::PEGhost},
+        {"CATEGORY", SettingField::PECategory},
+    };
+    static const std::unordered_map<std::string, SettingField> emitterFields = {
+        {"ACTIVE", SettingField::EmitterActive},
+        {"JAM", SettingField::EmitterJam},
+        {"JAM_RESPONSIBLE", SettingField::EmitterJamResponsible},
+        {"REACTIVE_ELIGIBLE", SettingField::EmitterReactiveEligible},
+        {"PREEMPTIVE_ELIGIBLE", SettingField::EmitterPreemptiveEligible},
+        {"CONSENT_REQUIRED", SettingField::EmitterConsentRequired},
+        {"OPERATOR_MANAGED", SettingField::EmitterOperatorManaged},
+        {"JAM_INEFFECTIVE", SettingField::EmitterJamIneffective},
+        {"JAM_EFFECTIVE", SettingField::EmitterJamEffective},
+        {"FREQ_MIN", SettingField::EmitterFreqMin},
+        {"FREQ_MAX", SettingField::EmitterFreqMax},
+    };
+    const auto& fields = isPE ? peFields : emitterFields;
+    auto found = fields.find(setting);
+    return found != fields.end() ? found->second : SettingField::Generic;
+}
+
+std::uint32_t EntityStore::addPERow(const QString& id) {
+    const auto row = static_cast<std::uint32_t>(peTable.size());
+    const std::size_t rows = row + 1;
+    peIndex.insert(id, row);
+    peTable.id.push_back(id);
+    peTable.type.emplace_back();
+    peTable.lat.push_back(0.0);
+    peTable.lon.push_back(0.0);
+    peTable.altitude.push_back(0.0);
+    peTable.speed.push_back(0.0);
+    peTable.heading.push_back(0.0);
+    peTable.apd.emplace_back();
+    peTable.priority.emplace_back();
+    peTable.category.push_back(0);
+    peTable.state.emplace_back();
+    peTable.jam.resize(rows);
+    peTable.ghost.resize(rows);
+    for (auto& column : peSettings) {
+        column.values.resize(rows, 0);
+    }
+    peDirty.resize(rows);
+    return row;
+}
+
+std::uint32_t EntityStore::addEmitterRow(const QString& id) {
+    const auto row = static_cast<std::uint32_t>(emitterTable.size());
+    const std::size_t rows = row + 1;
+    emitterIndex.insert(id, row);
+    emitterTable.id.push_back(id);
+    emitterTable.type.emplace_back();
+    emitterTable.category.emplace_back();
+    emitterTable.lat.push_back(0.0);
+    emitterTable.lon.push_back(0.0);
+    emitterTable.altitude.push_back(0.0);
+    emitterTable.heading.push_back(0.0);
+    emitterTable.speed.push_back(0.0);
+    emitterTable.freqMin.push_back(0.0);
+    emitterTable.freqMax.push_back(0.0);
+    emitterTable.eaPriority.emplace_back();
+    emitterTable.esPriority.emplace_back();
+    emitterTable.jamIneffective.push_back(0);
+    emitterTable.jamEffective.push_back(0);
+    emitterTable.active.resize(rows);
+    emitterTable.jamResponsible.resize(rows);
+    emitterTable.reactiveEligible.resize(rows);
+    emitterTable.preemptiveEligible.resize(rows);
+    emitterTable.consentRequired.resize(rows);
+    emitterTable.operatorManaged.resize(rows);
+    emitterTable.jam.resize(rows);
+    for (auto& column : emitterSettings) {
+        column.values.resize(rows, 0);
+    }
+    emitterDirty.resize(rows);
+    return row;
+}
+
+void EntityStore::markPEDirty(std::uint32_t row) {
+    if (!peDirty.test(row)) {
+        peDirty.set(row, true);
+        changes.pes.push_back(row);
+    }
+}
+
+void EntityStore::markEmitterDirty(std::uint32_t row) {
+    if (!emitterDirty.test(row)) {
+        emitterDirty.set(row, true);
+        changes.emitters.push_back(row);
+    }
+}
+
+std::vector<int>& EntityStore::settingColumn(std::vector<SettingColumn>& columns, const std::string& setting, std::size_t rows) {
+    for (auto& column : columns) {
+        if (column.name == setting) {
+            return column.values;
+        }
+    }
+    columns.push_back(SettingColumn{setting, std::vector<int>(rows, 0)});
+    return columns.back().values;
+}
+
+const std::vector<int>* EntityStore::findSettingColumn(const std::vector<SettingColumn>& columns, const std::string& setting) {
+    for (const auto& column : columns) {
+        if (column.name == setting) {
+            return &column.values;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,169 @@
+#ifndef ENTITYSTORE_H
+#define ENTITYSTORE_H
+
+#include <QHash>
+#include <QString>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "pe.h"
+#include "emitter.h"
+#include "FrequencyIndex.h"
+#include "MessageCodec.h"
+#include "SpatialIndex.h"
+
+// Packed per-row boolean column, 64 rows per word
+class BitColumn {
+public:
+    bool test(std::size_t row) const { return (words[row >> 6] >> (row & 63)) & 1u; }
+    void set(std::size_t row, bool value) {
+        const std::uint64_t bit = std::uint64_t(1) << (row & 63);
+        if (value) words[row >> 6] |= bit;
+        else words[row >> 6] &= ~bit;
+    }
+    void resize(std::size_t rows) { words.resize((rows + 63) / 64, 0); }
+    // Replace the column with rows bits copied from packed words
+    void assign(const std::uint64_t* source, std::size_t rows) { words.assign(source, source + (rows + 63) / 64); }
+    void clear() { std::fill(words.begin(), words.end(), 0); }
+    const std::vector<std::uint64_t>& data() const { return words; }
+
+private:
+    std::vector<std::uint64_t> words;
+};
+
+// Column storage for PE state, one entry per dense row index
+struct PETable {
+    std::vector<QString> id;
+    std::vector<QString> type;
+    std::vector<double> lat;
+    std::vector<double> lon;
+    std::vector<double> altitude;
+    std::vector<double> speed;
+    std::vector<double> heading;
+    std::vector<QString> apd;
+    std::vector<QString> priority;
+    std::vector<int> category;
+    std::vector<QString> state;
+    BitColumn jam;
+    BitColumn ghost;
+    std::size_t size() const { return id.size(); }
+};
+
+// Column storage for Emitter state, one entry per dense row index
+struct EmitterTable {
+    std::vector<QString> id;
+    std::vector<QString> type;
+    std::vector<QString> category;
+    std::vector<double> lat;
+    std::vector<double> lon;
+    std::vector<double> altitude;
+    std::vector<double> heading;
+    std::vector<double> speed;
+    std::vector<double> freqMin;
+    std::vector<double> freqMax;
+    std::vector<QString> eaPriority;
+    std::vector<QString> esPriority;
+    std::vector<int> jamIneffective;
+    std::vector<int> jamEffective;
+    BitColumn active;
+    BitColumn jamResponsible;
+    BitColumn reactiveEligible;
+    BitColumn preemptiveEligible;
+    BitColumn consentRequired;
+    BitColumn operatorManaged;
+    BitColumn jam;
+    std::size_t size() const { return id.size(); }
+};
+
+// Rows touched since the last call to EntityStore::takeChanges, in first-touched order
+struct EntityChangeSet {
+    std::vector<std::uint32_t> pes;
+    std::vector<std::uint32_t> emitters;
+    bool empty() const { return pes.empty() && emitters.empty(); }
+};
+
+class EntityStore {
+public:
+    EntityStore() = default;
+    // Insert or update a PE in place, returns its row
+    std::uint32_t applyPE(const PE& pe);
+    // Insert or update an Emitter in place, returns its row
+    std::uint32_t applyEmitter(const Emitter& emitter);
+    // Apply a setting tuple as returned by receiveSetting, false if the entity is unknown or the band would be empty
+    bool applySetting(const std::tuple<std::string, std::string, std::string, int>& setting);
+    // Apply a whole setting batch as returned by receiveSettingBatch, or nothing of it and return false
+    bool applySettings(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings);
+    // Settings and batches rejected because they named an unknown entity in a batch or would empty a band
+    std::size_t rejectedSettingCount() const { return rejectedSettings; }
+    // Apply every entity in a snapshot
+    void applySnapshot(const EntitySnapshot& snapshot);
+    // Row lookup by id, -1 if the entity has not been seen
+    int peRow(const QString& id) const;
+    int emitterRow(const QString& id) const;
+    // Reassemble a full object from its row
+    PE pe(std::uint32_t row) const;
+    Emitter emitter(std::uint32_t row) const;
+    // Read-only column access for iteration
+    const PETable& pes() const { return peTable; }
+    const EmitterTable& emitters() const { return emitterTable; }
+    // Values of a setting that has no dedicated column, 0 for rows it was never applied to
+    const std::vector<int>* peSetting(const std::string& setting) const;
+    const std::vector<int>* emitterSetting(const std::string& setting) const;
+    // Position indices over PE and Emitter rows, kept current by applyPE and applyEmitter
+    const SpatialIndex& peLocations() const { return peSpatial; }
+    const SpatialIndex& emitterLocations() const { return emitterSpatial; }
+    // Band index over Emitter rows, kept current by applyEmitter and ACTIVE/FREQ_MIN/FREQ_MAX settings
+    const FrequencyIndex& emitterBands() const { return emitterFrequencies; }
+    // Rows changed since the previous call, clears the dirty state
+    EntityChangeSet takeChanges();
+
+private:
+    // Checkpoints copy and restore the columns directly
+    friend class EntityCheckpoint;
+    // Settings that map onto a dedicated column, anything else lands in a generic setting column
+    enum class SettingField {
+        Generic,
+        PEJam, PEGhost, PECategory,
+        EmitterActive, EmitterJam, EmitterJamResponsible, EmitterReactiveEligible,
+        EmitterPreemptiveEligible, EmitterConsentRequired, EmitterOperatorManaged,
+        EmitterJamIneffective, EmitterJamEffective, EmitterFreqMin, EmitterFreqMax
+    };
+    struct SettingColumn {
+        std::string name;
+        std::vector<int> values;
+    };
+    // Where a setting lands, resolved before anything is written
+    struct SettingTarget {
+        bool isPE = false;
+        std::uint32_t row = 0;
+        SettingField field = SettingField::Generic;
+    };
+    static SettingField resolveSetting(bool isPE, const std::string& setting);
+    bool resolveTarget(const std::tuple<std::string, std::string, std::string, int>& setting, SettingTarget& target) const;
+    bool validBand(const std::string& id, double freqMin, double freqMax);
+    void writeSetting(const SettingTarget& target, const std::string& name, int value);
+    std::uint32_t addPERow(const QString& id);
+    std::uint32_t addEmitterRow(const QString& id);
+    void markPEDirty(std::uint32_t row);
+    void markEmitterDirty(std::uint32_t row);
+    static std::vector<int>& settingColumn(std::vector<SettingColumn>& columns, const std::string& setting, std::size_t rows);
+    static const std::vector<int>* findSettingColumn(const std::vector<SettingColumn>& columns, const std::string& setting);
+
+    PETable peTable;
+    EmitterTable emitterTable;
+    QHash<QString, std::uint32_t> peIndex;
+    QHash<QString, std::uint32_t> emitterIndex;
+    std::vector<SettingColumn> peSettings;
+    std::vector<SettingColumn> emitterSettings;
+    SpatialIndex peSpatial;
+    SpatialIndex emitterSpatial;
+    FrequencyIndex emitterFrequencies;
+    BitColumn peDirty;
+    BitColumn emitterDirty;
+    EntityChangeSet changes;
+    std::size_t rejectedSettings = 0;
+};
+
+#endif // ENTITYSTORE_H
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "EntityStore.h"
+
+TEST(EntityStoreTest, ApplyPEInsertsThenUpdatesInPlace) {
+    EntityStore store;
+    PE first("PE1", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+    PE second("PE2", "F35", -10.0, -20.0, 25000.0, 450.0, "LOW", "MED", true, false);
+    EXPECT_EQ(store.applyPE(first), 0u);
+    EXPECT_EQ(store.applyPE(second), 1u);
+
+    PE moved("PE1", "F18", 11.0, 21.0, 31000.0, 505.0, "MED", "HIGH", true, true);
+    EXPECT_EQ(store.applyPE(moved), 0u);
+
+    ASSERT_EQ(store.pes().size(), 2u);
+    EXPECT_DOUBLE_EQ(store.pes().lat[0], 11.0);
+    EXPECT_DOUBLE_EQ(store.pes().lon[1], -20.0);
+    EXPECT_TRUE(store.pes().jam.test(0));
+    EXPECT_TRUE(store.pes().ghost.test(0));
+    EXPECT_FALSE(store.pes().ghost.test(1));
+
+    PE rebuilt = store.pe(0);
+    EXPECT_EQ(rebuilt.id, moved.id);
+    EXPECT_DOUBLE_EQ(rebuilt.altitude, moved.altitude);
+    EXPECT_EQ(rebuilt.jam, moved.jam);
+}
+
+TEST(EntityStoreTest, ApplySettingUpdatesColumns) {
+    EntityStore store;
+    store.applyPE(PE("PE1", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false));
+    store.applyEmitter(Emitter("EM1", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, false));
+
+    EXPECT_TRUE(store.applySetting(std::make_tuple("PE_SETTING", "PE1", "JAM", 1)));
+    EXPECT_TRUE(store.applySetting(std::make_tuple("EMITTER_SETTING", "EM1", "ACTIVE", 1)));
+    EXPECT_TRUE(store.applySetting(std::make_tuple("PE_SETTING", "PE1", "APD", 5)));
+    EXPECT_FALSE(store.applySetting(std::make_tuple("PE_SETTING", "Unknown", "JAM", 1)));
+
+    EXPECT_TRUE(store.pes().jam.test(0));
+    EXPECT_TRUE(store.emitters().active.test(0));
+    const std::vector<int>* apd = store.peSetting("APD");
+    ASSERT_NE(apd, nullptr);
+    EXPECT_EQ((*apd)[0], 5);
+    EXPECT_EQ(store.emitterSetting("APD"), nullptr);
+}
+
+TEST(EntityStoreTest, TakeChangesReportsEachDirtyRowOnce) {
+    EntityStore store;
+    store.applyPE(PE("PE1", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false));
+    store.applyPE(PE("PE2", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false));
+    store.applyPE(PE("PE1", "F18", 12.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false));
+
+    EntityChangeSet changes = store.takeChanges();
+    EXPECT_EQ(changes.pes, (std::vector<std::uint32_t>{0, 1}));
+    EXPECT_TRUE(changes.emitters.empty());
+    EXPECT_TRUE(store.takeChanges().empty());
+
+    store.applySetting(std::make_tuple("PE_SETTING", "PE2", "GHOST", 1));
+    EXPECT_EQ(store.takeChanges().pes, (std::vector<std::uint32_t>{1}));
+}
+
+TEST(EntityStoreTest, ApplySettingsAppliesTheBatchInOrder) {
+    EntityStore store;
+    store.applyPE(PE("PE1", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false));
+    store.applyEmitter(Emitter("EM1", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, false));
+    store.takeChanges();
+
+    const std::vector<std::tuple<std::string, std::string, std::string, int>> batch = {
+        {"PE_SETTING", "PE1", "JAM", 1},
+        {"EMITTER_SETTING", "EM1", "JAM_EFFECTIVE", 3},
+        {"PE_SETTING", "PE1", "JAM", 0},
+    };
+    EXPECT_TRUE(store.applySettings(batch));
+    EXPECT_FALSE(store.pes().jam.test(0));
+    EXPECT_EQ(store.emitters().jamEffective[0], 3);
+
+    EntityChangeSet changes = store.takeChanges();
+    EXPECT_EQ(changes.pes, (std::vector<std::uint32_t>{0}));
+    EXPECT_EQ(changes.emitters, (std::vector<std::uint32_t>{0}));
+}
+
+TEST(EntityStoreTest, ApplySettingsAppliesNothingOfARejectedBatch) {
+    EntityStore store;
+    store.applyPE(PE("PE1", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false));
+    store.applyEmitter(Emitter("EM1", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, false));
+    store.takeChanges();
+
+    EXPECT_FALSE(store.applySettings({{"PE_SETTING", "PE1", "JAM", 1}, {"PE_SETTING", "Unknown", "JAM", 1}}));
+    EXPECT_FALSE(store.applySettings({{"PE_SETTING", "PE1", "JAM", 1}, {"EMITTER_SETTING", "EM1", "FREQ_MIN", 13000}}));
+    EXPECT_FALSE(store.pes().jam.test(0));
+    EXPECT_DOUBLE_EQ(store.emitter(0).freqMin, 8000.0);
+    EXPECT_EQ(store.rejectedSettingCount(), 2u);
+    EXPECT_TRUE(store.takeChanges().pes.empty());
+}
+
+TEST(EntityStoreTest, ABatchCanMoveABandPastItself) {
+    using Batch = std::vector<std::tuple<std::string, std::string, std::string, int>>;
+    // Up from [2000,4000] to [9000,12000] and back down again, with the band's ends in either order
+    const std::vector<Batch> moves = {
+        {{"EMITTER_SETTING", "EM1", "FREQ_MIN", 9000}, {"EMITTER_SETTING", "EM1", "FREQ_MAX", 12000}},
+        {{"EMITTER_SETTING", "EM1", "FREQ_MAX", 12000}, {"EMITTER_SETTING", "EM1", "FREQ_MIN", 9000}},
+    };
+    for (const Batch& up : moves) {
+        EntityStore store;
+        store.applyEmitter(Emitter("EM1", "RadarType", "Category", 15.0, 25.0, 2000.0, 4000.0, true));
+        ASSERT_TRUE(store.applySettings(up));
+        EXPECT_DOUBLE_EQ(store.emitter(0).freqMin, 9000.0);
+        EXPECT_DOUBLE_EQ(store.emitter(0).freqMax, 12000.0);
+        EXPECT_EQ(store.emitterBands().stabbing(10000.0, true), (std::vector<std::uint32_t>{0}));
+        EXPECT_EQ(store.emitterBands().stabbing(3000.0, true), std::vector<std::uint32_t>{});
+
+        for (const Batch& down : {Batch{{"EMITTER_SETTING", "EM1", "FREQ_MIN", 2000}, {"EMITTER_SETTING", "EM1", "FREQ_MAX", 4000}},
+                                  Batch{{"EMITTER_SETTING", "EM1", "FREQ_MAX", 4000}, {"EMITTER_SETTING", "EM1", "FREQ_MIN", 2000}}}) {
+            EntityStore moved;
+            moved.applyEmitter(Emitter("EM1", "RadarType", "Category", 15.0, 25.0, 9000.0, 12000.0, true));
+            ASSERT_TRUE(moved.applySettings(down));
+            EXPECT_DOUBLE_EQ(moved.emitter(0).freqMin, 2000.0);
+            EXPECT_DOUBLE_EQ(moved.emitter(0).freqMax, 4000.0);
+            EXPECT_EQ(moved.emitterBands().stabbing(3000.0, true), (std::vector<std::uint32_t>{0}));
+        }
+        EXPECT_EQ(store.rejectedSettingCount(), 0u);
+    }
+}
+
+TEST(EntityStoreTest, EmitterLocationsFollowUpdates) {
+    EntityStore store;
+    const std::uint32_t pe = store.applyPE(PE("PE1", "F18", -33.9, 151.2, 30000.0, 500.0, "MED", "HIGH", false, false));
+    store.applyEmitter(Emitter("Near", "RadarType", "Category", -33.8, 151.3, 8000.0, 12000.0, true));
+    store.applyEmitter(Emitter("Far", "RadarType", "Category", -37.8, 144.9, 8000.0, 12000.0, true));
+
+    const double lat = store.pes().lat[pe];
+    const double lon = store.pes().lon[pe];
+    EXPECT_EQ(store.emitterLocations().withinRadius(lat, lon, 50.0), (std::vector<std::uint32_t>{0}));
+
+    store.applyEmitter(Emitter("Far", "RadarType", "Category", -33.85, 151.25, 8000.0, 12000.0, true));
+    EXPECT_EQ(store.emitterLocations().withinRadius(lat, lon, 50.0).size(), 2u);
+}
+
+TEST(EntityStoreTest, EmitterBandsFollowSettings) {
+    EntityStore store;
+    store.applyEmitter(Emitter("EM1", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, false));
+    store.applyEmitter(Emitter("EM2", "RadarType", "Category", 15.0, 25.0, 2000.0, 4000.0, true));
+    EXPECT_EQ(store.emitterBands().stabbing(9000.0, true), std::vector<std::uint32_t>{});
+
+    store.applySetting(std::make_tuple("EMITTER_SETTING", "EM1", "ACTIVE", 1));
+    EXPECT_EQ(store.emitterBands().stabbing(9000.0, true), (std::vector<std::uint32_t>{0}));
+
+    store.applySetting(std::make_tuple("EMITTER_SETTING", "EM2", "FREQ_MAX", 9500));
+    EXPECT_EQ(store.emitterBands().stabbing(9000.0, true), (std::vector<std::uint32_t>{1, 0}));
+
+    // A band that would be empty is rejected and the index left alone
+    EXPECT_FALSE(store.applySetting(std::make_tuple("EMITTER_SETTING", "EM2", "FREQ_MIN", 9500)));
+    EXPECT_FALSE(store.applySetting(std::make_tuple("EMITTER_SETTING", "EM1", "FREQ_MAX", 7000)));
+    EXPECT_DOUBLE_EQ(store.emitter(1).freqMin, 2000.0);
+    EXPECT_DOUBLE_EQ(store.emitter(0).freqMax, 12000.0);
+    EXPECT_EQ(store.emitterBands().stabbing(9000.0, true), (std::vector<std::uint32_t>{1, 0}));
+    EXPECT_EQ(store.rejectedSettingCount(), 2u);
+}
+
+TEST(EntityStoreTest, LoneBandSettingsThatCrossTheBandAreCounted) {
+    EntityStore store;
+    store.applyEmitter(Emitter("EM1", "RadarType", "Category", 15.0, 25.0, 2000.0, 4000.0, true));
+    // Moving fully above one end at a time fails at the first step, fully below at the first step too
+    EXPECT_FALSE(store.applySetting(std::make_tuple("EMITTER_SETTING", "EM1", "FREQ_MIN", 9000)));
+    EXPECT_FALSE(store.applySetting(std::make_tuple("EMITTER_SETTING", "EM1", "FREQ_MAX", 1000)));
+    EXPECT_EQ(store.rejectedSettingCount(), 2u);
+    // The other order works for a move above, as each step leaves a valid band
+    EXPECT_TRUE(store.applySetting(std::make_tuple("EMITTER_SETTING", "EM1", "FREQ_MAX", 12000)));
+    EXPECT_TRUE(store.applySetting(std::make_tuple("EMITTER_SETTING", "EM1", "FREQ_MIN", 9000)));
+    EXPECT_DOUBLE_EQ(store.emitter(0).freqMin, 9000.0);
+    EXPECT_DOUBLE_EQ(store.emitter(0).freqMax, 12000.0);
+    EXPECT_EQ(store.rejectedSettingCount(), 2u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
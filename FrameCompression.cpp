@@ -0,0 +1,487 @@
+#include "FrameCompression.h"
+#include "MessageCodec.h"
+#include "Tracing.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
+/*!
+    \class FrameDictionary
+    \brief Holds the preset history that FrameCompression matches frames against.
+
+    A general purpose compressor learns a frame's repetition from the frame
+    itself, so a small batch compresses badly: the keys, type strings and
+    row layout each appear only a few times. With a dictionary, the
+    compressor starts every frame as if the dictionary had just been sent, so
+    a frame can point back into it from its first byte. Both ends must hold
+    the same dictionary, which id() lets them check.
+*/
+
+/*!
+    \class FrameCompression
+    \brief Compresses single frames with a byte oriented LZ77 codec and a preset dictionary.
+
+    Each frame is a sequence of literal runs and matches. A match copies up
+    to 64 KiB back, into the frame or the dictionary before it. The format
+    is a token byte holding a 4 bit literal length and a 4 bit match length,
+    the literals, then a two byte offset. Lengths of 15 or more continue in
+    further bytes, and the frame ends after a final literal run. The
+    compressed bytes are preceded by kMarker and the original length. A
+    newline is escaped to 0x1b 'n' and 0x1b itself to 0x1b 0x1b, so the
+    result can still be framed by newlines.
+
+    Matching trades ratio for speed with one hash table probe per position,
+    which suits links where the CPU has time to spare but the bandwidth does
+    not.
+*/
+
+namespace {
+constexpr unsigned kHashBits = 12;
+constexpr std::uint32_t kEmpty = 0xffffffffu;
+constexpr std::size_t kMinMatch = 4;
+constexpr std::size_t kMaxOffset = 65535;
+// Guards against corrupt lengths, well above the largest snapshot frame
+constexpr std::uint64_t kMaxFrameSize = 64ull << 20;
+constexpr char kEscape = '\x1b';
+// Training scores segments by how often the 8 byte grams in them recur
+constexpr std::size_t kGram = 8;
+constexpr std::size_t kSegment = 64;
+
+std::uint32_t read32(const char* data) {
+    std::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+std::uint64_t read64(const char* data) {
+    std::uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+std::uint32_t hashAt(const char* data) {
+    return (read32(data) * 2654435761u) >> (32 - kHashBits);
+}
+
+std::uint32_t fnv1a(const std::string& data) {
+    std::uint32_t hash = 2166136261u;
+    for (unsigned char byte : data) {
+        hash = (hash ^ byte) * 16777619u;
+    }
+    return hash;
+}
+
+void writeLength(std::string& out, std::size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void writeSequence(std::string& out, const char* literals, std::size_t literalCount, std::size_t offset, std::size_t matchLength) {
+    const std::size_t matchCode = matchLength - kMinMatch;
+    out.push_back(static_cast<char>((std::min<std::size_t>(literalCount, 15) << 4) | std::min<std::size_t>(matchCode, 15)));
+    if (literalCount >= 15) {
+        writeLength(out, literalCount - 15);
+    }
+    out.append(literals, literalCount);
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (matchCode >= 15) {
+        writeLength(out, matchCode - 15);
+    }
+}
+
+void writeLastLiterals(std::string& out, const char* literals, std::size_t literalCount) {
+    out.push_back(static_cast<char>(std::min<std::size_t>(literalCount, 15) << 4));
+    if (literalCount >= 15) {
+        writeLength(out, literalCount - 15);
+    }
+    out.append(literals, literalCount);
+}
+
+// Reads escaped bytes back, throwing if the frame ends early
+class Reader {
+public:
+    Reader(const std::string& data, std::size_t position) : data(data), position(position) {}
+    bool atEnd() const { return position >= data.size(); }
+    unsigned char byte() {
+        if (atEnd()) {
+            throw std::runtime_error("Compressed frame is truncated");
+        }
+        char c = data[position++];
+        if (c == kEscape) {
+            if (atEnd()) {
+                throw std::runtime_error("Compressed frame is truncated");
+            }
+            c = data[position++];
+            if (c == 'n') {
+                c = '\n';
+            } else if (c != kEscape) {
+                throw std::runtime_error("Compressed frame has an invalid escape");
+            }
+        }
+        return static_cast<unsigned char>(c);
+    }
+    std::size_t length(std::size_t base) {
+        std::size_t length = base;
+        if (base == 15) {
+            unsigned char next;
+            do {
+                next = byte();
+                length += next;
+            } while (next == 255);
+        }
+        return length;
+    }
+
+private:
+    const std::string& data;
+    std::size_t position;
+};
+
+// Entities shaped like real traffic, from a fixed seed so every build trains the same dictionary
+std::vector<std::string> standardSamples() {
+    std::mt19937 random(1729);
+    auto uniform = [&random](double low, double high) { return low + (high - low) * (random() / 4294967296.0); };
+    const char* peTypes[] = {"F18", "F16", "F35", "E3", "KC135", "MIG29", "SU27", "UAV"};
+    const char* levels[] = {"LOW", "MED", "HIGH"};
+    const char* emitterTypes[] = {"RadarType", "SAM", "EW", "Comms"};
+
+    std::vector<std::string> samples;
+    for (int batch = 0; batch < 16; ++batch) {
+        std::vector<PE> pes;
+        std::vector<Emitter> emitters;
+        for (int i = 0; i < 32; ++i) {
+            PE pe(QString("PE%1").arg(batch * 32 + i), peTypes[random() % 8], uniform(-60.0, 60.0), uniform(-180.0, 180.0),
+                  uniform(5000.0, 40000.0), uniform(250.0, 550.0), levels[random() % 3], levels[random() % 3], random() % 8 == 0, false);
+            pe.heading = uniform(0.0, 360.0);
+            pes.push_back(pe);
+            const double freqMin = uniform(2000.0, 9000.0);
+            Emitter emitter(QString("Emitter%1").arg(batch * 32 + i), emitterTypes[random() % 4], "", uniform(-60.0, 60.0),
+                            uniform(-180.0, 180.0), freqMin, freqMin + uniform(500.0, 3000.0), true);
+            emitter.speed = uniform(0.0, 30.0);
+            emitter.heading = uniform(0.0, 360.0);
+            emitters.push_back(emitter);
+        }
+        samples.push_back(MessageCodec::encodePEBatch(pes));
+        samples.push_back(MessageCodec::encodeEmitterBatch(emitters));
+        samples.push_back(MessageCodec::encodePE(pes.front()));
+        samples.push_back(MessageCodec::encodeEmitter(emitters.front()));
+        samples.push_back(MessageCodec::encodeSnapshot(EntitySnapshot{static_cast<std::uint64_t>(batch), pes, emitters}));
+    }
+    return samples;
+}
+}
+
+/*!
+    \fn FrameDictionary::FrameDictionary(std::string content)
+    \brief Creates a dictionary from raw bytes.
+    \param content The bytes frames will be matched against, the last kMaxSize of which are kept.
+
+    Put the strings frames repeat most near the end, where offsets to them are shortest.
+*/
+FrameDictionary::FrameDictionary(std::string content)
+    : bytes(std::move(content)), table(std::size_t(1) << kHashBits, kEmpty) {
+    if (bytes.size() > kMaxSize) {
+        bytes.erase(0, bytes.size() - kMaxSize);
+    }
+    checksum = fnv1a(bytes);
+    for (std::size_t i = 0; i + kMinMatch <= bytes.size(); ++i) {
+        table[hashAt(bytes.data() + i)] = static_cast<std::uint32_t>(i);
+    }
+}
+
+/*!
+    \fn FrameDictionary FrameDictionary::train(const std::vector<std::string>& samples, std::size_t size)
+    \brief Builds a dictionary from sample frames.
+    \param samples Frames representative of the traffic, such as encoded batches or a capture's frames.
+    \param size The largest dictionary to build, at most kMaxSize.
+    \return The trained dictionary.
+
+    Counts every 8 byte sequence across the samples, then splits the samples
+    into one stretch per 64 byte segment the dictionary has room for. From
+    each stretch it takes the segment whose sequences recur most, and stops
+    counting those sequences, so later segments cover something new.
+*/
+FrameDictionary FrameDictionary::train(const std::vector<std::string>& samples, std::size_t size) {
+    ANI_TRACE_SPAN("FrameDictionary::train");
+    size = std::min(size, kMaxSize);
+    std::string data;
+    for (const std::string& sample : samples) {
+        data += sample;
+    }
+    if (data.size() <= size) {
+        return FrameDictionary(std::move(data));
+    }
+
+    std::unordered_map<std::uint64_t, std::uint32_t> frequency;
+    for (std::size_t i = 0; i + kGram <= data.size(); ++i) {
+        ++frequency[read64(data.data() + i)];
+    }
+    auto frequencyAt = [&frequency, &data](std::size_t i) { return frequency[read64(data.data() + i)]; };
+
+    const std::size_t segment = std::min(kSegment, size);
+    const std::size_t grams = segment - kGram + 1;
+    const std::size_t epochs = size / segment;
+    const std::size_t epochLength = data.size() / epochs;
+    std::string content;
+    for (std::size_t epoch = 0; epoch < epochs; ++epoch) {
+        const std::size_t begin = epoch * epochLength;
+        const std::size_t end = std::min(data.size(), begin + epochLength);
+        if (end - begin < segment) {
+            continue;
+        }
+        // Slide a window of one segment's grams across the stretch, keeping the best total
+        std::uint64_t score = 0;
+        for (std::size_t i = begin; i < begin + grams; ++i) {
+            score += frequencyAt(i);
+        }
+        std::uint64_t bestScore = score;
+        std::size_t best = begin;
+        for (std::size_t start = begin + 1; start + segment <= end; ++start) {
+            score += frequencyAt(start + grams - 1);
+            score -= frequencyAt(start - 1);
+            if (score > bestScore) {
+                bestScore = score;
+                best = start;
+            }
+        }
+        if (bestScore == 0) {
+            continue;
+        }
+        content.append(data, best, segment);
+        for (std::size_t i = best; i < best + grams; ++i) {
+            frequency[read64(data.data() + i)] = 0;
+        }
+    }
+    return FrameDictionary(std::move(content));
+}
+
+/*!
+    \fn std::shared_ptr<const FrameDictionary> FrameDictionary::standard()
+    \brief Returns the dictionary trained on generated PE and Emitter frames.
+
+    The samples come from a fixed seed, so two builds with the same Qt JSON
+    formatting train identical dictionaries. Traffic with very different ids
+    or types compresses better with a dictionary trained on a capture of it.
+*/
+std::shared_ptr<const FrameDictionary> FrameDictionary::standard() {
+    static const std::shared_ptr<const FrameDictionary> dictionary =
+        std::make_shared<const FrameDictionary>(train(standardSamples()));
+    return dictionary;
+}
+
+/*!
+    \fn std::string FrameCompression::compress(const std::string& frame, const FrameDictionary& dictionary)
+    \brief Compresses one frame.
+    \param frame The frame, without its newline.
+    \param dictionary The dictionary the receiver will decompress with.
+    \return The escaped wire form, starting with kMarker and free of newlines.
+*/
+std::string FrameCompression::compress(const std::string& frame, const FrameDictionary& dictionary) {
+    ANI_TRACE_SPAN("FrameCompression::compress");
+    // Matching runs over the dictionary and frame as one buffer, starting with the dictionary already hashed
+    const std::string buffer = dictionary.bytes + frame;
+    const char* data = buffer.data();
+    std::vector<std::uint32_t> table = dictionary.table;
+    const std::size_t end = buffer.size();
+
+    std::string packed;
+    packed.reserve(frame.size() / 2 + 16);
+    std::uint64_t length = frame.size();
+    while (length >= 0x80) {
+        packed.push_back(static_cast<char>((length & 0x7f) | 0x80));
+        length >>= 7;
+    }
+    packed.push_back(static_cast<char>(length));
+
+    std::size_t anchor = dictionary.bytes.size();
+    std::size_t position = anchor;
+    while (position + kMinMatch <= end) {
+        const std::uint32_t hash = hashAt(data + position);
+        const std::uint32_t candidate = table[hash];
+        table[hash] = static_cast<std::uint32_t>(position);
+        if (candidate == kEmpty || position - candidate > kMaxOffset || read32(data + candidate) != read32(data + position)) {
+            ++position;
+            continue;
+        }
+        std::size_t matchLength = kMinMatch;
+        while (position + matchLength < end && data[candidate + matchLength] == data[position + matchLength]) {
+            ++matchLength;
+        }
+        writeSequence(packed, data + anchor, position - anchor, position - candidate, matchLength);
+        // Hash the positions the match covers so later matches can start inside it
+        for (std::size_t i = position + 1; i < position + matchLength && i + kMinMatch <= end; ++i) {
+            table[hashAt(data + i)] = static_cast<std::uint32_t>(i);
+        }
+        position += matchLength;
+        anchor = position;
+    }
+    writeLastLiterals(packed, data + anchor, end - anchor);
+
+    std::string out;
+    out.reserve(packed.size() + packed.size() / 64 + 2);
+    out.push_back(kMarker);
+    for (char c : packed) {
+        if (c == '\n') {
+            out.push_back(kEscape);
+            out.push_back('n');
+        } else if (c == kEscape) {
+            out.push_back(kEscape);
+            out.push_back(kEscape);
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+/*!
+    \fn std::string FrameCompression::decompress(const std::string& data, const FrameDictionary& dictionary)
+    \brief Restores a frame from its compressed wire form.
+    \param data The compressed frame, starting with kMarker.
+    \param dictionary The dictionary it was compressed with.
+    \return The original frame, without its newline.
+
+    Throws std::runtime_error if the data is truncated, refers outside the
+    frame and dictionary, or does not come to the length it starts with.
+*/
+std::string FrameCompression::decompress(const std::string& data, const FrameDictionary& dictionary) {
+    ANI_TRACE_SPAN("FrameCompression::decompress");
+    if (!isCompressed(data)) {
+        throw std::runtime_error("Frame is not compressed");
+    }
+    Reader reader(data, 1);
+    std::uint64_t length = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        if (shift > 56) {
+            throw std::runtime_error("Compressed frame has an invalid length");
+        }
+        const unsigned char byte = reader.byte();
+        length |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    if (length > kMaxFrameSize) {
+        throw std::runtime_error("Compressed frame is longer than " + std::to_string(kMaxFrameSize) + " bytes");
+    }
+
+    const std::size_t begin = dictionary.bytes.size();
+    const std::size_t total = begin + length;
+    std::string out = dictionary.bytes;
+    out.reserve(total);
+    while (!reader.atEnd()) {
+        const unsigned char token = reader.byte();
+        const std::size_t literalCount = reader.length(token >> 4);
+        if (literalCount > total - out.size()) {
+            throw std::runtime_error("Compressed frame overruns its length");
+        }
+        for (std::size_t i = 0; i < literalCount; ++i) {
+            out.push_back(static_cast<char>(reader.byte()));
+        }
+        if (reader.atEnd()) {
+            break;
+        }
+        std::size_t offset = reader.byte();
+        offset |= static_cast<std::size_t>(reader.byte()) << 8;
+        const std::size_t matchLength = reader.length(token & 0x0f) + kMinMatch;
+        if (offset == 0 || offset > out.size()) {
+            throw std::runtime_error("Compressed frame refers before the start of its dictionary");
+        }
+        if (matchLength > total - out.size()) {
+            throw std::runtime_error("Compressed frame overruns its length");
+        }
+        // Byte by byte, since a match may overlap the bytes it produces
+        std::size_t from = out.size() - offset;
+        for (std::size_t i = 0; i < matchLength; ++i) {
+            out.push_back(out[from + i]);
+        }
+    }
+    if (out.size() != total) {
+        throw std::runtime_error("Compressed frame is shorter than its length");
+    }
+    out.erase(0, begin);
+    return out;
+}
+
+/*!
+    \fn std::string FrameCompression::encodeHello(const FrameDictionary& dictionary)
+    \brief Encodes the frame that tells a receiver which dictionary the following compressed frames use.
+*/
+std::string FrameCompression::encodeHello(const FrameDictionary& dictionary) {
+    char id[9];
+    std::snprintf(id, sizeof(id), "%08x", dictionary.id());
+    QJsonObject json;
+    json["type"] = "HELLO";
+    json["compression"] = "lz77";
+    json["dictionary"] = id;
+    return QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString();
+}
+
+/*!
+    \fn bool FrameCompression::decodeHello(const std::string& frame, std::uint32_t& dictionaryId)
+    \brief Recognises a hello frame.
+    \param frame A received frame, without its newline.
+    \param dictionaryId Set to the id of the dictionary the hello names.
+    \return True if the frame is a hello.
+
+    Frames are checked cheaply by size and content first, so calling this
+    on every frame costs next to nothing.
+*/
+bool FrameCompression::decodeHello(const std::string& frame, std::uint32_t& dictionaryId) {
+    if (frame.size() > 128 || frame.find("\"HELLO\"") == std::string::npos) {
+        return false;
+    }
+    const QJsonObject json = QJsonDocument::fromJson(QByteArray::fromStdString(frame)).object();
+    if (json["type"].toString() != "HELLO" || json["compression"].toString() != "lz77") {
+        return false;
+    }
+    bool ok = false;
+    dictionaryId = json["dictionary"].toString().toUInt(&ok, 16);
+    return ok;
+}
+
+/*!
+    \fn std::string FrameCompression::encodeHelloAck(std::uint32_t dictionaryId)
+    \brief Encodes the frame that tells a sender its hello was understood.
+    \param dictionaryId The id from the hello, which the receiver holds.
+
+    The sender only compresses once it has received this for the dictionary it
+    compresses with.
+*/
+std::string FrameCompression::encodeHelloAck(std::uint32_t dictionaryId) {
+    char id[9];
+    std::snprintf(id, sizeof(id), "%08x", dictionaryId);
+    QJsonObject json;
+    json["type"] = "HELLO_ACK";
+    json["dictionary"] = id;
+    return QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString();
+}
+
+/*!
+    \fn bool FrameCompression::decodeHelloAck(const std::string& frame, std::uint32_t& dictionaryId)
+    \brief Recognises a hello acknowledgement, as cheaply as decodeHello().
+    \param frame A received frame, without its newline.
+    \param dictionaryId Set to the id of the dictionary the acknowledgement names.
+    \return True if the frame is a hello acknowledgement.
+*/
+bool FrameCompression::decodeHelloAck(const std::string& frame, std::uint32_t& dictionaryId) {
+    if (frame.size() > 128 || frame.find("\"HELLO_ACK\"") == std::string::npos) {
+        return false;
+    }
+    const QJsonObject json = QJsonDocument::fromJson(QByteArray::fromStdString(frame)).object();
+    if (json["type"].toString() != "HELLO_ACK") {
+        return false;
+    }
+    bool ok = false;
+    dictionaryId = json["dictionary"].toString().toUInt(&ok, 16);
+    return ok;
+}
@@ -0,0 +1,57 @@
+#ifndef FRAMECOMPRESSION_H
+#define FRAMECOMPRESSION_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Bytes that compressed frames are likely to repeat, loaded as history before every frame so
+// even a small batch can refer back to keys, type strings and row layout it has never sent
+class FrameDictionary {
+public:
+    // Every match offset into the dictionary and the frame fits in two bytes
+    static constexpr std::size_t kMaxSize = 32768;
+
+    // Only the last kMaxSize bytes of content are kept
+    explicit FrameDictionary(std::string content);
+    // Pick the segments that recur most often across the samples, up to size bytes
+    static FrameDictionary train(const std::vector<std::string>& samples, std::size_t size = 16384);
+    // Trained on generated PE and Emitter traffic, the dictionary used when none is given
+    static std::shared_ptr<const FrameDictionary> standard();
+
+    const std::string& content() const { return bytes; }
+    // Checksum of the content, so both ends can check they hold the same dictionary
+    std::uint32_t id() const { return checksum; }
+
+private:
+    friend class FrameCompression;
+    std::string bytes;
+    std::uint32_t checksum;
+    // Match finder state after hashing the dictionary, copied at the start of every frame
+    std::vector<std::uint32_t> table;
+};
+
+// LZ77 compression of single frames against a FrameDictionary. Compressed frames are escaped so
+// they never contain a newline, and start with a marker byte that JSON text never does.
+class FrameCompression {
+public:
+    static constexpr char kMarker = '\x01';
+
+    // Compress a frame without its newline into its wire form
+    static std::string compress(const std::string& frame, const FrameDictionary& dictionary);
+    // Reverse compress(), throws std::runtime_error on corrupt input or the wrong dictionary
+    static std::string decompress(const std::string& data, const FrameDictionary& dictionary);
+    static bool isCompressed(const std::string& frame) { return !frame.empty() && frame[0] == kMarker; }
+
+    // The frame announcing that the sender compresses with dictionary, without its newline
+    static std::string encodeHello(const FrameDictionary& dictionary);
+    // True if frame is a hello, and if so the id of the dictionary it names
+    static bool decodeHello(const std::string& frame, std::uint32_t& dictionaryId);
+    // The receiver's reply to a hello naming a dictionary it holds, without its newline
+    static std::string encodeHelloAck(std::uint32_t dictionaryId);
+    // True if frame is a hello acknowledgement, and if so the id of the dictionary it names
+    static bool decodeHelloAck(const std::string& frame, std::uint32_t& dictionaryId);
+};
+
+#endif // FRAMECOMPRESSION_H
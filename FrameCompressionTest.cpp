@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+#include "FrameCompression.h"
+#include "InMemoryNetworkInterface.h"
+#include "MessageCodec.h"
+#include "Metrics.h"
+#include <random>
+
+namespace {
+std::vector<PE> makePEs(int count) {
+    std::vector<PE> pes;
+    for (int i = 0; i < count; ++i) {
+        PE pe(QString("PE%1").arg(i), "F18", 10.0 + i * 0.001, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+        pe.heading = 90.0;
+        pes.push_back(pe);
+    }
+    return pes;
+}
+
+std::string withoutNewline(std::string frame) {
+    frame.pop_back();
+    return frame;
+}
+}
+
+TEST(FrameCompressionTest, BatchFramesRoundTripSmaller) {
+    const auto dictionary = FrameDictionary::standard();
+    for (int count : {1, 16, 1024}) {
+        const std::string frame = withoutNewline(MessageCodec::encodePEBatch(makePEs(count)));
+        const std::string compressed = FrameCompression::compress(frame, *dictionary);
+        EXPECT_TRUE(FrameCompression::isCompressed(compressed));
+        EXPECT_EQ(compressed.find('\n'), std::string::npos);
+        EXPECT_LT(compressed.size(), count == 1 ? frame.size() : frame.size() / 2) << count << " PEs";
+        EXPECT_EQ(FrameCompression::decompress(compressed, *dictionary), frame);
+    }
+}
+
+TEST(FrameCompressionTest, DictionaryShrinksSmallFrames) {
+    const std::string frame = withoutNewline(MessageCodec::encodePEBatch(makePEs(2)));
+    const FrameDictionary none("");
+    const std::size_t withDictionary = FrameCompression::compress(frame, *FrameDictionary::standard()).size();
+    const std::size_t withoutDictionary = FrameCompression::compress(frame, none).size();
+    EXPECT_LT(withDictionary, withoutDictionary);
+    EXPECT_EQ(FrameCompression::decompress(FrameCompression::compress(frame, none), none), frame);
+}
+
+TEST(FrameCompressionTest, AnyBytesRoundTrip) {
+    std::mt19937 random(7);
+    const FrameDictionary dictionary("\n\x1b\x01 newline escape marker");
+    for (int i = 0; i < 200; ++i) {
+        std::string frame(random() % 4096, '\0');
+        for (char& c : frame) {
+            // Half the frames use only a few byte values, so they are full of matches
+            c = static_cast<char>(i % 2 ? random() % 4 + '\n' : random());
+        }
+        const std::string compressed = FrameCompression::compress(frame, dictionary);
+        ASSERT_EQ(compressed.find('\n'), std::string::npos);
+        ASSERT_EQ(FrameCompression::decompress(compressed, dictionary), frame);
+    }
+}
+
+TEST(FrameCompressionTest, CorruptFramesThrow) {
+    const auto dictionary = FrameDictionary::standard();
+    const std::string frame = withoutNewline(MessageCodec::encodePEBatch(makePEs(64)));
+    const std::string compressed = FrameCompression::compress(frame, *dictionary);
+    EXPECT_THROW(FrameCompression::decompress(compressed.substr(0, compressed.size() / 2), *dictionary), std::runtime_error);
+    EXPECT_THROW(FrameCompression::decompress(frame, *dictionary), std::runtime_error);
+    EXPECT_THROW(FrameCompression::decompress(compressed, FrameDictionary("")), std::runtime_error);
+}
+
+TEST(FrameCompressionTest, TrainingIsDeterministicAndBounded) {
+    std::vector<std::string> samples;
+    for (int i = 0; i < 50; ++i) {
+        samples.push_back(MessageCodec::encodePEBatch(makePEs(40)));
+    }
+    const FrameDictionary first = FrameDictionary::train(samples, 4096);
+    const FrameDictionary second = FrameDictionary::train(samples, 4096);
+    EXPECT_LE(first.content().size(), 4096u);
+    EXPECT_FALSE(first.content().empty());
+    EXPECT_EQ(first.id(), second.id());
+    EXPECT_LE(FrameDictionary::train(samples, 1 << 20).content().size(), FrameDictionary::kMaxSize);
+}
+
+TEST(FrameCompressionTest, HelloNamesTheDictionary) {
+    const FrameDictionary dictionary("dictionary");
+    std::uint32_t id = 0;
+    ASSERT_TRUE(FrameCompression::decodeHello(FrameCompression::encodeHello(dictionary), id));
+    EXPECT_EQ(id, dictionary.id());
+    EXPECT_FALSE(FrameCompression::decodeHello(withoutNewline(MessageCodec::encodePE(makePEs(1).front())), id));
+    EXPECT_FALSE(FrameCompression::decodeHello("HELLO", id));
+
+    id = 0;
+    ASSERT_TRUE(FrameCompression::decodeHelloAck(FrameCompression::encodeHelloAck(dictionary.id()), id));
+    EXPECT_EQ(id, dictionary.id());
+    EXPECT_FALSE(FrameCompression::decodeHelloAck(FrameCompression::encodeHello(dictionary), id));
+    EXPECT_FALSE(FrameCompression::decodeHello(FrameCompression::encodeHelloAck(dictionary.id()), id));
+}
+
+TEST(FrameCompressionTest, CompressedLinkDeliversEveryKind) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    client->enableCompression();
+    const std::vector<PE> pes = makePEs(256);
+    // Sent plain with the hello, and the server acknowledges the hello when it reads it
+    ASSERT_TRUE(client->sendPEBatch(pes));
+    EXPECT_EQ(server->receivePEBatch().size(), pes.size());
+    ASSERT_TRUE(server->sendPE(pes.back()));
+    EXPECT_EQ(client->receivePE().id, pes.back().id);
+
+    const MetricsSnapshot before = Metrics::stats();
+    ASSERT_TRUE(client->sendPEBatch(pes));
+    ASSERT_TRUE(client->sendSnapshot(EntitySnapshot{9, pes, {}}));
+    ASSERT_TRUE(client->sendPE(pes.front()));
+
+    EXPECT_EQ(server->receivePEBatch().size(), pes.size());
+    const EntitySnapshot snapshot = server->receiveSnapshot();
+    EXPECT_EQ(snapshot.sequence, 9u);
+    EXPECT_EQ(snapshot.pes.size(), pes.size());
+    EXPECT_EQ(server->receivePE().id, pes.front().id);
+    if (Metrics::enabled()) {
+        const MetricsSnapshot after = Metrics::stats();
+        const std::size_t batch = static_cast<std::size_t>(NetworkMessage::Kind::PEBatch);
+        EXPECT_LT(after.bytesSent[batch] - before.bytesSent[batch], MessageCodec::encodePEBatch(pes).size() / 2);
+    }
+}
+
+TEST(FrameCompressionTest, TrainedDictionaryNeedsBothEnds) {
+    std::vector<std::string> samples;
+    for (int i = 0; i < 20; ++i) {
+        samples.push_back(MessageCodec::encodePEBatch(makePEs(20)));
+    }
+    const auto trained = std::make_shared<const FrameDictionary>(FrameDictionary::train(samples, 2048));
+    const std::vector<PE> pes = makePEs(64);
+    {
+        auto [client, server] = InMemoryNetworkInterface::createPair();
+        client->enableCompression(trained);
+        server->enableCompression(trained);
+        ASSERT_TRUE(client->sendPEBatch(pes));
+        EXPECT_EQ(server->receivePEBatch().size(), pes.size());
+    }
+    {
+        auto [client, server] = InMemoryNetworkInterface::createPair();
+        client->enableCompression(trained);
+        ASSERT_TRUE(client->sendPEBatch(pes));
+        EXPECT_EQ(server->receivePEBatch().size(), pes.size());
+        ASSERT_TRUE(server->sendPE(pes.back()));
+        EXPECT_EQ(client->receivePE().id, pes.back().id);
+        // The server does not hold the dictionary and never acknowledged it, so frames stay plain
+        const MetricsSnapshot before = Metrics::stats();
+        ASSERT_TRUE(client->sendPEBatch(pes));
+        EXPECT_EQ(server->receivePEBatch().size(), pes.size());
+        if (Metrics::enabled()) {
+            const MetricsSnapshot after = Metrics::stats();
+            const std::size_t batch = static_cast<std::size_t>(NetworkMessage::Kind::PEBatch);
+            EXPECT_EQ(after.bytesSent[batch] - before.bytesSent[batch], MessageCodec::encodePEBatch(pes).size());
+        }
+    }
+}
+
+TEST(FrameCompressionTest, NothingIsCompressedBeforeTheAcknowledgement) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    client->enableCompression();
+    const std::vector<PE> pes = makePEs(64);
+    const MetricsSnapshot before = Metrics::stats();
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(client->sendPEBatch(pes));
+    }
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(server->receivePEBatch().size(), pes.size());
+    }
+    if (Metrics::enabled()) {
+        const MetricsSnapshot after = Metrics::stats();
+        const std::size_t batch = static_cast<std::size_t>(NetworkMessage::Kind::PEBatch);
+        EXPECT_EQ(after.bytesSent[batch] - before.bytesSent[batch], 3 * MessageCodec::encodePEBatch(pes).size());
+    }
+
+    // A new dictionary is not compressed with on the strength of the old one's acknowledgement
+    ASSERT_TRUE(server->sendPE(pes.back()));
+    EXPECT_EQ(client->receivePE().id, pes.back().id);
+    std::vector<std::string> samples{MessageCodec::encodePEBatch(makePEs(20))};
+    client->enableCompression(std::make_shared<const FrameDictionary>(FrameDictionary::train(samples, 2048)));
+    const MetricsSnapshot changed = Metrics::stats();
+    ASSERT_TRUE(client->sendPEBatch(pes));
+    EXPECT_EQ(server->receivePEBatch().size(), pes.size());
+    if (Metrics::enabled()) {
+        const MetricsSnapshot after = Metrics::stats();
+        const std::size_t batch = static_cast<std::size_t>(NetworkMessage::Kind::PEBatch);
+        EXPECT_EQ(after.bytesSent[batch] - changed.bytesSent[batch], MessageCodec::encodePEBatch(pes).size());
+    }
+}
+
+TEST(FrameCompressionTest, BlobsShapedLikeCompressionFramesArriveAsBlobs) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    client->enableCompression();
+    server->enableCompression();
+    const std::vector<PE> pes = makePEs(64);
+    // Both ends compress, so each decompresses and handles hellos from the other
+    ASSERT_TRUE(client->sendPEBatch(pes));
+    ASSERT_TRUE(server->sendPEBatch(pes));
+    EXPECT_EQ(server->receivePEBatch().size(), pes.size());
+    EXPECT_EQ(client->receivePEBatch().size(), pes.size());
+
+    const std::vector<std::string> lookalikes = {
+        std::string(1, FrameCompression::kMarker) + "not compressed",
+        FrameCompression::encodeHello(*FrameDictionary::standard()),
+        FrameCompression::encodeHelloAck(FrameDictionary::standard()->id()),
+    };
+    for (const std::string& blob : lookalikes) {
+        ASSERT_TRUE(client->sendBlob(blob));
+        ASSERT_TRUE(client->sendPE(pes.front()));
+        EXPECT_EQ(server->receiveBlob(), std::vector<std::string>{blob});
+        EXPECT_EQ(server->receivePE().id, pes.front().id);
+    }
+}
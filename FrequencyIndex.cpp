@@ -0,0 +1,206 @@
+#include "FrequencyIndex.h"
+#include <algorithm>
+#include <limits>
+
+/*!
+    \class FrequencyIndex
+    \brief Interval index over Emitter frequency bands.
+
+    Bands are kept in a treap ordered by freqMin, where every node also records
+    the largest freqMax in its subtree, both over all bands and over active bands
+    only. Overlap and stabbing queries skip any subtree whose largest freqMax is
+    below the query, and stop descending right once freqMin passes the query, so
+    they run in O(log n + k) expected time for k results. Updates replace a key's
+    band in O(log n) expected time.
+
+    Keys are dense row indices, such as those handed out by EntityStore, and double
+    as node indices so no per-update allocation is needed once a key has been seen.
+*/
+
+namespace {
+constexpr double kNoBand = -std::numeric_limits<double>::infinity();
+
+// Deterministic per-key priority, so the tree shape does not depend on update order
+std::uint32_t mixKey(std::uint32_t key) {
+    std::uint64_t x = key + 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<std::uint32_t>(x ^ (x >> 31));
+}
+}
+
+/*!
+    \fn void FrequencyIndex::update(std::uint32_t key, double freqMin, double freqMax, bool active)
+    \brief Inserts a band for a key, or replaces the key's existing band.
+    \param key The key to index.
+    \param freqMin The lower edge of the band.
+    \param freqMax The upper edge of the band.
+    \param active Whether the band is currently active.
+*/
+void FrequencyIndex::update(std::uint32_t key, double freqMin, double freqMax, bool active) {
+    if (key >= nodes.size()) {
+        nodes.resize(key + 1);
+    }
+    if (nodes[key].present) {
+        root = erase(root, key);
+        --count;
+    }
+    Node& node = nodes[key];
+    node.low = freqMin;
+    node.high = freqMax;
+    node.active = active;
+    node.priority = mixKey(key);
+    node.left = kNone;
+    node.right = kNone;
+    node.present = true;
+    refresh(static_cast<std::int32_t>(key));
+    root = insert(root, key);
+    ++count;
+}
+
+/*!
+    \fn void FrequencyIndex::remove(std::uint32_t key)
+    \brief Removes a key's band from the index.
+    \param key The key to remove.
+*/
+void FrequencyIndex::remove(std::uint32_t key) {
+    if (!contains(key)) {
+        return;
+    }
+    root = erase(root, key);
+    nodes[key].present = false;
+    --count;
+}
+
+/*!
+    \fn bool FrequencyIndex::contains(std::uint32_t key) const
+    \brief Returns true if the key currently has a band in the index.
+*/
+bool FrequencyIndex::contains(std::uint32_t key) const {
+    return key < nodes.size() && nodes[key].present;
+}
+
+/*!
+    \fn std::vector<std::uint32_t> FrequencyIndex::overlapping(double low, double high, bool activeOnly) const
+    \brief Finds every band that overlaps a query band.
+    \param low The lower edge of the query band.
+    \param high The upper edge of the query band.
+    \param activeOnly If true, only active bands are returned.
+    \return The matching keys in ascending freqMin order.
+*/
+std::vector<std::uint32_t> FrequencyIndex::overlapping(double low, double high, bool activeOnly) const {
+    std::vector<std::uint32_t> result;
+    collect(root, low, high, activeOnly, result);
+    return result;
+}
+
+/*!
+    \fn std::vector<std::uint32_t> FrequencyIndex::stabbing(double freq, bool activeOnly) const
+    \brief Finds every band that contains a frequency.
+    \param freq The frequency to look up.
+    \param activeOnly If true, only active bands are returned.
+    \return The matching keys in ascending freqMin order.
+*/
+std::vector<std::uint32_t> FrequencyIndex::stabbing(double freq, bool activeOnly) const {
+    return overlapping(freq, freq, activeOnly);
+}
+
+bool FrequencyIndex::lessThan(std::uint32_t a, std::uint32_t b) const {
+    if (nodes[a].low != nodes[b].low) {
+        return nodes[a].low < nodes[b].low;
+    }
+    return a < b;
+}
+
+void FrequencyIndex::refresh(std::int32_t index) {
+    Node& node = nodes[index];
+    node.maxHigh = node.high;
+    node.maxActiveHigh = node.active ? node.high : kNoBand;
+    for (std::int32_t child : {node.left, node.right}) {
+        if (child != kNone) {
+            node.maxHigh = std::max(node.maxHigh, nodes[child].maxHigh);
+            node.maxActiveHigh = std::max(node.maxActiveHigh, nodes[child].maxActiveHigh);
+        }
+    }
+}
+
+void FrequencyIndex::split(std::int32_t subtree, std::uint32_t key, std::int32_t& before, std::int32_t& after) {
+    if (subtree == kNone) {
+        before = after = kNone;
+        return;
+    }
+    if (lessThan(static_cast<std::uint32_t>(subtree), key)) {
+        split(nodes[subtree].right, key, nodes[subtree].right, after);
+        before = subtree;
+    } else {
+        split(nodes[subtree].left, key, before, nodes[subtree].left);
+        after = subtree;
+    }
+    refresh(subtree);
+}
+
+std::int32_t FrequencyIndex::merge(std::int32_t before, std::int32_t after) {
+    if (before == kNone) return after;
+    if (after == kNone) return before;
+    if (nodes[before].priority > nodes[after].priority) {
+        nodes[before].right = merge(nodes[before].right, after);
+        refresh(before);
+        return before;
+    }
+    nodes[after].left = merge(before, nodes[after].left);
+    refresh(after);
+    return after;
+}
+
+std::int32_t FrequencyIndex::insert(std::int32_t subtree, std::uint32_t key) {
+    const auto index = static_cast<std::int32_t>(key);
+    if (subtree == kNone) {
+        return index;
+    }
+    if (nodes[index].priority > nodes[subtree].priority) {
+        split(subtree, key, nodes[index].left, nodes[index].right);
+        refresh(index);
+        return index;
+    }
+    if (lessThan(key, static_cast<std::uint32_t>(subtree))) {
+        nodes[subtree].left = insert(nodes[subtree].left, key);
+    } else {
+        nodes[subtree].right = insert(nodes[subtree].right, key);
+    }
+    refresh(subtree);
+    return subtree;
+}
+
+std::int32_t FrequencyIndex::erase(std::int32_t subtree, std::uint32_t key) {
+    if (subtree == kNone) {
+        return kNone;
+    }
+    if (static_cast<std::uint32_t>(subtree) == key) {
+        return merge(nodes[subtree].left, nodes[subtree].right);
+    }
+    if (lessThan(key, static_cast<std::uint32_t>(subtree))) {
+        nodes[subtree].left = erase(nodes[subtree].left, key);
+    } else {
+        nodes[subtree].right = erase(nodes[subtree].right, key);
+    }
+    refresh(subtree);
+    return subtree;
+}
+
+void FrequencyIndex::collect(std::int32_t index, double low, double high, bool activeOnly, std::vector<std::uint32_t>& out) const {
+    if (index == kNone) {
+        return;
+    }
+    const Node& node = nodes[index];
+    if ((activeOnly ? node.maxActiveHigh : node.maxHigh) < low) {
+        return;
+    }
+    collect(node.left, low, high, activeOnly, out);
+    if (node.low > high) {
+        return;
+    }
+    if (node.high >= low && (!activeOnly || node.active)) {
+        out.push_back(static_cast<std::uint32_t>(index));
+    }
+    collect(node.right, low, high, activeOnly, out);
+}
@@ -0,0 +1,49 @@
+#ifndef FREQUENCYINDEX_H
+#define FREQUENCYINDEX_H
+
+#include <cstdint>
+#include <vector>
+
+class FrequencyIndex {
+public:
+    FrequencyIndex() = default;
+    // Insert a key's band or replace its existing band and active flag
+    void update(std::uint32_t key, double freqMin, double freqMax, bool active);
+    // Remove a key, no-op if it is not indexed
+    void remove(std::uint32_t key);
+    bool contains(std::uint32_t key) const;
+    std::size_t size() const { return count; }
+    // Keys whose [freqMin, freqMax] band overlaps [low, high]
+    std::vector<std::uint32_t> overlapping(double low, double high, bool activeOnly = false) const;
+    // Keys whose band contains a single frequency
+    std::vector<std::uint32_t> stabbing(double freq, bool activeOnly = false) const;
+
+private:
+    static constexpr std::int32_t kNone = -1;
+    struct Node {
+        double low = 0.0;
+        double high = 0.0;
+        // Largest band end in this subtree, over all nodes and over active nodes only
+        double maxHigh = 0.0;
+        double maxActiveHigh = 0.0;
+        std::uint32_t priority = 0;
+        std::int32_t left = kNone;
+        std::int32_t right = kNone;
+        bool active = false;
+        bool present = false;
+    };
+    bool lessThan(std::uint32_t a, std::uint32_t b) const;
+    void refresh(std::int32_t node);
+    // Split a subtree into nodes ordered before key and the rest
+    void split(std::int32_t root, std::uint32_t key, std::int32_t& before, std::int32_t& after);
+    std::int32_t merge(std::int32_t before, std::int32_t after);
+    std::int32_t insert(std::int32_t root, std::uint32_t key);
+    std::int32_t erase(std::int32_t root, std::uint32_t key);
+    void collect(std::int32_t node, double low, double high, bool activeOnly, std::vector<std::uint32_t>& out) const;
+
+    std::vector<Node> nodes;
+    std::int32_t root = kNone;
+    std::size_t count = 0;
+};
+
+#endif // FREQUENCYINDEX_H
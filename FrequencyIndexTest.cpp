@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "FrequencyIndex.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+std::vector<std::uint32_t> sorted(std::vector<std::uint32_t> keys) {
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+}
+
+TEST(FrequencyIndexTest, OverlapAndStabbingQueries) {
+    FrequencyIndex index;
+    index.update(0, 8000.0, 12000.0, true);
+    index.update(1, 2000.0, 4000.0, true);
+    index.update(2, 3500.0, 9000.0, false);
+    index.update(3, 15000.0, 18000.0, true);
+
+    EXPECT_EQ(sorted(index.overlapping(3800.0, 8500.0)), (std::vector<std::uint32_t>{0, 1, 2}));
+    EXPECT_EQ(sorted(index.overlapping(3800.0, 8500.0, true)), (std::vector<std::uint32_t>{0, 1}));
+    EXPECT_EQ(index.stabbing(16000.0), (std::vector<std::uint32_t>{3}));
+    EXPECT_TRUE(index.stabbing(13000.0).empty());
+}
+
+TEST(FrequencyIndexTest, UpdateReplacesBandAndActiveFlag) {
+    FrequencyIndex index;
+    index.update(0, 8000.0, 12000.0, false);
+    EXPECT_TRUE(index.stabbing(10000.0, true).empty());
+
+    index.update(0, 1000.0, 2000.0, true);
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_TRUE(index.stabbing(10000.0).empty());
+    EXPECT_EQ(index.stabbing(1500.0, true), (std::vector<std::uint32_t>{0}));
+
+    index.remove(0);
+    EXPECT_FALSE(index.contains(0));
+    EXPECT_TRUE(index.stabbing(1500.0).empty());
+}
+
+TEST(FrequencyIndexTest, MatchesBruteForceUnderRandomUpdates) {
+    struct Band {
+        double low = 0.0;
+        double high = 0.0;
+        bool active = false;
+        bool present = false;
+    };
+    FrequencyIndex index;
+    std::vector<Band> bands(500);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> freq(0.0, 20000.0);
+    std::uniform_real_distribution<double> width(1.0, 2000.0);
+    std::uniform_int_distribution<std::uint32_t> pickKey(0, 499);
+
+    for (int step = 0; step < 5000; ++step) {
+        const std::uint32_t key = pickKey(rng);
+        if (step % 10 == 9) {
+            index.remove(key);
+            bands[key].present = false;
+        } else {
+            const double low = freq(rng);
+            bands[key] = Band{low, low + width(rng), rng() % 2 == 0, true};
+            index.update(key, bands[key].low, bands[key].high, bands[key].active);
+        }
+    }
+
+    for (int query = 0; query < 200; ++query) {
+        const double low = freq(rng);
+        const double high = low + width(rng);
+        const bool activeOnly = query % 2 == 0;
+        std::vector<std::uint32_t> expected;
+        for (std::uint32_t key = 0; key < bands.size(); ++key) {
+            const Band& band = bands[key];
+            if (band.present && band.low <= high && band.high >= low && (!activeOnly || band.active)) {
+                expected.push_back(key);
+            }
+        }
+        EXPECT_EQ(sorted(index.overlapping(low, high, activeOnly)), expected);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
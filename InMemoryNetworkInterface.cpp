@@ -0,0 +1,228 @@
+#include "InMemoryNetworkInterface.h"
+#include <boost/asio/error.hpp>
+#include <boost/system/system_error.hpp>
+#include <algorithm>
+#include <thread>
+
+namespace {
+// Spins before a blocked push or pop parks on the condition variable
+constexpr int kSpinIterations = 64;
+
+std::size_t roundUpToPowerOfTwo(std::size_t value) {
+    std::size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+}
+
+/*!
+    \class InMemoryChannel
+    \brief Carries frames in one direction between the two ends of an in-memory pair.
+
+    The frames sit in a ring of slots indexed by two atomic counters. The
+    writer only advances tail and the reader only advances head, so a send
+    and a receive never contend on a lock. NetworkImplementation serialises
+    its senders and its receivers, which keeps each ring to one writer and
+    one reader.
+
+    A push or pop that cannot proceed spins briefly and then parks on a
+    condition variable. The other side only takes the mutex to wake it when
+    a waiter has registered, so an unloaded channel runs entirely on the
+    atomics.
+
+    Each frame is stamped with the time it becomes readable. With a bandwidth
+    set, a frame occupies the simulated link for its size divided by the rate,
+    starting when the previous frame has finished, and the latency is added on
+    top. The reader waits until that time before returning it.
+*/
+
+/*!
+    \fn InMemoryChannel::InMemoryChannel(const InMemoryLinkConfig& config)
+    \brief Creates an empty channel with the config's latency, bandwidth and capacity.
+*/
+InMemoryChannel::InMemoryChannel(const InMemoryLinkConfig& config)
+    : latency(config.latency),
+      bytesPerSecond(config.bytesPerSecond),
+      ring(roundUpToPowerOfTwo(std::max<std::size_t>(config.capacity, 2))),
+      mask(ring.size() - 1) {}
+
+template <typename Ready>
+void InMemoryChannel::waitFor(Ready ready) {
+    for (int i = 0; i < kSpinIterations; ++i) {
+        if (ready() || closed.load()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    // Registering before the last check pairs with the other side publishing before it reads waiters
+    waiters.fetch_add(1);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return ready() || closed.load(); });
+    }
+    waiters.fetch_sub(1);
+}
+
+void InMemoryChannel::wakeWaiters() {
+    if (waiters.load() > 0) {
+        // Taking the mutex means a waiter is either before its check or already waiting
+        { std::lock_guard<std::mutex> lock(mutex); }
+        changed.notify_all();
+    }
+}
+
+/*!
+    \fn void InMemoryChannel::push(std::string frame)
+    \brief Queues a frame for the reader.
+    \param frame The frame, without its trailing newline.
+
+    Throws boost::system::system_error with boost::asio::error::broken_pipe
+    if the channel is closed, as a write to a closed socket would.
+*/
+void InMemoryChannel::push(std::string frame) {
+    const std::size_t position = tail.load(std::memory_order_relaxed);
+    waitFor([&]() { return position - head.load() < ring.size(); });
+    if (closed.load()) {
+        throw boost::system::system_error(boost::asio::error::broken_pipe);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (bytesPerSecond > 0) {
+        // The newline a socket would carry is counted too
+        const auto transmit = std::chrono::nanoseconds((frame.size() + 1) * 1000000000ull / bytesPerSecond);
+        linkFree = std::max(linkFree, now) + transmit;
+        now = linkFree;
+    }
+    Slot& slot = ring[position & mask];
+    slot.frame = std::move(frame);
+    slot.deliverAt = now + latency;
+    tail.store(position + 1);
+    wakeWaiters();
+}
+
+/*!
+    \fn std::string InMemoryChannel::pop()
+    \brief Takes the next frame once it is due.
+    \return The frame, without its trailing newline.
+
+    Frames already queued are still returned after close(), so the peer sees
+    everything that was sent. Once they are drained this throws
+    boost::system::system_error with boost::asio::error::eof.
+*/
+std::string InMemoryChannel::pop() {
+    const std::size_t position = head.load(std::memory_order_relaxed);
+    waitFor([&]() { return tail.load() != position; });
+    if (tail.load() == position) {
+        throw boost::system::system_error(boost::asio::error::eof);
+    }
+
+    Slot& slot = ring[position & mask];
+    if (slot.deliverAt > std::chrono::steady_clock::now()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait_until(lock, slot.deliverAt, [this]() { return closed.load(); });
+    }
+    std::string frame = std::move(slot.frame);
+    head.store(position + 1);
+    wakeWaiters();
+    return frame;
+}
+
+/*!
+    \fn void InMemoryChannel::close()
+    \brief Closes the channel and wakes any blocked push or pop. Safe to call from any thread.
+*/
+void InMemoryChannel::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    changed.notify_all();
+}
+
+/*!
+    \class InMemoryNetworkInterface
+    \brief A NetworkImplementation connected to its peer through memory rather than a socket.
+
+    Every send and receive goes through the same encoding, validation,
+    framing, metrics, tracing and capture code as the TCP implementation;
+    only the transport hooks differ. Tests get a connected pair without
+    ports or sleeps, and benchmarks measure the message paths without the
+    kernel's networking stack. InMemoryLinkConfig adds latency and a
+    bandwidth limit for testing behaviour on slow links.
+*/
+
+/*!
+    \fn InMemoryNetworkInterface::Pair InMemoryNetworkInterface::createPair(const InMemoryLinkConfig& config)
+    \brief Creates two interfaces connected to each other.
+    \param config The simulated link, applied to both directions.
+    \return The two ends, either can be used as the client or the server.
+*/
+InMemoryNetworkInterface::Pair InMemoryNetworkInterface::createPair(const InMemoryLinkConfig& config) {
+    auto forward = std::make_shared<InMemoryChannel>(config);
+    auto backward = std::make_shared<InMemoryChannel>(config);
+    return {std::unique_ptr<InMemoryNetworkInterface>(new InMemoryNetworkInterface(backward, forward)),
+            std::unique_ptr<InMemoryNetworkInterface>(new InMemoryNetworkInterface(forward, backward))};
+}
+
+InMemoryNetworkInterface::InMemoryNetworkInterface(std::shared_ptr<InMemoryChannel> incoming,
+                                                   std::shared_ptr<InMemoryChannel> outgoing)
+    : incoming(std::move(incoming)), outgoing(std::move(outgoing)) {}
+
+/*!
+    \fn void InMemoryNetworkInterface::initialise(const std::string& address, unsigned short port)
+    \brief Does nothing, the pair is connected when it is created.
+*/
+void InMemoryNetworkInterface::initialise(const std::string&, unsigned short) {}
+
+/*!
+    \fn void InMemoryNetworkInterface::close()
+    \brief Closes both directions of the link.
+
+    A receive blocked on this end returns with an error, and the peer reads
+    any frames already sent before seeing end of file.
+*/
+void InMemoryNetworkInterface::close() {
+    incoming->close();
+    outgoing->close();
+}
+
+std::string InMemoryNetworkInterface::readTransportFrame() {
+    return incoming->pop();
+}
+
+void InMemoryNetworkInterface::writeTransportFrame(const std::string& data) {
+    // The channel carries frames as readTransportFrame() returns them, without the newline
+    const std::size_t length = !data.empty() && data.back() == '\n' ? data.size() - 1 : data.size();
+    outgoing->push(data.substr(0, length));
+}
+
+void InMemoryNetworkInterface::writeTransportFrame(const std::vector<boost::asio::const_buffer>& parts) {
+    std::string frame(boost::asio::buffer_size(parts), '\0');
+    boost::asio::buffer_copy(boost::asio::buffer(frame), parts);
+    if (!frame.empty() && frame.back() == '\n') {
+        frame.pop_back();
+    }
+    outgoing->push(std::move(frame));
+}
+
+void InMemoryNetworkInterface::writeTransportBytes(const std::vector<boost::asio::const_buffer>& parts) {
+    for (const boost::asio::const_buffer& part : parts) {
+        const char* data = static_cast<const char*>(part.data());
+        for (std::size_t offset = 0; offset < part.size(); offset += kStreamPieceBytes) {
+            outgoing->push(std::string(data + offset, std::min(kStreamPieceBytes, part.size() - offset)));
+        }
+    }
+}
+
+std::size_t InMemoryNetworkInterface::readTransportBytes(char* destination, std::size_t size) {
+    while (streamOffset == streamPiece.size()) {
+        streamPiece = incoming->pop();
+        streamOffset = 0;
+    }
+    const std::size_t count = std::min(size, streamPiece.size() - streamOffset);
+    std::copy_n(streamPiece.data() + streamOffset, count, destination);
+    streamOffset += count;
+    return count;
+}
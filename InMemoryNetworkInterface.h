@@ -0,0 +1,99 @@
+#ifndef INMEMORYNETWORKINTERFACE_H
+#define INMEMORYNETWORKINTERFACE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+
+// Simulated link between the two ends of an in-memory pair, the defaults deliver immediately
+struct InMemoryLinkConfig {
+    // Added to every frame between being written and becoming readable
+    std::chrono::nanoseconds latency{0};
+    // Frames are serialised onto the link at this rate, 0 for unlimited
+    std::uint64_t bytesPerSecond = 0;
+    // Frames in flight per direction before writers block, rounded up to a power of two
+    std::size_t capacity = 1024;
+};
+
+// One direction of an in-memory link, a lock-free ring with a single writer and a single reader
+class InMemoryChannel {
+public:
+    explicit InMemoryChannel(const InMemoryLinkConfig& config);
+    InMemoryChannel(const InMemoryChannel&) = delete;
+    InMemoryChannel& operator=(const InMemoryChannel&) = delete;
+    // Blocks while the ring is full, throws boost::system::system_error(broken_pipe) once closed
+    void push(std::string frame);
+    // Blocks until a frame is due, throws boost::system::system_error(eof) once closed and drained
+    std::string pop();
+    // Wakes every blocked push and pop
+    void close();
+    bool isClosed() const { return closed.load(); }
+
+private:
+    struct Slot {
+        std::string frame;
+        std::chrono::steady_clock::time_point deliverAt;
+    };
+
+    template <typename Ready>
+    void waitFor(Ready ready);
+    void wakeWaiters();
+
+    const std::chrono::nanoseconds latency;
+    const std::uint64_t bytesPerSecond;
+    std::vector<Slot> ring;
+    const std::size_t mask;
+    // Next slot to read, only advanced by the reader
+    alignas(64) std::atomic<std::size_t> head{0};
+    // Next slot to write, only advanced by the writer
+    alignas(64) std::atomic<std::size_t> tail{0};
+    // Writer only, when the simulated link finishes sending the last frame
+    std::chrono::steady_clock::time_point linkFree;
+    std::atomic<bool> closed{false};
+    // Threads parked on changed, so the fast path never touches the mutex
+    std::atomic<int> waiters{0};
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+// NetworkImplementation whose frames travel through in-memory channels instead of a socket,
+// for deterministic tests and benchmarks of the encode, framing and decode paths
+class InMemoryNetworkInterface : public NetworkImplementation {
+public:
+    using Pair = std::pair<std::unique_ptr<InMemoryNetworkInterface>, std::unique_ptr<InMemoryNetworkInterface>>;
+
+    // Two ends already connected to each other, whatever one sends the other receives
+    static Pair createPair(const InMemoryLinkConfig& config = {});
+    // The pair is connected when created, the address and port are ignored
+    void initialise(const std::string& address, unsigned short port) override;
+    // Both directions are closed, the peer reads what was already sent and then end of file
+    void close() override;
+
+protected:
+    std::string readTransportFrame() override;
+    void writeTransportFrame(const std::string& data) override;
+    void writeTransportFrame(const std::vector<boost::asio::const_buffer>& parts) override;
+    // Blob stream bytes travel as frames of at most kStreamPieceBytes, read back as one byte stream
+    void writeTransportBytes(const std::vector<boost::asio::const_buffer>& parts) override;
+    std::size_t readTransportBytes(char* destination, std::size_t size) override;
+
+private:
+    static constexpr std::size_t kStreamPieceBytes = 65536;
+
+    InMemoryNetworkInterface(std::shared_ptr<InMemoryChannel> incoming, std::shared_ptr<InMemoryChannel> outgoing);
+
+    std::shared_ptr<InMemoryChannel> incoming;
+    std::shared_ptr<InMemoryChannel> outgoing;
+    // Stream bytes popped but not yet read, guarded by the receive mutex like the socket's read buffer
+    std::string streamPiece;
+    std::size_t streamOffset = 0;
+};
+
+#endif // INMEMORYNETWORKINTERFACE_H
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "InMemoryNetworkInterface.h"
+#include "TrafficCapture.h"
+#include <filesystem>
+#include <thread>
+
+namespace {
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const PE kPE("InMemory", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+}
+
+TEST(InMemoryNetworkInterfaceTest, EachEndReceivesWhatTheOtherSends) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    client->initialise("ignored", 0);
+    ASSERT_TRUE(client->sendPE(kPE));
+    ASSERT_TRUE(server->sendPESetting("JAM", "InMemory", 1));
+    EXPECT_EQ(server->receivePE().id, kPE.id);
+    EXPECT_EQ(client->receiveSetting(), std::make_tuple(std::string("PE_SETTING"), std::string("InMemory"), std::string("JAM"), 1));
+}
+
+TEST(InMemoryNetworkInterfaceTest, WritersBlockWhileTheChannelIsFull) {
+    InMemoryLinkConfig config;
+    config.capacity = 4;
+    auto [client, server] = InMemoryNetworkInterface::createPair(config);
+    std::thread writer([&client = client]() {
+        for (int i = 0; i < 1000; ++i) {
+            client->sendBlob(std::to_string(i));
+        }
+    });
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(server->receiveBlob().front(), std::to_string(i));
+    }
+    writer.join();
+}
+
+TEST(InMemoryNetworkInterfaceTest, LatencyDelaysEveryFrame) {
+    InMemoryLinkConfig config;
+    config.latency = std::chrono::milliseconds(50);
+    auto [client, server] = InMemoryNetworkInterface::createPair(config);
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(client->sendPE(kPE));
+    ASSERT_TRUE(client->sendPE(kPE));
+    // Sending does not wait for the link, only receiving does
+    EXPECT_LT(secondsSince(start), 0.04);
+    server->receivePE();
+    server->receivePE();
+    // Latency overlaps between frames rather than adding up
+    EXPECT_GE(secondsSince(start), 0.05);
+    EXPECT_LT(secondsSince(start), 0.09);
+}
+
+TEST(InMemoryNetworkInterfaceTest, BandwidthSpacesFramesBySize) {
+    InMemoryLinkConfig config;
+    config.bytesPerSecond = 10000;
+    auto [client, server] = InMemoryNetworkInterface::createPair(config);
+    const std::string blob(499, 'x');
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(client->sendBlob(blob));
+    }
+    for (int i = 0; i < 4; ++i) {
+        server->receiveBlob();
+    }
+    // Four 500 byte frames at 10 kB/s take 200 ms to cross the link
+    EXPECT_GE(secondsSince(start), 0.2);
+    EXPECT_LT(secondsSince(start), 0.35);
+}
+
+TEST(InMemoryNetworkInterfaceTest, ClosingDeliversSentFramesThenEndOfFile) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    ASSERT_TRUE(client->sendBlob("last words"));
+    client->close();
+    EXPECT_FALSE(client->sendPE(kPE));
+    EXPECT_FALSE(server->sendPE(kPE));
+    EXPECT_EQ(server->receiveBlob().front(), "last words");
+    EXPECT_THROW(server->receiveBlob(), boost::system::system_error);
+}
+
+TEST(InMemoryNetworkInterfaceTest, CloseWakesABlockedReceive) {
+    auto [client, server] = InMemoryNetworkInterface::createPair();
+    std::thread closer([&server = server]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        server->close();
+    });
+    EXPECT_THROW(server->receivePE(), boost::system::system_error);
+    closer.join();
+}
+
+TEST(InMemoryNetworkInterfaceTest, ReceivedFramesAreCaptured) {
+    const auto directory = std::filesystem::temp_directory_path() / "ani-inmemory-capture";
+    std::filesystem::remove_all(directory);
+    {
+        auto [client, server] = InMemoryNetworkInterface::createPair();
+        server->setCapture(std::make_shared<TrafficCapture>(directory.string()));
+        ASSERT_TRUE(client->sendBlob("captured"));
+        server->receiveBlob();
+    }
+    CaptureReader reader(directory.string());
+    CapturedFrame frame;
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.data, "captured");
+    std::filesystem::remove_all(directory);
+}
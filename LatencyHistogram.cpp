@@ -0,0 +1,283 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+/*!
+    \class LatencyHistogram
+    \brief Fixed-precision histogram for latency percentiles.
+
+    Follows the layout of HdrHistogram: values are split into buckets that each
+    cover twice the range of the one before, and every bucket is divided into
+    the same number of linear sub-buckets. A value is therefore stored with a
+    relative error of at most one part in 10^significantDigits whether it is a
+    few microseconds or several seconds, and recording is a couple of shifts
+    and an increment with no allocation.
+
+    The percentile output uses the .hgrm text format, so it can be plotted with
+    the standard HdrHistogram tools.
+*/
+
+namespace {
+int leadingZeros(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return value == 0 ? 64 : __builtin_clzll(value);
+#else
+    int zeros = 0;
+    for (std::uint64_t bit = std::uint64_t(1) << 63; bit != 0 && !(value & bit); bit >>= 1) {
+        ++zeros;
+    }
+    return zeros;
+#endif
+}
+}
+
+/*!
+    \fn LatencyHistogram::LatencyHistogram(std::int64_t highestTrackableValue, int significantDigits)
+    \brief Constructs an empty histogram.
+    \param highestTrackableValue The largest value that can be recorded exactly, at least 2.
+    \param significantDigits The number of significant decimal digits kept, from 1 to 5.
+
+    Throws std::invalid_argument if either parameter is out of range.
+*/
+LatencyHistogram::LatencyHistogram(std::int64_t highestTrackableValue, int significantDigits)
+    : highestTrackable(highestTrackableValue) {
+    if (highestTrackableValue < 2 || significantDigits < 1 || significantDigits > 5) {
+        throw std::invalid_argument("LatencyHistogram needs a range of at least 2 and 1 to 5 significant digits");
+    }
+    // Enough linear sub-buckets to tell apart values that differ in the last significant digit
+    const std::int64_t largestSingleUnitValue = 2 * static_cast<std::int64_t>(std::pow(10, significantDigits));
+    int subBucketCountMagnitude = 0;
+    while ((std::int64_t(1) << subBucketCountMagnitude) < largestSingleUnitValue) {
+        ++subBucketCountMagnitude;
+    }
+    subBucketHalfCountMagnitude = subBucketCountMagnitude - 1;
+    const std::int64_t subBucketCount = std::int64_t(1) << subBucketCountMagnitude;
+    subBucketHalfCount = subBucketCount / 2;
+    subBucketMask = subBucketCount - 1;
+
+    bucketCount = 1;
+    for (std::int64_t trackable = subBucketCount; trackable <= highestTrackableValue && bucketCount < 62; trackable <<= 1) {
+        ++bucketCount;
+    }
+    counts.assign(static_cast<std::size_t>((bucketCount + 1) * subBucketHalfCount), 0);
+}
+
+/*!
+    \fn void LatencyHistogram::record(std::int64_t value)
+    \brief Records one value.
+    \param value The value, negative values are recorded as 0.
+*/
+void LatencyHistogram::record(std::int64_t value) {
+    value = std::clamp<std::int64_t>(value, 0, highestTrackable);
+    ++counts[countsIndex(value)];
+    if (totalCount == 0 || value < minValue) {
+        minValue = value;
+    }
+    maxValue = std::max(maxValue, value);
+    ++totalCount;
+}
+
+/*!
+    \fn void LatencyHistogram::recordCorrected(std::int64_t value, std::int64_t expectedInterval)
+    \brief Records one value with coordinated omission correction.
+    \param value The measured value.
+    \param expectedInterval The interval at which the measuring loop meant to take samples.
+
+    A loop that waits for each response before sending the next request takes
+    no samples while the system is stalled. For a value longer than the
+    expected interval, the samples that would have been taken during the stall
+    are added too, each one interval shorter than the last.
+*/
+void LatencyHistogram::recordCorrected(std::int64_t value, std::int64_t expectedInterval) {
+    record(value);
+    if (expectedInterval <= 0) {
+        return;
+    }
+    for (std::int64_t missing = value - expectedInterval; missing >= expectedInterval; missing -= expectedInterval) {
+        record(missing);
+    }
+}
+
+/*!
+    \fn void LatencyHistogram::merge(const LatencyHistogram& other)
+    \brief Adds all counts from another histogram.
+    \param other A histogram constructed with the same range and precision.
+
+    Throws std::invalid_argument if the layouts differ.
+*/
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.counts.size() != counts.size() || other.subBucketHalfCount != subBucketHalfCount) {
+        throw std::invalid_argument("Cannot merge LatencyHistograms with different ranges or precision");
+    }
+    if (other.totalCount == 0) {
+        return;
+    }
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+    minValue = totalCount == 0 ? other.minValue : std::min(minValue, other.minValue);
+    maxValue = std::max(maxValue, other.maxValue);
+    totalCount += other.totalCount;
+}
+
+/*!
+    \fn void LatencyHistogram::reset()
+    \brief Clears all counts, keeping the range and precision.
+*/
+void LatencyHistogram::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    totalCount = 0;
+    minValue = 0;
+    maxValue = 0;
+}
+
+/*!
+    \fn std::int64_t LatencyHistogram::min() const
+    \brief Returns the smallest recorded value, or 0 if the histogram is empty.
+*/
+std::int64_t LatencyHistogram::min() const {
+    return minValue;
+}
+
+/*!
+    \fn std::int64_t LatencyHistogram::max() const
+    \brief Returns the largest recorded value, or 0 if the histogram is empty.
+*/
+std::int64_t LatencyHistogram::max() const {
+    return maxValue;
+}
+
+/*!
+    \fn double LatencyHistogram::mean() const
+    \brief Returns the mean of the recorded values, to the histogram's precision.
+*/
+double LatencyHistogram::mean() const {
+    if (totalCount == 0) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            sum += static_cast<double>(counts[i]) * static_cast<double>(medianEquivalentValue(valueFromIndex(i)));
+        }
+    }
+    return sum / static_cast<double>(totalCount);
+}
+
+/*!
+    \fn double LatencyHistogram::stddev() const
+    \brief Returns the standard deviation of the recorded values, to the histogram's precision.
+*/
+double LatencyHistogram::stddev() const {
+    if (totalCount == 0) {
+        return 0.0;
+    }
+    const double average = mean();
+    double squares = 0.0;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] != 0) {
+            const double deviation = static_cast<double>(medianEquivalentValue(valueFromIndex(i))) - average;
+            squares += static_cast<double>(counts[i]) * deviation * deviation;
+        }
+    }
+    return std::sqrt(squares / static_cast<double>(totalCount));
+}
+
+/*!
+    \fn std::int64_t LatencyHistogram::valueAtPercentile(double percentile) const
+    \brief Returns the value at a percentile.
+    \param percentile The percentile, from 0 to 100.
+    \return The highest value equivalent to the recorded value at that percentile, or 0 if empty.
+*/
+std::int64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+    if (totalCount == 0) {
+        return 0;
+    }
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    const std::uint64_t target = std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(totalCount) + 0.5));
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        cumulative += counts[i];
+        if (cumulative >= target) {
+            return std::min(highestEquivalentValue(valueFromIndex(i)), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+/*!
+    \fn void LatencyHistogram::writePercentiles(std::ostream& out, double scale, int ticksPerHalfDistance) const
+    \brief Writes the percentile distribution in the HdrHistogram .hgrm format.
+    \param out The stream to write to.
+    \param scale Divisor applied to every value, for example 1000 to print nanoseconds as microseconds.
+    \param ticksPerHalfDistance Lines written for each halving of the distance to 100%.
+*/
+void LatencyHistogram::writePercentiles(std::ostream& out, double scale, int ticksPerHalfDistance) const {
+    char line[128];
+    out << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+    double level = 0.0;
+    while (totalCount != 0) {
+        const std::int64_t value = valueAtPercentile(level);
+        std::uint64_t atOrBelow = 0;
+        const std::size_t last = countsIndex(value);
+        for (std::size_t i = 0; i <= last && i < counts.size(); ++i) {
+            atOrBelow += counts[i];
+        }
+        if (atOrBelow >= totalCount) {
+            std::snprintf(line, sizeof(line), "%12.3f %2.12f %10llu\n", static_cast<double>(maxValue) / scale, 1.0,
+                          static_cast<unsigned long long>(totalCount));
+            out << line;
+            break;
+        }
+        std::snprintf(line, sizeof(line), "%12.3f %2.12f %10llu %14.2f\n", static_cast<double>(value) / scale, level / 100.0,
+                      static_cast<unsigned long long>(atOrBelow), 1.0 / (1.0 - level / 100.0));
+        out << line;
+        // Step in ever smaller increments towards 100%, ticksPerHalfDistance per halving
+        const int halfDistance = static_cast<int>(std::floor(std::log2(100.0 / (100.0 - level))));
+        const double ticks = ticksPerHalfDistance * std::pow(2.0, halfDistance + 1);
+        level += 100.0 / ticks;
+    }
+    std::snprintf(line, sizeof(line), "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean() / scale, stddev() / scale);
+    out << line;
+    std::snprintf(line, sizeof(line), "#[Max     = %12.3f, Total count    = %12llu]\n", static_cast<double>(maxValue) / scale,
+                  static_cast<unsigned long long>(totalCount));
+    out << line;
+    std::snprintf(line, sizeof(line), "#[Buckets = %12d, SubBuckets     = %12lld]\n", bucketCount,
+                  static_cast<long long>(subBucketHalfCount * 2));
+    out << line;
+}
+
+int LatencyHistogram::bucketIndex(std::int64_t value) const {
+    const int pow2Ceiling = 64 - leadingZeros(static_cast<std::uint64_t>(value | subBucketMask));
+    return pow2Ceiling - (subBucketHalfCountMagnitude + 1);
+}
+
+std::size_t LatencyHistogram::countsIndex(std::int64_t value) const {
+    const int bucket = bucketIndex(value);
+    const std::int64_t subBucket = value >> bucket;
+    return static_cast<std::size_t>(((static_cast<std::int64_t>(bucket) + 1) << subBucketHalfCountMagnitude)
+                                    + (subBucket - subBucketHalfCount));
+}
+
+std::int64_t LatencyHistogram::valueFromIndex(std::size_t index) const {
+    int bucket = static_cast<int>(index >> subBucketHalfCountMagnitude) - 1;
+    std::int64_t subBucket = static_cast<std::int64_t>(index & static_cast<std::size_t>(subBucketHalfCount - 1)) + subBucketHalfCount;
+    if (bucket < 0) {
+        subBucket -= subBucketHalfCount;
+        bucket = 0;
+    }
+    return subBucket << bucket;
+}
+
+std::int64_t LatencyHistogram::highestEquivalentValue(std::int64_t value) const {
+    const std::int64_t range = std::int64_t(1) << bucketIndex(value);
+    return (value & ~(range - 1)) + range - 1;
+}
+
+std::int64_t LatencyHistogram::medianEquivalentValue(std::int64_t value) const {
+    const std::int64_t range = std::int64_t(1) << bucketIndex(value);
+    return (value & ~(range - 1)) + range / 2;
+}
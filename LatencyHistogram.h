@@ -0,0 +1,52 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// HDR style histogram of non-negative integer values, typically nanoseconds.
+// Buckets are log-linear, so every recorded value is kept to a fixed number of
+// significant digits across the whole range at a constant memory cost.
+class LatencyHistogram {
+public:
+    // Track values from 1 to highestTrackableValue to significantDigits (1 to 5) digits
+    explicit LatencyHistogram(std::int64_t highestTrackableValue = 60'000'000'000, int significantDigits = 3);
+    // Record a value, values above the trackable range are clamped to it
+    void record(std::int64_t value);
+    // Record a value measured by a loop that expected one measurement every expectedInterval,
+    // adding the samples a stalled loop failed to take (coordinated omission correction)
+    void recordCorrected(std::int64_t value, std::int64_t expectedInterval);
+    // Add every count of another histogram with the same range and precision
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    std::uint64_t count() const { return totalCount; }
+    std::int64_t min() const;
+    std::int64_t max() const;
+    double mean() const;
+    double stddev() const;
+    // Smallest recorded value that percentile percent of all values are at or below
+    std::int64_t valueAtPercentile(double percentile) const;
+    // Write the percentile distribution in the .hgrm text format, values divided by scale
+    void writePercentiles(std::ostream& out, double scale = 1.0, int ticksPerHalfDistance = 5) const;
+
+private:
+    int bucketIndex(std::int64_t value) const;
+    std::size_t countsIndex(std::int64_t value) const;
+    std::int64_t valueFromIndex(std::size_t index) const;
+    std::int64_t highestEquivalentValue(std::int64_t value) const;
+    std::int64_t medianEquivalentValue(std::int64_t value) const;
+
+    std::int64_t highestTrackable;
+    int subBucketHalfCountMagnitude;
+    std::int64_t subBucketHalfCount;
+    std::int64_t subBucketMask;
+    int bucketCount;
+    std::vector<std::uint64_t> counts;
+    std::uint64_t totalCount = 0;
+    std::int64_t minValue = 0;
+    std::int64_t maxValue = 0;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "LatencyHistogram.h"
+#include <sstream>
+
+TEST(LatencyHistogramTest, PercentilesKeepSignificantDigits) {
+    LatencyHistogram histogram(3'600'000'000, 3);
+    for (std::int64_t value = 1; value <= 10000; ++value) {
+        histogram.record(value * 1000);
+    }
+    EXPECT_EQ(histogram.count(), 10000u);
+    EXPECT_EQ(histogram.min(), 1000);
+    EXPECT_EQ(histogram.max(), 10'000'000);
+    EXPECT_NEAR(histogram.valueAtPercentile(50.0), 5'000'000, 5'000'000 * 0.001);
+    EXPECT_NEAR(histogram.valueAtPercentile(99.0), 9'900'000, 9'900'000 * 0.001);
+    EXPECT_NEAR(histogram.valueAtPercentile(99.9), 9'990'000, 9'990'000 * 0.001);
+    EXPECT_EQ(histogram.valueAtPercentile(100.0), 10'000'000);
+    EXPECT_NEAR(histogram.mean(), 5'000'500, 5'000'500 * 0.001);
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+    LatencyHistogram histogram(1'000'000, 3);
+    for (std::int64_t value = 0; value < 2048; ++value) {
+        histogram.record(value);
+    }
+    EXPECT_EQ(histogram.valueAtPercentile(0.0), 0);
+    EXPECT_EQ(histogram.valueAtPercentile(50.0), 1023);
+    EXPECT_EQ(histogram.max(), 2047);
+}
+
+TEST(LatencyHistogramTest, OutOfRangeValuesAreClamped) {
+    LatencyHistogram histogram(1000, 2);
+    histogram.record(-5);
+    histogram.record(5000);
+    EXPECT_EQ(histogram.min(), 0);
+    EXPECT_EQ(histogram.max(), 1000);
+    EXPECT_THROW(LatencyHistogram(1000, 6), std::invalid_argument);
+}
+
+TEST(LatencyHistogramTest, CorrectionFillsInStalledSamples) {
+    LatencyHistogram raw;
+    LatencyHistogram corrected;
+    // 99 fast responses and one 1 s stall, sampled every 10 ms
+    for (int i = 0; i < 99; ++i) {
+        raw.record(1'000'000);
+        corrected.recordCorrected(1'000'000, 10'000'000);
+    }
+    raw.record(1'000'000'000);
+    corrected.recordCorrected(1'000'000'000, 10'000'000);
+
+    EXPECT_EQ(raw.count(), 100u);
+    EXPECT_EQ(corrected.count(), 199u);
+    // The stall hides in the raw p99 but dominates the corrected one
+    EXPECT_LT(raw.valueAtPercentile(99.0), 2'000'000);
+    EXPECT_GT(corrected.valueAtPercentile(99.0), 900'000'000);
+    EXPECT_GT(corrected.valueAtPercentile(75.0), 400'000'000);
+}
+
+TEST(LatencyHistogramTest, MergeAndReset) {
+    LatencyHistogram first;
+    LatencyHistogram second;
+    first.record(100);
+    second.record(200);
+    second.record(300);
+    first.merge(second);
+    EXPECT_EQ(first.count(), 3u);
+    EXPECT_EQ(first.min(), 100);
+    EXPECT_EQ(first.max(), 300);
+    EXPECT_THROW(first.merge(LatencyHistogram(1000, 1)), std::invalid_argument);
+
+    first.reset();
+    EXPECT_EQ(first.count(), 0u);
+    EXPECT_EQ(first.valueAtPercentile(99.0), 0);
+}
+
+TEST(LatencyHistogramTest, WritesHgrmDistribution) {
+    LatencyHistogram histogram;
+    for (std::int64_t value = 1; value <= 1000; ++value) {
+        histogram.record(value * 1000);
+    }
+    std::ostringstream out;
+    histogram.writePercentiles(out, 1000.0);
+    const std::string text = out.str();
+    EXPECT_EQ(text.rfind("       Value     Percentile TotalCount 1/(1-Percentile)", 0), 0u);
+    EXPECT_NE(text.find("    1000.000 1.000000000000       1000"), std::string::npos);
+    EXPECT_NE(text.find("#[Max     =     1000.000, Total count    =         1000]"), std::string::npos);
+}
@@ -0,0 +1,382 @@
+#include "LoadGenerator.h"
+#include "DeadReckoning.h"
+#include "DecodePipeline.h"
+#include "StripedNetworkInterface.h"
+#include <QCommandLineParser>
+#include <boost/system/system_error.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+std::int64_t toNanoseconds(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+// Sleep until shortly before the deadline, then spin, sleeps alone overshoot by tens of microseconds
+void waitUntil(Clock::time_point deadline) {
+    const auto spinWindow = std::chrono::microseconds(200);
+    if (deadline - Clock::now() > spinWindow) {
+        std::this_thread::sleep_until(deadline - spinWindow);
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+// Moves an entity along its heading and turns it steadily, so consecutive updates form a plausible track
+struct Track {
+    double turnRate = 0.0;
+    Clock::time_point updatedAt;
+
+    template <typename Entity>
+    void advance(Entity& entity, Clock::time_point now) {
+        const double seconds = std::chrono::duration<double>(now - updatedAt).count();
+        updatedAt = now;
+        DeadReckoning::extrapolate(entity.lat, entity.lon, entity.speed, entity.heading, seconds,
+                                   DeadReckoningConfig().speedToMetresPerSecond);
+        entity.lat = std::clamp(entity.lat, -89.0, 89.0);
+        entity.heading = std::fmod(entity.heading + turnRate * seconds + 360.0, 360.0);
+    }
+};
+
+void writeLatency(std::ostream& out, const char* label, const LatencyHistogram& histogram) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%s (us): p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f  mean %.1f\n", label,
+                  histogram.valueAtPercentile(50.0) / 1000.0, histogram.valueAtPercentile(99.0) / 1000.0,
+                  histogram.valueAtPercentile(99.9) / 1000.0, histogram.max() / 1000.0, histogram.mean() / 1000.0);
+    out << line;
+}
+}
+
+/*!
+    \fn bool LoadConfig::parse(const QStringList& arguments, LoadConfig& config, QString& error, QString& helpText)
+    \brief Builds a load configuration from the command line.
+    \param arguments The command line, including the program name.
+    \param config The configuration to fill in, options not given keep their defaults.
+    \param error Set to a description of the problem if parsing fails.
+    \param helpText Set to the usage text if --help was given.
+    \return True if the load run should start with config, false otherwise.
+*/
+bool LoadConfig::parse(const QStringList& arguments, LoadConfig& config, QString& error, QString& helpText) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Drives simulated PE and Emitter tracks over a loopback link and reports latency");
+    const QCommandLineOption helpOption = parser.addHelpOption();
+    const QCommandLineOption modeOption("mode", "open (fixed schedule) or closed (bounded in-flight window).", "mode");
+    const QCommandLineOption pesOption("pes", "Number of simulated PEs.", "count");
+    const QCommandLineOption emittersOption("emitters", "Number of simulated Emitters.", "count");
+    const QCommandLineOption rateOption("rate", "Updates per second sent for each entity.", "hz");
+    const QCommandLineOption durationOption("duration", "Measured run time in seconds.", "seconds");
+    const QCommandLineOption warmupOption("warmup", "Unmeasured run time before the measurement starts, in seconds.", "seconds");
+    const QCommandLineOption windowOption("window", "Messages allowed in flight in closed loop mode.", "count");
+    const QCommandLineOption decodeThreadsOption("decode-threads", "Threads decoding received messages, 0 to decode on the receive thread.", "count");
+    const QCommandLineOption stripesOption("stripes", "Connections the link is striped across, 1 for a single connection.", "count");
+    const QCommandLineOption seedOption("seed", "Seed for the simulated tracks.", "seed");
+    const QCommandLineOption hgrmOption("hgrm", "Also write the latency distribution to this .hgrm file.", "file");
+    parser.addOptions({modeOption, pesOption, emittersOption, rateOption, durationOption, warmupOption, windowOption,
+                       decodeThreadsOption, stripesOption, seedOption, hgrmOption});
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText();
+        return false;
+    }
+    if (parser.isSet(helpOption)) {
+        helpText = parser.helpText();
+        return false;
+    }
+
+    if (parser.isSet(modeOption)) {
+        const QString mode = parser.value(modeOption);
+        if (mode == "open") {
+            config.mode = Mode::Open;
+        } else if (mode == "closed") {
+            config.mode = Mode::Closed;
+        } else {
+            error = QString("Unknown mode %1, expected open or closed").arg(mode);
+            return false;
+        }
+    }
+    bool ok = true;
+    if (ok && parser.isSet(pesOption)) {
+        config.pes = parser.value(pesOption).toInt(&ok);
+    }
+    if (ok && parser.isSet(emittersOption)) {
+        config.emitters = parser.value(emittersOption).toInt(&ok);
+    }
+    if (ok && parser.isSet(rateOption)) {
+        config.updateHz = parser.value(rateOption).toDouble(&ok);
+    }
+    if (ok && parser.isSet(durationOption)) {
+        config.duration = std::chrono::milliseconds(static_cast<std::int64_t>(parser.value(durationOption).toDouble(&ok) * 1000));
+    }
+    if (ok && parser.isSet(warmupOption)) {
+        config.warmup = std::chrono::milliseconds(static_cast<std::int64_t>(parser.value(warmupOption).toDouble(&ok) * 1000));
+    }
+    if (ok && parser.isSet(windowOption)) {
+        config.window = static_cast<std::size_t>(parser.value(windowOption).toUInt(&ok));
+    }
+    if (ok && parser.isSet(decodeThreadsOption)) {
+        config.decodeThreads = static_cast<std::size_t>(parser.value(decodeThreadsOption).toUInt(&ok));
+    }
+    if (ok && parser.isSet(stripesOption)) {
+        config.stripes = static_cast<std::size_t>(parser.value(stripesOption).toUInt(&ok));
+    }
+    if (ok && parser.isSet(seedOption)) {
+        config.seed = parser.value(seedOption).toUInt(&ok);
+    }
+    if (!ok) {
+        error = "Counts, rates and durations must be numbers";
+        return false;
+    }
+    if (parser.isSet(hgrmOption)) {
+        config.histogramFile = parser.value(hgrmOption);
+    }
+    if (config.pes < 0 || config.emitters < 0 || config.pes + config.emitters == 0) {
+        error = "At least one PE or Emitter is needed";
+        return false;
+    }
+    if (config.updateHz <= 0.0 || config.duration.count() <= 0 || config.warmup.count() < 0 || config.window == 0
+        || config.stripes == 0 || config.stripes > StripedNetworkInterface::kMaxStripes) {
+        error = "Rate, duration, window and stripes must be positive";
+        return false;
+    }
+    if (config.stripes > 1 && config.decodeThreads > 0) {
+        error = "A striped link already decodes each stripe on its own thread, --decode-threads needs one stripe";
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \fn void LoadReport::write(std::ostream& out) const
+    \brief Writes a summary of the run: counts, throughput and latency percentiles in microseconds.
+*/
+void LoadReport::write(std::ostream& out) const {
+    char line[200];
+    std::snprintf(line, sizeof(line), "%s loop, %d PEs and %d Emitters at %.1f Hz, target %.0f msgs/s\n",
+                  config.mode == LoadConfig::Mode::Open ? "Open" : "Closed", config.pes, config.emitters,
+                  config.updateHz, config.targetRate());
+    out << line;
+    std::snprintf(line, sizeof(line), "Sent %llu, received %llu, failed %llu in %.2f s\n",
+                  static_cast<unsigned long long>(sent), static_cast<unsigned long long>(received),
+                  static_cast<unsigned long long>(failed), elapsedSeconds);
+    out << line;
+    std::snprintf(line, sizeof(line), "Throughput: %.1f msgs/s\n", throughput());
+    out << line;
+    writeLatency(out, config.mode == LoadConfig::Mode::Closed ? "Latency, corrected" : "Latency", latency);
+    if (config.mode == LoadConfig::Mode::Closed) {
+        writeLatency(out, "Latency, uncorrected", uncorrected);
+    }
+}
+
+/*!
+    \class LoadGenerator
+    \brief Measures how much track traffic one link sustains.
+
+    A pair of NetworkImplementations is connected over loopback. The calling
+    thread simulates the configured PEs and Emitters moving along turning
+    tracks and sends their updates round robin with sendPE() and sendEmitter().
+    A second thread receives them with receiveMessage(), the same decoding as
+    receivePE() and receiveEmitter() but for either kind, or through a
+    DecodePipeline when decodeThreads is set. With stripes above one the link
+    is a StripedNetworkInterface, which receives each stripe on its own
+    thread. The send time travels in the message as nanoseconds on the steady
+    clock, in the PE state field and, since Emitter has no free text field
+    for it, the Emitter category.
+
+    In open loop mode every update has a scheduled send time and latency is
+    measured from that time, so a sender that falls behind shows up as latency
+    rather than as fewer samples. In closed loop mode at most window messages
+    are in flight. Latency is measured from the actual send, and each sample is
+    corrected for coordinated omission against the scheduled interval; the
+    uncorrected histogram is reported alongside for comparison.
+*/
+
+/*!
+    \fn LoadGenerator::LoadGenerator(const LoadConfig& config)
+    \brief Constructs a generator, nothing is connected until run().
+*/
+LoadGenerator::LoadGenerator(const LoadConfig& config)
+    : config(config) {}
+
+/*!
+    \fn LoadReport LoadGenerator::run()
+    \brief Runs the warm-up and the measured period, then waits for outstanding messages.
+    \return Counts, throughput and latency for the measured period.
+
+    Throws boost::system::system_error if the loopback link cannot be set up.
+*/
+LoadReport LoadGenerator::run() {
+    LoadReport report;
+    report.config = config;
+
+    std::unique_ptr<AbstractNetworkInterface> sender;
+    std::unique_ptr<AbstractNetworkInterface> receiver;
+    std::unique_ptr<DecodePipeline> pipeline;
+    {
+        boost::asio::io_context io_context;
+        boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        if (config.stripes > 1) {
+            // Every stripe connects against the listen backlog and sends its hello before accept() reads them
+            auto stripedSender = std::make_unique<StripedNetworkInterface>(config.stripes);
+            stripedSender->initialise("127.0.0.1", acceptor.local_endpoint().port());
+            receiver = StripedNetworkInterface::accept(acceptor);
+            sender = std::move(stripedSender);
+        } else {
+            auto plainSender = std::make_unique<NetworkImplementation>();
+            auto plainReceiver = std::make_unique<NetworkImplementation>();
+            plainSender->initialise("127.0.0.1", acceptor.local_endpoint().port());
+            acceptor.accept(*plainReceiver->getSocket());
+            plainSender->getSocket()->set_option(boost::asio::ip::tcp::no_delay(true));
+            if (config.decodeThreads > 0) {
+                pipeline = std::make_unique<DecodePipeline>(*plainReceiver, config.decodeThreads);
+            }
+            sender = std::move(plainSender);
+            receiver = std::move(plainReceiver);
+        }
+    }
+
+    std::mt19937 random(config.seed);
+    auto uniform = [&random](double low, double high) { return std::uniform_real_distribution<double>(low, high)(random); };
+    const Clock::time_point created = Clock::now();
+    std::vector<PE> pes;
+    std::vector<Emitter> emitters;
+    std::vector<Track> tracks;
+    for (int i = 0; i < config.pes; ++i) {
+        PE pe(QString("LoadPE%1").arg(i), "F18", uniform(-60.0, 60.0), uniform(-180.0, 180.0), uniform(5000.0, 40000.0),
+              uniform(250.0, 550.0), "MED", "HIGH", false, false);
+        pe.heading = uniform(0.0, 360.0);
+        pes.push_back(pe);
+        tracks.push_back(Track{uniform(-3.0, 3.0), created});
+    }
+    for (int i = 0; i < config.emitters; ++i) {
+        const double freqMin = uniform(2000.0, 9000.0);
+        Emitter emitter(QString("LoadEmitter%1").arg(i), "RadarType", "", uniform(-60.0, 60.0), uniform(-180.0, 180.0),
+                        freqMin, freqMin + uniform(500.0, 3000.0), true);
+        emitter.speed = uniform(0.0, 30.0);
+        emitter.heading = uniform(0.0, 360.0);
+        emitters.push_back(emitter);
+        tracks.push_back(Track{uniform(-1.0, 1.0), created});
+    }
+
+    const auto interval = std::chrono::nanoseconds(static_cast<std::int64_t>(1e9 / config.targetRate()));
+    const bool closedLoop = config.mode == LoadConfig::Mode::Closed;
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point measureFrom = start + config.warmup;
+    const Clock::time_point end = measureFrom + config.duration;
+    const std::int64_t measureFromNs = toNanoseconds(measureFrom);
+
+    std::mutex progressMutex;
+    std::condition_variable progress;
+    std::uint64_t totalSent = 0;
+    std::uint64_t totalReceived = 0;
+    bool receiving = true;
+
+    std::thread receiveThread([&]() {
+        while (true) {
+            NetworkMessage message;
+            try {
+                message = pipeline ? pipeline->next() : receiver->receiveMessage();
+            } catch (const boost::system::system_error&) {
+                break;
+            } catch (const std::exception&) {
+                // The frame still arrived, so it leaves the closed loop window like any other
+                {
+                    std::lock_guard<std::mutex> lock(progressMutex);
+                    ++report.failed;
+                    ++totalReceived;
+                }
+                progress.notify_all();
+                continue;
+            }
+            const std::int64_t now = toNanoseconds(Clock::now());
+            QString stamp;
+            if (message.kind == NetworkMessage::Kind::PE) {
+                stamp = message.pes.front().state;
+            } else if (message.kind == NetworkMessage::Kind::Emitter) {
+                stamp = message.emitters.front().category;
+            }
+            bool ok = false;
+            const std::int64_t sentAt = stamp.toLongLong(&ok);
+            if (ok && sentAt >= measureFromNs) {
+                if (closedLoop) {
+                    report.uncorrected.record(now - sentAt);
+                    report.latency.recordCorrected(now - sentAt, interval.count());
+                } else {
+                    report.latency.record(now - sentAt);
+                }
+                ++report.received;
+            }
+            {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                ++totalReceived;
+            }
+            progress.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(progressMutex);
+        receiving = false;
+        progress.notify_all();
+    });
+
+    const std::size_t entityCount = tracks.size();
+    for (std::uint64_t k = 0;; ++k) {
+        const Clock::time_point scheduled = start + static_cast<std::int64_t>(k) * interval;
+        if (scheduled >= end) {
+            break;
+        }
+        if (closedLoop) {
+            std::unique_lock<std::mutex> lock(progressMutex);
+            progress.wait(lock, [&]() { return !receiving || totalSent - totalReceived < config.window; });
+            if (!receiving) {
+                break;
+            }
+        }
+        waitUntil(scheduled);
+        const Clock::time_point sendTime = closedLoop ? Clock::now() : scheduled;
+        const QString stamp = QString::number(toNanoseconds(sendTime));
+
+        const std::size_t index = k % entityCount;
+        bool sent;
+        if (index < pes.size()) {
+            PE& pe = pes[index];
+            tracks[index].advance(pe, scheduled);
+            pe.state = stamp;
+            sent = sender->sendPE(pe);
+        } else {
+            Emitter& emitter = emitters[index - pes.size()];
+            tracks[index].advance(emitter, scheduled);
+            emitter.category = stamp;
+            sent = sender->sendEmitter(emitter);
+        }
+
+        std::lock_guard<std::mutex> lock(progressMutex);
+        if (!sent) {
+            ++report.failed;
+            continue;
+        }
+        ++totalSent;
+        if (sendTime >= measureFrom) {
+            ++report.sent;
+        }
+    }
+
+    // Let everything already sent arrive before closing the link
+    {
+        std::unique_lock<std::mutex> lock(progressMutex);
+        progress.wait_for(lock, std::chrono::seconds(5), [&]() { return !receiving || totalReceived >= totalSent; });
+    }
+    report.elapsedSeconds = std::chrono::duration<double>(Clock::now() - measureFrom).count();
+    sender->close();
+    receiveThread.join();
+    pipeline.reset();
+    receiver->close();
+    return report;
+}
@@ -0,0 +1,69 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include "LatencyHistogram.h"
+
+struct LoadConfig {
+    enum class Mode {
+        // Send on a fixed schedule whatever the receiver does, latency is measured from the scheduled time
+        Open,
+        // Keep at most window messages in flight, stalls are corrected for in the histogram
+        Closed
+    };
+    Mode mode = Mode::Open;
+    // Number of simulated PEs and Emitters, each sending updateHz position updates a second
+    int pes = 100;
+    int emitters = 20;
+    double updateHz = 10.0;
+    std::chrono::milliseconds duration{10000};
+    // Updates sent before this are not recorded, so connection start-up does not skew the result
+    std::chrono::milliseconds warmup{1000};
+    // Messages allowed in flight in closed loop mode
+    std::size_t window = 1;
+    // Decode received messages on this many threads, in wire order, 0 decodes on the receive thread
+    std::size_t decodeThreads = 0;
+    // Stripe the link across this many connections, sharded by entity id
+    std::size_t stripes = 1;
+    // Seed for the initial entity positions, speeds and headings
+    unsigned int seed = 1;
+    // When set, the latency distribution is also written here in the .hgrm format
+    QString histogramFile;
+    // Parse the command line, returns false with a message in error, or with helpText set if --help was given
+    static bool parse(const QStringList& arguments, LoadConfig& config, QString& error, QString& helpText);
+    // Total messages per second across all entities
+    double targetRate() const { return (pes + emitters) * updateHz; }
+};
+
+struct LoadReport {
+    LoadConfig config;
+    std::uint64_t sent = 0;
+    std::uint64_t received = 0;
+    // Sends that failed and frames that arrived but did not decode
+    std::uint64_t failed = 0;
+    double elapsedSeconds = 0.0;
+    // End-to-end latency in nanoseconds, corrected for coordinated omission in closed loop mode
+    LatencyHistogram latency;
+    // Closed loop only, latency as measured without the correction
+    LatencyHistogram uncorrected;
+    double throughput() const { return elapsedSeconds > 0.0 ? received / elapsedSeconds : 0.0; }
+    // Summary with throughput and p50/p99/p99.9/max latency in microseconds
+    void write(std::ostream& out) const;
+};
+
+// Drives simulated PE and Emitter tracks over a loopback link
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const LoadConfig& config);
+    // Run for the configured duration and report what was measured
+    LoadReport run();
+
+private:
+    LoadConfig config;
+};
+
+#endif // LOADGENERATOR_H
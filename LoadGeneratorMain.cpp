@@ -0,0 +1,44 @@
+#include <QFile>
+#include <QStringList>
+#include <fstream>
+#include <iostream>
+#include "LoadGenerator.h"
+
+int main (int argc, char *argv[]) {
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) {
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    }
+
+    LoadConfig config;
+    QString error;
+    QString helpText;
+    if (!LoadConfig::parse(arguments, config, error, helpText)) {
+        if (!helpText.isEmpty()) {
+            std::cout << helpText.toStdString();
+            return 0;
+        }
+        std::cerr << error.toStdString() << std::endl;
+        return 1;
+    }
+
+    LoadReport report;
+    try {
+        report = LoadGenerator(config).run();
+    } catch (const std::exception& e) {
+        std::cerr << "Load run failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    report.write(std::cout);
+    if (!config.histogramFile.isEmpty()) {
+        std::ofstream hgrm(config.histogramFile.toStdString());
+        if (!hgrm) {
+            std::cerr << "Cannot write " << config.histogramFile.toStdString() << std::endl;
+            return 1;
+        }
+        // .hgrm files are conventionally in microseconds
+        report.latency.writePercentiles(hgrm, 1000.0);
+    }
+    return report.failed == 0 ? 0 : 2;
+}
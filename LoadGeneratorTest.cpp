@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "LoadGenerator.h"
+
+TEST(LoadGeneratorTest, ParsesCommandLine) {
+    LoadConfig config;
+    QString error;
+    QString helpText;
+    ASSERT_TRUE(LoadConfig::parse({"LoadGenerator", "--mode", "closed", "--pes", "50", "--emitters", "5",
+                                   "--rate", "20", "--duration", "2.5", "--window", "4"}, config, error, helpText));
+    EXPECT_EQ(config.mode, LoadConfig::Mode::Closed);
+    EXPECT_EQ(config.pes, 50);
+    EXPECT_EQ(config.emitters, 5);
+    EXPECT_DOUBLE_EQ(config.targetRate(), 1100.0);
+    EXPECT_EQ(config.duration.count(), 2500);
+    EXPECT_EQ(config.window, 4u);
+    EXPECT_EQ(config.stripes, 1u);
+
+    LoadConfig striped;
+    ASSERT_TRUE(LoadConfig::parse({"LoadGenerator", "--stripes", "4"}, striped, error, helpText));
+    EXPECT_EQ(striped.stripes, 4u);
+
+    LoadConfig invalid;
+    EXPECT_FALSE(LoadConfig::parse({"LoadGenerator", "--mode", "sideways"}, invalid, error, helpText));
+    EXPECT_FALSE(LoadConfig::parse({"LoadGenerator", "--pes", "0", "--emitters", "0"}, invalid, error, helpText));
+    EXPECT_FALSE(LoadConfig::parse({"LoadGenerator", "--stripes", "0"}, invalid, error, helpText));
+    EXPECT_FALSE(LoadConfig::parse({"LoadGenerator", "--stripes", "2", "--decode-threads", "2"}, invalid, error, helpText));
+}
+
+TEST(LoadGeneratorTest, OpenLoopDeliversEveryScheduledUpdate) {
+    LoadConfig config;
+    config.pes = 20;
+    config.emitters = 5;
+    config.updateHz = 20.0;
+    config.warmup = std::chrono::milliseconds(100);
+    config.duration = std::chrono::milliseconds(500);
+    LoadReport report = LoadGenerator(config).run();
+
+    // 500 messages a second for half a second
+    EXPECT_NEAR(static_cast<double>(report.sent), 250.0, 2.0);
+    EXPECT_EQ(report.received, report.sent);
+    EXPECT_EQ(report.failed, 0u);
+    EXPECT_EQ(report.latency.count(), report.received);
+    EXPECT_GT(report.latency.valueAtPercentile(50.0), 0);
+    EXPECT_LE(report.latency.valueAtPercentile(50.0), report.latency.valueAtPercentile(99.0));
+}
+
+TEST(LoadGeneratorTest, ClosedLoopReportsCorrectedAndRawLatency) {
+    LoadConfig config;
+    config.mode = LoadConfig::Mode::Closed;
+    config.pes = 10;
+    config.emitters = 10;
+    config.updateHz = 10.0;
+    config.warmup = std::chrono::milliseconds(50);
+    config.duration = std::chrono::milliseconds(500);
+    LoadReport report = LoadGenerator(config).run();
+
+    EXPECT_GT(report.sent, 0u);
+    EXPECT_EQ(report.received, report.sent);
+    EXPECT_EQ(report.uncorrected.count(), report.received);
+    EXPECT_GE(report.latency.count(), report.uncorrected.count());
+}
+
+TEST(LoadGeneratorTest, StripedLinkDeliversEveryUpdate) {
+    LoadConfig config;
+    config.pes = 40;
+    config.emitters = 10;
+    config.updateHz = 10.0;
+    config.stripes = 4;
+    config.warmup = std::chrono::milliseconds(50);
+    config.duration = std::chrono::milliseconds(400);
+    LoadReport report = LoadGenerator(config).run();
+
+    EXPECT_GT(report.sent, 0u);
+    EXPECT_EQ(report.received, report.sent);
+    EXPECT_EQ(report.failed, 0u);
+}
@@ -0,0 +1,300 @@
+#include "Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+/*!
+    \class Logger
+    \brief Leveled logger that keeps formatting and terminal writes off the hot path.
+
+    write() copies the level, component, timestamp, thread number and up to
+    LogRecord::kMessageSize bytes of message into a slot of a bounded
+    multi-producer ring buffer, without taking a lock. A background thread
+    drains the ring about once a millisecond, formats each record and writes the
+    batch to the sink with a single flush. If writers outpace it the ring fills
+    and new records are dropped and counted, and the number dropped is reported
+    once the ring drains.
+
+    The ANI_LOG_* macros test the level before evaluating their message, and
+    levels below ANI_LOG_LEVEL compile to nothing. Records still in the ring at
+    exit are written by an atexit handler.
+*/
+
+static_assert((Logger::kCapacity & (Logger::kCapacity - 1)) == 0, "Logger capacity must be a power of two");
+
+std::atomic<int> Logger::threshold{static_cast<int>(LogLevel::Info)};
+
+namespace {
+struct Slot {
+    std::atomic<std::size_t> sequence;
+    LogRecord record;
+};
+
+struct LoggerState {
+    Slot slots[Logger::kCapacity];
+    alignas(64) std::atomic<std::size_t> tail{0};
+    alignas(64) std::atomic<std::uint64_t> dropped{0};
+    // Held while draining, so flush() and the background thread never consume at once
+    std::mutex mutex;
+    std::size_t head = 0;
+    std::uint64_t reportedDropped = 0;
+    std::ostream* sink = &std::cerr;
+    std::string buffer;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> stopped{false};
+    std::thread thread;
+
+    LoggerState() {
+        for (std::size_t i = 0; i < Logger::kCapacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+std::uint32_t threadNumber() {
+    static std::atomic<std::uint32_t> next{1};
+    thread_local const std::uint32_t number = next.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+void fill(LogRecord& record, LogLevel level, const char* component, const std::string& message) {
+    record.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record.component = component;
+    record.thread = threadNumber();
+    record.level = level;
+    const std::size_t length = std::min(message.size(), LogRecord::kMessageSize);
+    std::memcpy(record.message, message.data(), length);
+    record.length = static_cast<std::uint16_t>(length);
+    record.truncated = length < message.size();
+}
+
+// Caller holds state.mutex. Returns true if anything was written.
+bool drain(LoggerState& state) {
+    state.buffer.clear();
+    while (true) {
+        Slot& slot = state.slots[state.head & (Logger::kCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != state.head + 1) {
+            break;
+        }
+        state.buffer += Logger::format(slot.record);
+        state.buffer += '\n';
+        slot.sequence.store(state.head + Logger::kCapacity, std::memory_order_release);
+        ++state.head;
+    }
+    const std::uint64_t dropped = state.dropped.load(std::memory_order_relaxed);
+    if (dropped != state.reportedDropped) {
+        LogRecord warning;
+        fill(warning, LogLevel::Warn, "Logger",
+             std::to_string(dropped - state.reportedDropped) + " records dropped, ring buffer full");
+        state.buffer += Logger::format(warning);
+        state.buffer += '\n';
+        state.reportedDropped = dropped;
+    }
+    if (state.buffer.empty()) {
+        return false;
+    }
+    state.sink->write(state.buffer.data(), static_cast<std::streamsize>(state.buffer.size()));
+    state.sink->flush();
+    return true;
+}
+
+void consume(LoggerState* state) {
+    while (!state->stopping.load(std::memory_order_acquire)) {
+        bool wrote;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            wrote = drain(*state);
+        }
+        if (!wrote) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+LoggerState& state();
+
+void shutdown() {
+    LoggerState& s = state();
+    s.stopping.store(true, std::memory_order_release);
+    if (s.thread.joinable()) {
+        s.thread.join();
+    }
+    std::lock_guard<std::mutex> lock(s.mutex);
+    drain(s);
+    s.stopped.store(true, std::memory_order_release);
+}
+
+// Never destroyed, so threads that log during static destruction still find it
+LoggerState& state() {
+    static LoggerState* instance = []() {
+        LoggerState* s = new LoggerState;
+        s->thread = std::thread(consume, s);
+        std::atexit(shutdown);
+        return s;
+    }();
+    return *instance;
+}
+}
+
+/*!
+    \fn void Logger::write(LogLevel level, const char* component, const std::string& message)
+    \brief Queues a record for the background thread, use the ANI_LOG_* macros instead.
+    \param level The record's level, not checked against the threshold.
+    \param component The part of the library logging, must outlive the logger.
+    \param message The message, truncated to LogRecord::kMessageSize bytes.
+*/
+void Logger::write(LogLevel level, const char* component, const std::string& message) {
+    LoggerState& s = state();
+    if (s.stopped.load(std::memory_order_acquire)) {
+        // After exit handling there is no consumer, so write straight through
+        LogRecord record;
+        fill(record, level, component, message);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        *s.sink << format(record) << '\n';
+        s.sink->flush();
+        return;
+    }
+    std::size_t position = s.tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &s.slots[position & (kCapacity - 1)];
+        const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0) {
+            if (s.tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            s.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            position = s.tail.load(std::memory_order_relaxed);
+        }
+    }
+    fill(slot->record, level, component, message);
+    slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+/*!
+    \fn void Logger::setLevel(LogLevel level)
+    \brief Sets the lowest level that is recorded. Levels compiled out stay out.
+*/
+void Logger::setLevel(LogLevel level) {
+    threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+/*!
+    \fn LogLevel Logger::level()
+    \brief Returns the lowest level that is recorded.
+*/
+LogLevel Logger::level() {
+    return static_cast<LogLevel>(threshold.load(std::memory_order_relaxed));
+}
+
+/*!
+    \fn void Logger::setSink(std::ostream& sink)
+    \brief Sends formatted records to a stream, after writing out those already queued.
+    \param sink The stream, which must outlive the logger or the next call.
+*/
+void Logger::setSink(std::ostream& sink) {
+    LoggerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    drain(s);
+    s.sink = &sink;
+}
+
+/*!
+    \fn void Logger::flush()
+    \brief Writes out every queued record on the calling thread and flushes the sink.
+*/
+void Logger::flush() {
+    LoggerState& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    drain(s);
+}
+
+/*!
+    \fn std::uint64_t Logger::dropped()
+    \brief Returns the number of records dropped because the ring was full.
+*/
+std::uint64_t Logger::dropped() {
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+/*!
+    \fn const char* Logger::levelName(LogLevel level)
+    \brief Returns the upper case name of a level.
+*/
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Trace:
+        return "TRACE";
+    case LogLevel::Debug:
+        return "DEBUG";
+    case LogLevel::Info:
+        return "INFO";
+    case LogLevel::Warn:
+        return "WARN";
+    case LogLevel::Error:
+        return "ERROR";
+    case LogLevel::Off:
+        break;
+    }
+    return "OFF";
+}
+
+/*!
+    \fn bool Logger::parseLevel(const std::string& name, LogLevel& level)
+    \brief Parses a level name in any case.
+    \param name The name, one of trace, debug, info, warn, error or off.
+    \param level Set to the parsed level on success.
+    \return True if the name was recognised.
+*/
+bool Logger::parseLevel(const std::string& name, LogLevel& level) {
+    std::string upper = name;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    for (LogLevel candidate : {LogLevel::Trace, LogLevel::Debug, LogLevel::Info, LogLevel::Warn, LogLevel::Error, LogLevel::Off}) {
+        if (upper == levelName(candidate)) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+    \fn std::string Logger::format(const LogRecord& record)
+    \brief Formats a record as one line without the trailing newline.
+    \return The UTC time to the microsecond, level, thread number, component and message.
+*/
+std::string Logger::format(const LogRecord& record) {
+    const std::time_t seconds = static_cast<std::time_t>(record.timestampNs / 1'000'000'000);
+    std::tm utc{};
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    char prefix[96];
+    const int length = std::snprintf(prefix, sizeof(prefix), "%04d-%02d-%02dT%02d:%02d:%02d.%06dZ %-5s [%u] ",
+                                     utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec,
+                                     static_cast<int>(record.timestampNs % 1'000'000'000 / 1000),
+                                     levelName(record.level), static_cast<unsigned>(record.thread));
+    std::string line(prefix, static_cast<std::size_t>(std::max(length, 0)));
+    line += record.component;
+    line += ": ";
+    line.append(record.message, record.length);
+    if (record.truncated) {
+        line += "...";
+    }
+    return line;
+}
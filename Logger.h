@@ -0,0 +1,104 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+enum class LogLevel {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+// Levels below this are compiled out of the ANI_LOG_* macros: 0 trace, 1 debug, 2 info, 3 warn, 4 error
+#ifndef ANI_LOG_LEVEL
+#define ANI_LOG_LEVEL 2
+#endif
+
+// One fixed-size log entry, copied into the ring buffer by the logging thread
+struct LogRecord {
+    static constexpr std::size_t kMessageSize = 200;
+    std::int64_t timestampNs = 0;
+    // Must outlive the logger, in practice a string literal
+    const char* component = "";
+    std::uint32_t thread = 0;
+    LogLevel level = LogLevel::Info;
+    // True if the message did not fit and was cut short
+    bool truncated = false;
+    std::uint16_t length = 0;
+    char message[kMessageSize];
+};
+
+// Process-wide asynchronous logger. Writers copy a record into a lock-free ring buffer
+// and return, a background thread formats the records and writes them to the sink.
+// When the ring is full records are dropped and counted rather than blocking the writer.
+class Logger {
+public:
+    static constexpr std::size_t kCapacity = 8192;
+
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= threshold.load(std::memory_order_relaxed);
+    }
+    static void write(LogLevel level, const char* component, const std::string& message);
+    // Runtime threshold, records below it are discarded before they are copied
+    static void setLevel(LogLevel level);
+    static LogLevel level();
+    // Where formatted records go, std::cerr by default. The stream must outlive the logger or the next setSink.
+    static void setSink(std::ostream& sink);
+    // Block until every record written before the call has reached the sink
+    static void flush();
+    // Records dropped because the ring was full
+    static std::uint64_t dropped();
+    static const char* levelName(LogLevel level);
+    // Accepts trace, debug, info, warn, error and off, returns false for anything else
+    static bool parseLevel(const std::string& name, LogLevel& level);
+    // Formats one record as "<UTC time> <LEVEL> [thread] component: message"
+    static std::string format(const LogRecord& record);
+
+private:
+    static std::atomic<int> threshold;
+};
+
+#define ANI_LOG(level, component, message)                  \
+    do {                                                    \
+        if (Logger::enabled(level)) {                       \
+            Logger::write(level, component, message);       \
+        }                                                   \
+    } while (0)
+
+#if ANI_LOG_LEVEL <= 0
+#define ANI_LOG_TRACE(component, message) ANI_LOG(LogLevel::Trace, component, message)
+#else
+#define ANI_LOG_TRACE(component, message) do {} while (0)
+#endif
+
+#if ANI_LOG_LEVEL <= 1
+#define ANI_LOG_DEBUG(component, message) ANI_LOG(LogLevel::Debug, component, message)
+#else
+#define ANI_LOG_DEBUG(component, message) do {} while (0)
+#endif
+
+#if ANI_LOG_LEVEL <= 2
+#define ANI_LOG_INFO(component, message) ANI_LOG(LogLevel::Info, component, message)
+#else
+#define ANI_LOG_INFO(component, message) do {} while (0)
+#endif
+
+#if ANI_LOG_LEVEL <= 3
+#define ANI_LOG_WARN(component, message) ANI_LOG(LogLevel::Warn, component, message)
+#else
+#define ANI_LOG_WARN(component, message) do {} while (0)
+#endif
+
+#if ANI_LOG_LEVEL <= 4
+#define ANI_LOG_ERROR(component, message) ANI_LOG(LogLevel::Error, component, message)
+#else
+#define ANI_LOG_ERROR(component, message) do {} while (0)
+#endif
+
+#endif // LOGGER_H
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include "Logger.h"
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+class LoggerTest : public ::testing::Test {
+protected:
+    std::ostringstream sink;
+
+    void SetUp() override {
+        Logger::setSink(sink);
+        Logger::setLevel(LogLevel::Trace);
+    }
+
+    void TearDown() override {
+        Logger::setSink(std::cerr);
+        Logger::setLevel(LogLevel::Info);
+    }
+};
+
+TEST_F(LoggerTest, RecordsReachTheSinkInOrder) {
+    Logger::write(LogLevel::Info, "LoggerTest", "first");
+    Logger::write(LogLevel::Error, "LoggerTest", "second");
+    Logger::flush();
+
+    const std::string text = sink.str();
+    const std::size_t first = text.find("INFO  [");
+    const std::size_t second = text.find("ERROR [");
+    ASSERT_NE(first, std::string::npos);
+    ASSERT_NE(second, std::string::npos);
+    EXPECT_LT(first, second);
+    EXPECT_NE(text.find("LoggerTest: first\n"), std::string::npos);
+    EXPECT_NE(text.find("LoggerTest: second\n"), std::string::npos);
+}
+
+TEST_F(LoggerTest, LevelsBelowTheThresholdAreNotEvaluated) {
+    Logger::setLevel(LogLevel::Warn);
+    int evaluated = 0;
+    auto message = [&evaluated]() {
+        ++evaluated;
+        return std::string("evaluated");
+    };
+    ANI_LOG(LogLevel::Info, "LoggerTest", message());
+    ANI_LOG(LogLevel::Warn, "LoggerTest", message());
+    Logger::flush();
+    EXPECT_EQ(evaluated, 1);
+    EXPECT_EQ(sink.str().find("INFO"), std::string::npos);
+    EXPECT_NE(sink.str().find("WARN"), std::string::npos);
+}
+
+TEST_F(LoggerTest, CompiledOutLevelsAreNotEvaluated) {
+    int evaluated = 0;
+    auto message = [&evaluated]() {
+        ++evaluated;
+        return std::string("evaluated");
+    };
+    ANI_LOG_TRACE("LoggerTest", message());
+    ANI_LOG_ERROR("LoggerTest", message());
+    Logger::flush();
+    EXPECT_EQ(evaluated, ANI_LOG_LEVEL <= 0 ? 2 : 1);
+}
+
+TEST_F(LoggerTest, LongMessagesAreTruncated) {
+    Logger::write(LogLevel::Info, "LoggerTest", std::string(1000, 'x'));
+    Logger::flush();
+    const std::string expected = "LoggerTest: " + std::string(LogRecord::kMessageSize, 'x') + "...\n";
+    EXPECT_NE(sink.str().find(expected), std::string::npos);
+}
+
+TEST_F(LoggerTest, ConcurrentWritersLoseNothingBelowCapacity) {
+    const std::uint64_t droppedBefore = Logger::dropped();
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([t]() {
+            for (int i = 0; i < 1000; ++i) {
+                Logger::write(LogLevel::Info, "LoggerTest", std::to_string(t) + ":" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    Logger::flush();
+
+    EXPECT_EQ(Logger::dropped(), droppedBefore);
+    std::istringstream lines(sink.str());
+    std::string line;
+    std::vector<int> next(4, 0);
+    int count = 0;
+    while (std::getline(lines, line)) {
+        const std::size_t start = line.find("LoggerTest: ");
+        ASSERT_NE(start, std::string::npos);
+        const std::string body = line.substr(start + 12);
+        const int thread = std::stoi(body.substr(0, body.find(':')));
+        const int index = std::stoi(body.substr(body.find(':') + 1));
+        // Each writer's records keep their order
+        EXPECT_EQ(index, next[thread]++);
+        ++count;
+    }
+    EXPECT_EQ(count, 4000);
+}
+
+TEST(LoggerLevelTest, ParsesLevelNames) {
+    LogLevel level = LogLevel::Info;
+    EXPECT_TRUE(Logger::parseLevel("debug", level));
+    EXPECT_EQ(level, LogLevel::Debug);
+    EXPECT_TRUE(Logger::parseLevel("ERROR", level));
+    EXPECT_EQ(level, LogLevel::Error);
+    EXPECT_FALSE(Logger::parseLevel("verbose", level));
+    EXPECT_EQ(level, LogLevel::Error);
+}
@@ -0,0 +1,571 @@
+#include "MessageCodec.h"
+#include "Tracing.h"
+#include <QJsonDocument>
+#include <stdexcept>
+
+/*!
+    \class MessageCodec
+    \brief Converts PE and Emitter objects to and from their JSON wire representations.
+
+    Single entity messages use keyed JSON objects. Batch frames such as snapshots
+    carry each entity as a positional row instead, so the field names are not
+    repeated for every entity in the batch.
+*/
+
+namespace {
+constexpr int kPERowSize = 13;
+constexpr int kEmitterRowSize = 21;
+}
+
+/*!
+    \fn QJsonObject MessageCodec::peToJson(const PE& pe)
+    \brief Converts a PE object to a keyed JSON object.
+    \param pe The PE object to convert.
+    \return The JSON object representation of the PE.
+*/
+QJsonObject MessageCodec::peToJson(const PE& pe) {
+    QJsonObject json;
+    json["id"] = pe.id;
+    json["type"] = pe.type;
+    json["lat"] = pe.lat;
+    json["lon"] = pe.lon;
+    json["altitude"] = pe.altitude;
+    json["speed"] = pe.speed;
+    json["heading"] = pe.heading;
+    json["apd"] = pe.apd;
+    json["priority"] = pe.priority;
+    json["jam"] = pe.jam;
+    json["ghost"] = pe.ghost;
+    json["category"] = static_cast<int>(pe.category);
+    json["state"] = pe.state;
+    return json;
+}
+
+/*!
+    \fn PE MessageCodec::peFromJson(const QJsonObject& json)
+    \brief Constructs a PE object from a keyed JSON object.
+    \param json The JSON object to read.
+    \return The PE object described by the JSON.
+*/
+PE MessageCodec::peFromJson(const QJsonObject& json) {
+    PE pe(
+        json["id"].toString(),
+        json["type"].toString(),
+        json["lat"].toDouble(),
+        json["lon"].toDouble(),
+        json["altitude"].toDouble(),
+        json["speed"].toDouble(),
+        json["apd"].toString(),
+        json["priority"].toString(),
+        json["jam"].toBool(),
+        json["ghost"].toBool()
+    );
+    pe.heading = json["heading"].toDouble();
+    pe.category = static_cast<PE::PECategory>(json["category"].toInt());
+    pe.state = json["state"].toString();
+    return pe;
+}
+
+/*!
+    \fn QJsonObject MessageCodec::emitterToJson(const Emitter& emitter)
+    \brief Converts an Emitter object to a keyed JSON object.
+    \param emitter The Emitter object to convert.
+    \return The JSON object representation of the Emitter.
+*/
+QJsonObject MessageCodec::emitterToJson(const Emitter& emitter) {
+    QJsonObject json;
+    json["id"] = emitter.id;
+    json["type"] = emitter.type;
+    json["category"] = emitter.category;
+    json["lat"] = emitter.lat;
+    json["lon"] = emitter.lon;
+    json["altitude"] = emitter.altitude;
+    json["heading"] = emitter.heading;
+    json["speed"] = emitter.speed;
+    json["freqMin"] = emitter.freqMin;
+    json["freqMax"] = emitter.freqMax;
+    json["active"] = emitter.active;
+    json["eaPriority"] = emitter.eaPriority;
+    json["esPriority"] = emitter.esPriority;
+    json["jamResponsible"] = emitter.jamResponsible;
+    json["reactiveEligible"] = emitter.reactiveEligible;
+    json["preemptiveEligible"] = emitter.preemptiveEligible;
+    json["consentRequired"] = emitter.consentRequired;
+    json["operatorManaged"] = emitter.operatorManaged;
+    json["jam"] = emitter.jam;
+    json["jamIneffective"] = emitter.jamIneffective;
+    json["jamEffective"] = emitter.jamEffective;
+    return json;
+}
+
+/*!
+    \fn Emitter MessageCodec::emitterFromJson(const QJsonObject& json)
+    \brief Constructs an Emitter object from a keyed JSON object.
+    \param json The JSON object to read.
+    \return The Emitter object described by the JSON.
+*/
+Emitter MessageCodec::emitterFromJson(const QJsonObject& json) {
+    Emitter emitter(
+        json["id"].toString(),
+        json["type"].toString(),
+        json["category"].toString(),
+        json["lat"].toDouble(),
+        json["lon"].toDouble(),
+        json["freqMin"].toDouble(),
+        json["freqMax"].toDouble(),
+        json["active"].toBool(),
+        json["eaPriority"].toString(),
+        json["esPriority"].toString(),
+        json["jamResponsible"].toBool(),
+        json["reactiveEligible"].toBool(),
+        json["preemptiveEligible"].toBool(),
+        json["consentRequired"].toBool(),
+        json["jam"].toBool()
+    );
+    emitter.altitude = json["altitude"].toDouble();
+    emitter.heading = json["heading"].toDouble();
+    emitter.speed = json["speed"].toDouble();
+    emitter.operatorManaged = json["operatorManaged"].toBool();
+    emitter.jamIneffective = json["jamIneffective"].toInt();
+    emitter.jamEffective = json["jamEffective"].toInt();
+    return emitter;
+}
+
+/*!
+    \fn QJsonArray MessageCodec::peToRow(const PE& pe)
+    \brief Converts a PE object to a positional JSON row.
+    \param pe The PE object to convert.
+    \return The row, in the same field order as peToJson.
+*/
+QJsonArray MessageCodec::peToRow(const PE& pe) {
+    return QJsonArray{
+        pe.id, pe.type, pe.lat, pe.lon, pe.altitude, pe.speed, pe.heading,
+        pe.apd, pe.priority, pe.jam, pe.ghost, static_cast<int>(pe.category), pe.state
+    };
+}
+
+/*!
+    \fn PE MessageCodec::peFromRow(const QJsonArray& row)
+    \brief Constructs a PE object from a positional JSON row.
+    \param row The row to read.
+    \return The PE object described by the row.
+*/
+PE MessageCodec::peFromRow(const QJsonArray& row) {
+    if (row.size() != kPERowSize) {
+        throw std::runtime_error("PE row has " + std::to_string(row.size()) + " fields, expected "
+                                 + std::to_string(kPERowSize));
+    }
+    PE pe(
+        row[0].toString(),
+        row[1].toString(),
+        row[2].toDouble(),
+        row[3].toDouble(),
+        row[4].toDouble(),
+        row[5].toDouble(),
+        row[7].toString(),
+        row[8].toString(),
+        row[9].toBool(),
+        row[10].toBool()
+    );
+    pe.heading = row[6].toDouble();
+    pe.category = static_cast<PE::PECategory>(row[11].toInt());
+    pe.state = row[12].toString();
+    return pe;
+}
+
+/*!
+    \fn QJsonArray MessageCodec::emitterToRow(const Emitter& emitter)
+    \brief Converts an Emitter object to a positional JSON row.
+    \param emitter The Emitter object to convert.
+    \return The row, in the same field order as emitterToJson.
+*/
+QJsonArray MessageCodec::emitterToRow(const Emitter& emitter) {
+    return QJsonArray{
+        emitter.id, emitter.type, emitter.category, emitter.lat, emitter.lon,
+        emitter.altitude, emitter.heading, emitter.speed, emitter.freqMin, emitter.freqMax,
+        emitter.active, emitter.eaPriority, emitter.esPriority, emitter.jamResponsible,
+        emitter.reactiveEligible, emitter.preemptiveEligible, emitter.consentRequired,
+        emitter.operatorManaged, emitter.jam, emitter.jamIneffective, emitter.jamEffective
+    };
+}
+
+/*!
+    \fn Emitter MessageCodec::emitterFromRow(const QJsonArray& row)
+    \brief Constructs an Emitter object from a positional JSON row.
+    \param row The row to read.
+    \return The Emitter object described by the row.
+*/
+Emitter MessageCodec::emitterFromRow(const QJsonArray& row) {
+    if (row.size() != kEmitterRowSize) {
+        throw std::runtime_error("Emitter row has " + std::to_string(row.size()) + " fields, expected "
+                                 + std::to_string(kEmitterRowSize));
+    }
+    Emitter emitter(
+        row[0].toString(),
+        row[1].toString(),
+        row[2].toString(),
+        row[3].toDouble(),
+        row[4].toDouble(),
+        row[8].toDouble(),
+        row[9].toDouble(),
+        row[10].toBool(),
+        row[11].toString(),
+        row[12].toString(),
+        row[13].toBool(),
+        row[14].toBool(),
+        row[15].toBool(),
+        row[16].toBool(),
+        row[18].toBool()
+    );
+    emitter.altitude = row[5].toDouble();
+    emitter.heading = row[6].toDouble();
+    emitter.speed = row[7].toDouble();
+    emitter.operatorManaged = row[17].toBool();
+    emitter.jamIneffective = row[19].toInt();
+    emitter.jamEffective = row[20].toInt();
+    return emitter;
+}
+
+/*!
+    \fn std::string MessageCodec::encodePE(const PE& pe)
+    \brief Encodes a single PE as one frame.
+    \param pe The PE to encode.
+    \return A newline terminated JSON frame holding the keyed PE object.
+*/
+std::string MessageCodec::encodePE(const PE& pe) {
+    ANI_TRACE_SPAN("MessageCodec::encodePE");
+    QJsonDocument doc(peToJson(pe));
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn std::string MessageCodec::encodeEmitter(const Emitter& emitter)
+    \brief Encodes a single Emitter as one frame.
+    \param emitter The Emitter to encode.
+    \return A newline terminated JSON frame holding the keyed Emitter object.
+*/
+std::string MessageCodec::encodeEmitter(const Emitter& emitter) {
+    ANI_TRACE_SPAN("MessageCodec::encodeEmitter");
+    QJsonDocument doc(emitterToJson(emitter));
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn std::string MessageCodec::encodeSetting(const std::string& type, const std::string& setting, const std::string& id, int value)
+    \brief Encodes a setting update as one frame.
+    \param type PE_SETTING or EMITTER_SETTING.
+    \param setting The name of the setting to update.
+    \param id The ID of the PE or Emitter.
+    \param value The new value for the setting.
+    \return A newline terminated JSON frame of the given type.
+*/
+std::string MessageCodec::encodeSetting(const std::string& type, const std::string& setting, const std::string& id, int value) {
+    ANI_TRACE_SPAN("MessageCodec::encodeSetting");
+    QJsonObject json;
+    json["type"] = QString::fromStdString(type);
+    json["id"] = QString::fromStdString(id);
+    json["setting"] = QString::fromStdString(setting);
+    json["value"] = value;
+    QJsonDocument doc(json);
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn std::string MessageCodec::encodeComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap)
+    \brief Encodes a PE, an Emitter and a map of doubles as one frame.
+    \param pe The PE to include in the blob.
+    \param emitter The Emitter to include in the blob.
+    \param doubleMap A map of string keys to double values to include in the blob.
+    \return A newline terminated JSON frame, with the PE and Emitter nested as encoded strings.
+*/
+std::string MessageCodec::encodeComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) {
+    ANI_TRACE_SPAN("MessageCodec::encodeComplexBlob");
+    QJsonObject json;
+    json["pe"] = QJsonObject{{"data", QString::fromStdString(encodePE(pe))}};
+    json["emitter"] = QJsonObject{{"data", QString::fromStdString(encodeEmitter(emitter))}};
+    QJsonObject mapJson;
+    for (const auto& pair : doubleMap) {
+        mapJson[QString::fromStdString(pair.first)] = pair.second;
+    }
+    json["doubleMap"] = mapJson;
+    QJsonDocument doc(json);
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn std::string MessageCodec::encodePEBatch(const std::vector<PE>& pes)
+    \brief Encodes a batch of PEs as one frame.
+    \param pes The PEs to encode.
+    \return A newline terminated JSON frame of type PE_BATCH.
+*/
+std::string MessageCodec::encodePEBatch(const std::vector<PE>& pes) {
+    ANI_TRACE_SPAN("MessageCodec::encodePEBatch");
+    QJsonArray rows;
+    for (const auto& pe : pes) {
+        rows.append(peToRow(pe));
+    }
+    QJsonObject json;
+    json["type"] = "PE_BATCH";
+    json["pes"] = rows;
+    QJsonDocument doc(json);
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn std::string MessageCodec::encodeEmitterBatch(const std::vector<Emitter>& emitters)
+    \brief Encodes a batch of Emitters as one frame.
+    \param emitters The Emitters to encode.
+    \return A newline terminated JSON frame of type EMITTER_BATCH.
+*/
+std::string MessageCodec::encodeEmitterBatch(const std::vector<Emitter>& emitters) {
+    ANI_TRACE_SPAN("MessageCodec::encodeEmitterBatch");
+    QJsonArray rows;
+    for (const auto& emitter : emitters) {
+        rows.append(emitterToRow(emitter));
+    }
+    QJsonObject json;
+    json["type"] = "EMITTER_BATCH";
+    json["emitters"] = rows;
+    QJsonDocument doc(json);
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn std::vector<PE> MessageCodec::decodePEBatch(const std::string& data)
+    \brief Decodes a PE_BATCH frame.
+    \param data The JSON frame to decode.
+    \return The decoded PEs, in the order they were encoded.
+*/
+std::vector<PE> MessageCodec::decodePEBatch(const std::string& data) {
+    ANI_TRACE_SPAN("MessageCodec::decodePEBatch");
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(data));
+    if (doc.isNull() || doc.object()["type"].toString() != "PE_BATCH") {
+        throw std::runtime_error("Invalid JSON data for PE batch deserialization");
+    }
+    const QJsonArray rows = doc.object()["pes"].toArray();
+    std::vector<PE> pes;
+    pes.reserve(rows.size());
+    for (const auto& row : rows) {
+        pes.push_back(peFromRow(row.toArray()));
+    }
+    return pes;
+}
+
+/*!
+    \fn std::vector<Emitter> MessageCodec::decodeEmitterBatch(const std::string& data)
+    \brief Decodes an EMITTER_BATCH frame.
+    \param data The JSON frame to decode.
+    \return The decoded Emitters, in the order they were encoded.
+*/
+std::vector<Emitter> MessageCodec::decodeEmitterBatch(const std::string& data) {
+    ANI_TRACE_SPAN("MessageCodec::decodeEmitterBatch");
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(data));
+    if (doc.isNull() || doc.object()["type"].toString() != "EMITTER_BATCH") {
+        throw std::runtime_error("Invalid JSON data for Emitter batch deserialization");
+    }
+    const QJsonArray rows = doc.object()["emitters"].toArray();
+    std::vector<Emitter> emitters;
+    emitters.reserve(rows.size());
+    for (const auto& row : rows) {
+        emitters.push_back(emitterFromRow(row.toArray()));
+    }
+    return emitters;
+}
+
+/*!
+    \fn std::string MessageCodec::encodeSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings)
+    \brief Encodes many setting updates as one frame.
+    \param settings (type, id, setting, value) tuples, with type PE_SETTING or EMITTER_SETTING.
+    \return A newline terminated JSON frame of type SETTING_BATCH, with one positional row per setting.
+*/
+std::string MessageCodec::encodeSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) {
+    ANI_TRACE_SPAN("MessageCodec::encodeSettingBatch");
+    QJsonArray rows;
+    for (const auto& [type, id, setting, value] : settings) {
+        rows.append(QJsonArray{QString::fromStdString(type), QString::fromStdString(id), QString::fromStdString(setting), value});
+    }
+    QJsonObject json;
+    json["type"] = "SETTING_BATCH";
+    json["settings"] = rows;
+    QJsonDocument doc(json);
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn bool MessageCodec::isValidSetting(const std::tuple<std::string, std::string, std::string, int>& setting)
+    \brief Checks a (type, id, setting, value) tuple before it is sent.
+    \return True if the type is PE_SETTING or EMITTER_SETTING and the id and setting name are not empty.
+*/
+bool MessageCodec::isValidSetting(const std::tuple<std::string, std::string, std::string, int>& setting) {
+    const auto& [type, id, name, value] = setting;
+    return (type == "PE_SETTING" || type == "EMITTER_SETTING") && !id.empty() && !name.empty();
+}
+
+/*!
+    \fn std::vector<std::tuple<std::string, std::string, std::string, int>> MessageCodec::decodeSettingBatch(const std::string& data)
+    \brief Decodes a SETTING_BATCH frame.
+    \param data The JSON frame to decode.
+    \return The (type, id, setting, value) tuples, in the order they were encoded.
+
+    Throws std::runtime_error if any row is malformed, so a batch is only ever
+    decoded whole.
+*/
+std::vector<std::tuple<std::string, std::string, std::string, int>> MessageCodec::decodeSettingBatch(const std::string& data) {
+    ANI_TRACE_SPAN("MessageCodec::decodeSettingBatch");
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(data));
+    if (doc.isNull() || doc.object()["type"].toString() != "SETTING_BATCH") {
+        throw std::runtime_error("Invalid JSON data for setting batch deserialization");
+    }
+    const QJsonArray rows = doc.object()["settings"].toArray();
+    std::vector<std::tuple<std::string, std::string, std::string, int>> settings;
+    settings.reserve(rows.size());
+    for (const auto& value : rows) {
+        const QJsonArray row = value.toArray();
+        if (row.size() != 4) {
+            throw std::runtime_error("Setting batch row has " + std::to_string(row.size()) + " fields, expected 4");
+        }
+        const QString type = row[0].toString();
+        if ((type != "PE_SETTING" && type != "EMITTER_SETTING") || !row[3].isDouble()) {
+            throw std::runtime_error("Malformed row in setting batch");
+        }
+        settings.emplace_back(type.toStdString(), row[1].toString().toStdString(), row[2].toString().toStdString(),
+                              row[3].toInt());
+    }
+    return settings;
+}
+
+/*!
+    \fn std::string MessageCodec::encodeSnapshot(const EntitySnapshot& snapshot)
+    \brief Encodes a snapshot of all current PEs and Emitters as one frame.
+    \param snapshot The snapshot to encode.
+    \return A newline terminated JSON frame of type SNAPSHOT.
+*/
+std::string MessageCodec::encodeSnapshot(const EntitySnapshot& snapshot) {
+    ANI_TRACE_SPAN("MessageCodec::encodeSnapshot");
+    QJsonArray pes;
+    for (const auto& pe : snapshot.pes) {
+        pes.append(peToRow(pe));
+    }
+    QJsonArray emitters;
+    for (const auto& emitter : snapshot.emitters) {
+        emitters.append(emitterToRow(emitter));
+    }
+    QJsonObject json;
+    json["type"] = "SNAPSHOT";
+    // Sequence numbers stay well inside the 53 bits a JSON double represents exactly
+    json["seq"] = static_cast<double>(snapshot.sequence);
+    json["pes"] = pes;
+    json["emitters"] = emitters;
+    QJsonDocument doc(json);
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn EntitySnapshot MessageCodec::decodeSnapshot(const std::string& data)
+    \brief Decodes a SNAPSHOT frame.
+    \param data The JSON frame to decode.
+    \return The decoded snapshot.
+*/
+EntitySnapshot MessageCodec::decodeSnapshot(const std::string& data) {
+    ANI_TRACE_SPAN("MessageCodec::decodeSnapshot");
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(data));
+    if (doc.isNull() || doc.object()["type"].toString() != "SNAPSHOT") {
+        throw std::runtime_error("Invalid JSON data for snapshot deserialization");
+    }
+    QJsonObject json = doc.object();
+
+    EntitySnapshot snapshot;
+    snapshot.sequence = static_cast<std::uint64_t>(json["seq"].toDouble());
+    const QJsonArray pes = json["pes"].toArray();
+    snapshot.pes.reserve(pes.size());
+    for (const auto& row : pes) {
+        snapshot.pes.push_back(peFromRow(row.toArray()));
+    }
+    const QJsonArray emitters = json["emitters"].toArray();
+    snapshot.emitters.reserve(emitters.size());
+    for (const auto& row : emitters) {
+        snapshot.emitters.push_back(emitterFromRow(row.toArray()));
+    }
+    return snapshot;
+}
+
+/*!
+    \fn std::string MessageCodec::encodeBlobStreamHeader(std::uint64_t length)
+    \brief Encodes the frame that starts a blob stream.
+    \param length The number of raw bytes that follow the frame.
+    \return A newline terminated JSON frame of type BLOB_STREAM.
+*/
+std::string MessageCodec::encodeBlobStreamHeader(std::uint64_t length) {
+    QJsonObject json;
+    json["type"] = "BLOB_STREAM";
+    // Blob lengths stay well inside the 53 bits a JSON double represents exactly
+    json["length"] = static_cast<double>(length);
+    QJsonDocument doc(json);
+    return doc.toJson(QJsonDocument::Compact).toStdString() + "\n";
+}
+
+/*!
+    \fn bool MessageCodec::decodeBlobStreamHeader(const std::string& frame, std::uint64_t& length)
+    \brief Recognises the frame that starts a blob stream.
+    \param frame A received frame, without its trailing newline.
+    \param length Set to the number of raw bytes that follow the frame.
+    \return True if the frame is a blob stream header.
+
+    Frames are checked by size and content before parsing, so calling this
+    on every frame costs next to nothing.
+*/
+bool MessageCodec::decodeBlobStreamHeader(const std::string& frame, std::uint64_t& length) {
+    if (frame.size() > 64 || frame.find("\"BLOB_STREAM\"") == std::string::npos) {
+        return false;
+    }
+    const QJsonObject json = QJsonDocument::fromJson(QByteArray::fromStdString(frame)).object();
+    const double value = json["length"].toDouble(-1.0);
+    if (json["type"].toString() != "BLOB_STREAM" || value < 0.0) {
+        return false;
+    }
+    length = static_cast<std::uint64_t>(value);
+    return true;
+}
+
+/*!
+    \fn NetworkMessage::Kind MessageCodec::classify(const std::string& data)
+    \brief Works out which kind of message a frame holds.
+    \param data The frame, without its trailing newline.
+    \return The message kind, or Blob for anything that is not a known message.
+
+    Frames are recognised by their shape rather than their "type" field, since a
+    PE or Emitter also carries a "type" of its own.
+*/
+NetworkMessage::Kind MessageCodec::classify(const std::string& data) {
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(data));
+    if (!doc.isObject()) {
+        return NetworkMessage::Kind::Blob;
+    }
+    const QJsonObject json = doc.object();
+    const QString type = json["type"].toString();
+    if (json.contains("setting") && (type == "PE_SETTING" || type == "EMITTER_SETTING")) {
+        return NetworkMessage::Kind::Setting;
+    }
+    if (type == "SETTING_BATCH" && json.contains("settings")) {
+        return NetworkMessage::Kind::SettingBatch;
+    }
+    if (type == "SNAPSHOT" && json.contains("seq")) {
+        return NetworkMessage::Kind::Snapshot;
+    }
+    if (type == "PE_BATCH" && json.contains("pes")) {
+        return NetworkMessage::Kind::PEBatch;
+    }
+    if (type == "EMITTER_BATCH" && json.contains("emitters")) {
+        return NetworkMessage::Kind::EmitterBatch;
+    }
+    if (json.contains("pe") && json.contains("emitter")) {
+        return NetworkMessage::Kind::ComplexBlob;
+    }
+    if (json.contains("freqMin")) {
+        return NetworkMessage::Kind::Emitter;
+    }
+    if (json.contains("ghost")) {
+        return NetworkMessage::Kind::PE;
+    }
+    return NetworkMessage::Kind::Blob;
+}
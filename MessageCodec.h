@@ -0,0 +1,84 @@
+#ifndef MESSAGECODEC_H
+#define MESSAGECODEC_H
+
+#include <QJsonObject>
+#include <QJsonArray>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "pe.h"
+#include "emitter.h"
+
+// Full picture of current entity state, tagged with the publisher sequence it was taken at
+struct EntitySnapshot {
+    std::uint64_t sequence = 0;
+    std::vector<PE> pes;
+    std::vector<Emitter> emitters;
+};
+
+// Any received frame, as returned by receiveMessage, only the fields for its kind are filled
+struct NetworkMessage {
+    enum class Kind { Blob, PE, Emitter, Setting, ComplexBlob, PEBatch, EmitterBatch, Snapshot, SettingBatch };
+    Kind kind = Kind::Blob;
+    // PE, ComplexBlob, PEBatch and Snapshot
+    std::vector<PE> pes;
+    // Emitter, ComplexBlob, EmitterBatch and Snapshot
+    std::vector<Emitter> emitters;
+    // Setting
+    std::tuple<std::string, std::string, std::string, int> setting;
+    // SettingBatch, in the order they were sent
+    std::vector<std::tuple<std::string, std::string, std::string, int>> settings;
+    // ComplexBlob
+    std::map<std::string, double> doubleMap;
+    // Blob, the raw frame
+    std::string blob;
+    // Snapshot
+    std::uint64_t sequence = 0;
+};
+
+class MessageCodec {
+public:
+    // Convert a PE to and from its keyed JSON object form
+    static QJsonObject peToJson(const PE& pe);
+    static PE peFromJson(const QJsonObject& json);
+    // Convert an Emitter to and from its keyed JSON object form
+    static QJsonObject emitterToJson(const Emitter& emitter);
+    static Emitter emitterFromJson(const QJsonObject& json);
+    // Convert a PE to and from a positional row, as used in batch frames
+    static QJsonArray peToRow(const PE& pe);
+    static PE peFromRow(const QJsonArray& row);
+    // Convert an Emitter to and from a positional row, as used in batch frames
+    static QJsonArray emitterToRow(const Emitter& emitter);
+    static Emitter emitterFromRow(const QJsonArray& row);
+    // Encode a single PE, Emitter, setting or complex blob as a newline terminated frame
+    static std::string encodePE(const PE& pe);
+    static std::string encodeEmitter(const Emitter& emitter);
+    static std::string encodeSetting(const std::string& type, const std::string& setting, const std::string& id, int value);
+    static std::string encodeComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap);
+    // Encode a batch of PEs or Emitters into a single newline terminated frame
+    static std::string encodePEBatch(const std::vector<PE>& pes);
+    static std::string encodeEmitterBatch(const std::vector<Emitter>& emitters);
+    // Decode a batch frame, throws std::runtime_error on malformed input
+    static std::vector<PE> decodePEBatch(const std::string& data);
+    static std::vector<Emitter> decodeEmitterBatch(const std::string& data);
+    // Encode (type, id, setting, value) tuples, as returned by receiveSetting, into a single newline terminated frame
+    static std::string encodeSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings);
+    // True if a setting tuple has type PE_SETTING or EMITTER_SETTING and a non-empty id and setting name
+    static bool isValidSetting(const std::tuple<std::string, std::string, std::string, int>& setting);
+    // Decode a setting batch frame, throws std::runtime_error on malformed input
+    static std::vector<std::tuple<std::string, std::string, std::string, int>> decodeSettingBatch(const std::string& data);
+    // Encode a snapshot into a single newline terminated frame
+    static std::string encodeSnapshot(const EntitySnapshot& snapshot);
+    // Decode a snapshot frame, throws std::runtime_error on malformed input
+    static EntitySnapshot decodeSnapshot(const std::string& data);
+    // Header frame announcing a blob stream of length raw bytes, which follow it directly
+    static std::string encodeBlobStreamHeader(std::uint64_t length);
+    // True if frame, without its newline, is a blob stream header, setting length
+    static bool decodeBlobStreamHeader(const std::string& frame, std::uint64_t& length);
+    // Work out which kind of message a frame holds, anything unrecognised is a Blob
+    static NetworkMessage::Kind classify(const std::string& data);
+};
+
+#endif // MESSAGECODEC_H
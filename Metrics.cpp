@@ -0,0 +1,295 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+
+/*!
+    \class Metrics
+    \brief Process-wide counters, gauges and latency histograms for the network paths.
+
+    Recording must cost far less than the work it measures, so every thread
+    writes to its own MetricsShard. A shard is aligned to a cache line and only
+    ever written by its owner, so an update is a relaxed load and store with no
+    locked instruction and no cache line shared between threads. stats() sums
+    the shards of all live threads plus the totals left behind by threads that
+    have exited.
+
+    Gauges go up and down on different threads, so they are single shared
+    atomics; they are only touched when work is queued or dequeued.
+
+    When ANI_ENABLE_METRICS is not defined every recording call compiles to
+    nothing and stats() returns zeros.
+*/
+
+namespace {
+const char* const kKindNames[kMessageKindCount] = {
+    "blob", "pe", "emitter", "setting", "complex_blob", "pe_batch", "emitter_batch", "snapshot", "setting_batch"
+};
+
+struct alignas(64) PaddedGauge {
+    std::atomic<std::int64_t> value{0};
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<MetricsShard*> live;
+    // Totals of shards whose threads have exited
+    MetricsSnapshot retired;
+    PaddedGauge gauges[static_cast<std::size_t>(MetricGauge::Count)];
+};
+
+// Never destroyed, threads may still exit and retire their shards during static destruction
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+struct ShardOwner {
+    MetricsShard* shard;
+    ShardOwner() : shard(new MetricsShard) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.push_back(shard);
+    }
+    ~ShardOwner() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        shard->addTo(r.retired);
+        r.live.erase(std::remove(r.live.begin(), r.live.end(), shard), r.live.end());
+        delete shard;
+    }
+};
+
+int highestBit(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+void writeFamily(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n';
+}
+
+void writeByKind(std::ostringstream& out, const char* name, const char* help,
+                 const std::array<std::uint64_t, kMessageKindCount>& values) {
+    writeFamily(out, name, "counter", help);
+    for (std::size_t kind = 0; kind < kMessageKindCount; ++kind) {
+        out << name << "{kind=\"" << kKindNames[kind] << "\"} " << values[kind] << '\n';
+    }
+}
+
+void writeHistogram(std::ostringstream& out, const char* name, const char* help, const MetricsHistogramSnapshot& histogram) {
+    writeFamily(out, name, "histogram", help);
+    char line[160];
+    std::uint64_t cumulative = 0;
+    std::size_t bucket = 0;
+    // Export at powers of two from 256 ns to 17 s, the internal sub-buckets are summed into them
+    for (int power = 8; power <= 34; ++power) {
+        const std::uint64_t bound = std::uint64_t(1) << power;
+        while (bucket < MetricsHistogramSnapshot::kBuckets && MetricsHistogramSnapshot::bucketUpperBound(bucket) < bound) {
+            cumulative += histogram.buckets[bucket++];
+        }
+        std::snprintf(line, sizeof(line), "%s_bucket{le=\"%.9g\"} %llu\n", name, bound / 1e9,
+                      static_cast<unsigned long long>(cumulative));
+        out << line;
+    }
+    std::snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.9g\n%s_count %llu\n", name,
+                  static_cast<unsigned long long>(histogram.count), name, histogram.sum / 1e9, name,
+                  static_cast<unsigned long long>(histogram.count));
+    out << line;
+}
+}
+
+/*!
+    \fn std::size_t MetricsHistogramSnapshot::bucketIndex(std::uint64_t value)
+    \brief Returns the bucket for a value: exact below 4, then four buckets per power of two.
+*/
+std::size_t MetricsHistogramSnapshot::bucketIndex(std::uint64_t value) {
+    if (value < 4) {
+        return static_cast<std::size_t>(value);
+    }
+    const int exponent = highestBit(value);
+    const std::uint64_t subBucket = (value >> (exponent - 2)) & 3;
+    return 4 + static_cast<std::size_t>(exponent - 2) * 4 + static_cast<std::size_t>(subBucket);
+}
+
+/*!
+    \fn std::uint64_t MetricsHistogramSnapshot::bucketUpperBound(std::size_t index)
+    \brief Returns the largest value that falls in a bucket.
+*/
+std::uint64_t MetricsHistogramSnapshot::bucketUpperBound(std::size_t index) {
+    if (index < 4) {
+        return index;
+    }
+    const std::size_t exponent = (index - 4) / 4 + 2;
+    const std::uint64_t subBucket = (index - 4) % 4;
+    return ((4 + subBucket + 1) << (exponent - 2)) - 1;
+}
+
+/*!
+    \fn std::uint64_t MetricsHistogramSnapshot::valueAtPercentile(double percentile) const
+    \brief Returns the upper bound of the bucket holding a percentile, or 0 if nothing was recorded.
+    \param percentile The percentile, from 0 to 100.
+*/
+std::uint64_t MetricsHistogramSnapshot::valueAtPercentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    const std::uint64_t target = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(percentile / 100.0 * count + 0.5));
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        cumulative += buckets[i];
+        if (cumulative >= target) {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(kBuckets - 1);
+}
+
+/*!
+    \fn std::string MetricsSnapshot::toPrometheus() const
+    \brief Formats the snapshot in the Prometheus text exposition format.
+    \return Counters, gauges and histograms, with durations in seconds.
+*/
+std::string MetricsSnapshot::toPrometheus() const {
+    std::ostringstream out;
+    writeByKind(out, "ani_messages_sent_total", "Frames written, by message kind.", messagesSent);
+    writeByKind(out, "ani_sent_bytes_total", "Bytes written, by message kind.", bytesSent);
+    writeByKind(out, "ani_messages_received_total", "Frames read, by message kind.", messagesReceived);
+    writeByKind(out, "ani_received_bytes_total", "Bytes read, by message kind.", bytesReceived);
+
+    writeFamily(out, "ani_send_failures_total", "counter", "Sends that failed to encode or write.");
+    out << "ani_send_failures_total " << counter(MetricCounter::SendFailures) << '\n';
+    writeFamily(out, "ani_receive_failures_total", "counter", "Receives that failed to read or decode.");
+    out << "ani_receive_failures_total " << counter(MetricCounter::ReceiveFailures) << '\n';
+    writeFamily(out, "ani_invalid_entities_total", "counter", "PEs, Emitters and settings rejected by validation.");
+    out << "ani_invalid_entities_total{entity=\"pe\"} " << counter(MetricCounter::InvalidPEs) << '\n';
+    out << "ani_invalid_entities_total{entity=\"emitter\"} " << counter(MetricCounter::InvalidEmitters) << '\n';
+    out << "ani_invalid_entities_total{entity=\"setting\"} " << counter(MetricCounter::InvalidSettings) << '\n';
+    writeFamily(out, "ani_write_stalls_total", "counter", "Socket writes that blocked for more than 1 ms.");
+    out << "ani_write_stalls_total " << counter(MetricCounter::WriteStalls) << '\n';
+    writeFamily(out, "ani_queued_sends", "gauge", "Sends queued on network workers and not yet written.");
+    out << "ani_queued_sends " << gauge(MetricGauge::QueuedSends) << '\n';
+
+    writeHistogram(out, "ani_encode_seconds", "Time spent encoding a frame.", histogram(MetricHistogram::EncodeNs));
+    writeHistogram(out, "ani_decode_seconds", "Time spent decoding a frame.", histogram(MetricHistogram::DecodeNs));
+    writeHistogram(out, "ani_write_seconds", "Time spent writing a frame to the socket.", histogram(MetricHistogram::WriteNs));
+    return out.str();
+}
+
+/*!
+    \fn MetricsShard::MetricsShard()
+    \brief Constructs a shard with every value zero.
+*/
+MetricsShard::MetricsShard() {
+    for (std::size_t kind = 0; kind < kMessageKindCount; ++kind) {
+        messagesSent[kind].store(0, std::memory_order_relaxed);
+        bytesSent[kind].store(0, std::memory_order_relaxed);
+        messagesReceived[kind].store(0, std::memory_order_relaxed);
+        bytesReceived[kind].store(0, std::memory_order_relaxed);
+    }
+    for (auto& counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto& histogram : histograms) {
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.sum.store(0, std::memory_order_relaxed);
+        for (auto& bucket : histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+/*!
+    \fn void MetricsShard::addTo(MetricsSnapshot& snapshot) const
+    \brief Adds this shard's values to a snapshot.
+*/
+void MetricsShard::addTo(MetricsSnapshot& snapshot) const {
+    for (std::size_t kind = 0; kind < kMessageKindCount; ++kind) {
+        snapshot.messagesSent[kind] += messagesSent[kind].load(std::memory_order_relaxed);
+        snapshot.bytesSent[kind] += bytesSent[kind].load(std::memory_order_relaxed);
+        snapshot.messagesReceived[kind] += messagesReceived[kind].load(std::memory_order_relaxed);
+        snapshot.bytesReceived[kind] += bytesReceived[kind].load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 0; i < snapshot.counters.size(); ++i) {
+        snapshot.counters[i] += counters[i].load(std::memory_order_relaxed);
+    }
+    for (std::size_t h = 0; h < snapshot.histograms.size(); ++h) {
+        MetricsHistogramSnapshot& target = snapshot.histograms[h];
+        target.count += histograms[h].count.load(std::memory_order_relaxed);
+        target.sum += histograms[h].sum.load(std::memory_order_relaxed);
+        for (std::size_t b = 0; b < MetricsHistogramSnapshot::kBuckets; ++b) {
+            target.buckets[b] += histograms[h].buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/*!
+    \fn void Metrics::record(MetricHistogram histogram, std::int64_t nanoseconds)
+    \brief Records a duration in one of the latency histograms.
+    \param histogram The histogram to record in.
+    \param nanoseconds The duration, negative values are recorded as 0.
+
+    A WriteNs duration longer than kWriteStallNs also counts as a write stall.
+*/
+void Metrics::record(MetricHistogram histogram, std::int64_t nanoseconds) {
+#ifdef ANI_ENABLE_METRICS
+    const std::uint64_t value = nanoseconds > 0 ? static_cast<std::uint64_t>(nanoseconds) : 0;
+    MetricsShard::Histogram& target = shard().histograms[static_cast<std::size_t>(histogram)];
+    bump(target.count, 1);
+    bump(target.sum, value);
+    bump(target.buckets[MetricsHistogramSnapshot::bucketIndex(value)], 1);
+    if (histogram == MetricHistogram::WriteNs && nanoseconds > kWriteStallNs) {
+        count(MetricCounter::WriteStalls);
+    }
+#else
+    (void)histogram;
+    (void)nanoseconds;
+#endif
+}
+
+/*!
+    \fn void Metrics::adjust(MetricGauge gauge, std::int64_t delta)
+    \brief Moves a gauge up or down.
+*/
+void Metrics::adjust(MetricGauge gauge, std::int64_t delta) {
+#ifdef ANI_ENABLE_METRICS
+    registry().gauges[static_cast<std::size_t>(gauge)].value.fetch_add(delta, std::memory_order_relaxed);
+#else
+    (void)gauge;
+    (void)delta;
+#endif
+}
+
+/*!
+    \fn MetricsSnapshot Metrics::stats()
+    \brief Returns the current totals across every thread.
+
+    Values recorded concurrently with the call may or may not be included, each
+    individual counter is read atomically.
+*/
+MetricsSnapshot Metrics::stats() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    MetricsSnapshot snapshot = r.retired;
+    for (const MetricsShard* live : r.live) {
+        live->addTo(snapshot);
+    }
+    for (std::size_t g = 0; g < snapshot.gauges.size(); ++g) {
+        snapshot.gauges[g] = r.gauges[g].value.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+MetricsShard& Metrics::shard() {
+    thread_local ShardOwner owner;
+    return *owner.shard;
+}
@@ -0,0 +1,180 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MessageCodec.h"
+
+enum class MetricCounter {
+    SendFailures,
+    ReceiveFailures,
+    // PEs and Emitters rejected by validation, sent or received, singly or in batches
+    InvalidPEs,
+    InvalidEmitters,
+    // Malformed settings in setting batches refused before sending
+    InvalidSettings,
+    // Writes that blocked longer than Metrics::kWriteStallNs, usually on a full socket buffer
+    WriteStalls,
+    Count
+};
+
+enum class MetricHistogram {
+    // Nanoseconds spent encoding a frame, decoding a frame and writing it to the socket
+    EncodeNs,
+    DecodeNs,
+    WriteNs,
+    Count
+};
+
+enum class MetricGauge {
+    // Sends queued on NetworkWorkers and not yet written
+    QueuedSends,
+    Count
+};
+
+constexpr std::size_t kMessageKindCount = static_cast<std::size_t>(NetworkMessage::Kind::SettingBatch) + 1;
+
+// Aggregated log-linear histogram, four sub-buckets per power of two
+struct MetricsHistogramSnapshot {
+    static constexpr std::size_t kBuckets = 252;
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::array<std::uint64_t, kBuckets> buckets{};
+    // Upper bound of the bucket a value falls in, to within 25%
+    std::uint64_t valueAtPercentile(double percentile) const;
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+    static std::size_t bucketIndex(std::uint64_t value);
+    static std::uint64_t bucketUpperBound(std::size_t index);
+};
+
+// Totals across every thread at the time stats() was called
+struct MetricsSnapshot {
+    std::array<std::uint64_t, kMessageKindCount> messagesSent{};
+    std::array<std::uint64_t, kMessageKindCount> bytesSent{};
+    std::array<std::uint64_t, kMessageKindCount> messagesReceived{};
+    std::array<std::uint64_t, kMessageKindCount> bytesReceived{};
+    std::array<std::uint64_t, static_cast<std::size_t>(MetricCounter::Count)> counters{};
+    std::array<std::int64_t, static_cast<std::size_t>(MetricGauge::Count)> gauges{};
+    std::array<MetricsHistogramSnapshot, static_cast<std::size_t>(MetricHistogram::Count)> histograms{};
+
+    std::uint64_t counter(MetricCounter c) const { return counters[static_cast<std::size_t>(c)]; }
+    std::int64_t gauge(MetricGauge g) const { return gauges[static_cast<std::size_t>(g)]; }
+    const MetricsHistogramSnapshot& histogram(MetricHistogram h) const { return histograms[static_cast<std::size_t>(h)]; }
+    std::uint64_t sent(NetworkMessage::Kind kind) const { return messagesSent[static_cast<std::size_t>(kind)]; }
+    std::uint64_t received(NetworkMessage::Kind kind) const { return messagesReceived[static_cast<std::size_t>(kind)]; }
+    // Prometheus text exposition format, version 0.0.4
+    std::string toPrometheus() const;
+};
+
+// Each thread updates its own cache-line aligned shard with plain relaxed stores,
+// so recording never contends. Shards are only summed when stats() is called.
+struct alignas(64) MetricsShard {
+    std::atomic<std::uint64_t> messagesSent[kMessageKindCount];
+    std::atomic<std::uint64_t> bytesSent[kMessageKindCount];
+    std::atomic<std::uint64_t> messagesReceived[kMessageKindCount];
+    std::atomic<std::uint64_t> bytesReceived[kMessageKindCount];
+    std::atomic<std::uint64_t> counters[static_cast<std::size_t>(MetricCounter::Count)];
+    struct Histogram {
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> sum;
+        std::atomic<std::uint64_t> buckets[MetricsHistogramSnapshot::kBuckets];
+    } histograms[static_cast<std::size_t>(MetricHistogram::Count)];
+    MetricsShard();
+    void addTo(MetricsSnapshot& snapshot) const;
+};
+
+// Process-wide runtime metrics, compiled to nothing unless ANI_ENABLE_METRICS is defined
+class Metrics {
+public:
+    static constexpr std::int64_t kWriteStallNs = 1'000'000;
+
+    static void count(MetricCounter counter, std::uint64_t n = 1) {
+#ifdef ANI_ENABLE_METRICS
+        bump(shard().counters[static_cast<std::size_t>(counter)], n);
+#else
+        (void)counter;
+        (void)n;
+#endif
+    }
+    static void countSent(NetworkMessage::Kind kind, std::size_t bytes) {
+#ifdef ANI_ENABLE_METRICS
+        MetricsShard& s = shard();
+        bump(s.messagesSent[static_cast<std::size_t>(kind)], 1);
+        bump(s.bytesSent[static_cast<std::size_t>(kind)], bytes);
+#else
+        (void)kind;
+        (void)bytes;
+#endif
+    }
+    static void countReceived(NetworkMessage::Kind kind, std::size_t bytes) {
+#ifdef ANI_ENABLE_METRICS
+        MetricsShard& s = shard();
+        bump(s.messagesReceived[static_cast<std::size_t>(kind)], 1);
+        bump(s.bytesReceived[static_cast<std::size_t>(kind)], bytes);
+#else
+        (void)kind;
+        (void)bytes;
+#endif
+    }
+    static void record(MetricHistogram histogram, std::int64_t nanoseconds);
+    static void adjust(MetricGauge gauge, std::int64_t delta);
+    // Sum every thread's shard, including threads that have exited
+    static MetricsSnapshot stats();
+    static constexpr bool enabled() {
+#ifdef ANI_ENABLE_METRICS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+    // Only the owning thread writes a shard, so a load and store is enough and avoids a locked add
+    static void bump(std::atomic<std::uint64_t>& value, std::uint64_t n) {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    static MetricsShard& shard();
+};
+
+// Records the time from construction to stop() or destruction into a histogram
+class MetricsTimer {
+public:
+    explicit MetricsTimer(MetricHistogram histogram)
+#ifdef ANI_ENABLE_METRICS
+        : histogram(histogram), start(std::chrono::steady_clock::now())
+#endif
+    {
+        (void)histogram;
+    }
+    ~MetricsTimer() { stop(); }
+    MetricsTimer(const MetricsTimer&) = delete;
+    MetricsTimer& operator=(const MetricsTimer&) = delete;
+    // Record now instead of at destruction, returns the elapsed nanoseconds
+    std::int64_t stop() {
+#ifdef ANI_ENABLE_METRICS
+        if (stopped) {
+            return 0;
+        }
+        stopped = true;
+        const std::int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        Metrics::record(histogram, elapsed);
+        return elapsed;
+#else
+        return 0;
+#endif
+    }
+
+private:
+#ifdef ANI_ENABLE_METRICS
+    MetricHistogram histogram;
+    std::chrono::steady_clock::time_point start;
+    bool stopped = false;
+#endif
+};
+
+#endif // METRICS_H
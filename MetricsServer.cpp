@@ -0,0 +1,127 @@
+#include "MetricsServer.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Tracing.h"
+
+/*!
+    \class MetricsServer
+    \brief Minimal HTTP endpoint for scraping runtime metrics.
+
+    Connections are handled one at a time on a single thread: each request is
+    read up to the end of its headers, answered with the current
+    Metrics::stats() formatted for Prometheus, and closed. GET /trace returns
+    the recorded tracing spans as Chrome trace JSON. Any other path gets a 404. It is meant for a local scraper, so bind it to a
+    loopback address unless the port is otherwise protected.
+*/
+
+/*!
+    \fn MetricsServer::MetricsServer(const std::string& address, unsigned short port)
+    \brief Constructs a server, nothing is bound until start().
+    \param address The address to listen on.
+    \param port The port to listen on, or 0 for any free port.
+*/
+MetricsServer::MetricsServer(const std::string& address, unsigned short port)
+    : address(address), requestedPort(port), acceptor(io_context) {}
+
+/*!
+    \fn MetricsServer::~MetricsServer()
+    \brief Stops the server if it is running.
+*/
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+/*!
+    \fn void MetricsServer::start()
+    \brief Binds the port and starts the server thread.
+
+    Throws boost::system::system_error if the port cannot be bound.
+*/
+void MetricsServer::start() {
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address(address), requestedPort);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+    running = true;
+    thread = std::thread(&MetricsServer::serve, this);
+}
+
+/*!
+    \fn void MetricsServer::stop()
+    \brief Stops serving and joins the server thread. Safe to call more than once.
+*/
+void MetricsServer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    // A blocking accept only returns once a connection arrives
+    boost::asio::ip::address wakeAddress = acceptor.local_endpoint().address();
+    if (wakeAddress.is_unspecified()) {
+        wakeAddress = wakeAddress.is_v6() ? boost::asio::ip::address(boost::asio::ip::address_v6::loopback())
+                                          : boost::asio::ip::address(boost::asio::ip::address_v4::loopback());
+    }
+    boost::asio::ip::tcp::socket wake(io_context);
+    boost::system::error_code ec;
+    wake.connect(boost::asio::ip::tcp::endpoint(wakeAddress, port()), ec);
+    thread.join();
+    acceptor.close(ec);
+}
+
+/*!
+    \fn unsigned short MetricsServer::port() const
+    \brief Returns the port the server is bound to.
+*/
+unsigned short MetricsServer::port() const {
+    boost::system::error_code ec;
+    return acceptor.local_endpoint(ec).port();
+}
+
+void MetricsServer::serve() {
+    while (running) {
+        boost::asio::ip::tcp::socket socket(io_context);
+        boost::system::error_code ec;
+        acceptor.accept(socket, ec);
+        if (!running) {
+            return;
+        }
+        if (ec) {
+            ANI_LOG_ERROR("MetricsServer", "Failed to accept: " + ec.message());
+            continue;
+        }
+        respond(socket);
+    }
+}
+
+void MetricsServer::respond(boost::asio::ip::tcp::socket& socket) {
+    boost::asio::streambuf request(8192);
+    boost::system::error_code ec;
+    boost::asio::read_until(socket, request, "\r\n\r\n", ec);
+    if (ec) {
+        return;
+    }
+    std::istream lines(&request);
+    std::string method;
+    std::string path;
+    lines >> method >> path;
+
+    std::string status = "200 OK";
+    std::string body;
+    std::string contentType = "text/plain; version=0.0.4";
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+    } else if (path == "/metrics") {
+        body = Metrics::stats().toPrometheus();
+    } else if (path == "/trace") {
+        contentType = "application/json";
+        body = Tracing::chromeTrace();
+    } else {
+        status = "404 Not Found";
+    }
+    const std::string response = "HTTP/1.1 " + status + "\r\n"
+                                 "Content-Type: " + contentType + "\r\n"
+                                 "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                 "Connection: close\r\n\r\n" + body;
+    boost::asio::write(socket, boost::asio::buffer(response), ec);
+    socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+}
@@ -0,0 +1,37 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Serves Metrics::stats() in the Prometheus text format over plain HTTP on GET /metrics,
+// and the tracing spans as Chrome trace JSON on GET /trace
+class MetricsServer {
+public:
+    // Port 0 picks a free port, see port()
+    MetricsServer(const std::string& address, unsigned short port);
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+    // Bind and start serving, throws if the port cannot be bound
+    void start();
+    // Stop serving and join the server thread
+    void stop();
+    // The bound port, valid after start()
+    unsigned short port() const;
+
+private:
+    void serve();
+    void respond(boost::asio::ip::tcp::socket& socket);
+
+    std::string address;
+    unsigned short requestedPort;
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::acceptor acceptor;
+    std::atomic<bool> running{false};
+    std::thread thread;
+};
+
+#endif // METRICSSERVER_H
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include "AbstractNetworkInterface.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "emitter.h"
+#include "pe.h"
+#include <thread>
+#include <vector>
+
+namespace {
+std::string httpGet(unsigned short port, const std::string& request) {
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::socket socket(io_context);
+    socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+    boost::asio::write(socket, boost::asio::buffer(request));
+    std::string response;
+    boost::system::error_code ec;
+    boost::asio::read(socket, boost::asio::dynamic_buffer(response), ec);
+    return response;
+}
+}
+
+TEST(MetricsTest, HistogramBucketsBoundTheirValues) {
+    for (std::uint64_t value : {0ull, 1ull, 3ull, 4ull, 7ull, 100ull, 1000ull, 123456789ull, 1ull << 40}) {
+        const std::size_t index = MetricsHistogramSnapshot::bucketIndex(value);
+        ASSERT_LT(index, MetricsHistogramSnapshot::kBuckets);
+        EXPECT_GE(MetricsHistogramSnapshot::bucketUpperBound(index), value);
+        if (index > 0) {
+            EXPECT_LT(MetricsHistogramSnapshot::bucketUpperBound(index - 1), value);
+        }
+    }
+    EXPECT_EQ(MetricsHistogramSnapshot::bucketIndex(~std::uint64_t(0)), MetricsHistogramSnapshot::kBuckets - 1);
+
+    MetricsHistogramSnapshot histogram;
+    for (std::uint64_t value = 1; value <= 1000; ++value) {
+        histogram.buckets[MetricsHistogramSnapshot::bucketIndex(value * 1000)]++;
+        histogram.sum += value * 1000;
+        histogram.count++;
+    }
+    EXPECT_NEAR(static_cast<double>(histogram.valueAtPercentile(50.0)), 500'000.0, 500'000.0 * 0.25);
+    EXPECT_NEAR(static_cast<double>(histogram.valueAtPercentile(99.0)), 990'000.0, 990'000.0 * 0.25);
+    EXPECT_DOUBLE_EQ(histogram.mean(), 500'500.0);
+}
+
+TEST(MetricsTest, CountersAggregateAcrossThreads) {
+    if (!Metrics::enabled()) {
+        GTEST_SKIP() << "Built without ANI_ENABLE_METRICS";
+    }
+    const MetricsSnapshot before = Metrics::stats();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 1000; ++i) {
+                Metrics::count(MetricCounter::SendFailures);
+                Metrics::countSent(NetworkMessage::Kind::PE, 100);
+                Metrics::record(MetricHistogram::EncodeNs, 2000);
+            }
+        });
+    }
+    // Counts from threads that have exited must not be lost
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const MetricsSnapshot after = Metrics::stats();
+    EXPECT_EQ(after.counter(MetricCounter::SendFailures) - before.counter(MetricCounter::SendFailures), 4000u);
+    EXPECT_EQ(after.sent(NetworkMessage::Kind::PE) - before.sent(NetworkMessage::Kind::PE), 4000u);
+    const std::size_t pe = static_cast<std::size_t>(NetworkMessage::Kind::PE);
+    EXPECT_EQ(after.bytesSent[pe] - before.bytesSent[pe], 400'000u);
+    EXPECT_EQ(after.histogram(MetricHistogram::EncodeNs).count - before.histogram(MetricHistogram::EncodeNs).count, 4000u);
+}
+
+TEST(MetricsTest, SlowWritesCountAsStalls) {
+    if (!Metrics::enabled()) {
+        GTEST_SKIP() << "Built without ANI_ENABLE_METRICS";
+    }
+    const MetricsSnapshot before = Metrics::stats();
+    Metrics::record(MetricHistogram::WriteNs, 1000);
+    Metrics::record(MetricHistogram::WriteNs, Metrics::kWriteStallNs * 5);
+    Metrics::adjust(MetricGauge::QueuedSends, 3);
+    const MetricsSnapshot after = Metrics::stats();
+    Metrics::adjust(MetricGauge::QueuedSends, -3);
+    EXPECT_EQ(after.counter(MetricCounter::WriteStalls) - before.counter(MetricCounter::WriteStalls), 1u);
+    EXPECT_EQ(after.gauge(MetricGauge::QueuedSends) - before.gauge(MetricGauge::QueuedSends), 3);
+}
+
+TEST(MetricsTest, PrometheusTextHasEveryFamily) {
+    MetricsSnapshot snapshot;
+    snapshot.messagesSent[static_cast<std::size_t>(NetworkMessage::Kind::Emitter)] = 7;
+    snapshot.counters[static_cast<std::size_t>(MetricCounter::InvalidPEs)] = 2;
+    snapshot.histograms[static_cast<std::size_t>(MetricHistogram::DecodeNs)].count = 1;
+    snapshot.histograms[static_cast<std::size_t>(MetricHistogram::DecodeNs)].sum = 1500;
+    snapshot.histograms[static_cast<std::size_t>(MetricHistogram::DecodeNs)].buckets[MetricsHistogramSnapshot::bucketIndex(1500)] = 1;
+
+    const std::string text = snapshot.toPrometheus();
+    EXPECT_NE(text.find("# TYPE ani_messages_sent_total counter"), std::string::npos);
+    EXPECT_NE(text.find("ani_messages_sent_total{kind=\"emitter\"} 7"), std::string::npos);
+    EXPECT_NE(text.find("ani_invalid_entities_total{entity=\"pe\"} 2"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE ani_queued_sends gauge"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE ani_decode_seconds histogram"), std::string::npos);
+    EXPECT_NE(text.find("ani_decode_seconds_bucket{le=\"1.024e-06\"} 0"), std::string::npos);
+    EXPECT_NE(text.find("ani_decode_seconds_bucket{le=\"2.048e-06\"} 1"), std::string::npos);
+    EXPECT_NE(text.find("ani_decode_seconds_bucket{le=\"+Inf\"} 1"), std::string::npos);
+    EXPECT_NE(text.find("ani_decode_seconds_count 1"), std::string::npos);
+}
+
+TEST(MetricsTest, SendAndReceiveAreCounted) {
+    if (!Metrics::enabled()) {
+        GTEST_SKIP() << "Built without ANI_ENABLE_METRICS";
+    }
+    NetworkImplementation sender;
+    NetworkImplementation receiver;
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    sender.initialise("127.0.0.1", acceptor.local_endpoint().port());
+    acceptor.accept(*receiver.getSocket());
+
+    const MetricsSnapshot before = Metrics::stats();
+    ASSERT_TRUE(sender.sendPE(PE("MetricsPE", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false)));
+    EXPECT_FALSE(sender.sendPE(PE("", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false)));
+    EXPECT_FALSE(sender.sendSettingBatch({{"PE_SETTING", "MetricsPE", "JAM", 1}, {"PE_SETTING", "", "JAM", 1}}));
+    receiver.receivePE();
+    const MetricsSnapshot after = Metrics::stats();
+    sender.close();
+    receiver.close();
+
+    EXPECT_EQ(after.sent(NetworkMessage::Kind::PE) - before.sent(NetworkMessage::Kind::PE), 1u);
+    EXPECT_EQ(after.received(NetworkMessage::Kind::PE) - before.received(NetworkMessage::Kind::PE), 1u);
+    EXPECT_EQ(after.counter(MetricCounter::InvalidPEs) - before.counter(MetricCounter::InvalidPEs), 1u);
+    EXPECT_EQ(after.counter(MetricCounter::InvalidSettings) - before.counter(MetricCounter::InvalidSettings), 1u);
+    EXPECT_EQ(after.counter(MetricCounter::SendFailures), before.counter(MetricCounter::SendFailures));
+    EXPECT_GE(after.histogram(MetricHistogram::EncodeNs).count - before.histogram(MetricHistogram::EncodeNs).count, 1u);
+    EXPECT_GE(after.histogram(MetricHistogram::WriteNs).count - before.histogram(MetricHistogram::WriteNs).count, 1u);
+    EXPECT_GE(after.histogram(MetricHistogram::DecodeNs).count - before.histogram(MetricHistogram::DecodeNs).count, 1u);
+}
+
+TEST(MetricsTest, ServerAnswersScrapes) {
+    MetricsServer server("127.0.0.1", 0);
+    server.start();
+    ASSERT_NE(server.port(), 0);
+
+    const std::string metrics = httpGet(server.port(), "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    EXPECT_EQ(metrics.rfind("HTTP/1.1 200 OK", 0), 0u);
+    EXPECT_NE(metrics.find("ani_messages_sent_total{kind=\"pe\"}"), std::string::npos);
+
+    const std::string missing = httpGet(server.port(), "GET /other HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(missing.rfind("HTTP/1.1 404", 0), 0u);
+    const std::string post = httpGet(server.port(), "POST /metrics HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(post.rfind("HTTP/1.1 405", 0), 0u);
+    server.stop();
+}
@@ -1,6 +1,8 @@
 #include "NetworkInterfaceWrapper.h"
+#include "Tracing.h"
 #include <QJsonObject>
 #include <QJsonArray>
+#include <algorithm>
 
 /*!
     \class NetworkInterfaceWrapper
@@ -10,11 +12,111 @@
     allowing easy integration with Qt applications. It handles conversions
     between Qt and standard C++ types, and provides error handling through
     Qt's signal-slot mechanism.
+
+    All socket I/O runs on a NetworkWorker, so no slot blocks the GUI thread.
+    Sends are queued and return immediately; a failed send is reported through
+    the error signal. Once connected, the worker receives continuously and a
+    frame timer delivers everything received since the previous frame: PE and
+    Emitter updates are coalesced to the latest state per id and delivered with
+    one pesUpdated or emittersUpdated signal, while settings and blobs are
+    delivered in arrival order.
+
+    PEs and Emitters are passed to and from QML as QmlPE and QmlEmitter value
+    types, whose fields QML reads as properties without building a QVariantMap.
+
+    Every received PE, Emitter, setting and snapshot is also applied to an
+    EntityStore, exposed to QML through the peModel and emitterModel list
+    models. Model updates are coalesced and published once per display frame.
+
+    The blocking receive slots remain for callers that set receiveContinuously
+    to false before initialise(); otherwise the worker takes every message.
+
+    The worker also keeps a short position history for every PE and Emitter it
+    receives, which QML reads through peTrail(), emitterTrail(), pePositionAt()
+    and emitterPositionAt() to draw track trails.
 */
 
+namespace {
+// One display frame at 60 Hz
+constexpr int kModelFrameIntervalMs = 16;
+
+QVariantMap sampleToVariant(const TrackSample& sample, DeadReckoning::Clock::time_point now)
+{
+    QVariantMap map;
+    map["lat"] = sample.lat;
+    map["lon"] = sample.lon;
+    map["altitude"] = sample.altitude;
+    map["speed"] = sample.speed;
+    map["heading"] = sample.heading;
+    map["ageMs"] = static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(now - sample.time).count());
+    return map;
+}
+
+QVariantList trailToVariant(const TrackHistory& history, const QString& id, int count)
+{
+    // No ring holds more than capacity() samples
+    std::vector<TrackSample> samples(std::min(static_cast<std::size_t>(std::max(count, 0)), history.capacity()));
+    const std::size_t copied = history.last(id, samples.size(), samples.data());
+    const DeadReckoning::Clock::time_point now = DeadReckoning::Clock::now();
+    QVariantList trail;
+    trail.reserve(static_cast<int>(copied));
+    for (std::size_t i = 0; i < copied; ++i) {
+        trail.append(sampleToVariant(samples[i], now));
+    }
+    return trail;
+}
+
+QVariantList settingsToVariant(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings)
+{
+    QVariantList list;
+    list.reserve(static_cast<int>(settings.size()));
+    for (const auto& [type, id, setting, value] : settings) {
+        list.append(QVariant(QVariantList{QString::fromStdString(type), QString::fromStdString(id),
+                                          QString::fromStdString(setting), value}));
+    }
+    return list;
+}
+
+QVariantMap positionToVariant(const TrackHistory& history, const QString& id, int offsetMs)
+{
+    const DeadReckoning::Clock::time_point now = DeadReckoning::Clock::now();
+    std::optional<TrackSample> sample = history.positionAt(id, now + std::chrono::milliseconds(offsetMs));
+    return sample ? sampleToVariant(*sample, now) : QVariantMap();
+}
+}
+
 NetworkInterfaceWrapper::NetworkInterfaceWrapper(AbstractNetworkInterface* interface, QObject *parent)
-    : QObject(parent), m_interface(interface)
+    : QObject(parent), m_interface(interface),
+      m_peModel(new PEListModel(&m_store, this)),
+      m_emitterModel(new EmitterListModel(&m_store, this)),
+      m_frameTimer(new QTimer(this)),
+      m_worker(std::make_unique<NetworkWorker>(interface))
 {
+    registerQmlEntityTypes();
+    m_frameTimer->setInterval(kModelFrameIntervalMs);
+    connect(m_frameTimer, &QTimer::timeout, this, &NetworkInterfaceWrapper::deliverFrame);
+    m_frameTimer->start();
+}
+
+NetworkInterfaceWrapper::~NetworkInterfaceWrapper()
+{
+    m_worker->stop();
+}
+
+/*!
+    \fn void NetworkInterfaceWrapper::setReceiveContinuously(bool receive)
+    \brief Sets whether the network thread receives continuously after initialise().
+    \param receive True to receive on the network thread, false to use the blocking receive slots.
+
+    Takes effect at the next initialise().
+*/
+void NetworkInterfaceWrapper::setReceiveContinuously(bool receive)
+{
+    if (m_receiveContinuously == receive) {
+        return;
+    }
+    m_receiveContinuously = receive;
+    emit receiveContinuouslyChanged();
 }
 
 /*!
@@ -23,94 +125,159 @@ NetworkInterfaceWrapper::NetworkInterfaceWrapper(AbstractNetworkInterface* inter
     \param address The IP address to connect to.
     \param port The port number to use.
 
-    This function attempts to initialize the underlying network interface.
-    If initialization fails, it emits an error signal with a description.
+    The connection is made on the network thread and this function returns
+    immediately. The connected signal is emitted once it succeeds; if it fails,
+    the error signal is emitted with a description.
 */
 void NetworkInterfaceWrapper::initialise(const QString& address, unsigned short port)
 {
-    try {
-        m_interface->initialise(address.toStdString(), port);
-    } catch (const std::exception& e) {
-        emit error(QString("Failed to initialize: %1").arg(e.what()));
-    }
+    m_worker->connect(address.toStdString(), port, m_receiveContinuously);
+}
+
+/*!
+    \fn QmlPE NetworkInterfaceWrapper::createPE() const
+    \brief Creates an empty PE value for QML to fill in and pass to sendPE().
+*/
+QmlPE NetworkInterfaceWrapper::createPE() const
+{
+    return QmlPE();
+}
+
+/*!
+    \fn QmlEmitter NetworkInterfaceWrapper::createEmitter() const
+    \brief Creates an empty Emitter value for QML to fill in and pass to sendEmitter().
+*/
+QmlEmitter NetworkInterfaceWrapper::createEmitter() const
+{
+    return QmlEmitter();
+}
+
+/*!
+    \fn QVariantList NetworkInterfaceWrapper::peTrail(const QString& id, int count) const
+    \brief Returns the newest positions received for a PE, oldest first.
+    \param id The PE id.
+    \param count The most positions to return.
+
+    Each position is a map with lat, lon, altitude, speed and heading keys, and
+    ageMs giving how long ago it was received. Only updates received by the
+    network thread are recorded, so the list is empty while receiveContinuously
+    is false.
+*/
+QVariantList NetworkInterfaceWrapper::peTrail(const QString& id, int count) const
+{
+    return trailToVariant(m_worker->peTracks(), id, count);
+}
+
+/*!
+    \fn QVariantList NetworkInterfaceWrapper::emitterTrail(const QString& id, int count) const
+    \brief Returns the newest positions received for an Emitter, oldest first.
+    \param id The Emitter id.
+    \param count The most positions to return.
+
+    The positions have the same form as those returned by peTrail().
+*/
+QVariantList NetworkInterfaceWrapper::emitterTrail(const QString& id, int count) const
+{
+    return trailToVariant(m_worker->emitterTracks(), id, count);
 }
 
 /*!
-    \fn bool NetworkInterfaceWrapper::sendPE(const QVariantMap& pe)
+    \fn QVariantMap NetworkInterfaceWrapper::pePositionAt(const QString& id, int offsetMs) const
+    \brief Returns where a PE was, or is predicted to be, relative to now.
+    \param id The PE id.
+    \param offsetMs Milliseconds from now, negative for a past position.
+    \return A position map as returned by peTrail(), or an empty map if the
+            time is outside the recorded history.
+
+    See TrackHistory::positionAt() for how positions between and after the
+    received updates are estimated.
+*/
+QVariantMap NetworkInterfaceWrapper::pePositionAt(const QString& id, int offsetMs) const
+{
+    return positionToVariant(m_worker->peTracks(), id, offsetMs);
+}
+
+/*!
+    \fn QVariantMap NetworkInterfaceWrapper::emitterPositionAt(const QString& id, int offsetMs) const
+    \brief Returns where an Emitter was, or is predicted to be, relative to now.
+    \param id The Emitter id.
+    \param offsetMs Milliseconds from now, negative for a past position.
+    \return A position map as returned by peTrail(), or an empty map if the
+            time is outside the recorded history.
+*/
+QVariantMap NetworkInterfaceWrapper::emitterPositionAt(const QString& id, int offsetMs) const
+{
+    return positionToVariant(m_worker->emitterTracks(), id, offsetMs);
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::sendPE(const QmlPE& pe)
     \brief Sends a Platform Element (PE) over the network.
-    \param pe A QVariantMap representing the PE to send.
-    \return True if the PE was sent successfully, false otherwise.
+    \param pe The PE to send.
+    \return True if the PE was queued for sending.
 
-    This function converts the provided QVariantMap to a PE object and sends it.
-    If an error occurs, it emits an error signal with a description.
+    This function queues the PE on the network thread.
+    If the send fails, it emits an error signal with a description.
 */
-bool NetworkInterfaceWrapper::sendPE(const QVariantMap& pe)
+bool NetworkInterfaceWrapper::sendPE(const QmlPE& pe)
 {
-    try {
-        return m_interface->sendPE(convertToPE(pe));
-    } catch (const std::exception& e) {
-        emit error(QString("Failed to send PE: %1").arg(e.what()));
-        return false;
-    }
+    PE value = pe.pe();
+    m_worker->post([this, value]() { return m_interface->sendPE(value); }, "Failed to send PE");
+    return true;
 }
 
 /*!
-    \fn bool NetworkInterfaceWrapper::sendEmitter(const QVariantMap& emitter)
+    \fn bool NetworkInterfaceWrapper::sendEmitter(const QmlEmitter& emitter)
     \brief Sends an Emitter over the network.
-    \param emitter A QVariantMap representing the Emitter to send.
-    \return True if the Emitter was sent successfully, false otherwise.
+    \param emitter The Emitter to send.
+    \return True if the Emitter was queued for sending.
 
-    This function converts the provided QVariantMap to an Emitter object and sends it.
-    If an error occurs, it emits an error signal with a description.
+    This function queues the Emitter on the network thread.
+    If the send fails, it emits an error signal with a description.
 */
-bool NetworkInterfaceWrapper::sendEmitter(const QVariantMap& emitter)
+bool NetworkInterfaceWrapper::sendEmitter(const QmlEmitter& emitter)
 {
-    try {
-        return m_interface->sendEmitter(convertToEmitter(emitter));
-    } catch (const std::exception& e) {
-        emit error(QString("Failed to send Emitter: %1").arg(e.what()));
-        return false;
-    }
+    Emitter value = emitter.emitter();
+    m_worker->post([this, value]() { return m_interface->sendEmitter(value); }, "Failed to send Emitter");
+    return true;
 }
 
 /*!
     \fn bool NetworkInterfaceWrapper::sendBlob(const QString& blobString)
     \brief Sends a blob string over the network.
     \param blobString The blob string to send.
-    \return True if the blob was sent successfully, false otherwise.
+    \return True if the blob was queued for sending, false otherwise.
 
-    This function sends the provided blob string.
-    If an error occurs, it emits an error signal with a description.
+    This function queues the provided blob string on the network thread.
+    If the send fails, it emits an error signal with a description.
 */
 bool NetworkInterfaceWrapper::sendBlob(const QString& blobString)
 {
-    try {
-        return m_interface->sendBlob(blobString.toStdString());
-    } catch (const std::exception& e) {
-        emit error(QString("Failed to send blob: %1").arg(e.what()));
-        return false;
-    }
+    std::string blob = blobString.toStdString();
+    m_worker->post([this, blob]() { return m_interface->sendBlob(blob); }, "Failed to send blob");
+    return true;
 }
 
 /*!
-    \fn bool NetworkInterfaceWrapper::sendComplexBlob(const QVariantMap& pe, const QVariantMap& emitter, const QVariantMap& doubleMap)
+    \fn bool NetworkInterfaceWrapper::sendComplexBlob(const QmlPE& pe, const QmlEmitter& emitter, const QVariantMap& doubleMap)
     \brief Sends a complex blob over the network.
-    \param pe A QVariantMap representing the PE part of the complex blob.
-    \param emitter A QVariantMap representing the Emitter part of the complex blob.
+    \param pe The PE part of the complex blob.
+    \param emitter The Emitter part of the complex blob.
     \param doubleMap A QVariantMap representing additional double values.
-    \return True if the complex blob was sent successfully, false otherwise.
+    \return True if the complex blob was queued for sending.
 
-    This function converts the provided QVariantMaps to their respective types and sends them as a complex blob.
-    If an error occurs, it emits an error signal with a description.
+    This function queues the complex blob on the network thread.
+    If the send fails, it emits an error signal with a description.
 */
-bool NetworkInterfaceWrapper::sendComplexBlob(const QVariantMap& pe, const QVariantMap& emitter, const QVariantMap& doubleMap)
+bool NetworkInterfaceWrapper::sendComplexBlob(const QmlPE& pe, const QmlEmitter& emitter, const QVariantMap& doubleMap)
 {
-    try {
-        return m_interface->sendComplexBlob(convertToPE(pe), convertToEmitter(emitter), convertToDoubleMap(doubleMap));
-    } catch (const std::exception& e) {
-        emit error(QString("Failed to send complex blob: %1").arg(e.what()));
-        return false;
-    }
+    PE peValue = pe.pe();
+    Emitter emitterValue = emitter.emitter();
+    std::map<std::string, double> convertedMap = convertToDoubleMap(doubleMap);
+    m_worker->post([this, peValue, emitterValue, convertedMap]() {
+        return m_interface->sendComplexBlob(peValue, emitterValue, convertedMap);
+    }, "Failed to send complex blob");
+    return true;
 }
 
 /*!
@@ -119,19 +286,19 @@ bool NetworkInterfaceWrapper::sendComplexBlob(const QVariantMap& pe, const QVari
     \param setting The setting to update.
     \param id The ID of the PE.
     \param updateVal The new value for the setting.
-    \return True if the setting was sent successfully, false otherwise.
+    \return True if the setting was queued for sending, false otherwise.
 
-    This function sends an update for a specific PE setting.
-    If an error occurs, it emits an error signal with a description.
+    This function queues an update for a specific PE setting on the network thread.
+    If the send fails, it emits an error signal with a description.
 */
 bool NetworkInterfaceWrapper::sendPESetting(const QString& setting, const QString& id, int updateVal)
 {
-    try {
-        return m_interface->sendPESetting(setting.toStdString(), id.toStdString(), updateVal);
-    } catch (const std::exception& e) {
-        emit error(QString("Failed to send PE setting: %1").arg(e.what()));
-        return false;
-    }
+    std::string name = setting.toStdString();
+    std::string entity = id.toStdString();
+    m_worker->post([this, name, entity, updateVal]() {
+        return m_interface->sendPESetting(name, entity, updateVal);
+    }, "Failed to send PE setting");
+    return true;
 }
 
 /*!
@@ -140,19 +307,56 @@ bool NetworkInterfaceWrapper::sendPESetting(const QString& setting, const QStrin
     \param setting The setting to update.
     \param id The ID of the Emitter.
     \param updateVal The new value for the setting.
-    \return True if the setting was sent successfully, false otherwise.
+    \return True if the setting was queued for sending, false otherwise.
 
-    This function sends an update for a specific Emitter setting.
-    If an error occurs, it emits an error signal with a description.
+    This function queues an update for a specific Emitter setting on the network thread.
+    If the send fails, it emits an error signal with a description.
 */
 bool NetworkInterfaceWrapper::sendEmitterSetting(const QString& setting, const QString& id, int updateVal)
 {
-    try {
-        return m_interface->sendEmitterSetting(setting.toStdString(), id.toStdString(), updateVal);
-    } catch (const std::exception& e) {
-        emit error(QString("Failed to send Emitter setting: %1").arg(e.what()));
-        return false;
+    std::string name = setting.toStdString();
+    std::string entity = id.toStdString();
+    m_worker->post([this, name, entity, updateVal]() {
+        return m_interface->sendEmitterSetting(name, entity, updateVal);
+    }, "Failed to send Emitter setting");
+    return true;
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::sendSettingBatch(const QVariantList& settings)
+    \brief Sends many PE and Emitter setting updates in one frame.
+    \param settings The settings, each a list of type (PE_SETTING or
+           EMITTER_SETTING), ID, setting name and value, the form receiveSetting()
+           returns.
+    \return True if the batch was queued for sending, false if any setting is malformed.
+
+    The receiver applies the batch in one step. If any setting is malformed,
+    nothing is queued and an error signal is emitted.
+*/
+bool NetworkInterfaceWrapper::sendSettingBatch(const QVariantList& settings)
+{
+    std::vector<std::tuple<std::string, std::string, std::string, int>> batch;
+    batch.reserve(static_cast<std::size_t>(settings.size()));
+    for (const QVariant& entry : settings) {
+        const QVariantList fields = entry.toList();
+        bool isInt = fields.size() == 4;
+        const int value = isInt ? fields[3].toInt(&isInt) : 0;
+        if (!isInt) {
+            emit error("Failed to send setting batch: each setting must be a [type, id, setting, value] list");
+            return false;
+        }
+        batch.emplace_back(fields[0].toString().toStdString(), fields[1].toString().toStdString(),
+                           fields[2].toString().toStdString(), value);
+        if (!MessageCodec::isValidSetting(batch.back())) {
+            emit error(QString("Failed to send setting batch: malformed setting %1 %2 %3")
+                           .arg(fields[0].toString(), fields[1].toString(), fields[2].toString()));
+            return false;
+        }
     }
+    m_worker->post([this, batch = std::move(batch)]() {
+        return m_interface->sendSettingBatch(batch);
+    }, "Failed to send setting batch");
+    return true;
 }
 
 /*!
@@ -167,7 +371,9 @@ bool NetworkInterfaceWrapper::sendEmitterSetting(const QString& setting, const Q
 QVariantList NetworkInterfaceWrapper::receiveSetting()
 {
     try {
-        auto [type, id, setting, value] = m_interface->receiveSetting();
+        auto received = m_interface->receiveSetting();
+        m_store.applySetting(received);
+        auto [type, id, setting, value] = received;
         return QVariantList{QString::fromStdString(type), QString::fromStdString(id), QString::fromStdString(setting), value};
     } catch (const std::exception& e) {
         emit error(QString("Failed to receive setting: %1").arg(e.what()));
@@ -176,38 +382,67 @@ QVariantList NetworkInterfaceWrapper::receiveSetting()
 }
 
 /*!
-    \fn QVariantMap NetworkInterfaceWrapper::receivePE()
+    \fn QVariantList NetworkInterfaceWrapper::receiveSettingBatch()
+    \brief Receives a batch of setting updates.
+    \return A list of settings, each in the form receiveSetting() returns, or an
+            empty list if an error occurred.
+
+    The whole batch is applied to the entity models before this returns. If an
+    error occurs, or the batch names an unknown entity or empties an Emitter's
+    band, nothing is applied and an error signal is emitted. A rejected batch
+    is still returned.
+*/
+QVariantList NetworkInterfaceWrapper::receiveSettingBatch()
+{
+    try {
+        auto received = m_interface->receiveSettingBatch();
+        if (!m_store.applySettings(received)) {
+            emit error("Rejected a setting batch that does not fit the entity models");
+        }
+        return settingsToVariant(received);
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to receive setting batch: %1").arg(e.what()));
+        return QVariantList();
+    }
+}
+
+/*!
+    \fn QmlPE NetworkInterfaceWrapper::receivePE()
     \brief Receives a Platform Element (PE).
-    \return A QVariantMap representing the received PE, or an empty map if an error occurred.
+    \return The received PE, or an empty PE if an error occurred.
 
-    This function receives a PE and converts it to a QVariantMap.
+    This function receives a PE.
     If an error occurs, it emits an error signal with a description.
 */
-QVariantMap NetworkInterfaceWrapper::receivePE()
+QmlPE NetworkInterfaceWrapper::receivePE()
 {
     try {
-        return convertFromPE(m_interface->receivePE());
+        PE pe = m_interface->receivePE();
+        m_store.applyPE(pe);
+        return QmlPE(pe);
     } catch (const std::exception& e) {
         emit error(QString("Failed to receive PE: %1").arg(e.what()));
-        return QVariantMap();
+        return QmlPE();
     }
 }
 
 /*!
-    \fn QVariantMap NetworkInterfaceWrapper::receiveEmitter()
+    \fn QmlEmitter NetworkInterfaceWrapper::receiveEmitter()
     \brief Receives an Emitter.
-    \return A QVariantMap representing the received Emitter, or an empty map if an error occurred.
+    \return The received Emitter, or an empty Emitter if an error occurred.
 
-    This function receives an Emitter and converts it to a QVariantMap.
+    This function receives an Emitter.
     If an error occurs, it emits an error signal with a description.
 */
-QVariantMap NetworkInterfaceWrapper::receiveEmitter()
+QmlEmitter NetworkInterfaceWrapper::receiveEmitter()
 {
     try {
-        return convertFromEmitter(m_interface->receiveEmitter());
+        Emitter emitter = m_interface->receiveEmitter();
+        m_store.applyEmitter(emitter);
+        return QmlEmitter(emitter);
     } catch (const std::exception& e) {
         emit error(QString("Failed to receive Emitter: %1").arg(e.what()));
-        return QVariantMap();
+        return QmlEmitter();
     }
 }
 
@@ -239,7 +474,7 @@ QVariantList NetworkInterfaceWrapper::receiveBlob()
     \brief Receives a complex blob.
     \return A QVariantList containing the PE, Emitter, and double map components of the complex blob, or an empty list if an error occurred.
 
-    This function receives a complex blob and converts its components to Qt-friendly types.
+    This function receives a complex blob and returns its PE and Emitter as QmlPE and QmlEmitter values.
     If an error occurs, it emits an error signal with a description.
 */
 QVariantList NetworkInterfaceWrapper::receiveComplexBlob()
@@ -250,127 +485,310 @@ QVariantList NetworkInterfaceWrapper::receiveComplexBlob()
         for (const auto& [key, value] : doubleMap) {
             convertedDoubleMap[QString::fromStdString(key)] = value;
         }
-        return QVariantList{convertFromPE(pe), convertFromEmitter(emitter), convertedDoubleMap};
+        return QVariantList{QVariant::fromValue(QmlPE(pe)), QVariant::fromValue(QmlEmitter(emitter)), convertedDoubleMap};
     } catch (const std::exception& e) {
         emit error(QString("Failed to receive complex blob: %1").arg(e.what()));
         return QVariantList();
     }
 }
 
+/*!
+    \fn bool NetworkInterfaceWrapper::receivePEIntoModel()
+    \brief Receives a Platform Element (PE) into the PE model.
+    \return True if a PE was received, false otherwise.
+
+    The PE row is updated in place and announced on the next frame.
+    If an error occurs, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::receivePEIntoModel()
+{
+    try {
+        m_store.applyPE(m_interface->receivePE());
+        return true;
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to receive PE: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::receiveEmitterIntoModel()
+    \brief Receives an Emitter into the Emitter model.
+    \return True if an Emitter was received, false otherwise.
+
+    The Emitter row is updated in place and announced on the next frame.
+    If an error occurs, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::receiveEmitterIntoModel()
+{
+    try {
+        m_store.applyEmitter(m_interface->receiveEmitter());
+        return true;
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to receive Emitter: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::receiveSettingIntoModels()
+    \brief Receives a setting update into the PE or Emitter model.
+    \return True if the setting was applied to a known entity, false otherwise.
+
+    If an error occurs, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::receiveSettingIntoModels()
+{
+    try {
+        return m_store.applySetting(m_interface->receiveSetting());
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to receive setting: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::receiveSnapshotIntoModels()
+    \brief Receives a snapshot of every entity into the models.
+    \return True if a snapshot was received, false otherwise.
+
+    Used once after connecting to a relay to fill the models before live updates.
+    If an error occurs, it emits an error signal with a description.
+*/
+bool NetworkInterfaceWrapper::receiveSnapshotIntoModels()
+{
+    try {
+        m_store.applySnapshot(m_interface->receiveSnapshot());
+        return true;
+    } catch (const std::exception& e) {
+        emit error(QString("Failed to receive snapshot: %1").arg(e.what()));
+        return false;
+    }
+}
+
+/*!
+    \fn void NetworkInterfaceWrapper::commitModelChanges()
+    \brief Publishes the rows changed since the previous frame to the models.
+
+    Each model emits at most one rowsInserted and one dataChanged range per call,
+    however many updates were received in between.
+*/
+void NetworkInterfaceWrapper::commitModelChanges()
+{
+    ANI_TRACE_SPAN("NetworkInterfaceWrapper::commitModelChanges");
+    EntityChangeSet changes = m_store.takeChanges();
+    if (changes.empty()) {
+        return;
+    }
+    m_peModel->commitChanges(changes.pes);
+    m_emitterModel->commitChanges(changes.emitters);
+}
+
+/*!
+    \fn void NetworkInterfaceWrapper::deliverFrame()
+    \brief Delivers everything received on the network thread since the previous frame.
+
+    Called by the frame timer. Updates the entity models, then emits each of
+    pesUpdated, emittersUpdated, settingsReceived, settingBatchesReceived,
+    blobsReceived and complexBlobsReceived at most once, and only if there is
+    something to deliver. Updates are applied to the models in the order they
+    were received, each setting batch whole. Errors from the network thread
+    and failed checkpoint writes are emitted through the error signal.
+*/
+void NetworkInterfaceWrapper::deliverFrame()
+{
+    ANI_TRACE_SPAN("NetworkInterfaceWrapper::deliverFrame");
+    reportCheckpointFailures();
+    ReceivedFrame frame = m_worker->takeReceived();
+    if (frame.empty()) {
+        commitModelChanges();
+        return;
+    }
+    if (frame.connected) {
+        emit connected();
+    }
+    for (const auto& message : frame.errors) {
+        emit error(QString::fromStdString(message));
+    }
+
+    {
+        ANI_TRACE_SPAN("NetworkInterfaceWrapper::applyToStore");
+        // In arrival order, so a setting and a PE or Emitter update for the same entity land as they were sent
+        for (const auto& update : frame.updates) {
+            switch (update.kind) {
+            case ReceivedUpdate::Kind::PE: m_store.applyPE(frame.pes[update.index]); break;
+            case ReceivedUpdate::Kind::Emitter: m_store.applyEmitter(frame.emitters[update.index]); break;
+            case ReceivedUpdate::Kind::Setting: m_store.applySetting(frame.settings[update.index]); break;
+            case ReceivedUpdate::Kind::SettingBatch:
+                if (!m_store.applySettings(frame.settingBatches[update.index])) {
+                    emit error("Rejected a setting batch that does not fit the entity models");
+                }
+                break;
+            }
+        }
+    }
+    commitModelChanges();
+
+    if (!frame.pes.empty()) {
+        ANI_TRACE_SPAN("NetworkInterfaceWrapper::pesToVariants");
+        QVariantList pes;
+        pes.reserve(static_cast<int>(frame.pes.size()));
+        for (const auto& pe : frame.pes) {
+            pes.append(QVariant::fromValue(QmlPE(pe)));
+        }
+        emit pesUpdated(pes);
+    }
+    if (!frame.emitters.empty()) {
+        ANI_TRACE_SPAN("NetworkInterfaceWrapper::emittersToVariants");
+        QVariantList emitters;
+        emitters.reserve(static_cast<int>(frame.emitters.size()));
+        for (const auto& emitter : frame.emitters) {
+            emitters.append(QVariant::fromValue(QmlEmitter(emitter)));
+        }
+        emit emittersUpdated(emitters);
+    }
+    if (!frame.settings.empty()) {
+        ANI_TRACE_SPAN("NetworkInterfaceWrapper::settingsToVariants");
+        QVariantList settings;
+        for (const auto& [type, id, setting, value] : frame.settings) {
+            settings.append(QVariant(QVariantList{QString::fromStdString(type), QString::fromStdString(id),
+                                                  QString::fromStdString(setting), value}));
+        }
+        emit settingsReceived(settings);
+    }
+    if (!frame.settingBatches.empty()) {
+        ANI_TRACE_SPAN("NetworkInterfaceWrapper::settingBatchesToVariants");
+        QVariantList batches;
+        for (const auto& batch : frame.settingBatches) {
+            batches.append(QVariant(settingsToVariant(batch)));
+        }
+        emit settingBatchesReceived(batches);
+    }
+    if (!frame.blobs.empty()) {
+        QVariantList blobs;
+        for (const auto& blob : frame.blobs) {
+            blobs.append(QString::fromStdString(blob));
+        }
+        emit blobsReceived(blobs);
+    }
+    if (!frame.complexBlobs.empty()) {
+        ANI_TRACE_SPAN("NetworkInterfaceWrapper::complexBlobsToVariants");
+        QVariantList complexBlobs;
+        for (const auto& [pe, emitter, doubleMap] : frame.complexBlobs) {
+            QVariantMap convertedDoubleMap;
+            for (const auto& [key, value] : doubleMap) {
+                convertedDoubleMap[QString::fromStdString(key)] = value;
+            }
+            complexBlobs.append(QVariant(QVariantList{QVariant::fromValue(QmlPE(pe)), QVariant::fromValue(QmlEmitter(emitter)),
+                                                      convertedDoubleMap}));
+        }
+        emit complexBlobsReceived(complexBlobs);
+    }
+}
+
 /*!
     \fn void NetworkInterfaceWrapper::close()
     \brief Closes the network connection.
 
-    This function attempts to close the underlying network connection.
+    The close is queued on the network thread after any sends already queued.
     If an error occurs, it emits an error signal with a description.
 */
 void NetworkInterfaceWrapper::close()
 {
-    try {
-        m_interface->close();
-    } catch (const std::exception& e) {
-        emit error(QString("Failed to close connection: %1").arg(e.what()));
+    m_worker->disconnect();
+}
+
+/*!
+    \fn bool NetworkInterfaceWrapper::dumpTrace(const QString& path)
+    \brief Writes the recorded tracing spans as Chrome trace JSON.
+    \param path The file to write, which can be opened in chrome://tracing or ui.perfetto.dev.
+    \return True if the file was written.
+
+    The trace holds no spans unless the library was built with ENABLE_TRACING.
+*/
+bool NetworkInterfaceWrapper::dumpTrace(const QString& path)
+{
+    if (!Tracing::dump(path.toStdString())) {
+        emit error(QString("Failed to write trace to %1").arg(path));
+        return false;
     }
+    return true;
 }
 
-// Helper functions - private methods
+/*!
+    \fn bool NetworkInterfaceWrapper::saveCheckpoint(const QString& path)
+    \brief Saves the current PE and Emitter picture to a checkpoint file.
+    \param path The checkpoint file, replaced atomically.
+    \return True once the picture is queued for writing.
+
+    The picture is captured here, which only copies the store's columns, and
+    is encoded, synced and renamed into place by a CheckpointWriter thread, so
+    the GUI thread never waits on the disk. A failed write is reported through
+    the error signal on a later frame. Saves to the path in use are written
+    in order, skipping any superseded before its write started. Saving to
+    another path first finishes the pending write to the previous one.
+*/
+bool NetworkInterfaceWrapper::saveCheckpoint(const QString& path)
+{
+    const std::string file = path.toStdString();
+    if (!m_checkpointWriter || m_checkpointWriter->filePath() != file) {
+        if (m_checkpointWriter) {
+            m_checkpointWriter->stop();
+            reportCheckpointFailures();
+        }
+        m_checkpointWriter = std::make_unique<CheckpointWriter>(file);
+        m_checkpointFailures = 0;
+        m_checkpointWriter->start();
+    }
+    m_checkpointWriter->post(EntityCheckpoint::capture(m_store));
+    return true;
+}
 
-PE NetworkInterfaceWrapper::convertToPE(const QVariantMap& map)
-{
-    PE pe(
-        map["id"].toString(),
-        map["type"].toString(),
-        map["lat"].toDouble(),
-        map["lon"].toDouble(),
-        map["altitude"].toDouble(),
-        map["speed"].toDouble(),
-        map["apd"].toString(),
-        map["priority"].toString(),
-        map["jam"].toBool(),
-        map["ghost"].toBool()
-    );
-    pe.heading = map["heading"].toDouble();
-    pe.category = static_cast<PE::PECategory>(map["category"].toInt());
-    pe.state = map["state"].toString();
-    return pe;
-}
-
-Emitter NetworkInterfaceWrapper::convertToEmitter(const QVariantMap& map)
-{
-    Emitter emitter(
-        map["id"].toString(),
-        map["type"].toString(),
-        map["category"].toString(),
-        map["lat"].toDouble(),
-        map["lon"].toDouble(),
-        map["freqMin"].toDouble(),
-        map["freqMax"].toDouble(),
-        map["active"].toBool(),
-        map["eaPriority"].toString(),
-        map["esPriority"].toString(),
-        map["jamResponsible"].toBool(),
-        map["reactiveEligible"].toBool(),
-        map["preemptiveEligible"].toBool(),
-        map["consentRequired"].toBool(),
-        map["jam"].toBool()
-    );
-    emitter.altitude = map["altitude"].toDouble();
-    emitter.heading = map["heading"].toDouble();
-    emitter.speed = map["speed"].toDouble();
-    emitter.operatorManaged = map["operatorManaged"].toBool();
-    emitter.jamIneffective = map["jamIneffective"].toInt();
-    emitter.jamEffective = map["jamEffective"].toInt();
-    return emitter;
-}
-
-QVariantMap NetworkInterfaceWrapper::convertFromPE(const PE& pe)
-{
-    return QVariantMap{
-        {"id", pe.id},
-        {"type", pe.type},
-        {"lat", pe.lat},
-        {"lon", pe.lon},
-        {"altitude", pe.altitude},
-        {"speed", pe.speed},
-        {"heading", pe.heading},
-        {"apd", pe.apd},
-        {"priority", pe.priority},
-        {"jam", pe.jam},
-        {"ghost", pe.ghost},
-        {"category", static_cast<int>(pe.category)},
-        {"state", pe.state}
-    };
-}
-
-QVariantMap NetworkInterfaceWrapper::convertFromEmitter(const Emitter& emitter)
-{
-    return QVariantMap{
-        {"id", emitter.id},
-        {"type", emitter.type},
-        {"category", emitter.category},
-        {"lat", emitter.lat},
-        {"lon", emitter.lon},
-        {"altitude", emitter.altitude},
-        {"heading", emitter.heading},
-        {"speed", emitter.speed},
-        {"freqMin", emitter.freqMin},
-        {"freqMax", emitter.freqMax},
-        {"active", emitter.active},
-        {"eaPriority", emitter.eaPriority},
-        {"esPriority", emitter.esPriority},
-        {"jamResponsible", emitter.jamResponsible},
-        {"reactiveEligible", emitter.reactiveEligible},
-        {"preemptiveEligible", emitter.preemptiveEligible},
-        {"consentRequired", emitter.consentRequired},
-        {"operatorManaged", emitter.operatorManaged},
-        {"jam", emitter.jam},
-        {"jamIneffective", emitter.jamIneffective},
-        {"jamEffective", emitter.jamEffective}
-    };
+/*!
+    \fn void NetworkInterfaceWrapper::reportCheckpointFailures()
+    \brief Emits an error for each checkpoint write that has failed since the last call.
+*/
+void NetworkInterfaceWrapper::reportCheckpointFailures()
+{
+    if (!m_checkpointWriter) {
+        return;
+    }
+    const std::uint64_t failures = m_checkpointWriter->failedCount();
+    for (; m_checkpointFailures < failures; ++m_checkpointFailures) {
+        emit error(QString("Failed to write checkpoint to %1").arg(QString::fromStdString(m_checkpointWriter->filePath())));
+    }
 }
 
+/*!
+    \fn bool NetworkInterfaceWrapper::loadCheckpoint(const QString& path)
+    \brief Fills the entity models from a checkpoint file.
+    \param path A checkpoint written by saveCheckpoint() or by the relay.
+    \return True if the checkpoint was loaded.
+
+    Only allowed before any entity has been received, so the models never see
+    rows renumbered. The loaded rows are published straight away and live
+    updates then apply on top of them.
+*/
+bool NetworkInterfaceWrapper::loadCheckpoint(const QString& path)
+{
+    if (m_store.pes().size() > 0 || m_store.emitters().size() > 0) {
+        emit error("A checkpoint can only be loaded before any entity is received");
+        return false;
+    }
+    std::uint64_t sequence = 0;
+    if (!EntityCheckpoint::load(path.toStdString(), m_store, sequence)) {
+        emit error(QString("Failed to load checkpoint from %1").arg(path));
+        return false;
+    }
+    commitModelChanges();
+    return true;
+}
+
+// Helper functions - private methods
+
 std::map<std::string, double> NetworkInterfaceWrapper::convertToDoubleMap(const QVariantMap& map)
 {
+    ANI_TRACE_SPAN("NetworkInterfaceWrapper::convertToDoubleMap");
     std::map<std::string, double> result;
     for (auto it = map.begin(); it != map.end(); ++it) {
         result[it.key().toStdString()] = it.value().toDouble();
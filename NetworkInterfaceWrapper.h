@@ -3,42 +3,102 @@
 
 #include <QObject>
 #include <QString>
+#include <QTimer>
 #include <QVariant>
+#include <memory>
 #include "AbstractNetworkInterface.h"
+#include "EntityCheckpoint.h"
+#include "EntityModels.h"
+#include "EntityStore.h"
+#include "NetworkWorker.h"
+#include "QmlEntities.h"
 
 class NetworkInterfaceWrapper : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(PEListModel* peModel READ peModel CONSTANT)
+    Q_PROPERTY(EmitterListModel* emitterModel READ emitterModel CONSTANT)
+    Q_PROPERTY(bool receiveContinuously READ receiveContinuously WRITE setReceiveContinuously NOTIFY receiveContinuouslyChanged)
 
 public:
     explicit NetworkInterfaceWrapper(AbstractNetworkInterface* interface, QObject *parent = nullptr);
+    ~NetworkInterfaceWrapper() override;
+    PEListModel* peModel() const { return m_peModel; }
+    EmitterListModel* emitterModel() const { return m_emitterModel; }
+    bool receiveContinuously() const { return m_receiveContinuously; }
+    void setReceiveContinuously(bool receive);
+    // Empty values for QML to fill in before sending
+    Q_INVOKABLE QmlPE createPE() const;
+    Q_INVOKABLE QmlEmitter createEmitter() const;
+    // Up to count of the newest positions received for an entity, oldest first, as maps with lat, lon,
+    // altitude, speed, heading and ageMs keys
+    Q_INVOKABLE QVariantList peTrail(const QString& id, int count) const;
+    Q_INVOKABLE QVariantList emitterTrail(const QString& id, int count) const;
+    // Position offsetMs from now, negative for the past, or an empty map if it is outside the history
+    Q_INVOKABLE QVariantMap pePositionAt(const QString& id, int offsetMs) const;
+    Q_INVOKABLE QVariantMap emitterPositionAt(const QString& id, int offsetMs) const;
 
 public slots:
     void initialise(const QString& address, unsigned short port);
-    bool sendPE(const QVariantMap& pe);
-    bool sendEmitter(const QVariantMap& emitter);
+    bool sendPE(const QmlPE& pe);
+    bool sendEmitter(const QmlEmitter& emitter);
     bool sendBlob(const QString& blobString);
-    bool sendComplexBlob(const QVariantMap& pe, const QVariantMap& emitter, const QVariantMap& doubleMap);
+    bool sendComplexBlob(const QmlPE& pe, const QmlEmitter& emitter, const QVariantMap& doubleMap);
     bool sendPESetting(const QString& setting, const QString& id, int updateVal);
     bool sendEmitterSetting(const QString& setting, const QString& id, int updateVal);
+    // Send many settings in one frame, each a [type, id, setting, value] list as receiveSetting() returns
+    bool sendSettingBatch(const QVariantList& settings);
     QVariantList receiveSetting();
-    QVariantMap receivePE();
-    QVariantMap receiveEmitter();
+    QVariantList receiveSettingBatch();
+    QmlPE receivePE();
+    QmlEmitter receiveEmitter();
     QVariantList receiveBlob();
     QVariantList receiveComplexBlob();
+    // Receive straight into the entity models
+    bool receivePEIntoModel();
+    bool receiveEmitterIntoModel();
+    bool receiveSettingIntoModels();
+    bool receiveSnapshotIntoModels();
+    // Publish the model rows changed since the last frame
+    void commitModelChanges();
+    // Deliver everything the network thread received since the last frame, called by the frame timer
+    void deliverFrame();
     void close();
+    // Write the tracing spans recorded so far to a Chrome trace JSON file
+    bool dumpTrace(const QString& path);
+    // Save the entity picture, or fill the empty models from a saved one at start-up
+    bool saveCheckpoint(const QString& path);
+    bool loadCheckpoint(const QString& path);
 
 signals:
     void error(const QString& message);
+    void connected();
+    void receiveContinuouslyChanged();
+    // Emitted at most once per frame, with the latest QmlPE or QmlEmitter for each entity updated in that frame
+    void pesUpdated(const QVariantList& pes);
+    void emittersUpdated(const QVariantList& emitters);
+    // Emitted at most once per frame, with every event received in that frame in arrival order
+    void settingsReceived(const QVariantList& settings);
+    // Emitted at most once per frame, with every setting batch received in that frame, each a list of settings
+    void settingBatchesReceived(const QVariantList& batches);
+    void blobsReceived(const QVariantList& blobs);
+    void complexBlobsReceived(const QVariantList& complexBlobs);
 
 private:
     AbstractNetworkInterface* m_interface;
+    EntityStore m_store;
+    PEListModel* m_peModel;
+    EmitterListModel* m_emitterModel;
+    QTimer* m_frameTimer;
+    bool m_receiveContinuously = true;
+    // Writes saved checkpoints off the GUI thread, replaced when saveCheckpoint() is given another path
+    std::unique_ptr<CheckpointWriter> m_checkpointWriter;
+    std::uint64_t m_checkpointFailures = 0;
+    // Declared last so its threads are joined before anything they use is destroyed
+    std::unique_ptr<NetworkWorker> m_worker;
 
-    PE convertToPE(const QVariantMap& map);
-    Emitter convertToEmitter(const QVariantMap& map);
-    QVariantMap convertFromPE(const PE& pe);
-    QVariantMap convertFromEmitter(const Emitter& emitter);
     std::map<std::string, double> convertToDoubleMap(const QVariantMap& map);
+    void reportCheckpointFailures();
 };
 
 #endif // NETWORKINTERFACEWRAPPER_H
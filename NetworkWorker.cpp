@@ -0,0 +1,323 @@
+#include "NetworkWorker.h"
+#include "Metrics.h"
+#include "Tracing.h"
+#include <boost/system/system_error.hpp>
+
+namespace {
+// How long the send queue stays idle before updates deferred by update scheduling are flushed
+constexpr std::chrono::milliseconds kDeferredFlushInterval{100};
+}
+
+/*!
+    \class NetworkWorker
+    \brief Moves blocking network I/O off the calling thread.
+
+    Sends are queued and written in order by a dedicated send thread, so callers
+    return immediately. A second thread receives continuously with
+    receiveMessage() and collects the results into a ReceivedFrame. PE and
+    Emitter updates are coalesced to the latest state per id, so a consumer that
+    calls takeReceived() once per display frame handles each entity at most once
+    per frame, however fast the updates arrive. Coalescing never reorders an
+    update across a setting for the same entity: an update received after such
+    a setting starts a new entry, and ReceivedFrame::updates lists every entry
+    in arrival order. Every update is also recorded in a TrackHistory as it
+    arrives, so trails keep the samples that coalescing drops.
+
+    Errors from either thread are collected with the received data rather than
+    thrown, so the consumer reports them on its own thread.
+
+    While no sends are queued the send thread calls
+    AbstractNetworkInterface::flushDeferredUpdates() every
+    kDeferredFlushInterval, so an entity that stops updating still has its
+    latest state written once the link allows.
+*/
+
+/*!
+    \fn NetworkWorker::NetworkWorker(AbstractNetworkInterface* interface, const TrackHistoryConfig& tracks)
+    \brief Starts the send and receive threads for an interface.
+    \param interface The interface to run, which must outlive the worker.
+    \param tracks Size of the PE and Emitter track histories, a maxEntities of 0 records no tracks.
+
+    The receive thread is only started by the first connect() that asks to
+    receive, so a worker that only sends, such as a QueuedSubscriber's, runs
+    one thread.
+*/
+NetworkWorker::NetworkWorker(AbstractNetworkInterface* interface, const TrackHistoryConfig& tracks)
+    : interface(interface),
+      recordTracks(tracks.maxEntities > 0),
+      peHistory(tracks),
+      emitterHistory(tracks),
+      sendThread(&NetworkWorker::sendLoop, this) {}
+
+/*!
+    \fn NetworkWorker::~NetworkWorker()
+    \brief Stops and joins both threads.
+*/
+NetworkWorker::~NetworkWorker() {
+    stop();
+}
+
+/*!
+    \fn void NetworkWorker::connect(const std::string& address, unsigned short port, bool receive)
+    \brief Queues a connect on the send thread.
+    \param address The IP address to connect to.
+    \param port The port number to connect to.
+    \param receive True to start receiving continuously once connected.
+*/
+void NetworkWorker::connect(const std::string& address, unsigned short port, bool receive) {
+    std::lock_guard<std::mutex> lock(sendQueueMutex);
+    sendQueue.push_back([this, address, port, receive]() {
+        try {
+            interface->initialise(address, port);
+        } catch (const std::exception& e) {
+            reportError("Failed to initialize: " + std::string(e.what()));
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> receivedLock(receivedMutex);
+            received.connected = true;
+        }
+        if (receive) {
+            std::lock_guard<std::mutex> stateLock(stateMutex);
+            receiving = true;
+            // stop() joins the send thread before it looks at the receive thread
+            if (!receiveThread.joinable()) {
+                receiveThread = std::thread(&NetworkWorker::receiveLoop, this);
+            }
+            receiveReady.notify_one();
+        }
+    });
+    Metrics::adjust(MetricGauge::QueuedSends, 1);
+    sendReady.notify_one();
+}
+
+/*!
+    \fn void NetworkWorker::post(std::function<bool()> send, const std::string& failure)
+    \brief Queues a send on the send thread.
+    \param send The send to run, returning false on failure.
+    \param failure The error message reported if the send fails.
+*/
+void NetworkWorker::post(std::function<bool()> send, const std::string& failure) {
+    std::lock_guard<std::mutex> lock(sendQueueMutex);
+    sendQueue.push_back([this, send = std::move(send), failure]() {
+        try {
+            if (!send()) {
+                reportError(failure);
+            }
+        } catch (const std::exception& e) {
+            reportError(failure + ": " + e.what());
+        }
+    });
+    Metrics::adjust(MetricGauge::QueuedSends, 1);
+    sendReady.notify_one();
+}
+
+/*!
+    \fn void NetworkWorker::disconnect()
+    \brief Queues a close on the send thread, after any sends already queued.
+*/
+void NetworkWorker::disconnect() {
+    std::lock_guard<std::mutex> lock(sendQueueMutex);
+    sendQueue.push_back([this]() {
+        {
+            std::lock_guard<std::mutex> stateLock(stateMutex);
+            receiving = false;
+        }
+        try {
+            interface->close();
+        } catch (const std::exception& e) {
+            reportError("Failed to close connection: " + std::string(e.what()));
+        }
+    });
+    Metrics::adjust(MetricGauge::QueuedSends, 1);
+    sendReady.notify_one();
+}
+
+/*!
+    \fn ReceivedFrame NetworkWorker::takeReceived()
+    \brief Takes everything received since the previous call.
+    \return The coalesced updates, events and errors, empty if nothing arrived.
+*/
+ReceivedFrame NetworkWorker::takeReceived() {
+    std::lock_guard<std::mutex> lock(receivedMutex);
+    ReceivedFrame frame = std::move(received);
+    received = ReceivedFrame();
+    peSlots.clear();
+    emitterSlots.clear();
+    return frame;
+}
+
+/*!
+    \fn std::size_t NetworkWorker::pendingSends() const
+    \brief Returns the number of queued operations not yet started.
+*/
+std::size_t NetworkWorker::pendingSends() const {
+    std::lock_guard<std::mutex> lock(sendQueueMutex);
+    return sendQueue.size();
+}
+
+/*!
+    \fn void NetworkWorker::stop()
+    \brief Closes the interface and joins both threads.
+
+    Sends still queued are discarded. Safe to call more than once.
+*/
+void NetworkWorker::stop() {
+    {
+        std::lock_guard<std::mutex> stateLock(stateMutex);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+        receiving = false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sendQueueMutex);
+        Metrics::adjust(MetricGauge::QueuedSends, -static_cast<std::int64_t>(sendQueue.size()));
+        sendQueue.clear();
+    }
+    sendReady.notify_one();
+    receiveReady.notify_one();
+    // Wakes a receive blocked in the socket read
+    try {
+        interface->close();
+    } catch (const std::exception&) {
+    }
+    if (sendThread.joinable()) {
+        sendThread.join();
+    }
+    if (receiveThread.joinable()) {
+        receiveThread.join();
+    }
+}
+
+void NetworkWorker::sendLoop() {
+    ANI_TRACE_THREAD_NAME("NetworkWorker send");
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(sendQueueMutex);
+            const bool woken = sendReady.wait_for(lock, kDeferredFlushInterval, [this]() {
+                std::lock_guard<std::mutex> stateLock(stateMutex);
+                return stopping || !sendQueue.empty();
+            });
+            if (!woken) {
+                lock.unlock();
+                flushDeferred();
+                continue;
+            }
+            if (sendQueue.empty()) {
+                return;
+            }
+            job = std::move(sendQueue.front());
+            sendQueue.pop_front();
+        }
+        Metrics::adjust(MetricGauge::QueuedSends, -1);
+        job();
+    }
+}
+
+void NetworkWorker::flushDeferred() {
+    try {
+        if (!interface->flushDeferredUpdates()) {
+            reportError("Failed to send deferred updates");
+        }
+    } catch (const std::exception& e) {
+        reportError("Failed to send deferred updates: " + std::string(e.what()));
+    }
+}
+
+void NetworkWorker::receiveLoop() {
+    ANI_TRACE_THREAD_NAME("NetworkWorker receive");
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            receiveReady.wait(lock, [this]() { return stopping || receiving; });
+            if (stopping) {
+                return;
+            }
+        }
+        try {
+            collect(interface->receiveMessage());
+        } catch (const boost::system::system_error& e) {
+            // The connection is gone, wait for the next connect unless it was closed on purpose
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (receiving && !stopping) {
+                receiving = false;
+                reportError("Connection lost: " + std::string(e.what()));
+            }
+        } catch (const std::exception& e) {
+            // A malformed frame has been consumed, carry on with the next one
+            reportError("Failed to receive message: " + std::string(e.what()));
+        }
+    }
+}
+
+void NetworkWorker::collect(NetworkMessage&& message) {
+    if (recordTracks && message.kind != NetworkMessage::Kind::ComplexBlob) {
+        const DeadReckoning::Clock::time_point now = DeadReckoning::Clock::now();
+        for (const auto& pe : message.pes) {
+            peHistory.record(pe, now);
+        }
+        for (const auto& emitter : message.emitters) {
+            emitterHistory.record(emitter, now);
+        }
+    }
+    std::lock_guard<std::mutex> lock(receivedMutex);
+    switch (message.kind) {
+    case NetworkMessage::Kind::Setting:
+        settingReceived(message.setting);
+        received.updates.push_back({ReceivedUpdate::Kind::Setting, received.settings.size()});
+        received.settings.push_back(message.setting);
+        return;
+    case NetworkMessage::Kind::SettingBatch:
+        for (const auto& setting : message.settings) {
+            settingReceived(setting);
+        }
+        received.updates.push_back({ReceivedUpdate::Kind::SettingBatch, received.settingBatches.size()});
+        received.settingBatches.push_back(std::move(message.settings));
+        return;
+    case NetworkMessage::Kind::Blob:
+        received.blobs.push_back(std::move(message.blob));
+        return;
+    case NetworkMessage::Kind::ComplexBlob:
+        received.complexBlobs.emplace_back(message.pes.front(), message.emitters.front(), std::move(message.doubleMap));
+        return;
+    default:
+        break;
+    }
+    for (auto& pe : message.pes) {
+        auto slot = peSlots.constFind(pe.id);
+        if (slot != peSlots.constEnd()) {
+            received.pes[slot.value()] = std::move(pe);
+        } else {
+            peSlots.insert(pe.id, received.pes.size());
+            received.updates.push_back({ReceivedUpdate::Kind::PE, received.pes.size()});
+            received.pes.push_back(std::move(pe));
+        }
+    }
+    for (auto& emitter : message.emitters) {
+        auto slot = emitterSlots.constFind(emitter.id);
+        if (slot != emitterSlots.constEnd()) {
+            received.emitters[slot.value()] = std::move(emitter);
+        } else {
+            emitterSlots.insert(emitter.id, received.emitters.size());
+            received.updates.push_back({ReceivedUpdate::Kind::Emitter, received.emitters.size()});
+            received.emitters.push_back(std::move(emitter));
+        }
+    }
+}
+
+void NetworkWorker::settingReceived(const std::tuple<std::string, std::string, std::string, int>& setting) {
+    const QString id = QString::fromStdString(std::get<1>(setting));
+    if (std::get<0>(setting) == "PE_SETTING") {
+        peSlots.remove(id);
+    } else {
+        emitterSlots.remove(id);
+    }
+}
+
+void NetworkWorker::reportError(const std::string& error) {
+    std::lock_guard<std::mutex> lock(receivedMutex);
+    received.errors.push_back(error);
+}
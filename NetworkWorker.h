@@ -0,0 +1,106 @@
+#ifndef NETWORKWORKER_H
+#define NETWORKWORKER_H
+
+#include <QHash>
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+#include "TrackHistory.h"
+
+// One PE, Emitter, setting or setting batch in a ReceivedFrame, index points into the vector of its kind
+struct ReceivedUpdate {
+    enum class Kind { PE, Emitter, Setting, SettingBatch };
+    Kind kind;
+    std::size_t index;
+};
+
+// Everything received since the previous NetworkWorker::takeReceived
+struct ReceivedFrame {
+    // Latest state per id, snapshots are merged in here. An update is only merged into an earlier
+    // one for the same id if no setting for that id arrived in between, so an id can appear twice.
+    std::vector<PE> pes;
+    std::vector<Emitter> emitters;
+    // Events are kept in arrival order and not coalesced
+    std::vector<std::tuple<std::string, std::string, std::string, int>> settings;
+    // Setting batches, each kept whole so it can be applied in one step
+    std::vector<std::vector<std::tuple<std::string, std::string, std::string, int>>> settingBatches;
+    // Every entry of the four vectors above in arrival order, a merged update keeps its first position.
+    // Applying them in this order leaves each entity as receiveMessage() left it.
+    std::vector<ReceivedUpdate> updates;
+    std::vector<std::string> blobs;
+    std::vector<std::tuple<PE, Emitter, std::map<std::string, double>>> complexBlobs;
+    std::vector<std::string> errors;
+    // True if a connection was established since the previous take
+    bool connected = false;
+    bool empty() const {
+        return pes.empty() && emitters.empty() && settings.empty() && settingBatches.empty() && blobs.empty()
+               && complexBlobs.empty() && errors.empty() && !connected;
+    }
+};
+
+// Runs all I/O on an AbstractNetworkInterface off the calling thread: one thread
+// writes queued sends in order, another receives continuously into a ReceivedFrame
+class NetworkWorker {
+public:
+    explicit NetworkWorker(AbstractNetworkInterface* interface, const TrackHistoryConfig& tracks = TrackHistoryConfig());
+    ~NetworkWorker();
+    NetworkWorker(const NetworkWorker&) = delete;
+    NetworkWorker& operator=(const NetworkWorker&) = delete;
+    // Queue a connect, once connected the receive thread starts if receive is true
+    void connect(const std::string& address, unsigned short port, bool receive = true);
+    // Queue a send, a false return or exception is reported as an error prefixed with failure
+    void post(std::function<bool()> send, const std::string& failure);
+    // Queue a close, the receive thread stops without reporting an error
+    void disconnect();
+    // Everything received since the previous call
+    ReceivedFrame takeReceived();
+    // Every PE and Emitter update received, stamped with its arrival time, before coalescing
+    const TrackHistory& peTracks() const { return peHistory; }
+    const TrackHistory& emitterTracks() const { return emitterHistory; }
+    // Number of sends queued but not yet written
+    std::size_t pendingSends() const;
+    // Close the interface and join both threads, called by the destructor
+    void stop();
+
+private:
+    void sendLoop();
+    void receiveLoop();
+    void flushDeferred();
+    void collect(NetworkMessage&& message);
+    // A later PE or Emitter update for id must not be merged into one received before this setting
+    void settingReceived(const std::tuple<std::string, std::string, std::string, int>& setting);
+    void reportError(const std::string& error);
+
+    AbstractNetworkInterface* interface;
+
+    mutable std::mutex sendQueueMutex;
+    std::condition_variable sendReady;
+    std::deque<std::function<void()>> sendQueue;
+
+    std::mutex stateMutex;
+    std::condition_variable receiveReady;
+    bool receiving = false;
+    bool stopping = false;
+
+    std::mutex receivedMutex;
+    ReceivedFrame received;
+    QHash<QString, std::size_t> peSlots;
+    QHash<QString, std::size_t> emitterSlots;
+    // False when the histories are configured with no entities, so nothing takes their locks
+    const bool recordTracks;
+    TrackHistory peHistory;
+    TrackHistory emitterHistory;
+
+    std::thread sendThread;
+    std::thread receiveThread;
+};
+
+#endif // NETWORKWORKER_H
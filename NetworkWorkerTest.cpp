@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "NetworkWorker.h"
+#include <thread>
+#include <chrono>
+#include <iostream>
+
+class NetworkWorkerTest : public ::testing::Test {
+protected:
+    std::unique_ptr<NetworkImplementation> server;
+    std::unique_ptr<NetworkImplementation> client;
+    std::unique_ptr<NetworkWorker> worker;
+
+    void SetUp() override {
+        server = std::make_unique<NetworkImplementation>();
+        client = std::make_unique<NetworkImplementation>();
+        worker = std::make_unique<NetworkWorker>(client.get());
+
+        std::thread serverThread([this]() {
+            try {
+                boost::asio::io_context io_context;
+                boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 3527));
+                acceptor.accept(*(server->getSocket()));
+            } catch (const std::exception& e) {
+                std::cerr << "Server thread exception: " << e.what() << std::endl;
+            }
+        });
+
+        // Give the server a moment to start
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        worker->connect("127.0.0.1", 3527);
+        serverThread.join();
+    }
+
+    void TearDown() override {
+        worker->stop();
+        server->close();
+    }
+
+    // Collect received frames until the predicate holds or a second has passed
+    template <typename Predicate>
+    ReceivedFrame receiveUntil(Predicate done) {
+        ReceivedFrame all;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (!done(all) && std::chrono::steady_clock::now() < deadline) {
+            ReceivedFrame frame = worker->takeReceived();
+            all.connected = all.connected || frame.connected;
+            all.pes.insert(all.pes.end(), frame.pes.begin(), frame.pes.end());
+            all.settings.insert(all.settings.end(), frame.settings.begin(), frame.settings.end());
+            all.errors.insert(all.errors.end(), frame.errors.begin(), frame.errors.end());
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return all;
+    }
+};
+
+TEST_F(NetworkWorkerTest, UpdatesWithinAFrameAreCoalescedPerId) {
+    ASSERT_TRUE(receiveUntil([](const ReceivedFrame& frame) { return frame.connected; }).connected);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(server->sendPE(PE("Coalesced", "F18", 10.0 + i, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false)));
+    }
+    ASSERT_TRUE(server->sendPESetting("JAM", "Coalesced", 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Everything arrives before the next take
+
+    ReceivedFrame frame = worker->takeReceived();
+    ASSERT_EQ(frame.pes.size(), 1u);
+    EXPECT_DOUBLE_EQ(frame.pes[0].lat, 19.0);
+    ASSERT_EQ(frame.settings.size(), 1u);
+    EXPECT_TRUE(frame.errors.empty());
+}
+
+TEST_F(NetworkWorkerTest, UpdatesAreNotCoalescedAcrossASettingForTheSameId) {
+    ASSERT_TRUE(receiveUntil([](const ReceivedFrame& frame) { return frame.connected; }).connected);
+    ASSERT_TRUE(server->sendPE(PE("Jammer", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false)));
+    ASSERT_TRUE(server->sendPE(PE("Other", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false)));
+    ASSERT_TRUE(server->sendPESetting("JAM", "Jammer", 0));
+    ASSERT_TRUE(server->sendPE(PE("Jammer", "F18", 11.0, 20.0, 30000.0, 500.0, "MED", "HIGH", true, false)));
+    ASSERT_TRUE(server->sendPE(PE("Other", "F18", 11.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // Everything arrives before the next take
+
+    ReceivedFrame frame = worker->takeReceived();
+    ASSERT_EQ(frame.pes.size(), 3u);
+    ASSERT_EQ(frame.updates.size(), 4u);
+    EXPECT_EQ(frame.updates[0].kind, ReceivedUpdate::Kind::PE);
+    EXPECT_EQ(frame.pes[frame.updates[0].index].id, "Jammer");
+    EXPECT_FALSE(frame.pes[frame.updates[0].index].jam);
+    // Other has no setting in between, so its second update is merged into the first
+    EXPECT_EQ(frame.pes[frame.updates[1].index].id, "Other");
+    EXPECT_DOUBLE_EQ(frame.pes[frame.updates[1].index].lat, 11.0);
+    EXPECT_EQ(frame.updates[2].kind, ReceivedUpdate::Kind::Setting);
+    // The newer Jammer state comes after the setting, so applying in order leaves it jamming
+    EXPECT_EQ(frame.updates[3].kind, ReceivedUpdate::Kind::PE);
+    EXPECT_EQ(frame.pes[frame.updates[3].index].id, "Jammer");
+    EXPECT_TRUE(frame.pes[frame.updates[3].index].jam);
+}
+
+TEST_F(NetworkWorkerTest, CoalescedUpdatesStayInTheTrackHistory) {
+    ASSERT_TRUE(receiveUntil([](const ReceivedFrame& frame) { return frame.connected; }).connected);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(server->sendPE(PE("Tracked", "F18", 10.0 + i, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false)));
+    }
+    ReceivedFrame frame = receiveUntil([](const ReceivedFrame& all) {
+        return !all.pes.empty() && all.pes.back().lat == 19.0;
+    });
+    ASSERT_FALSE(frame.pes.empty());
+
+    TrackSample trail[10];
+    ASSERT_EQ(worker->peTracks().last("Tracked", 10, trail), 10u);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_DOUBLE_EQ(trail[i].lat, 10.0 + i);
+    }
+    EXPECT_EQ(worker->emitterTracks().entityCount(), 0u);
+}
+
+TEST_F(NetworkWorkerTest, SendsAreWrittenInOrderOffTheCallingThread) {
+    for (int i = 0; i < 5; ++i) {
+        std::string id = "Queued" + std::to_string(i);
+        PE pe(id.c_str(), "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+        worker->post([this, pe]() { return client->sendPE(pe); }, "Failed to send PE");
+    }
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(server->receivePE().id, QString::fromStdString("Queued" + std::to_string(i)));
+    }
+}
+
+TEST_F(NetworkWorkerTest, FailedSendsAreReportedAsErrors) {
+    PE invalid("", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+    worker->post([this, invalid]() { return client->sendPE(invalid); }, "Failed to send PE");
+    ReceivedFrame frame = receiveUntil([](const ReceivedFrame& all) { return !all.errors.empty(); });
+    ASSERT_EQ(frame.errors.size(), 1u);
+    EXPECT_EQ(frame.errors[0], "Failed to send PE");
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,68 @@
+#include "QmlEntities.h"
+
+/*!
+    \class QmlPE
+    \brief Exposes a PE to QML as a value type.
+
+    Each PE field is a Q_PROPERTY, so QML reads it through the meta-object by
+    property index instead of hashing a string key into a QVariantMap. The PE
+    itself is held by value and handed back unchanged by pe(), so passing a
+    QmlPE between the wrapper and QML costs one copy and no conversion.
+*/
+
+/*!
+    \fn QmlPE::QmlPE()
+    \brief Constructs an empty PE, for QML to fill in before sending.
+*/
+QmlPE::QmlPE()
+    : m_pe(QString(), QString(), 0.0, 0.0, 0.0, 0.0, QString(), QString(), false, false)
+{
+}
+
+/*!
+    \fn QmlPE::QmlPE(const PE& pe)
+    \brief Wraps a copy of a PE.
+*/
+QmlPE::QmlPE(const PE& pe)
+    : m_pe(pe)
+{
+}
+
+/*!
+    \class QmlEmitter
+    \brief Exposes an Emitter to QML as a value type.
+
+    Each Emitter field is a Q_PROPERTY, so QML reads it through the meta-object
+    by property index instead of hashing a string key into a QVariantMap.
+*/
+
+/*!
+    \fn QmlEmitter::QmlEmitter()
+    \brief Constructs an empty Emitter, for QML to fill in before sending.
+*/
+QmlEmitter::QmlEmitter()
+    : m_emitter(QString(), QString(), QString(), 0.0, 0.0, 0.0, 0.0)
+{
+}
+
+/*!
+    \fn QmlEmitter::QmlEmitter(const Emitter& emitter)
+    \brief Wraps a copy of an Emitter.
+*/
+QmlEmitter::QmlEmitter(const Emitter& emitter)
+    : m_emitter(emitter)
+{
+}
+
+/*!
+    \fn void registerQmlEntityTypes()
+    \brief Registers QmlPE and QmlEmitter with the meta-type system.
+
+    Needed before the types are passed through queued connections or read from
+    a QVariant in QML. Safe to call more than once.
+*/
+void registerQmlEntityTypes()
+{
+    qRegisterMetaType<QmlPE>("QmlPE");
+    qRegisterMetaType<QmlEmitter>("QmlEmitter");
+}
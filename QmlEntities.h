@@ -0,0 +1,147 @@
+#ifndef QMLENTITIES_H
+#define QMLENTITIES_H
+
+#include <QMetaType>
+#include <QString>
+#include "pe.h"
+#include "emitter.h"
+
+// PE as a QML value type, each field is a property read by index rather than a map key
+class QmlPE
+{
+    Q_GADGET
+    Q_PROPERTY(QString id READ id WRITE setId)
+    Q_PROPERTY(QString type READ type WRITE setType)
+    Q_PROPERTY(double lat READ lat WRITE setLat)
+    Q_PROPERTY(double lon READ lon WRITE setLon)
+    Q_PROPERTY(double altitude READ altitude WRITE setAltitude)
+    Q_PROPERTY(double speed READ speed WRITE setSpeed)
+    Q_PROPERTY(double heading READ heading WRITE setHeading)
+    Q_PROPERTY(QString apd READ apd WRITE setApd)
+    Q_PROPERTY(QString priority READ priority WRITE setPriority)
+    Q_PROPERTY(bool jam READ jam WRITE setJam)
+    Q_PROPERTY(bool ghost READ ghost WRITE setGhost)
+    Q_PROPERTY(int category READ category WRITE setCategory)
+    Q_PROPERTY(QString state READ state WRITE setState)
+
+public:
+    QmlPE();
+    explicit QmlPE(const PE& pe);
+    const PE& pe() const { return m_pe; }
+
+    QString id() const { return m_pe.id; }
+    void setId(const QString& value) { m_pe.id = value; }
+    QString type() const { return m_pe.type; }
+    void setType(const QString& value) { m_pe.type = value; }
+    double lat() const { return m_pe.lat; }
+    void setLat(double value) { m_pe.lat = value; }
+    double lon() const { return m_pe.lon; }
+    void setLon(double value) { m_pe.lon = value; }
+    double altitude() const { return m_pe.altitude; }
+    void setAltitude(double value) { m_pe.altitude = value; }
+    double speed() const { return m_pe.speed; }
+    void setSpeed(double value) { m_pe.speed = value; }
+    double heading() const { return m_pe.heading; }
+    void setHeading(double value) { m_pe.heading = value; }
+    QString apd() const { return m_pe.apd; }
+    void setApd(const QString& value) { m_pe.apd = value; }
+    QString priority() const { return m_pe.priority; }
+    void setPriority(const QString& value) { m_pe.priority = value; }
+    bool jam() const { return m_pe.jam; }
+    void setJam(bool value) { m_pe.jam = value; }
+    bool ghost() const { return m_pe.ghost; }
+    void setGhost(bool value) { m_pe.ghost = value; }
+    int category() const { return static_cast<int>(m_pe.category); }
+    void setCategory(int value) { m_pe.category = static_cast<PE::PECategory>(value); }
+    QString state() const { return m_pe.state; }
+    void setState(const QString& value) { m_pe.state = value; }
+
+private:
+    PE m_pe;
+};
+
+// Emitter as a QML value type, each field is a property read by index rather than a map key
+class QmlEmitter
+{
+    Q_GADGET
+    Q_PROPERTY(QString id READ id WRITE setId)
+    Q_PROPERTY(QString type READ type WRITE setType)
+    Q_PROPERTY(QString category READ category WRITE setCategory)
+    Q_PROPERTY(double lat READ lat WRITE setLat)
+    Q_PROPERTY(double lon READ lon WRITE setLon)
+    Q_PROPERTY(double altitude READ altitude WRITE setAltitude)
+    Q_PROPERTY(double heading READ heading WRITE setHeading)
+    Q_PROPERTY(double speed READ speed WRITE setSpeed)
+    Q_PROPERTY(double freqMin READ freqMin WRITE setFreqMin)
+    Q_PROPERTY(double freqMax READ freqMax WRITE setFreqMax)
+    Q_PROPERTY(bool active READ active WRITE setActive)
+    Q_PROPERTY(QString eaPriority READ eaPriority WRITE setEaPriority)
+    Q_PROPERTY(QString esPriority READ esPriority WRITE setEsPriority)
+    Q_PROPERTY(bool jamResponsible READ jamResponsible WRITE setJamResponsible)
+    Q_PROPERTY(bool reactiveEligible READ reactiveEligible WRITE setReactiveEligible)
+    Q_PROPERTY(bool preemptiveEligible READ preemptiveEligible WRITE setPreemptiveEligible)
+    Q_PROPERTY(bool consentRequired READ consentRequired WRITE setConsentRequired)
+    Q_PROPERTY(bool operatorManaged READ operatorManaged WRITE setOperatorManaged)
+    Q_PROPERTY(bool jam READ jam WRITE setJam)
+    Q_PROPERTY(int jamIneffective READ jamIneffective WRITE setJamIneffective)
+    Q_PROPERTY(int jamEffective READ jamEffective WRITE setJamEffective)
+
+public:
+    QmlEmitter();
+    explicit QmlEmitter(const Emitter& emitter);
+    const Emitter& emitter() const { return m_emitter; }
+
+    QString id() const { return m_emitter.id; }
+    void setId(const QString& value) { m_emitter.id = value; }
+    QString type() const { return m_emitter.type; }
+    void setType(const QString& value) { m_emitter.type = value; }
+    QString category() const { return m_emitter.category; }
+    void setCategory(const QString& value) { m_emitter.category = value; }
+    double lat() const { return m_emitter.lat; }
+    void setLat(double value) { m_emitter.lat = value; }
+    double lon() const { return m_emitter.lon; }
+    void setLon(double value) { m_emitter.lon = value; }
+    double altitude() const { return m_emitter.altitude; }
+    void setAltitude(double value) { m_emitter.altitude = value; }
+    double heading() const { return m_emitter.heading; }
+    void setHeading(double value) { m_emitter.heading = value; }
+    double speed() const { return m_emitter.speed; }
+    void setSpeed(double value) { m_emitter.speed = value; }
+    double freqMin() const { return m_emitter.freqMin; }
+    void setFreqMin(double value) { m_emitter.freqMin = value; }
+    double freqMax() const { return m_emitter.freqMax; }
+    void setFreqMax(double value) { m_emitter.freqMax = value; }
+    bool active() const { return m_emitter.active; }
+    void setActive(bool value) { m_emitter.active = value; }
+    QString eaPriority() const { return m_emitter.eaPriority; }
+    void setEaPriority(const QString& value) { m_emitter.eaPriority = value; }
+    QString esPriority() const { return m_emitter.esPriority; }
+    void setEsPriority(const QString& value) { m_emitter.esPriority = value; }
+    bool jamResponsible() const { return m_emitter.jamResponsible; }
+    void setJamResponsible(bool value) { m_emitter.jamResponsible = value; }
+    bool reactiveEligible() const { return m_emitter.reactiveEligible; }
+    void setReactiveEligible(bool value) { m_emitter.reactiveEligible = value; }
+    bool preemptiveEligible() const { return m_emitter.preemptiveEligible; }
+    void setPreemptiveEligible(bool value) { m_emitter.preemptiveEligible = value; }
+    bool consentRequired() const { return m_emitter.consentRequired; }
+    void setConsentRequired(bool value) { m_emitter.consentRequired = value; }
+    bool operatorManaged() const { return m_emitter.operatorManaged; }
+    void setOperatorManaged(bool value) { m_emitter.operatorManaged = value; }
+    bool jam() const { return m_emitter.jam; }
+    void setJam(bool value) { m_emitter.jam = value; }
+    int jamIneffective() const { return m_emitter.jamIneffective; }
+    void setJamIneffective(int value) { m_emitter.jamIneffective = value; }
+    int jamEffective() const { return m_emitter.jamEffective; }
+    void setJamEffective(int value) { m_emitter.jamEffective = value; }
+
+private:
+    Emitter m_emitter;
+};
+
+Q_DECLARE_METATYPE(QmlPE)
+Q_DECLARE_METATYPE(QmlEmitter)
+
+// Register QmlPE and QmlEmitter with the meta-type system, safe to call more than once
+void registerQmlEntityTypes();
+
+#endif // QMLENTITIES_H
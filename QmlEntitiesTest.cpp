@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+#include <QMetaProperty>
+#include <QVariant>
+#include "QmlEntities.h"
+
+TEST(QmlEntitiesTest, PEFieldsAreReadableByPropertyIndex) {
+    PE pe("GadgetPE", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", true, false);
+    pe.heading = 45.0;
+    QmlPE gadget(pe);
+
+    const QMetaObject& meta = QmlPE::staticMetaObject;
+    const int latIndex = meta.indexOfProperty("lat");
+    ASSERT_GE(latIndex, 0);
+    EXPECT_DOUBLE_EQ(meta.property(latIndex).readOnGadget(&gadget).toDouble(), 10.0);
+    EXPECT_TRUE(meta.property(meta.indexOfProperty("jam")).readOnGadget(&gadget).toBool());
+    EXPECT_DOUBLE_EQ(gadget.heading(), 45.0);
+
+    ASSERT_TRUE(meta.property(latIndex).writeOnGadget(&gadget, 11.5));
+    EXPECT_DOUBLE_EQ(gadget.pe().lat, 11.5);
+    EXPECT_EQ(gadget.pe().id, pe.id);
+}
+
+TEST(QmlEntitiesTest, EmitterRoundTripsThroughQVariant) {
+    registerQmlEntityTypes();
+    Emitter emitter("GadgetEmitter", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, true);
+    emitter.jamEffective = 3;
+
+    QVariant boxed = QVariant::fromValue(QmlEmitter(emitter));
+    ASSERT_TRUE(boxed.canConvert<QmlEmitter>());
+    QmlEmitter unboxed = boxed.value<QmlEmitter>();
+    EXPECT_EQ(unboxed.id(), emitter.id);
+    EXPECT_DOUBLE_EQ(unboxed.freqMax(), 12000.0);
+    EXPECT_TRUE(unboxed.active());
+    EXPECT_EQ(unboxed.jamEffective(), 3);
+}
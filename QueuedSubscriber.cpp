@@ -0,0 +1,158 @@
+#include "QueuedSubscriber.h"
+#include "Logger.h"
+
+/*!
+    \class QueuedSubscriber
+    \brief Queues sends to a connected interface and writes them on a dedicated thread.
+
+    Intended for publishers that fan updates out to many subscribers: each send
+    returns as soon as it is queued. A subscriber whose queue grows past the
+    limit, or whose link reports a failed write, returns false from every later
+    send, so SnapshotPublisher drops it from the live stream. Receives are passed
+    straight through to the wrapped interface.
+*/
+
+namespace {
+// Subscribers only send, so the worker records no tracks
+TrackHistoryConfig noTracks() {
+    TrackHistoryConfig config;
+    config.maxEntities = 0;
+    return config;
+}
+}
+
+/*!
+    \fn QueuedSubscriber::QueuedSubscriber(std::unique_ptr<AbstractNetworkInterface> interface, std::size_t maxQueued)
+    \brief Takes ownership of a connected interface.
+    \param interface The connected interface to write to.
+    \param maxQueued The number of outstanding sends after which the subscriber is treated as failed.
+*/
+QueuedSubscriber::QueuedSubscriber(std::unique_ptr<AbstractNetworkInterface> interface, std::size_t maxQueued)
+    : interface(std::move(interface)), worker(this->interface.get(), noTracks()), maxQueued(maxQueued) {}
+
+/*!
+    \fn QueuedSubscriber::~QueuedSubscriber()
+    \brief Stops the send thread, discarding any sends still queued.
+*/
+QueuedSubscriber::~QueuedSubscriber() {
+    worker.stop();
+}
+
+/*!
+    \fn bool QueuedSubscriber::failed()
+    \brief Returns true once a queued send has failed or the queue has overflowed.
+*/
+bool QueuedSubscriber::failed() {
+    if (!hasFailed && !worker.takeReceived().errors.empty()) {
+        hasFailed = true;
+    }
+    return hasFailed;
+}
+
+bool QueuedSubscriber::enqueue(std::function<bool()> send, const std::string& failure) {
+    if (failed()) {
+        return false;
+    }
+    if (worker.pendingSends() >= maxQueued) {
+        ANI_LOG_WARN("QueuedSubscriber", "Send queue full, dropping subscriber");
+        hasFailed = true;
+        return false;
+    }
+    worker.post(std::move(send), failure);
+    return true;
+}
+
+void QueuedSubscriber::initialise(const std::string& address, unsigned short port) {
+    interface->initialise(address, port);
+}
+
+bool QueuedSubscriber::sendPE(const PE& pe) {
+    return enqueue([this, pe]() { return interface->sendPE(pe); }, "Failed to send PE");
+}
+
+bool QueuedSubscriber::sendEmitter(const Emitter& emitter) {
+    return enqueue([this, emitter]() { return interface->sendEmitter(emitter); }, "Failed to send Emitter");
+}
+
+bool QueuedSubscriber::sendBlob(const std::string& blobString) {
+    return enqueue([this, blobString]() { return interface->sendBlob(blobString); }, "Failed to send blob");
+}
+
+bool QueuedSubscriber::sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) {
+    return enqueue([this, pe, emitter, doubleMap]() { return interface->sendComplexBlob(pe, emitter, doubleMap); },
+                   "Failed to send complex blob");
+}
+
+bool QueuedSubscriber::sendPESetting(const std::string& setting, const std::string& id, int updateVal) {
+    return enqueue([this, setting, id, updateVal]() { return interface->sendPESetting(setting, id, updateVal); },
+                   "Failed to send PE setting");
+}
+
+bool QueuedSubscriber::sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) {
+    return enqueue([this, setting, id, updateVal]() { return interface->sendEmitterSetting(setting, id, updateVal); },
+                   "Failed to send Emitter setting");
+}
+
+std::tuple<std::string, std::string, std::string, int> QueuedSubscriber::receiveSetting() {
+    return interface->receiveSetting();
+}
+
+PE QueuedSubscriber::receivePE() {
+    return interface->receivePE();
+}
+
+Emitter QueuedSubscriber::receiveEmitter() {
+    return interface->receiveEmitter();
+}
+
+std::vector<std::string> QueuedSubscriber::receiveBlob() {
+    return interface->receiveBlob();
+}
+
+std::tuple<PE, Emitter, std::map<std::string, double>> QueuedSubscriber::receiveComplexBlob() {
+    return interface->receiveComplexBlob();
+}
+
+bool QueuedSubscriber::sendPEBatch(const std::vector<PE>& pes) {
+    return enqueue([this, pes]() { return interface->sendPEBatch(pes); }, "Failed to send PE batch");
+}
+
+bool QueuedSubscriber::sendEmitterBatch(const std::vector<Emitter>& emitters) {
+    return enqueue([this, emitters]() { return interface->sendEmitterBatch(emitters); }, "Failed to send Emitter batch");
+}
+
+std::vector<PE> QueuedSubscriber::receivePEBatch() {
+    return interface->receivePEBatch();
+}
+
+std::vector<Emitter> QueuedSubscriber::receiveEmitterBatch() {
+    return interface->receiveEmitterBatch();
+}
+
+bool QueuedSubscriber::sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) {
+    return enqueue([this, settings]() { return interface->sendSettingBatch(settings); }, "Failed to send setting batch");
+}
+
+std::vector<std::tuple<std::string, std::string, std::string, int>> QueuedSubscriber::receiveSettingBatch() {
+    return interface->receiveSettingBatch();
+}
+
+bool QueuedSubscriber::sendSnapshot(const EntitySnapshot& snapshot) {
+    return enqueue([this, snapshot]() { return interface->sendSnapshot(snapshot); }, "Failed to send snapshot");
+}
+
+EntitySnapshot QueuedSubscriber::receiveSnapshot() {
+    return interface->receiveSnapshot();
+}
+
+NetworkMessage QueuedSubscriber::receiveMessage() {
+    return interface->receiveMessage();
+}
+
+/*!
+    \fn void QueuedSubscriber::close()
+    \brief Stops the send thread and closes the wrapped interface.
+*/
+void QueuedSubscriber::close() {
+    worker.stop();
+}
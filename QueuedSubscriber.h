@@ -0,0 +1,50 @@
+#ifndef QUEUEDSUBSCRIBER_H
+#define QUEUEDSUBSCRIBER_H
+
+#include <atomic>
+#include <memory>
+#include "AbstractNetworkInterface.h"
+#include "NetworkWorker.h"
+
+// Wraps a connected interface so sends are queued and written on its own thread.
+// A publisher fanning out to many subscribers then only pays for the enqueue,
+// and one slow link cannot stall the others.
+class QueuedSubscriber : public AbstractNetworkInterface {
+public:
+    // Subscribers with more than maxQueued sends outstanding are treated as failed
+    QueuedSubscriber(std::unique_ptr<AbstractNetworkInterface> interface, std::size_t maxQueued);
+    ~QueuedSubscriber() override;
+    // True once a queued send has failed or the queue has overflowed
+    bool failed();
+    void initialise(const std::string& address, unsigned short port) override;
+    bool sendPE(const PE& pe) override;
+    bool sendEmitter(const Emitter& emitter) override;
+    bool sendBlob(const std::string& blobString) override;
+    bool sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) override;
+    bool sendPESetting(const std::string& setting, const std::string& id, int updateVal) override;
+    bool sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) override;
+    std::tuple<std::string, std::string, std::string, int> receiveSetting() override;
+    PE receivePE() override;
+    Emitter receiveEmitter() override;
+    std::vector<std::string> receiveBlob() override;
+    std::tuple<PE, Emitter, std::map<std::string, double>> receiveComplexBlob() override;
+    bool sendPEBatch(const std::vector<PE>& pes) override;
+    bool sendEmitterBatch(const std::vector<Emitter>& emitters) override;
+    std::vector<PE> receivePEBatch() override;
+    std::vector<Emitter> receiveEmitterBatch() override;
+    bool sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) override;
+    std::vector<std::tuple<std::string, std::string, std::string, int>> receiveSettingBatch() override;
+    bool sendSnapshot(const EntitySnapshot& snapshot) override;
+    EntitySnapshot receiveSnapshot() override;
+    NetworkMessage receiveMessage() override;
+    void close() override;
+
+private:
+    bool enqueue(std::function<bool()> send, const std::string& failure);
+    std::unique_ptr<AbstractNetworkInterface> interface;
+    NetworkWorker worker;
+    std::size_t maxQueued;
+    std::atomic<bool> hasFailed{false};
+};
+
+#endif // QUEUEDSUBSCRIBER_H
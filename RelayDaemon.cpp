@@ -0,0 +1,413 @@
+#include "RelayDaemon.h"
+#include "DecodePipeline.h"
+#include "Logger.h"
+#include "Tracing.h"
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <boost/system/system_error.hpp>
+#include <chrono>
+#include <filesystem>
+
+/*!
+    \fn bool RelayConfig::parse(const QStringList& arguments, RelayConfig& config, QString& error, QString& helpText)
+    \brief Builds a relay configuration from a config file and the command line.
+    \param arguments The command line, including the program name.
+    \param config The configuration to fill in, fields not given keep their defaults.
+    \param error Set to a description of the problem if parsing fails.
+    \param helpText Set to the usage text if --help was given.
+    \return True if the daemon should start with config, false otherwise.
+
+    A JSON file given with --config may set "bind", "upstreamPort",
+    "downstreamPort", "maxQueuedSends", "metricsPort", "logLevel", "capture",
+    "checkpoint", "checkpointInterval" and "decodeThreads". Command line options override the file.
+*/
+bool RelayConfig::parse(const QStringList& arguments, RelayConfig& config, QString& error, QString& helpText) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Relays PE, Emitter and setting feeds to many subscribers");
+    const QCommandLineOption helpOption = parser.addHelpOption();
+    const QCommandLineOption configOption("config", "JSON configuration file.", "file");
+    const QCommandLineOption bindOption("bind", "Address to listen on.", "address");
+    const QCommandLineOption upstreamOption("upstream-port", "Port upstream feeds connect to.", "port");
+    const QCommandLineOption downstreamOption("downstream-port", "Port subscribers connect to.", "port");
+    const QCommandLineOption queueOption("max-queue", "Outstanding sends after which a subscriber is dropped.", "count");
+    const QCommandLineOption metricsOption("metrics-port", "Port serving Prometheus metrics on /metrics, 0 to disable.", "port");
+    const QCommandLineOption logLevelOption("log-level", "Lowest level logged: trace, debug, info, warn, error or off.", "level");
+    const QCommandLineOption captureOption("capture", "Record every frame received from the feeds to this directory.", "directory");
+    const QCommandLineOption checkpointOption("checkpoint", "Restore from and periodically write this checkpoint file.", "file");
+    const QCommandLineOption checkpointIntervalOption("checkpoint-interval", "Seconds between checkpoints.", "seconds");
+    const QCommandLineOption decodeThreadsOption("decode-threads", "Threads decoding each feed, 0 to decode on the receive thread.", "count");
+    parser.addOptions({configOption, bindOption, upstreamOption, downstreamOption, queueOption, metricsOption, logLevelOption,
+                       captureOption, checkpointOption, checkpointIntervalOption, decodeThreadsOption});
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText();
+        return false;
+    }
+    if (parser.isSet(helpOption)) {
+        helpText = parser.helpText();
+        return false;
+    }
+
+    if (parser.isSet(configOption)) {
+        QFile file(parser.value(configOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = QString("Cannot open config file %1").arg(file.fileName());
+            return false;
+        }
+        const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+        if (!doc.isObject()) {
+            error = QString("Config file %1 is not a JSON object").arg(file.fileName());
+            return false;
+        }
+        const QJsonObject json = doc.object();
+        if (json.contains("bind")) config.bindAddress = json["bind"].toString().toStdString();
+        if (json.contains("upstreamPort")) config.upstreamPort = static_cast<unsigned short>(json["upstreamPort"].toInt());
+        if (json.contains("downstreamPort")) config.downstreamPort = static_cast<unsigned short>(json["downstreamPort"].toInt());
+        if (json.contains("maxQueuedSends")) config.maxQueuedSends = static_cast<std::size_t>(json["maxQueuedSends"].toInt());
+        if (json.contains("metricsPort")) config.metricsPort = static_cast<unsigned short>(json["metricsPort"].toInt());
+        if (json.contains("logLevel") && !Logger::parseLevel(json["logLevel"].toString().toStdString(), config.logLevel)) {
+            error = QString("Unknown log level %1").arg(json["logLevel"].toString());
+            return false;
+        }
+        if (json.contains("capture")) config.captureDirectory = json["capture"].toString().toStdString();
+        if (json.contains("checkpoint")) config.checkpointPath = json["checkpoint"].toString().toStdString();
+        if (json.contains("checkpointInterval")) config.checkpointIntervalSeconds = json["checkpointInterval"].toInt();
+        if (json.contains("decodeThreads")) config.decodeThreads = static_cast<std::size_t>(json["decodeThreads"].toInt());
+    }
+
+    bool ok = true;
+    if (parser.isSet(bindOption)) {
+        config.bindAddress = parser.value(bindOption).toStdString();
+    }
+    if (parser.isSet(captureOption)) {
+        config.captureDirectory = parser.value(captureOption).toStdString();
+    }
+    if (parser.isSet(checkpointOption)) {
+        config.checkpointPath = parser.value(checkpointOption).toStdString();
+    }
+    if (ok && parser.isSet(upstreamOption)) {
+        config.upstreamPort = static_cast<unsigned short>(parser.value(upstreamOption).toUShort(&ok));
+    }
+    if (ok && parser.isSet(downstreamOption)) {
+        config.downstreamPort = static_cast<unsigned short>(parser.value(downstreamOption).toUShort(&ok));
+    }
+    if (ok && parser.isSet(queueOption)) {
+        config.maxQueuedSends = static_cast<std::size_t>(parser.value(queueOption).toUInt(&ok));
+    }
+    if (ok && parser.isSet(metricsOption)) {
+        config.metricsPort = static_cast<unsigned short>(parser.value(metricsOption).toUShort(&ok));
+    }
+    if (ok && parser.isSet(checkpointIntervalOption)) {
+        config.checkpointIntervalSeconds = parser.value(checkpointIntervalOption).toInt(&ok);
+    }
+    if (ok && parser.isSet(decodeThreadsOption)) {
+        config.decodeThreads = static_cast<std::size_t>(parser.value(decodeThreadsOption).toUInt(&ok));
+    }
+    if (parser.isSet(logLevelOption) && !Logger::parseLevel(parser.value(logLevelOption).toStdString(), config.logLevel)) {
+        error = QString("Unknown log level %1").arg(parser.value(logLevelOption));
+        return false;
+    }
+    if (!ok || config.checkpointIntervalSeconds <= 0) {
+        error = "Ports, queue sizes and intervals must be positive integers";
+        return false;
+    }
+    if (config.upstreamPort == config.downstreamPort
+        || (config.metricsPort != 0 && (config.metricsPort == config.upstreamPort || config.metricsPort == config.downstreamPort))) {
+        error = "Upstream, downstream and metrics ports must differ";
+        return false;
+    }
+    return true;
+}
+
+/*!
+    \class RelayDaemon
+    \brief Headless relay from upstream feeds to downstream subscribers.
+
+    Each upstream feed is read on its own thread with receiveMessage(), or
+    through a DecodePipeline when decodeThreads is set, which decodes in
+    parallel but still in wire order. PEs, Emitters, batches, snapshots and
+    settings are recorded in a SnapshotPublisher and forwarded to every
+    subscriber. A new subscriber first receives a snapshot
+    of the current picture. Each subscriber is a QueuedSubscriber with its own
+    send thread, so fan-out costs one enqueue per subscriber and a slow link is
+    dropped instead of stalling the feeds. Blobs and complex blobs are not part
+    of the entity picture and are not relayed.
+*/
+
+/*!
+    \fn RelayDaemon::RelayDaemon(const RelayConfig& config)
+    \brief Constructs a relay, nothing is bound until start().
+*/
+RelayDaemon::RelayDaemon(const RelayConfig& config)
+    : config(config), feedAcceptor(io_context), subscriberAcceptor(io_context) {}
+
+/*!
+    \fn RelayDaemon::~RelayDaemon()
+    \brief Stops the relay if it is running.
+*/
+RelayDaemon::~RelayDaemon() {
+    stop();
+}
+
+/*!
+    \fn void RelayDaemon::start()
+    \brief Binds the upstream and downstream ports and starts accepting connections.
+
+    Also starts the metrics endpoint if a metrics port is configured, and opens
+    the capture if a capture directory is. Throws boost::system::system_error
+    if any port cannot be bound, or std::runtime_error if the capture cannot be
+    created.
+
+    With a checkpoint configured, the picture is first restored from the
+    checkpoint if one exists, so the first subscribers get a full snapshot
+    while the feeds catch up, and a background writer starts rewriting it.
+*/
+void RelayDaemon::start() {
+    const auto address = boost::asio::ip::make_address(config.bindAddress);
+    for (auto [acceptor, port] : {std::make_pair(&feedAcceptor, config.upstreamPort),
+                                  std::make_pair(&subscriberAcceptor, config.downstreamPort)}) {
+        boost::asio::ip::tcp::endpoint endpoint(address, port);
+        acceptor->open(endpoint.protocol());
+        acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor->bind(endpoint);
+        acceptor->listen();
+    }
+    if (config.metricsPort != 0) {
+        metricsServer = std::make_unique<MetricsServer>(config.bindAddress, config.metricsPort);
+        metricsServer->start();
+    }
+    if (!config.checkpointPath.empty()) {
+        if (std::filesystem::exists(config.checkpointPath)) {
+            const auto begin = std::chrono::steady_clock::now();
+            if (publisher.restore(config.checkpointPath)) {
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+                ANI_LOG_INFO("RelayDaemon", "Restored the picture from " + config.checkpointPath + " in "
+                                            + std::to_string(elapsed.count()) + " ms");
+            }
+        }
+        checkpointWriter = std::make_unique<CheckpointWriter>(config.checkpointPath,
+            std::chrono::seconds(config.checkpointIntervalSeconds), [this]() { return publisher.checkpointState(); });
+        checkpointWriter->start();
+    }
+    if (!config.captureDirectory.empty()) {
+        capture = std::make_shared<TrafficCapture>(config.captureDirectory);
+        ANI_LOG_INFO("RelayDaemon", "Capturing feeds to " + config.captureDirectory);
+    }
+    running = true;
+    feedAcceptThread = std::thread(&RelayDaemon::acceptFeeds, this);
+    subscriberAcceptThread = std::thread(&RelayDaemon::acceptSubscribers, this);
+    ANI_LOG_INFO("RelayDaemon", "Listening for feeds on " + std::to_string(config.upstreamPort)
+                                + " and subscribers on " + std::to_string(config.downstreamPort));
+}
+
+/*!
+    \fn void RelayDaemon::run()
+    \brief Blocks until SIGINT or SIGTERM is received, then stops the relay.
+*/
+void RelayDaemon::run() {
+    boost::asio::signal_set stopSignals(io_context, SIGINT, SIGTERM);
+    stopSignals.async_wait([this](const boost::system::error_code&, int) { io_context.stop(); });
+    io_context.run();
+    stop();
+}
+
+/*!
+    \fn void RelayDaemon::stop()
+    \brief Closes every connection and joins every thread. Safe to call more than once.
+*/
+void RelayDaemon::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    // A blocking accept only returns once a connection arrives
+    wake(config.upstreamPort);
+    wake(config.downstreamPort);
+    feedAcceptThread.join();
+    subscriberAcceptThread.join();
+    boost::system::error_code ec;
+    feedAcceptor.close(ec);
+    subscriberAcceptor.close(ec);
+    if (metricsServer) {
+        metricsServer->stop();
+        metricsServer.reset();
+    }
+
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    for (auto& feed : feeds) {
+        feed->link->close();
+    }
+    for (auto& feed : feeds) {
+        feed->thread.join();
+    }
+    for (auto& subscriber : subscribers) {
+        publisher.removeSubscriber(subscriber.get());
+        subscriber->close();
+    }
+    feeds.clear();
+    subscribers.clear();
+    if (capture) {
+        capture->close();
+        capture.reset();
+    }
+    // Last, so the final checkpoint holds everything the feeds sent
+    if (checkpointWriter) {
+        checkpointWriter->stop();
+        checkpointWriter.reset();
+    }
+}
+
+/*!
+    \fn std::size_t RelayDaemon::feedCount() const
+    \brief Returns the number of connected upstream feeds.
+*/
+std::size_t RelayDaemon::feedCount() const {
+    return connectedFeeds;
+}
+
+/*!
+    \fn std::size_t RelayDaemon::subscriberCount() const
+    \brief Returns the number of live downstream subscribers.
+*/
+std::size_t RelayDaemon::subscriberCount() const {
+    return publisher.subscriberCount();
+}
+
+void RelayDaemon::acceptFeeds() {
+    while (running) {
+        auto feed = std::make_unique<Feed>();
+        feed->link = std::make_unique<NetworkImplementation>();
+        boost::system::error_code ec;
+        feedAcceptor.accept(*feed->link->getSocket(), ec);
+        if (!running) {
+            return;
+        }
+        if (ec) {
+            ANI_LOG_ERROR("RelayDaemon", "Failed to accept feed: " + ec.message());
+            continue;
+        }
+        feed->link->getSocket()->set_option(boost::asio::ip::tcp::no_delay(true), ec);
+        if (capture) {
+            feed->link->setCapture(capture);
+        }
+
+        std::vector<std::unique_ptr<Feed>> finished;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            // Release feeds that have disconnected since the last accept
+            for (auto it = feeds.begin(); it != feeds.end();) {
+                if ((*it)->done) {
+                    finished.push_back(std::move(*it));
+                    it = feeds.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            feed->thread = std::thread(&RelayDaemon::relay, this, feed.get());
+            feeds.push_back(std::move(feed));
+        }
+        for (auto& done : finished) {
+            done->thread.join();
+        }
+    }
+}
+
+void RelayDaemon::acceptSubscribers() {
+    while (running) {
+        auto link = std::make_unique<NetworkImplementation>();
+        boost::system::error_code ec;
+        subscriberAcceptor.accept(*link->getSocket(), ec);
+        if (!running) {
+            return;
+        }
+        if (ec) {
+            ANI_LOG_ERROR("RelayDaemon", "Failed to accept subscriber: " + ec.message());
+            continue;
+        }
+        link->getSocket()->set_option(boost::asio::ip::tcp::no_delay(true), ec);
+        auto subscriber = std::make_unique<QueuedSubscriber>(std::move(link), config.maxQueuedSends);
+        if (!publisher.addSubscriber(subscriber.get())) {
+            continue;
+        }
+
+        std::vector<std::unique_ptr<QueuedSubscriber>> dropped;
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            // Release subscribers the publisher has dropped since the last accept
+            for (auto it = subscribers.begin(); it != subscribers.end();) {
+                if ((*it)->failed()) {
+                    publisher.removeSubscriber(it->get());
+                    dropped.push_back(std::move(*it));
+                    it = subscribers.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            subscribers.push_back(std::move(subscriber));
+        }
+        // Torn down outside the lock, a dropped subscriber's send thread may still be stuck in a write
+        dropped.clear();
+    }
+}
+
+void RelayDaemon::relay(Feed* feed) {
+    ANI_TRACE_THREAD_NAME("RelayDaemon feed");
+    ++connectedFeeds;
+    std::unique_ptr<DecodePipeline> pipeline;
+    if (config.decodeThreads > 0) {
+        pipeline = std::make_unique<DecodePipeline>(*feed->link, config.decodeThreads);
+    }
+    while (running) {
+        try {
+            NetworkMessage message = pipeline ? pipeline->next() : feed->link->receiveMessage();
+            switch (message.kind) {
+            case NetworkMessage::Kind::PE:
+                publisher.publishPE(message.pes.front());
+                break;
+            case NetworkMessage::Kind::Emitter:
+                publisher.publishEmitter(message.emitters.front());
+                break;
+            case NetworkMessage::Kind::PEBatch:
+                publisher.publishPEs(message.pes);
+                break;
+            case NetworkMessage::Kind::EmitterBatch:
+                publisher.publishEmitters(message.emitters);
+                break;
+            case NetworkMessage::Kind::Snapshot:
+                publisher.publishPEs(message.pes);
+                publisher.publishEmitters(message.emitters);
+                break;
+            case NetworkMessage::Kind::Setting:
+                publisher.publishSetting(message.setting);
+                break;
+            case NetworkMessage::Kind::SettingBatch:
+                publisher.publishSettings(message.settings);
+                break;
+            case NetworkMessage::Kind::ComplexBlob:
+            case NetworkMessage::Kind::Blob:
+                break;
+            }
+        } catch (const boost::system::system_error&) {
+            // The feed disconnected or the relay is stopping
+            break;
+        } catch (const std::exception& e) {
+            ANI_LOG_WARN("RelayDaemon", "Skipping malformed frame from feed: " + std::string(e.what()));
+        }
+    }
+    pipeline.reset();
+    --connectedFeeds;
+    // Joined and released by the accept loop on the next accept, or by stop()
+    feed->done = true;
+}
+
+void RelayDaemon::wake(unsigned short port) {
+    boost::asio::ip::address address = boost::asio::ip::make_address(config.bindAddress);
+    if (address.is_unspecified()) {
+        address = address.is_v6() ? boost::asio::ip::address(boost::asio::ip::address_v6::loopback())
+                                  : boost::asio::ip::address(boost::asio::ip::address_v4::loopback());
+    }
+    boost::asio::ip::tcp::socket socket(io_context);
+    boost::system::error_code ec;
+    socket.connect(boost::asio::ip::tcp::endpoint(address, port), ec);
+}
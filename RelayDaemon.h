@@ -0,0 +1,95 @@
+#ifndef RELAYDAEMON_H
+#define RELAYDAEMON_H
+
+#include <QString>
+#include <QStringList>
+#include <boost/asio.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+#include "EntityCheckpoint.h"
+#include "Logger.h"
+#include "MetricsServer.h"
+#include "QueuedSubscriber.h"
+#include "SnapshotPublisher.h"
+#include "TrafficCapture.h"
+
+struct RelayConfig {
+    // Address both listening sockets bind to
+    std::string bindAddress = "0.0.0.0";
+    // Upstream feeds connect here and send PE, Emitter, setting, batch and snapshot frames
+    unsigned short upstreamPort = 3526;
+    // Downstream subscribers connect here, receive a snapshot and then the live stream
+    unsigned short downstreamPort = 3527;
+    // Subscribers with this many sends outstanding are dropped rather than slowing everyone down
+    std::size_t maxQueuedSends = 10000;
+    // Serve Prometheus metrics on GET /metrics at this port, 0 disables the endpoint
+    unsigned short metricsPort = 0;
+    // Lowest level logged, levels compiled out with ANI_LOG_LEVEL cannot be enabled here
+    LogLevel logLevel = LogLevel::Info;
+    // Record every frame received from the feeds to capture segments in this directory, empty disables capture
+    std::string captureDirectory;
+    // Restore the picture from this checkpoint at start-up and keep rewriting it, empty disables checkpoints
+    std::string checkpointPath;
+    int checkpointIntervalSeconds = 30;
+    // Decode each feed on this many threads, keeping wire order, 0 decodes on the feed's receive thread
+    std::size_t decodeThreads = 0;
+    // Read a JSON config file given by --config, then apply command line overrides.
+    // Returns false with a message in error, or with helpText set if --help was given.
+    static bool parse(const QStringList& arguments, RelayConfig& config, QString& error, QString& helpText);
+};
+
+// Accepts upstream feeds and re-publishes everything they send to every downstream subscriber
+class RelayDaemon {
+public:
+    explicit RelayDaemon(const RelayConfig& config);
+    ~RelayDaemon();
+    RelayDaemon(const RelayDaemon&) = delete;
+    RelayDaemon& operator=(const RelayDaemon&) = delete;
+    // Bind both ports and start accepting, throws if a port cannot be bound
+    void start();
+    // Block until SIGINT or SIGTERM, then stop
+    void run();
+    // Close every connection and join every thread
+    void stop();
+    std::size_t feedCount() const;
+    std::size_t subscriberCount() const;
+    const SnapshotPublisher& state() const { return publisher; }
+
+private:
+    void acceptFeeds();
+    void acceptSubscribers();
+    // An upstream connection and the thread relaying it, done once the thread is about to exit
+    struct Feed {
+        std::unique_ptr<NetworkImplementation> link;
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    void relay(Feed* feed);
+    void wake(unsigned short port);
+
+    RelayConfig config;
+    SnapshotPublisher publisher;
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::acceptor feedAcceptor;
+    boost::asio::ip::tcp::acceptor subscriberAcceptor;
+    std::atomic<bool> running{false};
+    std::atomic<std::size_t> connectedFeeds{0};
+
+    mutable std::mutex connectionsMutex;
+    std::vector<std::unique_ptr<Feed>> feeds;
+    std::vector<std::unique_ptr<QueuedSubscriber>> subscribers;
+
+    std::unique_ptr<MetricsServer> metricsServer;
+    std::shared_ptr<TrafficCapture> capture;
+    std::unique_ptr<CheckpointWriter> checkpointWriter;
+    std::thread feedAcceptThread;
+    std::thread subscriberAcceptThread;
+};
+
+#endif // RELAYDAEMON_H
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include "RelayDaemon.h"
+#include <thread>
+#include <chrono>
+
+namespace {
+// The relay registers connections on its accept threads, so counts lag the client side slightly
+template <typename Condition>
+bool waitFor(Condition condition) {
+    for (int attempt = 0; attempt < 200 && !condition(); ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return condition();
+}
+}
+
+TEST(RelayDaemonTest, CommandLineOverridesDefaults) {
+    RelayConfig config;
+    QString error;
+    QString helpText;
+    ASSERT_TRUE(RelayConfig::parse({"CarterMessage", "--upstream-port", "4100", "--downstream-port", "4101",
+                                    "--max-queue", "64", "--decode-threads", "4"}, config, error, helpText));
+    EXPECT_EQ(config.upstreamPort, 4100);
+    EXPECT_EQ(config.downstreamPort, 4101);
+    EXPECT_EQ(config.maxQueuedSends, 64u);
+    EXPECT_EQ(config.decodeThreads, 4u);
+    EXPECT_EQ(config.bindAddress, "0.0.0.0");
+
+    RelayConfig clash;
+    EXPECT_FALSE(RelayConfig::parse({"CarterMessage", "--upstream-port", "4100", "--downstream-port", "4100"},
+                                    clash, error, helpText));
+    EXPECT_FALSE(error.isEmpty());
+}
+
+TEST(RelayDaemonTest, FeedUpdatesReachLiveAndLateSubscribers) {
+    RelayConfig config;
+    config.bindAddress = "127.0.0.1";
+    config.upstreamPort = 3540;
+    config.downstreamPort = 3541;
+    RelayDaemon relay(config);
+    relay.start();
+
+    NetworkImplementation early;
+    early.initialise("127.0.0.1", config.downstreamPort);
+    EXPECT_TRUE(early.receiveSnapshot().pes.empty());
+
+    NetworkImplementation feed;
+    feed.initialise("127.0.0.1", config.upstreamPort);
+    PE sentPE("RelayedPE", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+    ASSERT_TRUE(feed.sendPE(sentPE));
+    ASSERT_TRUE(feed.sendPESetting("JAM", "RelayedPE", 1));
+
+    EXPECT_EQ(early.receivePE().id, sentPE.id);
+    EXPECT_EQ(early.receiveSetting(), std::make_tuple(std::string("PE_SETTING"), std::string("RelayedPE"), std::string("JAM"), 1));
+
+    NetworkImplementation late;
+    late.initialise("127.0.0.1", config.downstreamPort);
+    EntitySnapshot snapshot = late.receiveSnapshot();
+    ASSERT_EQ(snapshot.pes.size(), 1u);
+    EXPECT_EQ(snapshot.pes[0].id, sentPE.id);
+    EXPECT_TRUE(snapshot.pes[0].jam);
+    EXPECT_TRUE(waitFor([&relay]() { return relay.feedCount() == 1; }));
+    EXPECT_TRUE(waitFor([&relay]() { return relay.subscriberCount() == 2; }));
+
+    feed.close();
+    early.close();
+    late.close();
+    relay.stop();
+}
+
+TEST(RelayDaemonTest, SubscriberThatNeverReadsIsDroppedWithoutStallingTheRelay) {
+    RelayConfig config;
+    config.bindAddress = "127.0.0.1";
+    config.upstreamPort = 3542;
+    config.downstreamPort = 3543;
+    config.maxQueuedSends = 16;
+    RelayDaemon relay(config);
+    relay.start();
+
+    // A small receive buffer, so the relay's writes to it block soon after it stops reading
+    NetworkImplementation stalled;
+    stalled.getSocket()->open(boost::asio::ip::tcp::v4());
+    stalled.getSocket()->set_option(boost::asio::socket_base::receive_buffer_size(4096));
+    stalled.initialise("127.0.0.1", config.downstreamPort);
+    ASSERT_TRUE(waitFor([&relay]() { return relay.subscriberCount() == 1; }));
+
+    NetworkImplementation feed;
+    feed.initialise("127.0.0.1", config.upstreamPort);
+    std::vector<PE> pes;
+    for (int i = 0; i < 500; ++i) {
+        pes.emplace_back(QString("PE%1").arg(i), "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+    }
+    // Until the stalled subscriber's queue overflows and the publisher drops it
+    for (int i = 0; i < 2000 && relay.subscriberCount() != 0; ++i) {
+        ASSERT_TRUE(feed.sendPEBatch(pes));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(waitFor([&relay]() { return relay.subscriberCount() == 0; }));
+
+    // Accepting the next subscriber releases the stalled one, whose send thread is blocked in a write
+    NetworkImplementation late;
+    late.initialise("127.0.0.1", config.downstreamPort);
+    EXPECT_EQ(late.receiveSnapshot().pes.size(), pes.size());
+    EXPECT_TRUE(waitFor([&relay]() { return relay.subscriberCount() == 1; }));
+
+    feed.close();
+    late.close();
+    relay.stop();
+    stalled.close();
+}
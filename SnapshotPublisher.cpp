@@ -0,0 +1,276 @@
+#include "SnapshotPublisher.h"
+#include "BatchValidation.h"
+#include "Logger.h"
+#include "MessageCodec.h"
+#include <algorithm>
+
+namespace {
+// Keep the entries whose bit is set in a validity mask, preserving order
+template <typename T>
+std::vector<T> keepValid(const std::vector<T>& items, const ValidityMask& mask) {
+    std::vector<T> valid;
+    valid.reserve(BatchValidation::countValid(mask, items.size()));
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (BatchValidation::isValid(mask, i)) {
+            valid.push_back(items[i]);
+        }
+    }
+    return valid;
+}
+}
+
+/*!
+    \class SnapshotPublisher
+    \brief Keeps the current PE and Emitter picture and fans updates out to subscribers.
+
+    A subscriber added mid-stream first receives one SNAPSHOT frame holding every
+    current entity and is then switched onto the live update stream. Publishing and
+    subscribing share one lock, so every update is either already part of the
+    snapshot or is sent live afterwards, never both and never neither.
+
+    The picture is held in an EntityStore, so repeated updates to one entity
+    overwrite its row rather than growing the snapshot.
+
+    Updates are validated before they are recorded. Invalid input is rejected,
+    or dropped from a batch, without changing the picture or the sequence, so
+    a subscriber is only ever dropped because a send to it failed.
+*/
+
+/*!
+    \fn bool SnapshotPublisher::publishPE(const PE& pe)
+    \brief Records a PE update and sends it to every live subscriber.
+    \param pe The updated PE.
+    \return True if every subscriber accepted the update, false if it is invalid or a send failed.
+
+    Subscribers that fail to accept the update are dropped from the live stream.
+*/
+bool SnapshotPublisher::publishPE(const PE& pe) {
+    if (!NetworkImplementation::validatePE(pe)) {
+        ANI_LOG_WARN("SnapshotPublisher", "Rejected invalid PE " + pe.id.toStdString());
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    store.applyPE(pe);
+    ++sequence;
+    return forwardLocked([&pe](AbstractNetworkInterface* subscriber) { return subscriber->sendPE(pe); });
+}
+
+/*!
+    \fn bool SnapshotPublisher::publishEmitter(const Emitter& emitter)
+    \brief Records an Emitter update and sends it to every live subscriber.
+    \param emitter The updated Emitter.
+    \return True if every subscriber accepted the update, false if it is invalid or a send failed.
+
+    Subscribers that fail to accept the update are dropped from the live stream.
+*/
+bool SnapshotPublisher::publishEmitter(const Emitter& emitter) {
+    if (!NetworkImplementation::validateEmitter(emitter)) {
+        ANI_LOG_WARN("SnapshotPublisher", "Rejected invalid Emitter " + emitter.id.toStdString());
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    store.applyEmitter(emitter);
+    ++sequence;
+    return forwardLocked([&emitter](AbstractNetworkInterface* subscriber) { return subscriber->sendEmitter(emitter); });
+}
+
+/*!
+    \fn bool SnapshotPublisher::publishPEs(const std::vector<PE>& pes)
+    \brief Records a batch of PE updates and sends them to every live subscriber as one frame.
+    \param pes The updated PEs.
+    \return True if every subscriber accepted the batch, false if no entry was valid or a send failed.
+
+    Invalid entries are dropped and the rest recorded and sent, as sendPEBatch
+    does. Subscribers that fail to accept the batch are dropped from the live stream.
+*/
+bool SnapshotPublisher::publishPEs(const std::vector<PE>& pes) {
+    const std::vector<PE> valid = keepValid(pes, BatchValidation::validatePEs(pes));
+    if (valid.size() != pes.size()) {
+        ANI_LOG_WARN("SnapshotPublisher", "Dropped " + std::to_string(pes.size() - valid.size()) + " invalid PEs from batch");
+    }
+    if (valid.empty() && !pes.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& pe : valid) {
+        store.applyPE(pe);
+    }
+    ++sequence;
+    return forwardLocked([&valid](AbstractNetworkInterface* subscriber) { return subscriber->sendPEBatch(valid); });
+}
+
+/*!
+    \fn bool SnapshotPublisher::publishEmitters(const std::vector<Emitter>& emitters)
+    \brief Records a batch of Emitter updates and sends them to every live subscriber as one frame.
+    \param emitters The updated Emitters.
+    \return True if every subscriber accepted the batch, false if no entry was valid or a send failed.
+
+    Invalid entries are dropped and the rest recorded and sent, as
+    sendEmitterBatch does. Subscribers that fail to accept the batch are
+    dropped from the live stream.
+*/
+bool SnapshotPublisher::publishEmitters(const std::vector<Emitter>& emitters) {
+    const std::vector<Emitter> valid = keepValid(emitters, BatchValidation::validateEmitters(emitters));
+    if (valid.size() != emitters.size()) {
+        ANI_LOG_WARN("SnapshotPublisher",
+                     "Dropped " + std::to_string(emitters.size() - valid.size()) + " invalid Emitters from batch");
+    }
+    if (valid.empty() && !emitters.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& emitter : valid) {
+        store.applyEmitter(emitter);
+    }
+    ++sequence;
+    return forwardLocked([&valid](AbstractNetworkInterface* subscriber) { return subscriber->sendEmitterBatch(valid); });
+}
+
+/*!
+    \fn bool SnapshotPublisher::publishSetting(const std::tuple<std::string, std::string, std::string, int>& setting)
+    \brief Records a setting update and sends it to every live subscriber.
+    \param setting The setting, as returned by receiveSetting.
+    \return True if every subscriber accepted the setting, false otherwise.
+
+    Settings for entities that have not been published are still forwarded, but
+    only settings for known entities become part of later snapshots. A setting
+    with an unknown type or an empty id or name is rejected without changing
+    the picture or the sequence.
+*/
+bool SnapshotPublisher::publishSetting(const std::tuple<std::string, std::string, std::string, int>& setting) {
+    if (!MessageCodec::isValidSetting(setting)) {
+        ANI_LOG_WARN("SnapshotPublisher", "Rejected malformed setting " + std::get<0>(setting) + " "
+                     + std::get<1>(setting) + " " + std::get<2>(setting));
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    store.applySetting(setting);
+    ++sequence;
+    const std::string& id = std::get<1>(setting);
+    const std::string& name = std::get<2>(setting);
+    const int value = std::get<3>(setting);
+    const bool isPE = std::get<0>(setting) == "PE_SETTING";
+    return forwardLocked([&id, &name, value, isPE](AbstractNetworkInterface* subscriber) {
+        return isPE ? subscriber->sendPESetting(name, id, value) : subscriber->sendEmitterSetting(name, id, value);
+    });
+}
+
+/*!
+    \fn bool SnapshotPublisher::publishSettings(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings)
+    \brief Records a batch of setting updates and sends them to every live subscriber as one frame.
+    \param settings The settings, as returned by receiveSettingBatch.
+    \return True if every subscriber accepted the batch, false otherwise.
+
+    The whole batch is applied under the publish lock with one sequence number,
+    so a snapshot taken for a new subscriber has either all of it or none. A
+    batch holding any malformed setting is rejected whole, as sendSettingBatch does,
+    and so is one the picture rejects because it names an unknown entity or
+    empties an Emitter's band. Rejected batches are not forwarded.
+*/
+bool SnapshotPublisher::publishSettings(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) {
+    if (!std::all_of(settings.begin(), settings.end(), MessageCodec::isValidSetting)) {
+        ANI_LOG_WARN("SnapshotPublisher", "Rejected setting batch with a malformed setting");
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!store.applySettings(settings)) {
+        return false;
+    }
+    ++sequence;
+    return forwardLocked([&settings](AbstractNetworkInterface* subscriber) { return subscriber->sendSettingBatch(settings); });
+}
+
+/*!
+    \fn bool SnapshotPublisher::addSubscriber(AbstractNetworkInterface* subscriber)
+    \brief Sends the current picture to a new subscriber and adds it to the live stream.
+    \param subscriber The connected interface to publish to.
+    \return True if the snapshot was sent and the subscriber added, false otherwise.
+*/
+bool SnapshotPublisher::addSubscriber(AbstractNetworkInterface* subscriber) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!subscriber->sendSnapshot(snapshotLocked())) {
+        ANI_LOG_ERROR("SnapshotPublisher", "Failed to send snapshot to new subscriber");
+        return false;
+    }
+    subscribers.push_back(subscriber);
+    return true;
+}
+
+/*!
+    \fn void SnapshotPublisher::removeSubscriber(AbstractNetworkInterface* subscriber)
+    \brief Stops forwarding updates to a subscriber.
+    \param subscriber The interface to remove.
+*/
+void SnapshotPublisher::removeSubscriber(AbstractNetworkInterface* subscriber) {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
+}
+
+/*!
+    \fn EntitySnapshot SnapshotPublisher::snapshot() const
+    \brief Returns a copy of the current picture.
+    \return A snapshot of all current PEs and Emitters.
+*/
+EntitySnapshot SnapshotPublisher::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return snapshotLocked();
+}
+
+/*!
+    \fn std::size_t SnapshotPublisher::subscriberCount() const
+    \brief Returns the number of live subscribers.
+*/
+std::size_t SnapshotPublisher::subscriberCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return subscribers.size();
+}
+
+/*!
+    \fn EntityCheckpoint::State SnapshotPublisher::checkpointState() const
+    \brief Copies the current picture and sequence for a checkpoint.
+
+    Only the columns are copied under the lock. Encoding and writing the
+    checkpoint happen after it is released, so publishing is held up for a
+    copy rather than for the file write.
+*/
+EntityCheckpoint::State SnapshotPublisher::checkpointState() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return EntityCheckpoint::capture(store, sequence);
+}
+
+/*!
+    \fn bool SnapshotPublisher::restore(const std::string& path)
+    \brief Replaces the current picture with a checkpoint.
+    \param path A checkpoint written from checkpointState().
+    \return True if the checkpoint was loaded, false if the picture is unchanged.
+
+    Subscribers added afterwards receive the restored picture in their snapshot
+    and then the live updates applied on top of it.
+*/
+bool SnapshotPublisher::restore(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return EntityCheckpoint::load(path, store, sequence);
+}
+
+template <typename Send>
+bool SnapshotPublisher::forwardLocked(Send send) {
+    auto failed = std::remove_if(subscribers.begin(), subscribers.end(),
+                                 [&send](AbstractNetworkInterface* subscriber) { return !send(subscriber); });
+    bool allSent = failed == subscribers.end();
+    subscribers.erase(failed, subscribers.end());
+    return allSent;
+}
+
+EntitySnapshot SnapshotPublisher::snapshotLocked() const {
+    EntitySnapshot result;
+    result.sequence = sequence;
+    result.pes.reserve(store.pes().size());
+    for (std::uint32_t row = 0; row < store.pes().size(); ++row) {
+        result.pes.push_back(store.pe(row));
+    }
+    result.emitters.reserve(store.emitters().size());
+    for (std::uint32_t row = 0; row < store.emitters().size(); ++row) {
+        result.emitters.push_back(store.emitter(row));
+    }
+    return result;
+}
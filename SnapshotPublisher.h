@@ -0,0 +1,50 @@
+#ifndef SNAPSHOTPUBLISHER_H
+#define SNAPSHOTPUBLISHER_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+#include "EntityCheckpoint.h"
+#include "EntityStore.h"
+
+class SnapshotPublisher {
+public:
+    SnapshotPublisher() = default;
+    // Record a PE update and forward it to every live subscriber
+    bool publishPE(const PE& pe);
+    // Record an Emitter update and forward it to every live subscriber
+    bool publishEmitter(const Emitter& emitter);
+    // Record a batch of updates and forward it to every live subscriber as one frame
+    bool publishPEs(const std::vector<PE>& pes);
+    bool publishEmitters(const std::vector<Emitter>& emitters);
+    // Record a setting tuple as returned by receiveSetting and forward it to every live subscriber
+    bool publishSetting(const std::tuple<std::string, std::string, std::string, int>& setting);
+    // Record a setting batch in one step and forward it to every live subscriber as one frame
+    bool publishSettings(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings);
+    // Send the current picture to a new subscriber, then add it to the live stream
+    bool addSubscriber(AbstractNetworkInterface* subscriber);
+    // Stop forwarding updates to a subscriber
+    void removeSubscriber(AbstractNetworkInterface* subscriber);
+    // Copy of the current picture
+    EntitySnapshot snapshot() const;
+    std::size_t subscriberCount() const;
+    // Column copy of the current picture for a checkpoint, short enough to take on the publish lock
+    EntityCheckpoint::State checkpointState() const;
+    // Replace the picture and sequence with a checkpoint, before feeds and subscribers connect
+    bool restore(const std::string& path);
+
+private:
+    EntitySnapshot snapshotLocked() const;
+    // Send to every live subscriber, dropping any that fail, caller holds the lock
+    template <typename Send>
+    bool forwardLocked(Send send);
+    mutable std::mutex mutex;
+    EntityStore store;
+    std::vector<AbstractNetworkInterface*> subscribers;
+    std::uint64_t sequence = 0;
+};
+
+#endif // SNAPSHOTPUBLISHER_H
@@ -0,0 +1,249 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+
+/*!
+    \class SpatialIndex
+    \brief Incrementally updated lat/lon grid index over entity positions.
+
+    Keys are dense row indices, such as those handed out by EntityStore. The globe
+    is divided into fixed size lat/lon cells; each key lives in exactly one cell and
+    moves between cells in constant time when its position is updated. Queries only
+    visit the cells that can intersect the search area and then filter candidates by
+    exact great-circle distance. Longitude spans are wrapped across the antimeridian,
+    and a search circle that reaches a pole covers every longitude of the polar cells.
+*/
+
+namespace {
+constexpr double kEarthRadiusKm = 6371.0088;
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegToRad = kPi / 180.0;
+constexpr double kRadToDeg = 180.0 / kPi;
+// Half the equatorial circumference, no two points are further apart than this
+constexpr double kMaxDistanceKm = kPi * kEarthRadiusKm;
+
+double normaliseLon(double lon) {
+    lon = std::fmod(lon + 180.0, 360.0);
+    if (lon < 0.0) lon += 360.0;
+    return lon - 180.0;
+}
+}
+
+/*!
+    \fn SpatialIndex::SpatialIndex(double cellSizeDegrees)
+    \brief Constructs an empty index.
+    \param cellSizeDegrees The edge length of a grid cell in degrees.
+*/
+SpatialIndex::SpatialIndex(double cellSizeDegrees)
+    : cellSize(cellSizeDegrees),
+      rows(static_cast<int>(std::ceil(180.0 / cellSizeDegrees))),
+      cols(static_cast<int>(std::ceil(360.0 / cellSizeDegrees))) {}
+
+/*!
+    \fn void SpatialIndex::update(std::uint32_t key, double lat, double lon)
+    \brief Inserts a key at a position, or moves an already indexed key.
+    \param key The key to index.
+    \param lat The latitude in degrees.
+    \param lon The longitude in degrees.
+*/
+void SpatialIndex::update(std::uint32_t key, double lat, double lon) {
+    if (key >= entries.size()) {
+        entries.resize(key + 1);
+    }
+    Entry& entry = entries[key];
+    const auto cell = static_cast<std::uint32_t>(rowOf(lat) * cols + colOf(lon));
+    if (entry.present && entry.cell != cell) {
+        detach(key);
+    }
+    entry.lat = lat;
+    entry.lon = lon;
+    if (!entry.present || entry.cell != cell) {
+        auto& members = cells[cell];
+        entry.cell = cell;
+        entry.slot = static_cast<std::uint32_t>(members.size());
+        members.push_back(key);
+        if (!entry.present) ++count;
+        entry.present = true;
+    }
+}
+
+/*!
+    \fn void SpatialIndex::remove(std::uint32_t key)
+    \brief Removes a key from the index.
+    \param key The key to remove.
+*/
+void SpatialIndex::remove(std::uint32_t key) {
+    if (!contains(key)) {
+        return;
+    }
+    detach(key);
+    entries[key].present = false;
+    --count;
+}
+
+/*!
+    \fn bool SpatialIndex::contains(std::uint32_t key) const
+    \brief Returns true if the key is currently indexed.
+*/
+bool SpatialIndex::contains(std::uint32_t key) const {
+    return key < entries.size() && entries[key].present;
+}
+
+/*!
+    \fn std::vector<std::uint32_t> SpatialIndex::withinRadius(double lat, double lon, double radiusKm) const
+    \brief Finds every key within a great-circle distance of a point.
+    \param lat The latitude of the centre in degrees.
+    \param lon The longitude of the centre in degrees.
+    \param radiusKm The search radius in kilometres.
+    \return The matching keys, in no particular order.
+*/
+std::vector<std::uint32_t> SpatialIndex::withinRadius(double lat, double lon, double radiusKm) const {
+    std::vector<std::uint32_t> result;
+    const double radiusDeg = radiusKm / kEarthRadiusKm * kRadToDeg;
+    const double minLat = lat - radiusDeg;
+    const double maxLat = lat + radiusDeg;
+
+    // Longitude half-width of the circle, widest at the circle's extreme latitude
+    double halfWidth = 360.0;
+    if (minLat > -90.0 && maxLat < 90.0) {
+        const double ratio = std::sin(radiusDeg * kDegToRad) / std::cos(lat * kDegToRad);
+        if (ratio < 1.0) {
+            halfWidth = std::asin(ratio) * kRadToDeg;
+        }
+    }
+
+    visitCells(minLat, maxLat, lon - halfWidth, lon + halfWidth, [&](std::uint32_t key, const Entry& entry) {
+        if (distanceKm(lat, lon, entry.lat, entry.lon) <= radiusKm) {
+            result.push_back(key);
+        }
+    });
+    return result;
+}
+
+/*!
+    \fn std::vector<std::uint32_t> SpatialIndex::withinBox(double minLat, double minLon, double maxLat, double maxLon) const
+    \brief Finds every key inside a lat/lon box.
+    \param minLat The southern edge in degrees.
+    \param minLon The western edge in degrees.
+    \param maxLat The northern edge in degrees.
+    \param maxLon The eastern edge in degrees.
+    \return The matching keys, in no particular order.
+
+    If minLon is greater than maxLon the box is taken to cross the antimeridian,
+    running east from minLon through 180 to maxLon.
+*/
+std::vector<std::uint32_t> SpatialIndex::withinBox(double minLat, double minLon, double maxLat, double maxLon) const {
+    std::vector<std::uint32_t> result;
+    if (minLon > maxLon) {
+        maxLon += 360.0;
+    }
+    const double span = maxLon - minLon;
+    visitCells(minLat, maxLat, minLon, maxLon, [&](std::uint32_t key, const Entry& entry) {
+        if (entry.lat < minLat || entry.lat > maxLat) {
+            return;
+        }
+        double offset = std::fmod(entry.lon - minLon, 360.0);
+        if (offset < 0.0) offset += 360.0;
+        if (span >= 360.0 || offset <= span) {
+            result.push_back(key);
+        }
+    });
+    return result;
+}
+
+/*!
+    \fn std::vector<std::pair<std::uint32_t, double>> SpatialIndex::nearest(double lat, double lon, std::size_t k) const
+    \brief Finds the k keys closest to a point.
+    \param lat The latitude of the point in degrees.
+    \param lon The longitude of the point in degrees.
+    \param k The number of keys to return.
+    \return Up to k (key, distance in km) pairs ordered by increasing distance.
+
+    The search radius starts at one cell and doubles until at least k keys fall
+    inside it. Every key outside the radius is further away than every key inside,
+    so the k closest candidates found are the true k nearest.
+*/
+std::vector<std::pair<std::uint32_t, double>> SpatialIndex::nearest(double lat, double lon, std::size_t k) const {
+    std::vector<std::pair<std::uint32_t, double>> result;
+    if (k == 0 || count == 0) {
+        return result;
+    }
+    double radiusKm = cellSize * kDegToRad * kEarthRadiusKm;
+    std::vector<std::uint32_t> candidates;
+    for (;;) {
+        candidates = withinRadius(lat, lon, radiusKm);
+        if (candidates.size() >= k || radiusKm >= kMaxDistanceKm) {
+            break;
+        }
+        radiusKm = std::min(radiusKm * 2.0, kMaxDistanceKm);
+    }
+
+    result.reserve(candidates.size());
+    for (std::uint32_t key : candidates) {
+        result.emplace_back(key, distanceKm(lat, lon, entries[key].lat, entries[key].lon));
+    }
+    const std::size_t keep = std::min(k, result.size());
+    std::partial_sort(result.begin(), result.begin() + keep, result.end(),
+                      [](const auto& a, const auto& b) { return a.second < b.second; });
+    result.resize(keep);
+    return result;
+}
+
+/*!
+    \fn double SpatialIndex::distanceKm(double lat1, double lon1, double lat2, double lon2)
+    \brief Computes the great-circle distance between two points with the haversine formula.
+    \return The distance in kilometres on a spherical Earth.
+*/
+double SpatialIndex::distanceKm(double lat1, double lon1, double lat2, double lon2) {
+    const double dLat = (lat2 - lat1) * kDegToRad;
+    const double dLon = (lon2 - lon1) * kDegToRad;
+    const double a = std::sin(dLat / 2) * std::sin(dLat / 2)
+                   + std::cos(lat1 * kDegToRad) * std::cos(lat2 * kDegToRad) * std::sin(dLon / 2) * std::sin(dLon / 2);
+    return 2.0 * kEarthRadiusKm * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+int SpatialIndex::rowOf(double lat) const {
+    const int row = static_cast<int>(std::floor((lat + 90.0) / cellSize));
+    return std::clamp(row, 0, rows - 1);
+}
+
+int SpatialIndex::colOf(double lon) const {
+    const int col = static_cast<int>(std::floor((normaliseLon(lon) + 180.0) / cellSize));
+    return std::clamp(col, 0, cols - 1);
+}
+
+template <typename Visit>
+void SpatialIndex::visitCells(double minLat, double maxLat, double minLon, double maxLon, Visit&& visit) const {
+    const int firstRow = rowOf(std::max(minLat, -90.0));
+    const int lastRow = rowOf(std::min(maxLat, 90.0));
+    int firstCol = 0;
+    int colCount = cols;
+    if (maxLon - minLon < 360.0 - cellSize) {
+        firstCol = colOf(minLon);
+        colCount = (colOf(maxLon) - firstCol + cols) % cols + 1;
+    }
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int step = 0; step < colCount; ++step) {
+            const auto cell = static_cast<std::uint32_t>(row * cols + (firstCol + step) % cols);
+            auto found = cells.find(cell);
+            if (found == cells.end()) {
+                continue;
+            }
+            for (std::uint32_t key : found->second) {
+                visit(key, entries[key]);
+            }
+        }
+    }
+}
+
+void SpatialIndex::detach(std::uint32_t key) {
+    Entry& entry = entries[key];
+    auto& members = cells[entry.cell];
+    const std::uint32_t moved = members.back();
+    members[entry.slot] = moved;
+    entries[moved].slot = entry.slot;
+    members.pop_back();
+    if (members.empty()) {
+        cells.erase(entry.cell);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class SpatialIndex {
+public:
+    explicit SpatialIndex(double cellSizeDegrees = 1.0);
+    // Insert a key or move it to a new position
+    void update(std::uint32_t key, double lat, double lon);
+    // Remove a key, no-op if it is not indexed
+    void remove(std::uint32_t key);
+    bool contains(std::uint32_t key) const;
+    std::size_t size() const { return count; }
+    // Keys within a great-circle distance of a point
+    std::vector<std::uint32_t> withinRadius(double lat, double lon, double radiusKm) const;
+    // Keys inside a lat/lon box, minLon > maxLon selects a box crossing the antimeridian
+    std::vector<std::uint32_t> withinBox(double minLat, double minLon, double maxLat, double maxLon) const;
+    // The k closest keys to a point as (key, distance in km), nearest first
+    std::vector<std::pair<std::uint32_t, double>> nearest(double lat, double lon, std::size_t k) const;
+    // Great-circle distance in km between two points
+    static double distanceKm(double lat1, double lon1, double lat2, double lon2);
+
+private:
+    struct Entry {
+        double lat = 0.0;
+        double lon = 0.0;
+        std::uint32_t cell = 0;
+        std::uint32_t slot = 0;
+        bool present = false;
+    };
+    int rowOf(double lat) const;
+    int colOf(double lon) const;
+    // Visit every key in the cells covering a latitude band and a (possibly wrapped) longitude span
+    template <typename Visit>
+    void visitCells(double minLat, double maxLat, double minLon, double maxLon, Visit&& visit) const;
+    void detach(std::uint32_t key);
+
+    double cellSize;
+    int rows;
+    int cols;
+    std::size_t count = 0;
+    std::vector<Entry> entries;
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> cells;
+};
+
+#endif // SPATIALINDEX_H
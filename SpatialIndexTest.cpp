@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+std::vector<std::uint32_t> sorted(std::vector<std::uint32_t> keys) {
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+}
+
+TEST(SpatialIndexTest, DistanceMatchesKnownValues) {
+    // One degree of latitude is roughly 111.2 km
+    EXPECT_NEAR(SpatialIndex::distanceKm(0.0, 0.0, 1.0, 0.0), 111.2, 0.1);
+    EXPECT_NEAR(SpatialIndex::distanceKm(0.0, 179.5, 0.0, -179.5), 111.2, 0.1);
+    EXPECT_NEAR(SpatialIndex::distanceKm(89.5, 0.0, 89.5, 180.0), 111.2, 0.1);
+}
+
+TEST(SpatialIndexTest, RadiusQueryWrapsAcrossAntimeridian) {
+    SpatialIndex index;
+    index.update(0, 0.0, 179.8);
+    index.update(1, 0.0, -179.8);
+    index.update(2, 0.0, 170.0);
+    EXPECT_EQ(sorted(index.withinRadius(0.0, 179.9, 50.0)), (std::vector<std::uint32_t>{0, 1}));
+}
+
+TEST(SpatialIndexTest, RadiusQueryCoversPolarCap) {
+    SpatialIndex index;
+    index.update(0, 89.8, 0.0);
+    index.update(1, 89.8, 180.0);
+    index.update(2, 89.8, -90.0);
+    index.update(3, 80.0, 0.0);
+    EXPECT_EQ(sorted(index.withinRadius(89.9, 45.0, 100.0)), (std::vector<std::uint32_t>{0, 1, 2}));
+}
+
+TEST(SpatialIndexTest, BoxQueryAcrossAntimeridian) {
+    SpatialIndex index;
+    index.update(0, 10.0, 175.0);
+    index.update(1, 10.0, -175.0);
+    index.update(2, 10.0, 0.0);
+    index.update(3, 30.0, 178.0);
+    EXPECT_EQ(sorted(index.withinBox(0.0, 170.0, 20.0, -170.0)), (std::vector<std::uint32_t>{0, 1}));
+}
+
+TEST(SpatialIndexTest, UpdateMovesAndRemoveDrops) {
+    SpatialIndex index;
+    index.update(0, -33.9, 151.2);
+    index.update(1, -33.8, 151.3);
+    index.update(0, 51.5, -0.1);
+    EXPECT_EQ(index.withinRadius(-33.9, 151.2, 50.0), (std::vector<std::uint32_t>{1}));
+    EXPECT_EQ(index.withinRadius(51.5, -0.1, 50.0), (std::vector<std::uint32_t>{0}));
+    index.remove(1);
+    EXPECT_FALSE(index.contains(1));
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_TRUE(index.withinRadius(-33.9, 151.2, 50.0).empty());
+}
+
+TEST(SpatialIndexTest, NearestMatchesBruteForce) {
+    SpatialIndex index(2.0);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> latDist(-90.0, 90.0);
+    std::uniform_real_distribution<double> lonDist(-180.0, 180.0);
+    std::vector<std::pair<double, double>> points;
+    for (std::uint32_t key = 0; key < 2000; ++key) {
+        points.emplace_back(latDist(rng), lonDist(rng));
+        index.update(key, points.back().first, points.back().second);
+    }
+
+    const double lat = 85.0, lon = 179.0;
+    auto result = index.nearest(lat, lon, 5);
+    ASSERT_EQ(result.size(), 5u);
+
+    std::vector<double> expected;
+    for (const auto& [pLat, pLon] : points) {
+        expected.push_back(SpatialIndex::distanceKm(lat, lon, pLat, pLon));
+    }
+    std::sort(expected.begin(), expected.end());
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        EXPECT_DOUBLE_EQ(result[i].second, expected[i]);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
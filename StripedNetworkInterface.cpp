@@ -0,0 +1,597 @@
+#include "StripedNetworkInterface.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "Tracing.h"
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <boost/system/system_error.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+
+namespace {
+// First frame on every stripe, naming the link it belongs to and its place in it
+struct StripeHello {
+    std::string link;
+    std::size_t index = 0;
+    std::size_t count = 0;
+};
+
+StripeHello readHello(NetworkImplementation& stripe) {
+    const QJsonObject json = QJsonDocument::fromJson(QByteArray::fromStdString(stripe.receiveFrame())).object();
+    if (json["type"].toString() != "STRIPE" || !json.contains("link") || !json.contains("index") || !json.contains("count")) {
+        throw std::runtime_error("Connection did not start with a stripe hello");
+    }
+    StripeHello hello;
+    hello.link = json["link"].toString().toStdString();
+    hello.index = static_cast<std::size_t>(json["index"].toInt(-1));
+    hello.count = static_cast<std::size_t>(json["count"].toInt(0));
+    if (hello.count == 0 || hello.count > StripedNetworkInterface::kMaxStripes || hello.index >= hello.count) {
+        throw std::runtime_error("Stripe hello has an invalid index or count");
+    }
+    return hello;
+}
+}
+
+/*!
+    \class StripedNetworkInterface
+    \brief Spreads one logical link over several TCP connections.
+
+    A single TCP connection is limited by one congestion window, and each end
+    frames and parses it on one core. A striped link opens K connections
+    between the same two ends and sends each message on the stripe chosen
+    by hashing its entity id. Everything about one PE or Emitter, including
+    its settings and complex blobs, goes over the same stripe, so each
+    entity's updates stay in order while different entities travel and are
+    decoded in parallel. Blobs carry no id and use the first stripe.
+
+    Batches and snapshots are split by stripe and each stripe gets its part,
+    even when the part is empty. Typed receives such as receiveSnapshot()
+    wait for the part from every stripe and merge them. receiveMessage()
+    returns each PE batch, Emitter batch and snapshot part as soon as it
+    arrives, as merging the parts into an entity picture gives the same
+    result either way. A setting batch is meant to be applied in one step,
+    so receiveMessage() merges its parts and returns the whole batch once
+    the last part is in. Messages from stripes that have not sent their part
+    yet are returned in the meantime, and messages sent after a stripe's part
+    are held back until the batch, so every entity still sees its settings
+    in order.
+
+    Each stripe has its own receive thread that decodes into a shared queue,
+    which the receive functions read from. The threads stop reading once
+    kMaxReceived messages are waiting, so a slow consumer pushes back on the
+    sender through TCP. Messages held back by a merge count as waiting, except
+    that a stripe with none held may still fill the queue, as the merge may be
+    waiting for its part. At most twice kMaxReceived messages are kept. Sends run on the calling thread, holding only the
+    chosen stripe's lock, so several threads can send on different stripes
+    at once.
+
+    When a client connects, each connection first sends a hello frame. It
+    gives a random link id, the stripe's index and the stripe count. accept()
+    uses the hellos to put the server side back together. If one stripe
+    fails, the whole link is closed. Receives then return what was already
+    queued and then throw the error. A setting batch whose parts were still
+    being merged is returned with the parts that arrived, followed by the
+    messages held back behind it.
+*/
+
+/*!
+    \fn StripedNetworkInterface::StripedNetworkInterface(std::size_t count)
+    \brief Creates an unconnected client side link with count stripes.
+
+    The count is clamped to between 1 and kMaxStripes.
+*/
+StripedNetworkInterface::StripedNetworkInterface(std::size_t count) {
+    count = std::min(std::max<std::size_t>(count, 1), kMaxStripes);
+    for (std::size_t i = 0; i < count; ++i) {
+        stripes.push_back(std::make_unique<NetworkImplementation>());
+    }
+}
+
+StripedNetworkInterface::StripedNetworkInterface(std::vector<std::unique_ptr<NetworkImplementation>> stripes)
+    : stripes(std::move(stripes)) {
+    startReceiving();
+}
+
+/*!
+    \fn std::unique_ptr<StripedNetworkInterface> StripedNetworkInterface::accept(boost::asio::ip::tcp::acceptor& acceptor)
+    \brief Accepts every stripe of the next striped client.
+    \param acceptor A listening acceptor. Striped clients must connect to it one at a time.
+    \return The server side of the link, already receiving.
+
+    Throws std::runtime_error if a connection does not begin with a valid
+    hello, belongs to a different link or repeats a stripe, and
+    boost::system::system_error if accepting or reading fails.
+*/
+std::unique_ptr<StripedNetworkInterface> StripedNetworkInterface::accept(boost::asio::ip::tcp::acceptor& acceptor) {
+    std::vector<std::unique_ptr<NetworkImplementation>> stripes;
+    std::string link;
+    std::size_t accepted = 0;
+    do {
+        auto stripe = std::make_unique<NetworkImplementation>();
+        acceptor.accept(*stripe->getSocket());
+        stripe->getSocket()->set_option(boost::asio::ip::tcp::no_delay(true));
+        const StripeHello hello = readHello(*stripe);
+        if (stripes.empty()) {
+            link = hello.link;
+            stripes.resize(hello.count);
+        } else if (hello.link != link || hello.count != stripes.size()) {
+            throw std::runtime_error("Stripe belongs to another link, striped clients must connect one at a time");
+        }
+        if (stripes[hello.index]) {
+            throw std::runtime_error("Stripe " + std::to_string(hello.index) + " connected twice");
+        }
+        stripes[hello.index] = std::move(stripe);
+        ++accepted;
+    } while (accepted < stripes.size());
+    ANI_LOG_INFO("StripedNetworkInterface", "Accepted link " + link + " with " + std::to_string(stripes.size()) + " stripes");
+    return std::unique_ptr<StripedNetworkInterface>(new StripedNetworkInterface(std::move(stripes)));
+}
+
+/*!
+    \fn StripedNetworkInterface::~StripedNetworkInterface()
+    \brief Closes every stripe and joins the receive threads.
+*/
+StripedNetworkInterface::~StripedNetworkInterface() {
+    close();
+    for (std::thread& thread : receiveThreads) {
+        thread.join();
+    }
+}
+
+/*!
+    \fn std::size_t StripedNetworkInterface::stripeFor(const QString& id) const
+    \brief Returns the index of the stripe that carries messages about id.
+*/
+std::size_t StripedNetworkInterface::stripeFor(const QString& id) const {
+    return qHash(id) % stripes.size();
+}
+
+/*!
+    \fn void StripedNetworkInterface::initialise(const std::string& address, unsigned short port)
+    \brief Opens every stripe to address and port, introduces each with a hello, and starts receiving.
+
+    Throws if any stripe fails to connect, after closing those that did.
+*/
+void StripedNetworkInterface::initialise(const std::string& address, unsigned short port) {
+    std::random_device random;
+    char link[17];
+    std::snprintf(link, sizeof(link), "%08x%08x", random(), random());
+    try {
+        for (std::size_t i = 0; i < stripes.size(); ++i) {
+            stripes[i]->initialise(address, port);
+            stripes[i]->getSocket()->set_option(boost::asio::ip::tcp::no_delay(true));
+            stripes[i]->sendBlob(encodeHello(link, i, stripes.size()));
+        }
+    } catch (const std::exception&) {
+        for (auto& stripe : stripes) {
+            stripe->close();
+        }
+        throw;
+    }
+    startReceiving();
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendPE(const PE& pe)
+    \brief Sends a PE on its id's stripe.
+*/
+bool StripedNetworkInterface::sendPE(const PE& pe) {
+    return stripes[stripeFor(pe.id)]->sendPE(pe);
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendEmitter(const Emitter& emitter)
+    \brief Sends an Emitter on its id's stripe.
+*/
+bool StripedNetworkInterface::sendEmitter(const Emitter& emitter) {
+    return stripes[stripeFor(emitter.id)]->sendEmitter(emitter);
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendBlob(const std::string& blobString)
+    \brief Sends a blob on the first stripe.
+*/
+bool StripedNetworkInterface::sendBlob(const std::string& blobString) {
+    return stripes.front()->sendBlob(blobString);
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap)
+    \brief Sends a complex blob on its PE's stripe.
+*/
+bool StripedNetworkInterface::sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) {
+    return stripes[stripeFor(pe.id)]->sendComplexBlob(pe, emitter, doubleMap);
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendPESetting(const std::string& setting, const std::string& id, int updateVal)
+    \brief Sends a PE setting on the PE's stripe, so it stays in order with the PE's updates.
+*/
+bool StripedNetworkInterface::sendPESetting(const std::string& setting, const std::string& id, int updateVal) {
+    return stripes[stripeFor(QString::fromStdString(id))]->sendPESetting(setting, id, updateVal);
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal)
+    \brief Sends an Emitter setting on the Emitter's stripe, so it stays in order with the Emitter's updates.
+*/
+bool StripedNetworkInterface::sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) {
+    return stripes[stripeFor(QString::fromStdString(id))]->sendEmitterSetting(setting, id, updateVal);
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendPEBatch(const std::vector<PE>& pes)
+    \brief Splits a batch by stripe and sends every stripe its part.
+    \return True if every part was sent.
+*/
+bool StripedNetworkInterface::sendPEBatch(const std::vector<PE>& pes) {
+    ANI_TRACE_SPAN("StripedNetworkInterface::sendPEBatch");
+    std::vector<std::vector<PE>> parts(stripes.size());
+    for (const PE& pe : pes) {
+        parts[stripeFor(pe.id)].push_back(pe);
+    }
+    bool sent = true;
+    for (std::size_t i = 0; i < stripes.size(); ++i) {
+        sent = stripes[i]->sendPEBatch(parts[i]) && sent;
+    }
+    return sent;
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendEmitterBatch(const std::vector<Emitter>& emitters)
+    \brief Splits a batch by stripe and sends every stripe its part.
+    \return True if every part was sent.
+*/
+bool StripedNetworkInterface::sendEmitterBatch(const std::vector<Emitter>& emitters) {
+    ANI_TRACE_SPAN("StripedNetworkInterface::sendEmitterBatch");
+    std::vector<std::vector<Emitter>> parts(stripes.size());
+    for (const Emitter& emitter : emitters) {
+        parts[stripeFor(emitter.id)].push_back(emitter);
+    }
+    bool sent = true;
+    for (std::size_t i = 0; i < stripes.size(); ++i) {
+        sent = stripes[i]->sendEmitterBatch(parts[i]) && sent;
+    }
+    return sent;
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings)
+    \brief Splits a setting batch by the stripe of each setting's entity and sends every stripe its part.
+    \return True if every part was sent, false without sending anything if any setting is malformed.
+
+    Each setting stays in order with the updates of its entity. The parts of
+    concurrent batches are not interleaved, so the receiver can tell which
+    parts make up each batch by their order on every stripe.
+*/
+bool StripedNetworkInterface::sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) {
+    ANI_TRACE_SPAN("StripedNetworkInterface::sendSettingBatch");
+    const auto invalid = std::count_if(settings.begin(), settings.end(), [](const auto& setting) {
+        return !MessageCodec::isValidSetting(setting);
+    });
+    if (invalid > 0) {
+        ANI_LOG_ERROR("StripedNetworkInterface", "Refusing to send setting batch with a malformed setting");
+        Metrics::count(MetricCounter::InvalidSettings, static_cast<std::uint64_t>(invalid));
+        return false;
+    }
+    std::vector<std::vector<std::tuple<std::string, std::string, std::string, int>>> parts(stripes.size());
+    for (const auto& setting : settings) {
+        parts[stripeFor(QString::fromStdString(std::get<1>(setting)))].push_back(setting);
+    }
+    std::lock_guard<std::mutex> lock(settingBatchMutex);
+    bool sent = true;
+    for (std::size_t i = 0; i < stripes.size(); ++i) {
+        sent = stripes[i]->sendSettingBatch(parts[i]) && sent;
+    }
+    return sent;
+}
+
+/*!
+    \fn bool StripedNetworkInterface::sendSnapshot(const EntitySnapshot& snapshot)
+    \brief Splits a snapshot by stripe and sends every stripe its part, all with the snapshot's sequence.
+    \return True if every part was sent.
+*/
+bool StripedNetworkInterface::sendSnapshot(const EntitySnapshot& snapshot) {
+    ANI_TRACE_SPAN("StripedNetworkInterface::sendSnapshot");
+    std::vector<EntitySnapshot> parts(stripes.size());
+    for (EntitySnapshot& part : parts) {
+        part.sequence = snapshot.sequence;
+    }
+    for (const PE& pe : snapshot.pes) {
+        parts[stripeFor(pe.id)].pes.push_back(pe);
+    }
+    for (const Emitter& emitter : snapshot.emitters) {
+        parts[stripeFor(emitter.id)].emitters.push_back(emitter);
+    }
+    bool sent = true;
+    for (std::size_t i = 0; i < stripes.size(); ++i) {
+        sent = stripes[i]->sendSnapshot(parts[i]) && sent;
+    }
+    return sent;
+}
+
+/*!
+    \fn std::tuple<std::string, std::string, std::string, int> StripedNetworkInterface::receiveSetting()
+    \brief Receives the next message, which must be a setting.
+*/
+std::tuple<std::string, std::string, std::string, int> StripedNetworkInterface::receiveSetting() {
+    return takeKind(NetworkMessage::Kind::Setting, "setting").setting;
+}
+
+/*!
+    \fn PE StripedNetworkInterface::receivePE()
+    \brief Receives the next message, which must be a PE.
+*/
+PE StripedNetworkInterface::receivePE() {
+    return takeKind(NetworkMessage::Kind::PE, "PE").pes.front();
+}
+
+/*!
+    \fn Emitter StripedNetworkInterface::receiveEmitter()
+    \brief Receives the next message, which must be an Emitter.
+*/
+Emitter StripedNetworkInterface::receiveEmitter() {
+    return takeKind(NetworkMessage::Kind::Emitter, "Emitter").emitters.front();
+}
+
+/*!
+    \fn std::vector<std::string> StripedNetworkInterface::receiveBlob()
+    \brief Receives the next message, which must be a blob.
+*/
+std::vector<std::string> StripedNetworkInterface::receiveBlob() {
+    return {takeKind(NetworkMessage::Kind::Blob, "blob").blob};
+}
+
+/*!
+    \fn std::tuple<PE, Emitter, std::map<std::string, double>> StripedNetworkInterface::receiveComplexBlob()
+    \brief Receives the next message, which must be a complex blob.
+*/
+std::tuple<PE, Emitter, std::map<std::string, double>> StripedNetworkInterface::receiveComplexBlob() {
+    NetworkMessage message = takeKind(NetworkMessage::Kind::ComplexBlob, "complex blob");
+    return std::make_tuple(message.pes.front(), message.emitters.front(), std::move(message.doubleMap));
+}
+
+/*!
+    \fn std::vector<PE> StripedNetworkInterface::receivePEBatch()
+    \brief Receives one PE batch part from every stripe and merges them.
+*/
+std::vector<PE> StripedNetworkInterface::receivePEBatch() {
+    return takeParts(NetworkMessage::Kind::PEBatch, "PE batch").pes;
+}
+
+/*!
+    \fn std::vector<Emitter> StripedNetworkInterface::receiveEmitterBatch()
+    \brief Receives one Emitter batch part from every stripe and merges them.
+*/
+std::vector<Emitter> StripedNetworkInterface::receiveEmitterBatch() {
+    return takeParts(NetworkMessage::Kind::EmitterBatch, "Emitter batch").emitters;
+}
+
+/*!
+    \fn std::vector<std::tuple<std::string, std::string, std::string, int>> StripedNetworkInterface::receiveSettingBatch()
+    \brief Receives one setting batch part from every stripe and merges them.
+*/
+std::vector<std::tuple<std::string, std::string, std::string, int>> StripedNetworkInterface::receiveSettingBatch() {
+    return takeKind(NetworkMessage::Kind::SettingBatch, "setting batch").settings;
+}
+
+/*!
+    \fn EntitySnapshot StripedNetworkInterface::receiveSnapshot()
+    \brief Receives one snapshot part from every stripe and merges them.
+*/
+EntitySnapshot StripedNetworkInterface::receiveSnapshot() {
+    NetworkMessage message = takeParts(NetworkMessage::Kind::Snapshot, "snapshot");
+    return EntitySnapshot{message.sequence, std::move(message.pes), std::move(message.emitters)};
+}
+
+/*!
+    \fn NetworkMessage StripedNetworkInterface::receiveMessage()
+    \brief Receives the next message from whichever stripe has one.
+    \return The decoded message. Batch and snapshot parts are returned one at a
+    time, setting batches whole.
+
+    Throws std::runtime_error for a malformed frame, at its place in its
+    stripe's order, and boost::system::system_error once the link has
+    closed and everything received before has been returned. If the link
+    closes while a setting batch is being merged, the parts that arrived are
+    returned as the batch first.
+*/
+NetworkMessage StripedNetworkInterface::receiveMessage() {
+    while (true) {
+        Received item;
+        try {
+            item = take();
+        } catch (const boost::system::system_error&) {
+            if (settingBatchParts == 0) {
+                throw;
+            }
+            // The missing parts will never come, hand out what did and then what was held behind it
+            settingBatchParts = 0;
+            requeue(afterSettingBatch);
+            return std::move(settingBatch);
+        }
+        if (settingBatchParts > 0 && settingBatchSeen[item.stripe]) {
+            // Sent after this stripe's part of the batch being merged, so it comes out after the batch
+            hold(afterSettingBatch, std::move(item));
+            continue;
+        }
+        if (item.error) {
+            std::rethrow_exception(item.error);
+        }
+        if (item.message.kind != NetworkMessage::Kind::SettingBatch) {
+            return std::move(item.message);
+        }
+        if (settingBatchParts == 0) {
+            settingBatch = NetworkMessage();
+            settingBatch.kind = NetworkMessage::Kind::SettingBatch;
+            settingBatchSeen.assign(stripes.size(), false);
+        }
+        settingBatch.settings.insert(settingBatch.settings.end(), std::make_move_iterator(item.message.settings.begin()),
+                                     std::make_move_iterator(item.message.settings.end()));
+        settingBatchSeen[item.stripe] = true;
+        if (++settingBatchParts < stripes.size()) {
+            continue;
+        }
+        settingBatchParts = 0;
+        requeue(afterSettingBatch);
+        return std::move(settingBatch);
+    }
+}
+
+/*!
+    \fn void StripedNetworkInterface::close()
+    \brief Closes every stripe, waking any blocked receive.
+*/
+void StripedNetworkInterface::close() {
+    {
+        std::lock_guard<std::mutex> lock(receivedMutex);
+        closing = true;
+    }
+    receivedSpace.notify_all();
+    for (auto& stripe : stripes) {
+        stripe->close();
+    }
+}
+
+void StripedNetworkInterface::startReceiving() {
+    {
+        std::lock_guard<std::mutex> lock(receivedMutex);
+        receiving = true;
+        openStripes = stripes.size();
+        heldFrom.assign(stripes.size(), 0);
+    }
+    for (std::size_t i = 0; i < stripes.size(); ++i) {
+        receiveThreads.emplace_back(&StripedNetworkInterface::receiveLoop, this, i);
+    }
+}
+
+void StripedNetworkInterface::receiveLoop(std::size_t stripe) {
+    ANI_TRACE_THREAD_NAME("StripedNetworkInterface receive");
+    while (true) {
+        Received item{stripe, NetworkMessage(), nullptr};
+        try {
+            item.message = stripes[stripe]->receiveMessage();
+        } catch (const boost::system::system_error&) {
+            // One stripe gone breaks the link, close the rest so every receive thread ends
+            {
+                std::lock_guard<std::mutex> lock(receivedMutex);
+                if (!linkError) {
+                    linkError = std::current_exception();
+                }
+                --openStripes;
+            }
+            receivedReady.notify_all();
+            close();
+            return;
+        } catch (const std::exception&) {
+            item.error = std::current_exception();
+        }
+        {
+            std::unique_lock<std::mutex> lock(receivedMutex);
+            receivedSpace.wait(lock, [this, stripe]() {
+                return closing || received.size() + (heldFrom[stripe] > 0 ? held : 0) < kMaxReceived;
+            });
+            received.push_back(std::move(item));
+        }
+        receivedReady.notify_one();
+    }
+}
+
+StripedNetworkInterface::Received StripedNetworkInterface::take() {
+    std::unique_lock<std::mutex> lock(receivedMutex);
+    if (!receiving) {
+        throw boost::system::system_error(boost::asio::error::not_connected);
+    }
+    receivedReady.wait(lock, [this]() { return !received.empty() || openStripes == 0; });
+    if (received.empty()) {
+        std::rethrow_exception(linkError);
+    }
+    Received item = std::move(received.front());
+    received.pop_front();
+    lock.unlock();
+    // Each stripe waits on its own condition, so wake them all
+    receivedSpace.notify_all();
+    return item;
+}
+
+NetworkMessage StripedNetworkInterface::takeKind(NetworkMessage::Kind kind, const char* name) {
+    NetworkMessage message = receiveMessage();
+    if (message.kind != kind) {
+        throw std::runtime_error(std::string("Expected a ") + name + " but received another kind of message");
+    }
+    return message;
+}
+
+NetworkMessage StripedNetworkInterface::takeParts(NetworkMessage::Kind kind, const char* name) {
+    NetworkMessage merged;
+    merged.kind = kind;
+    std::vector<bool> seen(stripes.size(), false);
+    std::size_t parts = 0;
+    // Messages from stripes whose part is already in were sent after it, and are returned after the merge
+    std::deque<Received> later;
+    try {
+        while (parts < stripes.size()) {
+            Received item = take();
+            if (seen[item.stripe]) {
+                hold(later, std::move(item));
+                continue;
+            }
+            if (item.error) {
+                std::rethrow_exception(item.error);
+            }
+            if (item.message.kind != kind) {
+                throw std::runtime_error(std::string("Expected a ") + name + " part but received another kind of message");
+            }
+            merged.sequence = item.message.sequence;
+            merged.pes.insert(merged.pes.end(), std::make_move_iterator(item.message.pes.begin()),
+                              std::make_move_iterator(item.message.pes.end()));
+            merged.emitters.insert(merged.emitters.end(), std::make_move_iterator(item.message.emitters.begin()),
+                                   std::make_move_iterator(item.message.emitters.end()));
+            merged.settings.insert(merged.settings.end(), std::make_move_iterator(item.message.settings.begin()),
+                                   std::make_move_iterator(item.message.settings.end()));
+            seen[item.stripe] = true;
+            ++parts;
+        }
+    } catch (const std::exception&) {
+        requeue(later);
+        throw;
+    }
+    requeue(later);
+    return merged;
+}
+
+void StripedNetworkInterface::hold(std::deque<Received>& items, Received item) {
+    {
+        std::lock_guard<std::mutex> lock(receivedMutex);
+        ++held;
+        ++heldFrom[item.stripe];
+    }
+    items.push_back(std::move(item));
+}
+
+void StripedNetworkInterface::requeue(std::deque<Received>& items) {
+    {
+        std::lock_guard<std::mutex> lock(receivedMutex);
+        // Already counted while held, so putting them back does not need room
+        for (const Received& item : items) {
+            --heldFrom[item.stripe];
+        }
+        held -= items.size();
+        received.insert(received.begin(), std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        items.clear();
+    }
+    receivedSpace.notify_all();
+}
+
+std::string StripedNetworkInterface::encodeHello(const std::string& link, std::size_t index, std::size_t count) {
+    QJsonObject json;
+    json["type"] = "STRIPE";
+    json["link"] = QString::fromStdString(link);
+    json["index"] = static_cast<int>(index);
+    json["count"] = static_cast<int>(count);
+    return QJsonDocument(json).toJson(QJsonDocument::Compact).toStdString();
+}
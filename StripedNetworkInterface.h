@@ -0,0 +1,109 @@
+#ifndef STRIPEDNETWORKINTERFACE_H
+#define STRIPEDNETWORKINTERFACE_H
+
+#include <QString>
+#include <boost/asio.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AbstractNetworkInterface.h"
+
+// One logical link carried over several TCP connections. Messages are sharded by entity id, so each
+// id's updates stay in order on one connection, and every connection is received on its own thread.
+class StripedNetworkInterface : public AbstractNetworkInterface {
+public:
+    static constexpr std::size_t kMaxStripes = 64;
+    // Messages received on the stripes but not yet returned, receive threads wait beyond this
+    static constexpr std::size_t kMaxReceived = 4096;
+
+    // Client side, initialise() opens count connections to the same address and port
+    explicit StripedNetworkInterface(std::size_t count);
+    // Server side, accept the connections of one striped client in turn. Throws std::runtime_error
+    // if a connection does not start with a stripe hello, or belongs to another link.
+    static std::unique_ptr<StripedNetworkInterface> accept(boost::asio::ip::tcp::acceptor& acceptor);
+    ~StripedNetworkInterface() override;
+    StripedNetworkInterface(const StripedNetworkInterface&) = delete;
+    StripedNetworkInterface& operator=(const StripedNetworkInterface&) = delete;
+
+    std::size_t stripeCount() const { return stripes.size(); }
+    // The stripe that carries everything about an id
+    std::size_t stripeFor(const QString& id) const;
+
+    void initialise(const std::string& address, unsigned short port) override;
+    bool sendPE(const PE& pe) override;
+    bool sendEmitter(const Emitter& emitter) override;
+    bool sendBlob(const std::string& blobString) override;
+    bool sendComplexBlob(const PE& pe, const Emitter& emitter, const std::map<std::string, double>& doubleMap) override;
+    bool sendPESetting(const std::string& setting, const std::string& id, int updateVal) override;
+    bool sendEmitterSetting(const std::string& setting, const std::string& id, int updateVal) override;
+    std::tuple<std::string, std::string, std::string, int> receiveSetting() override;
+    PE receivePE() override;
+    Emitter receiveEmitter() override;
+    std::vector<std::string> receiveBlob() override;
+    std::tuple<PE, Emitter, std::map<std::string, double>> receiveComplexBlob() override;
+    // Batches, setting batches and snapshots are split into one part per stripe, the typed receives merge the parts
+    // while receiveMessage() returns each batch or snapshot part as it arrives. Setting batches are applied as a unit,
+    // so receiveMessage() merges their parts too.
+    bool sendPEBatch(const std::vector<PE>& pes) override;
+    bool sendEmitterBatch(const std::vector<Emitter>& emitters) override;
+    std::vector<PE> receivePEBatch() override;
+    std::vector<Emitter> receiveEmitterBatch() override;
+    bool sendSettingBatch(const std::vector<std::tuple<std::string, std::string, std::string, int>>& settings) override;
+    std::vector<std::tuple<std::string, std::string, std::string, int>> receiveSettingBatch() override;
+    bool sendSnapshot(const EntitySnapshot& snapshot) override;
+    EntitySnapshot receiveSnapshot() override;
+    // The next message from any stripe, messages from one stripe come out in the order they were sent.
+    // Call from one thread at a time.
+    NetworkMessage receiveMessage() override;
+    void close() override;
+
+private:
+    struct Received {
+        std::size_t stripe;
+        NetworkMessage message;
+        std::exception_ptr error;
+    };
+
+    explicit StripedNetworkInterface(std::vector<std::unique_ptr<NetworkImplementation>> stripes);
+    void startReceiving();
+    void receiveLoop(std::size_t stripe);
+    Received take();
+    NetworkMessage takeKind(NetworkMessage::Kind kind, const char* name);
+    NetworkMessage takeParts(NetworkMessage::Kind kind, const char* name);
+    // Keep a message back for requeue(), it still counts against kMaxReceived
+    void hold(std::deque<Received>& items, Received item);
+    // Put held messages back at the front of the received queue, in order
+    void requeue(std::deque<Received>& items);
+    static std::string encodeHello(const std::string& link, std::size_t index, std::size_t count);
+
+    std::vector<std::unique_ptr<NetworkImplementation>> stripes;
+
+    std::mutex receivedMutex;
+    std::condition_variable receivedReady;
+    std::condition_variable receivedSpace;
+    std::deque<Received> received;
+    bool receiving = false;
+    bool closing = false;
+    std::size_t openStripes = 0;
+    std::exception_ptr linkError;
+    // Messages taken off the queue but held back by a merge, in total and per stripe
+    std::size_t held = 0;
+    std::vector<std::size_t> heldFrom;
+    std::vector<std::thread> receiveThreads;
+
+    // Held while the parts of one setting batch are sent, so concurrent batches reach every stripe in the same order
+    std::mutex settingBatchMutex;
+    // The setting batch receiveMessage() is merging, and the messages sent after a stripe's part of it
+    NetworkMessage settingBatch;
+    std::vector<bool> settingBatchSeen;
+    std::size_t settingBatchParts = 0;
+    std::deque<Received> afterSettingBatch;
+};
+
+#endif // STRIPEDNETWORKINTERFACE_H
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include "StripedNetworkInterface.h"
+#include <boost/system/system_error.hpp>
+#include <algorithm>
+#include <map>
+#include <thread>
+
+namespace {
+PE makePE(int id, double lat) {
+    return PE(QString("PE%1").arg(id), "F18", lat, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+}
+
+class StripedNetworkInterfaceTest : public ::testing::Test {
+protected:
+    // Listening on an ephemeral port, the client connects every stripe before accept() returns
+    void SetUp() override {
+        boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        client = std::make_unique<StripedNetworkInterface>(4);
+        std::thread connector([this, port = acceptor.local_endpoint().port()]() {
+            client->initialise("127.0.0.1", port);
+        });
+        server = StripedNetworkInterface::accept(acceptor);
+        connector.join();
+    }
+
+    boost::asio::io_context io_context;
+    std::unique_ptr<StripedNetworkInterface> client;
+    std::unique_ptr<StripedNetworkInterface> server;
+};
+}
+
+TEST_F(StripedNetworkInterfaceTest, BothEndsAgreeOnTheStripes) {
+    EXPECT_EQ(client->stripeCount(), 4u);
+    EXPECT_EQ(server->stripeCount(), 4u);
+    EXPECT_EQ(StripedNetworkInterface(0).stripeCount(), 1u);
+    EXPECT_EQ(StripedNetworkInterface(1000).stripeCount(), StripedNetworkInterface::kMaxStripes);
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(client->stripeFor(QString("PE%1").arg(i)), server->stripeFor(QString("PE%1").arg(i)));
+    }
+}
+
+TEST_F(StripedNetworkInterfaceTest, EachIdsUpdatesStayInOrder) {
+    const int ids = 50;
+    const int updates = 200;
+    std::thread sender([this]() {
+        for (int update = 0; update < updates; ++update) {
+            for (int id = 0; id < ids; ++id) {
+                client->sendPE(makePE(id, update * 0.1));
+            }
+        }
+    });
+    std::map<QString, double> last;
+    for (int i = 0; i < ids * updates; ++i) {
+        const PE pe = server->receivePE();
+        auto previous = last.find(pe.id);
+        if (previous != last.end()) {
+            ASSERT_GT(pe.lat, previous->second) << pe.id.toStdString();
+        }
+        last[pe.id] = pe.lat;
+    }
+    sender.join();
+    EXPECT_EQ(last.size(), static_cast<std::size_t>(ids));
+}
+
+TEST_F(StripedNetworkInterfaceTest, SettingsFollowTheirEntity) {
+    for (int id = 0; id < 16; ++id) {
+        ASSERT_TRUE(client->sendPE(makePE(id, 1.0)));
+        ASSERT_TRUE(client->sendPESetting("JAM", QString("PE%1").arg(id).toStdString(), id));
+    }
+    std::map<std::string, bool> seenPE;
+    for (int i = 0; i < 32; ++i) {
+        NetworkMessage message = server->receiveMessage();
+        if (message.kind == NetworkMessage::Kind::PE) {
+            seenPE[message.pes.front().id.toStdString()] = true;
+        } else {
+            ASSERT_EQ(message.kind, NetworkMessage::Kind::Setting);
+            EXPECT_TRUE(seenPE[std::get<1>(message.setting)]) << std::get<1>(message.setting);
+        }
+    }
+}
+
+TEST_F(StripedNetworkInterfaceTest, TypedReceivesMergeTheParts) {
+    EntitySnapshot snapshot;
+    snapshot.sequence = 42;
+    std::vector<PE> batch;
+    for (int id = 0; id < 30; ++id) {
+        snapshot.pes.push_back(makePE(id, 1.0));
+        batch.push_back(makePE(id, 2.0));
+    }
+    snapshot.emitters.push_back(Emitter("E1", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, false));
+    ASSERT_TRUE(client->sendSnapshot(snapshot));
+    ASSERT_TRUE(client->sendPEBatch(batch));
+
+    const EntitySnapshot merged = server->receiveSnapshot();
+    EXPECT_EQ(merged.sequence, 42u);
+    EXPECT_EQ(merged.pes.size(), snapshot.pes.size());
+    EXPECT_EQ(merged.emitters.size(), 1u);
+    EXPECT_EQ(server->receivePEBatch().size(), batch.size());
+}
+
+TEST_F(StripedNetworkInterfaceTest, SettingBatchesFollowTheirEntities) {
+    std::vector<std::tuple<std::string, std::string, std::string, int>> settings;
+    for (int id = 0; id < 40; ++id) {
+        settings.emplace_back("PE_SETTING", "PE" + std::to_string(id), "JAM", id);
+    }
+    EXPECT_FALSE(client->sendSettingBatch({{"PE_SETTING", "PE1", "JAM", 1}, {"PE_SETTING", "", "JAM", 1}}));
+    ASSERT_TRUE(client->sendSettingBatch(settings));
+
+    auto merged = server->receiveSettingBatch();
+    ASSERT_EQ(merged.size(), settings.size());
+    std::sort(merged.begin(), merged.end());
+    std::sort(settings.begin(), settings.end());
+    EXPECT_EQ(merged, settings);
+}
+
+TEST_F(StripedNetworkInterfaceTest, ReceiveMessageMergesSettingBatchesInOrder) {
+    // Each round: a PE, a batch jamming every PE at the round's value, then the PE again
+    const int rounds = 20;
+    std::thread sender([this]() {
+        for (int round = 0; round < rounds; ++round) {
+            std::vector<std::tuple<std::string, std::string, std::string, int>> settings;
+            for (int id = 0; id < 12; ++id) {
+                ASSERT_TRUE(client->sendPE(makePE(id, round)));
+                settings.emplace_back("PE_SETTING", "PE" + std::to_string(id), "JAM", round);
+            }
+            ASSERT_TRUE(client->sendSettingBatch(settings));
+            for (int id = 0; id < 12; ++id) {
+                ASSERT_TRUE(client->sendPE(makePE(id, round + 0.5)));
+            }
+        }
+    });
+    std::map<std::string, double> lastLat;
+    for (int round = 0; round < rounds;) {
+        NetworkMessage message = server->receiveMessage();
+        if (message.kind == NetworkMessage::Kind::PE) {
+            lastLat[message.pes.front().id.toStdString()] = message.pes.front().lat;
+            continue;
+        }
+        ASSERT_EQ(message.kind, NetworkMessage::Kind::SettingBatch);
+        // Whole, and after every PE sent before it but none sent after it
+        ASSERT_EQ(message.settings.size(), 12u);
+        for (const auto& [type, id, name, value] : message.settings) {
+            EXPECT_EQ(value, round);
+            EXPECT_DOUBLE_EQ(lastLat[id], round) << id;
+        }
+        ++round;
+    }
+    sender.join();
+}
+
+TEST_F(StripedNetworkInterfaceTest, ReceiveMessageReturnsEachPart) {
+    ASSERT_TRUE(client->sendPEBatch({makePE(1, 1.0), makePE(2, 1.0), makePE(3, 1.0)}));
+    std::size_t pes = 0;
+    for (std::size_t part = 0; part < client->stripeCount(); ++part) {
+        NetworkMessage message = server->receiveMessage();
+        ASSERT_EQ(message.kind, NetworkMessage::Kind::PEBatch);
+        pes += message.pes.size();
+    }
+    EXPECT_EQ(pes, 3u);
+}
+
+TEST_F(StripedNetworkInterfaceTest, ClosingEndsTheLinkAfterQueuedMessages) {
+    ASSERT_TRUE(client->sendPE(makePE(7, 1.0)));
+    EXPECT_EQ(server->receivePE().id, "PE7");
+    client->close();
+    EXPECT_THROW(server->receivePE(), boost::system::system_error);
+}
+
+TEST(StripedNetworkInterfaceAcceptTest, ClosingMidMergeReturnsTheArrivedPartsAndHeldMessages) {
+    // Two plain connections posing as the stripes of one link, so one stripe can send its part and close
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    NetworkImplementation stripes[2];
+    for (int i = 0; i < 2; ++i) {
+        stripes[i].initialise("127.0.0.1", acceptor.local_endpoint().port());
+        ASSERT_TRUE(stripes[i].sendBlob("{\"type\":\"STRIPE\",\"link\":\"midmerge\",\"index\":" + std::to_string(i) + ",\"count\":2}"));
+    }
+    std::unique_ptr<StripedNetworkInterface> server = StripedNetworkInterface::accept(acceptor);
+    ASSERT_TRUE(stripes[0].sendSettingBatch({{"PE_SETTING", "PE1", "JAM", 3}}));
+    ASSERT_TRUE(stripes[0].sendPE(makePE(1, 2.0)));
+    stripes[0].close();
+
+    NetworkMessage batch = server->receiveMessage();
+    ASSERT_EQ(batch.kind, NetworkMessage::Kind::SettingBatch);
+    ASSERT_EQ(batch.settings.size(), 1u);
+    EXPECT_EQ(std::get<3>(batch.settings.front()), 3);
+    NetworkMessage after = server->receiveMessage();
+    ASSERT_EQ(after.kind, NetworkMessage::Kind::PE);
+    EXPECT_EQ(after.pes.front().id, "PE1");
+    EXPECT_THROW(server->receiveMessage(), boost::system::system_error);
+}
+
+TEST(StripedNetworkInterfaceAcceptTest, RejectsAConnectionWithoutAHello) {
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    NetworkImplementation plain;
+    plain.initialise("127.0.0.1", acceptor.local_endpoint().port());
+    ASSERT_TRUE(plain.sendPE(makePE(1, 1.0)));
+    EXPECT_THROW(StripedNetworkInterface::accept(acceptor), std::runtime_error);
+}
+
+TEST(StripedNetworkInterfaceAcceptTest, ReceivingBeforeInitialiseThrows) {
+    StripedNetworkInterface unconnected(2);
+    EXPECT_THROW(unconnected.receivePE(), boost::system::system_error);
+}
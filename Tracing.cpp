@@ -0,0 +1,267 @@
+#include "Tracing.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+/*!
+    \class Tracing
+    \brief Low-overhead span tracing for finding where a slow message spent its time.
+
+    ANI_TRACE_SPAN(name) times the enclosing scope. Each thread writes its
+    finished spans into its own ring buffer of kEventsPerThread entries with
+    relaxed stores and no locking, taking timestamps from the CPU's timestamp
+    counter where there is one. Only the most recent spans are kept.
+
+    writeChromeTrace() copies every buffer, converts ticks to microseconds
+    against the steady clock and writes the trace-event JSON format read by
+    chrome://tracing and ui.perfetto.dev. Spans overwritten while they were
+    being copied are left out.
+
+    When ANI_ENABLE_TRACING is not defined the macros compile to nothing and
+    dumps hold no spans.
+*/
+
+static_assert((Tracing::kEventsPerThread & (Tracing::kEventsPerThread - 1)) == 0,
+              "Trace buffer size must be a power of two");
+
+namespace {
+struct TraceSlot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<std::uint64_t> start{0};
+    std::atomic<std::uint64_t> end{0};
+};
+
+struct ThreadBuffer {
+    std::uint32_t tid = 0;
+    // Guarded by the registry mutex, as are floor and live
+    std::string name;
+    // Spans before this index were cleared
+    std::uint64_t floor = 0;
+    bool live = true;
+    // Only the owning thread writes, readers acquire it to see the slots below it
+    std::atomic<std::uint64_t> written{0};
+    std::unique_ptr<TraceSlot[]> slots{new TraceSlot[Tracing::kEventsPerThread]};
+};
+
+struct CopiedSpan {
+    const char* name;
+    std::uint64_t start;
+    std::uint64_t end;
+    std::uint32_t tid;
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Buffers of exited threads stay here, so their spans can still be dumped, until a new thread reuses them
+    std::vector<ThreadBuffer*> buffers;
+    std::uint32_t nextTid = 1;
+    std::uint64_t ticksOrigin = Tracing::now();
+    std::chrono::steady_clock::time_point clockOrigin = std::chrono::steady_clock::now();
+};
+
+// Never destroyed, threads may still record during static destruction
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+struct BufferOwner {
+    ThreadBuffer* buffer = nullptr;
+    BufferOwner() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (ThreadBuffer* candidate : r.buffers) {
+            if (!candidate->live) {
+                buffer = candidate;
+                break;
+            }
+        }
+        if (!buffer) {
+            buffer = new ThreadBuffer;
+            r.buffers.push_back(buffer);
+        }
+        buffer->tid = r.nextTid++;
+        buffer->name.clear();
+        buffer->floor = buffer->written.load(std::memory_order_relaxed);
+        buffer->live = true;
+    }
+    ~BufferOwner() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        buffer->live = false;
+    }
+};
+
+ThreadBuffer& threadBuffer() {
+    thread_local BufferOwner owner;
+    return *owner.buffer;
+}
+
+void writeEscaped(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(*c));
+            out << escaped;
+        } else {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+// Ticks per microsecond, measured between the registry's creation and now
+double ticksPerMicrosecond(const Registry& r) {
+#ifdef ANI_TRACE_HAVE_TSC
+    auto elapsed = std::chrono::steady_clock::now() - r.clockOrigin;
+    // Too short an interval gives a poor estimate of the counter frequency
+    if (elapsed < std::chrono::milliseconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10) - elapsed);
+    }
+    const std::uint64_t ticks = Tracing::now() - r.ticksOrigin;
+    elapsed = std::chrono::steady_clock::now() - r.clockOrigin;
+    const double microseconds = std::chrono::duration<double, std::micro>(elapsed).count();
+    return ticks / microseconds;
+#else
+    (void)r;
+    return 1000.0;
+#endif
+}
+}
+
+/*!
+    \fn void Tracing::record(const char* name, std::uint64_t start, std::uint64_t end)
+    \brief Adds a finished span to the calling thread's buffer, use ANI_TRACE_SPAN instead.
+    \param name The span's name, which must outlive the trace.
+    \param start The now() value when the span began.
+    \param end The now() value when the span ended.
+*/
+void Tracing::record(const char* name, std::uint64_t start, std::uint64_t end) {
+    ThreadBuffer& buffer = threadBuffer();
+    const std::uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    TraceSlot& slot = buffer.slots[index & (kEventsPerThread - 1)];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+/*!
+    \fn void Tracing::setThreadName(const std::string& name)
+    \brief Names the calling thread in dumped traces.
+*/
+void Tracing::setThreadName(const std::string& name) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    buffer.name = name;
+}
+
+/*!
+    \fn void Tracing::clear()
+    \brief Drops every span recorded so far from later dumps.
+*/
+void Tracing::clear() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (ThreadBuffer* buffer : r.buffers) {
+        buffer->floor = buffer->written.load(std::memory_order_acquire);
+    }
+}
+
+/*!
+    \fn void Tracing::writeChromeTrace(std::ostream& out)
+    \brief Writes every buffered span as Chrome trace-event JSON.
+    \param out The stream to write to.
+
+    Each span is a complete ("X") event with its start and duration in
+    microseconds, and each named thread gets a thread_name metadata event.
+    Recording carries on while the buffers are copied.
+*/
+void Tracing::writeChromeTrace(std::ostream& out) {
+    Registry& r = registry();
+    std::vector<CopiedSpan> spans;
+    std::vector<std::pair<std::uint32_t, std::string>> names;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (ThreadBuffer* buffer : r.buffers) {
+            const std::uint64_t written = buffer->written.load(std::memory_order_acquire);
+            const std::uint64_t first = std::max(buffer->floor, written > kEventsPerThread ? written - kEventsPerThread : 0);
+            const std::size_t copiedFrom = spans.size();
+            for (std::uint64_t i = first; i < written; ++i) {
+                const TraceSlot& slot = buffer->slots[i & (kEventsPerThread - 1)];
+                spans.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                                 slot.end.load(std::memory_order_relaxed), buffer->tid});
+            }
+            // The owner may have wrapped around onto slots while they were copied
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::uint64_t after = buffer->written.load(std::memory_order_acquire);
+            if (after > kEventsPerThread && after - kEventsPerThread >= first) {
+                const std::uint64_t overwritten = std::min(after - kEventsPerThread + 1, written) - first;
+                spans.erase(spans.begin() + static_cast<std::ptrdiff_t>(copiedFrom),
+                            spans.begin() + static_cast<std::ptrdiff_t>(copiedFrom + overwritten));
+            }
+            if (!buffer->name.empty()) {
+                names.emplace_back(buffer->tid, buffer->name);
+            }
+        }
+    }
+    const double ticksPerUs = ticksPerMicrosecond(r);
+
+    std::uint64_t origin = r.ticksOrigin;
+    for (const CopiedSpan& span : spans) {
+        origin = std::min(origin, span.start);
+    }
+    char number[64];
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& [tid, name] : names) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+        writeEscaped(out, name.c_str());
+        out << "}}";
+        first = false;
+    }
+    for (const CopiedSpan& span : spans) {
+        out << (first ? "" : ",") << "\n{\"name\":";
+        writeEscaped(out, span.name ? span.name : "");
+        std::snprintf(number, sizeof(number), "%.3f", (span.start - origin) / ticksPerUs);
+        out << ",\"cat\":\"ani\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.tid << ",\"ts\":" << number;
+        std::snprintf(number, sizeof(number), "%.3f", (span.end > span.start ? span.end - span.start : 0) / ticksPerUs);
+        out << ",\"dur\":" << number << '}';
+        first = false;
+    }
+    out << "\n]}\n";
+}
+
+/*!
+    \fn std::string Tracing::chromeTrace()
+    \brief Returns writeChromeTrace() as a string.
+*/
+std::string Tracing::chromeTrace() {
+    std::ostringstream out;
+    writeChromeTrace(out);
+    return out.str();
+}
+
+/*!
+    \fn bool Tracing::dump(const std::string& path)
+    \brief Writes the Chrome trace JSON to a file.
+    \param path The file to create or overwrite.
+    \return True if the file was written.
+*/
+bool Tracing::dump(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+    writeChromeTrace(file);
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,77 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define ANI_TRACE_HAVE_TSC
+#endif
+
+// Scoped spans recorded into per-thread ring buffers and dumped as Chrome trace-event JSON
+class Tracing {
+public:
+    // Most recent spans kept per thread, older ones are overwritten
+    static constexpr std::size_t kEventsPerThread = 1 << 16;
+
+    // Timestamp counter ticks on x86, steady clock nanoseconds elsewhere
+    static std::uint64_t now() {
+#ifdef ANI_TRACE_HAVE_TSC
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+    // name must outlive the trace, in practice a string literal
+    static void record(const char* name, std::uint64_t start, std::uint64_t end);
+    // Label the calling thread in dumped traces
+    static void setThreadName(const std::string& name);
+    // Forget every span recorded so far
+    static void clear();
+    // Chrome/Perfetto trace-event JSON holding the spans still in every thread's buffer
+    static void writeChromeTrace(std::ostream& out);
+    static std::string chromeTrace();
+    // Write writeChromeTrace() to a file, returns false if it cannot be written
+    static bool dump(const std::string& path);
+    static constexpr bool enabled() {
+#ifdef ANI_ENABLE_TRACING
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+// Records the time from construction to destruction as a complete event
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : name(name), start(Tracing::now()) {}
+    ~TraceSpan() { Tracing::record(name, start, Tracing::now()); }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    std::uint64_t start;
+};
+
+// Spans and thread names compile to nothing unless ANI_ENABLE_TRACING is defined
+#ifdef ANI_ENABLE_TRACING
+#define ANI_TRACE_CONCAT_INNER(a, b) a##b
+#define ANI_TRACE_CONCAT(a, b) ANI_TRACE_CONCAT_INNER(a, b)
+#define ANI_TRACE_SPAN(name) TraceSpan ANI_TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define ANI_TRACE_THREAD_NAME(name) Tracing::setThreadName(name)
+#else
+#define ANI_TRACE_SPAN(name) do {} while (0)
+#define ANI_TRACE_THREAD_NAME(name) do {} while (0)
+#endif
+
+#endif // TRACING_H
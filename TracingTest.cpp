@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "Tracing.h"
+#include <regex>
+#include <thread>
+
+namespace {
+struct ParsedSpan {
+    std::string name;
+    int tid;
+    double ts;
+    double dur;
+};
+
+std::vector<ParsedSpan> parseSpans(const std::string& trace) {
+    static const std::regex span("\\{\"name\":\"([^\"]*)\",\"cat\":\"ani\",\"ph\":\"X\",\"pid\":1,\"tid\":(\\d+),\"ts\":([0-9.]+),\"dur\":([0-9.]+)\\}");
+    std::vector<ParsedSpan> spans;
+    for (auto it = std::sregex_iterator(trace.begin(), trace.end(), span); it != std::sregex_iterator(); ++it) {
+        spans.push_back({(*it)[1], std::stoi((*it)[2]), std::stod((*it)[3]), std::stod((*it)[4])});
+    }
+    return spans;
+}
+
+const ParsedSpan* find(const std::vector<ParsedSpan>& spans, const std::string& name) {
+    for (const auto& span : spans) {
+        if (span.name == name) {
+            return &span;
+        }
+    }
+    return nullptr;
+}
+}
+
+TEST(TracingTest, NestedSpansAreContainedInTheirParent) {
+    Tracing::clear();
+    {
+        TraceSpan outer("outer");
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        {
+            TraceSpan inner("inner");
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    const std::string trace = Tracing::chromeTrace();
+    EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+
+    const auto spans = parseSpans(trace);
+    ASSERT_EQ(spans.size(), 2u);
+    const ParsedSpan* outer = find(spans, "outer");
+    const ParsedSpan* inner = find(spans, "inner");
+    ASSERT_TRUE(outer && inner);
+    EXPECT_EQ(outer->tid, inner->tid);
+    EXPECT_LE(outer->ts, inner->ts);
+    EXPECT_GE(outer->ts + outer->dur, inner->ts + inner->dur);
+    // Ticks are converted to microseconds, allowing for a coarse calibration
+    EXPECT_GT(inner->dur, 1000.0);
+    EXPECT_LT(inner->dur, 200000.0);
+    EXPECT_GT(outer->dur, 3000.0);
+}
+
+TEST(TracingTest, ThreadsGetTheirOwnNamedTracks) {
+    Tracing::clear();
+    std::thread worker([]() {
+        Tracing::setThreadName("worker \"one\"");
+        TraceSpan span("onWorker");
+    });
+    worker.join();
+    {
+        TraceSpan span("onMain");
+    }
+    const std::string trace = Tracing::chromeTrace();
+    const auto spans = parseSpans(trace);
+    const ParsedSpan* onWorker = find(spans, "onWorker");
+    const ParsedSpan* onMain = find(spans, "onMain");
+    ASSERT_TRUE(onWorker && onMain);
+    EXPECT_NE(onWorker->tid, onMain->tid);
+    // Spans of threads that have exited are kept until the buffer is reused
+    EXPECT_NE(trace.find("\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(onWorker->tid)
+                         + ",\"args\":{\"name\":\"worker \\\"one\\\"\"}"), std::string::npos);
+}
+
+TEST(TracingTest, OnlyTheMostRecentSpansAreKept) {
+    Tracing::clear();
+    static const char* const names[] = {"old", "new"};
+    for (std::size_t i = 0; i < Tracing::kEventsPerThread + 10; ++i) {
+        const std::uint64_t now = Tracing::now();
+        Tracing::record(i < 10 ? names[0] : names[1], now, now);
+    }
+    const auto spans = parseSpans(Tracing::chromeTrace());
+    // The oldest slot may be mid-overwrite by its owner, so a dump of a full buffer leaves it out
+    EXPECT_GE(spans.size(), Tracing::kEventsPerThread - 1);
+    EXPECT_LE(spans.size(), Tracing::kEventsPerThread);
+    EXPECT_EQ(find(spans, "old"), nullptr);
+
+    Tracing::clear();
+    EXPECT_TRUE(parseSpans(Tracing::chromeTrace()).empty());
+}
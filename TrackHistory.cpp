@@ -0,0 +1,284 @@
+#include "TrackHistory.h"
+#include <algorithm>
+#include <cmath>
+
+/*!
+    \class TrackHistory
+    \brief Recent timestamped positions per entity, for track trails and short-horizon queries.
+
+    Each entity id gets a ring of TrackHistoryConfig::capacity samples the first
+    time it is recorded, up to TrackHistoryConfig::maxEntities rings. Every ring
+    lives in one slab of samples, which grows by doubling as new ids take rings
+    and never shrinks, so a history that records few ids costs little and
+    recording only allocates when the slab grows; once a ring is full each new
+    sample overwrites the oldest. Samples for an id must be recorded in
+    time order, which keeps every ring sorted for positionAt().
+
+    When a new id arrives and every ring is taken, the rings of ids with no
+    sample for idleTimeout are freed, and if there are none the least recently
+    updated id loses its ring. Freed rings are filled by moving the last ring
+    into the gap, so the rings stay packed at the front of the slab.
+
+    Recording and queries take an internal lock, so a network thread can record
+    while the GUI thread draws trails.
+*/
+
+namespace {
+double secondsBetween(DeadReckoning::Clock::time_point from, DeadReckoning::Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+// Shortest way round from a to b, for longitudes and headings in degrees
+double angleDelta(double a, double b) {
+    double delta = std::fmod(b - a, 360.0);
+    if (delta > 180.0) delta -= 360.0;
+    if (delta < -180.0) delta += 360.0;
+    return delta;
+}
+
+double wrapDegrees(double angle, double low) {
+    angle = std::fmod(angle - low, 360.0);
+    if (angle < 0.0) angle += 360.0;
+    return angle + low;
+}
+
+TrackSample interpolate(const TrackSample& a, const TrackSample& b, DeadReckoning::Clock::time_point time) {
+    const double span = secondsBetween(a.time, b.time);
+    const double t = span > 0.0 ? secondsBetween(a.time, time) / span : 1.0;
+    TrackSample sample;
+    sample.time = time;
+    sample.lat = a.lat + (b.lat - a.lat) * t;
+    sample.lon = wrapDegrees(a.lon + angleDelta(a.lon, b.lon) * t, -180.0);
+    sample.altitude = a.altitude + (b.altitude - a.altitude) * t;
+    sample.speed = a.speed + (b.speed - a.speed) * t;
+    sample.heading = wrapDegrees(a.heading + angleDelta(a.heading, b.heading) * t, 0.0);
+    return sample;
+}
+}
+
+/*!
+    \fn TrackSample TrackSample::from(const PE& pe, DeadReckoning::Clock::time_point time)
+    \brief Takes the position, speed and heading of a PE as a sample at time.
+*/
+TrackSample TrackSample::from(const PE& pe, DeadReckoning::Clock::time_point time) {
+    return TrackSample{time, pe.lat, pe.lon, pe.altitude, pe.speed, pe.heading};
+}
+
+/*!
+    \fn TrackSample TrackSample::from(const Emitter& emitter, DeadReckoning::Clock::time_point time)
+    \brief Takes the position, speed and heading of an Emitter as a sample at time.
+*/
+TrackSample TrackSample::from(const Emitter& emitter, DeadReckoning::Clock::time_point time) {
+    return TrackSample{time, emitter.lat, emitter.lon, emitter.altitude, emitter.speed, emitter.heading};
+}
+
+/*!
+    \fn TrackHistory::TrackHistory(const TrackHistoryConfig& config)
+    \brief Creates an empty history, the slab is allocated as ids are recorded.
+    \param config Ring capacity and entity limit, a capacity of 0 is treated as 1.
+*/
+TrackHistory::TrackHistory(const TrackHistoryConfig& config) : settings(config) {
+    settings.capacity = std::max<std::size_t>(settings.capacity, 1);
+}
+
+/*!
+    \fn bool TrackHistory::record(const QString& id, const TrackSample& sample)
+    \brief Appends a sample to the ring for id.
+    \return True if the sample was kept, false if it is older than the newest
+            sample for id or maxEntities is 0.
+
+    A sample with the same time as the newest one is kept after it.
+*/
+bool TrackHistory::record(const QString& id, const TrackSample& sample) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = ringIndex.constFind(id);
+    std::size_t ring;
+    if (found != ringIndex.constEnd()) {
+        ring = found.value();
+        const Ring& state = rings[ring];
+        if (state.count > 0 && sample.time < sampleAt(ring, state, state.count - 1).time) {
+            return false;
+        }
+    } else {
+        if (settings.maxEntities == 0) {
+            return false;
+        }
+        if (rings.size() == settings.maxEntities) {
+            evictLocked(sample.time);
+        }
+        ring = rings.size();
+        if (slab.size() < (ring + 1) * settings.capacity) {
+            const std::size_t ringsHeld = std::min(settings.maxEntities, std::max<std::size_t>(kInitialRings, ring * 2));
+            slab.resize(ringsHeld * settings.capacity);
+        }
+        rings.emplace_back();
+        rings.back().id = id;
+        ringIndex.insert(id, static_cast<std::uint32_t>(ring));
+    }
+    Ring& state = rings[ring];
+    slab[ring * settings.capacity + state.head] = sample;
+    state.head = static_cast<std::uint32_t>((state.head + 1) % settings.capacity);
+    state.count = static_cast<std::uint32_t>(std::min<std::size_t>(state.count + 1, settings.capacity));
+    return true;
+}
+
+/*!
+    \fn std::size_t TrackHistory::last(const QString& id, std::size_t count, TrackSample* out) const
+    \brief Copies the newest samples for id, oldest first.
+    \param id The entity id.
+    \param count The most samples to copy, out must have room for this many.
+    \param out Where the samples are copied to.
+    \return The number of samples copied, 0 if id has never been recorded.
+*/
+std::size_t TrackHistory::last(const QString& id, std::size_t count, TrackSample* out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = ringIndex.constFind(id);
+    if (found == ringIndex.constEnd()) {
+        return 0;
+    }
+    const std::size_t ring = found.value();
+    const Ring& state = rings[ring];
+    const std::size_t copied = std::min<std::size_t>(count, state.count);
+    for (std::size_t i = 0; i < copied; ++i) {
+        out[i] = sampleAt(ring, state, state.count - copied + i);
+    }
+    return copied;
+}
+
+/*!
+    \fn std::optional<TrackSample> TrackHistory::positionAt(const QString& id, DeadReckoning::Clock::time_point time) const
+    \brief Estimates where id was, or is about to be, at a point in time.
+    \return The sample at time, empty if id is unknown, time is before the oldest
+            sample held, or time is more than maxExtrapolation past the newest.
+
+    Between two samples lat, lon, altitude, speed and heading are interpolated
+    linearly, taking the short way round for longitude and heading. Past the
+    newest sample the position is moved along its heading at its speed with
+    DeadReckoning::extrapolate(), as a dead-reckoning receiver would display it.
+*/
+std::optional<TrackSample> TrackHistory::positionAt(const QString& id, DeadReckoning::Clock::time_point time) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = ringIndex.constFind(id);
+    if (found == ringIndex.constEnd()) {
+        return std::nullopt;
+    }
+    const std::size_t ring = found.value();
+    const Ring& state = rings[ring];
+    if (state.count == 0 || time < sampleAt(ring, state, 0).time) {
+        return std::nullopt;
+    }
+    const TrackSample& newest = sampleAt(ring, state, state.count - 1);
+    if (time >= newest.time) {
+        if (time - newest.time > settings.maxExtrapolation) {
+            return std::nullopt;
+        }
+        TrackSample sample = newest;
+        sample.time = time;
+        DeadReckoning::extrapolate(sample.lat, sample.lon, sample.speed, sample.heading,
+                                   secondsBetween(newest.time, time), settings.speedToMetresPerSecond);
+        return sample;
+    }
+    // First sample after time, there is one since time is before the newest
+    std::size_t low = 1;
+    std::size_t high = state.count - 1;
+    while (low < high) {
+        const std::size_t middle = low + (high - low) / 2;
+        if (sampleAt(ring, state, middle).time <= time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return interpolate(sampleAt(ring, state, low - 1), sampleAt(ring, state, low), time);
+}
+
+/*!
+    \fn std::size_t TrackHistory::size(const QString& id) const
+    \brief Returns the number of samples held for id, at most capacity().
+*/
+std::size_t TrackHistory::size(const QString& id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = ringIndex.constFind(id);
+    return found == ringIndex.constEnd() ? 0 : rings[found.value()].count;
+}
+
+/*!
+    \fn std::size_t TrackHistory::entityCount() const
+    \brief Returns the number of ids with a ring.
+*/
+std::size_t TrackHistory::entityCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return rings.size();
+}
+
+/*!
+    \fn std::size_t TrackHistory::evictedCount() const
+    \brief Returns the number of rings taken from idle or least recently updated ids to make room for new ones.
+*/
+std::size_t TrackHistory::evictedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return evicted;
+}
+
+/*!
+    \fn void TrackHistory::forget(const QString& id)
+    \brief Frees the ring of id, if it has one, so a later sample for id starts a new trail.
+*/
+void TrackHistory::forget(const QString& id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = ringIndex.constFind(id);
+    if (found != ringIndex.constEnd()) {
+        removeLocked(found.value());
+    }
+}
+
+/*!
+    \fn void TrackHistory::clear()
+    \brief Forgets every id and sample, keeping the slab for reuse.
+*/
+void TrackHistory::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    rings.clear();
+    ringIndex.clear();
+    evicted = 0;
+}
+
+const TrackSample& TrackHistory::sampleAt(std::size_t ring, const Ring& state, std::size_t index) const {
+    const std::size_t oldest = (state.head + settings.capacity - state.count) % settings.capacity;
+    return slab[ring * settings.capacity + (oldest + index) % settings.capacity];
+}
+
+void TrackHistory::evictLocked(DeadReckoning::Clock::time_point now) {
+    std::size_t leastRecent = 0;
+    DeadReckoning::Clock::time_point leastRecentTime = DeadReckoning::Clock::time_point::max();
+    const std::size_t before = rings.size();
+    // Backwards, so the ring moved into a freed slot has already been looked at
+    for (std::size_t i = rings.size(); i-- > 0;) {
+        const DeadReckoning::Clock::time_point newest = sampleAt(i, rings[i], rings[i].count - 1).time;
+        if (now - newest >= settings.idleTimeout) {
+            if (leastRecent == rings.size() - 1) {
+                leastRecent = i;
+            }
+            removeLocked(i);
+        } else if (newest < leastRecentTime) {
+            leastRecent = i;
+            leastRecentTime = newest;
+        }
+    }
+    if (rings.size() == before) {
+        removeLocked(leastRecent);
+    }
+    evicted += before - rings.size();
+}
+
+void TrackHistory::removeLocked(std::size_t ring) {
+    ringIndex.remove(rings[ring].id);
+    const std::size_t last = rings.size() - 1;
+    if (ring != last) {
+        std::copy_n(slab.begin() + static_cast<std::ptrdiff_t>(last * settings.capacity), settings.capacity,
+                    slab.begin() + static_cast<std::ptrdiff_t>(ring * settings.capacity));
+        rings[ring] = std::move(rings[last]);
+        ringIndex.insert(rings[ring].id, static_cast<std::uint32_t>(ring));
+    }
+    rings.pop_back();
+}
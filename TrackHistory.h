@@ -0,0 +1,97 @@
+#ifndef TRACKHISTORY_H
+#define TRACKHISTORY_H
+
+#include <QHash>
+#include <QString>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "DeadReckoning.h"
+#include "pe.h"
+#include "emitter.h"
+
+// One timestamped position of a PE or Emitter
+struct TrackSample {
+    DeadReckoning::Clock::time_point time;
+    double lat = 0.0;
+    double lon = 0.0;
+    double altitude = 0.0;
+    double speed = 0.0;
+    double heading = 0.0;
+
+    static TrackSample from(const PE& pe, DeadReckoning::Clock::time_point time);
+    static TrackSample from(const Emitter& emitter, DeadReckoning::Clock::time_point time);
+};
+
+struct TrackHistoryConfig {
+    // Samples kept per entity, the oldest is overwritten once the ring is full
+    std::size_t capacity = 32;
+    // Entities with a ring. Once every ring is taken, a new id frees the rings of ids idle for
+    // idleTimeout, or failing that takes the ring of the least recently updated id.
+    std::size_t maxEntities = 4096;
+    std::chrono::milliseconds idleTimeout{60000};
+    // Converts the speed field to metres per second when extrapolating past the newest sample
+    double speedToMetresPerSecond = DeadReckoningConfig().speedToMetresPerSecond;
+    // Furthest positionAt() extrapolates past the newest sample
+    std::chrono::milliseconds maxExtrapolation{5000};
+};
+
+// Fixed-capacity ring of recent positions per entity id, all rings in one slab that grows with the
+// number of ids. Safe to record on one thread while others query.
+class TrackHistory {
+public:
+    explicit TrackHistory(const TrackHistoryConfig& config = TrackHistoryConfig());
+    TrackHistory(const TrackHistory&) = delete;
+    TrackHistory& operator=(const TrackHistory&) = delete;
+
+    // Append a sample, false if it is older than the newest sample for id or maxEntities is 0
+    bool record(const QString& id, const TrackSample& sample);
+    bool record(const PE& pe, DeadReckoning::Clock::time_point time) { return record(pe.id, TrackSample::from(pe, time)); }
+    bool record(const Emitter& emitter, DeadReckoning::Clock::time_point time) {
+        return record(emitter.id, TrackSample::from(emitter, time));
+    }
+
+    // Copy up to count of the newest samples for id into out, oldest first, and return how many were copied
+    std::size_t last(const QString& id, std::size_t count, TrackSample* out) const;
+    // Position at time, interpolated between the samples either side or extrapolated a short way past the
+    // newest one, empty if id is unknown or time is before its oldest sample or too far past its newest
+    std::optional<TrackSample> positionAt(const QString& id, DeadReckoning::Clock::time_point time) const;
+
+    // Samples currently held for id
+    std::size_t size(const QString& id) const;
+    std::size_t entityCount() const;
+    std::size_t capacity() const { return settings.capacity; }
+    // Rings taken from idle or least recently updated ids to make room for new ones
+    std::size_t evictedCount() const;
+    const TrackHistoryConfig& config() const { return settings; }
+    // Free the ring of one entity, for example once it has been deleted
+    void forget(const QString& id);
+    // Forget every entity, the slab is kept
+    void clear();
+
+private:
+    // Rings the slab first grows to, it doubles from there up to maxEntities
+    static constexpr std::size_t kInitialRings = 16;
+    struct Ring {
+        QString id;
+        std::uint32_t head = 0;  // Slot the next sample goes into
+        std::uint32_t count = 0;
+    };
+    // Sample index within a ring, 0 is the oldest held
+    const TrackSample& sampleAt(std::size_t ring, const Ring& state, std::size_t index) const;
+    // Free rings idle at now, or the least recently updated one if none is idle, caller holds the lock
+    void evictLocked(DeadReckoning::Clock::time_point now);
+    // Move the last ring into this one's place, caller holds the lock
+    void removeLocked(std::size_t ring);
+
+    TrackHistoryConfig settings;
+    mutable std::mutex mutex;
+    std::vector<TrackSample> slab;
+    std::vector<Ring> rings;
+    QHash<QString, std::uint32_t> ringIndex;
+    std::size_t evicted = 0;
+};
+
+#endif // TRACKHISTORY_H
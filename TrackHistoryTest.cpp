@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include "TrackHistory.h"
+#include <thread>
+
+namespace {
+const DeadReckoning::Clock::time_point kStart{std::chrono::seconds(1000)};
+
+DeadReckoning::Clock::time_point at(int ms) {
+    return kStart + std::chrono::milliseconds(ms);
+}
+
+TrackSample sample(int ms, double lat, double lon, double heading = 0.0, double speed = 0.0) {
+    return TrackSample{at(ms), lat, lon, 1000.0 + ms, speed, heading};
+}
+}
+
+TEST(TrackHistoryTest, LastReturnsTheNewestSamplesOldestFirst) {
+    TrackHistory history(TrackHistoryConfig{4, 8});
+    for (int i = 0; i < 6; ++i) {
+        ASSERT_TRUE(history.record("PE1", sample(i * 100, i, 0.0)));
+    }
+    EXPECT_EQ(history.size("PE1"), 4u);
+
+    TrackSample out[8];
+    ASSERT_EQ(history.last("PE1", 8, out), 4u);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_DOUBLE_EQ(out[i].lat, i + 2.0);
+    }
+    ASSERT_EQ(history.last("PE1", 2, out), 2u);
+    EXPECT_DOUBLE_EQ(out[0].lat, 4.0);
+    EXPECT_DOUBLE_EQ(out[1].lat, 5.0);
+    EXPECT_EQ(history.last("Unknown", 8, out), 0u);
+}
+
+TEST(TrackHistoryTest, EachIdHasItsOwnRing) {
+    TrackHistory history(TrackHistoryConfig{3, 2});
+    ASSERT_TRUE(history.record("A", sample(0, 1.0, 0.0)));
+    ASSERT_TRUE(history.record("B", sample(0, 2.0, 0.0)));
+    EXPECT_EQ(history.entityCount(), 2u);
+
+    TrackSample out[3];
+    ASSERT_EQ(history.last("B", 3, out), 1u);
+    EXPECT_DOUBLE_EQ(out[0].lat, 2.0);
+
+    history.forget("A");
+    EXPECT_EQ(history.size("A"), 0u);
+    ASSERT_EQ(history.last("B", 3, out), 1u);
+    EXPECT_DOUBLE_EQ(out[0].lat, 2.0);
+
+    history.clear();
+    EXPECT_EQ(history.entityCount(), 0u);
+    EXPECT_TRUE(history.record("C", sample(0, 3.0, 0.0)));
+}
+
+TEST(TrackHistoryTest, NewIdsTakeTheRingsOfIdleOrLeastRecentIds) {
+    TrackHistoryConfig config{2, 3};
+    config.idleTimeout = std::chrono::milliseconds(1000);
+    TrackHistory history(config);
+    ASSERT_TRUE(history.record("Idle1", sample(0, 1.0, 0.0)));
+    ASSERT_TRUE(history.record("Busy", sample(0, 2.0, 0.0)));
+    ASSERT_TRUE(history.record("Idle2", sample(100, 3.0, 0.0)));
+    ASSERT_TRUE(history.record("Busy", sample(1500, 2.5, 0.0)));
+
+    // Both idle ids are freed at once
+    ASSERT_TRUE(history.record("New1", sample(1500, 4.0, 0.0)));
+    EXPECT_EQ(history.entityCount(), 2u);
+    EXPECT_EQ(history.evictedCount(), 2u);
+    EXPECT_EQ(history.size("Idle1"), 0u);
+    EXPECT_EQ(history.size("Idle2"), 0u);
+    TrackSample out[2];
+    ASSERT_EQ(history.last("Busy", 2, out), 2u);
+    EXPECT_DOUBLE_EQ(out[1].lat, 2.5);
+
+    // Nobody is idle, so the least recently updated id gives way
+    ASSERT_TRUE(history.record("New2", sample(1600, 5.0, 0.0)));
+    ASSERT_TRUE(history.record("New1", sample(1700, 4.5, 0.0)));
+    ASSERT_TRUE(history.record("New3", sample(1800, 6.0, 0.0)));
+    EXPECT_EQ(history.evictedCount(), 3u);
+    EXPECT_EQ(history.size("Busy"), 0u);
+    EXPECT_EQ(history.size("New1"), 2u);
+    EXPECT_EQ(history.size("New2"), 1u);
+    EXPECT_EQ(history.size("New3"), 1u);
+}
+
+TEST(TrackHistoryTest, RingsKeepTheirSamplesAsTheSlabGrows) {
+    TrackHistory history(TrackHistoryConfig{3, 100});
+    for (int step = 0; step < 3; ++step) {
+        for (int id = 0; id < 100; ++id) {
+            ASSERT_TRUE(history.record(QString("PE%1").arg(id), sample(step * 100, id, step)));
+        }
+    }
+    EXPECT_EQ(history.entityCount(), 100u);
+    EXPECT_EQ(history.evictedCount(), 0u);
+    TrackSample out[3];
+    for (int id = 0; id < 100; ++id) {
+        ASSERT_EQ(history.last(QString("PE%1").arg(id), 3, out), 3u);
+        for (int step = 0; step < 3; ++step) {
+            EXPECT_DOUBLE_EQ(out[step].lat, id);
+            EXPECT_DOUBLE_EQ(out[step].lon, step);
+        }
+    }
+
+    TrackHistory disabled(TrackHistoryConfig{3, 0});
+    EXPECT_FALSE(disabled.record("PE1", sample(0, 1.0, 2.0)));
+    EXPECT_EQ(disabled.entityCount(), 0u);
+}
+
+TEST(TrackHistoryTest, OlderSamplesAreRefused) {
+    TrackHistory history;
+    ASSERT_TRUE(history.record("PE1", sample(100, 1.0, 0.0)));
+    EXPECT_FALSE(history.record("PE1", sample(50, 2.0, 0.0)));
+    EXPECT_TRUE(history.record("PE1", sample(100, 3.0, 0.0)));
+    EXPECT_EQ(history.size("PE1"), 2u);
+}
+
+TEST(TrackHistoryTest, PositionAtInterpolatesBetweenSamples) {
+    TrackHistory history(TrackHistoryConfig{8, 1});
+    for (int i = 0; i < 12; ++i) {
+        ASSERT_TRUE(history.record("PE1", sample(i * 1000, i * 2.0, i % 2 ? -179.5 : 179.5, i % 2 ? 350.0 : 10.0)));
+    }
+    // Only the last 8 samples are held, from 4 s onwards
+    EXPECT_FALSE(history.positionAt("PE1", at(3999)).has_value());
+    EXPECT_FALSE(history.positionAt("Unknown", at(5000)).has_value());
+
+    const auto exact = history.positionAt("PE1", at(5000));
+    ASSERT_TRUE(exact.has_value());
+    EXPECT_DOUBLE_EQ(exact->lat, 10.0);
+
+    const auto between = history.positionAt("PE1", at(6750));
+    ASSERT_TRUE(between.has_value());
+    EXPECT_DOUBLE_EQ(between->lat, 13.5);
+    EXPECT_DOUBLE_EQ(between->altitude, 1000.0 + 6750.0);
+    // Longitude crosses the antimeridian and heading goes the short way round through north
+    EXPECT_NEAR(between->lon, -179.75, 1e-9);
+    EXPECT_NEAR(between->heading, 355.0, 1e-9);
+}
+
+TEST(TrackHistoryTest, PositionAtExtrapolatesAShortWayPastTheNewest) {
+    TrackHistoryConfig config;
+    config.maxExtrapolation = std::chrono::milliseconds(2000);
+    TrackHistory history(config);
+    ASSERT_TRUE(history.record("PE1", sample(0, 10.0, 20.0, 90.0, 500.0)));
+
+    const auto ahead = history.positionAt("PE1", at(1000));
+    ASSERT_TRUE(ahead.has_value());
+    double lat = 10.0;
+    double lon = 20.0;
+    DeadReckoning::extrapolate(lat, lon, 500.0, 90.0, 1.0, config.speedToMetresPerSecond);
+    EXPECT_DOUBLE_EQ(ahead->lat, lat);
+    EXPECT_DOUBLE_EQ(ahead->lon, lon);
+    EXPECT_GT(ahead->lon, 20.0);
+    EXPECT_FALSE(history.positionAt("PE1", at(2001)).has_value());
+}
+
+TEST(TrackHistoryTest, RecordsPEsAndEmitters) {
+    TrackHistory history;
+    PE pe("PE1", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+    pe.heading = 45.0;
+    ASSERT_TRUE(history.record(pe, at(0)));
+    ASSERT_TRUE(history.record(Emitter("E1", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, false), at(0)));
+
+    TrackSample out;
+    ASSERT_EQ(history.last("PE1", 1, &out), 1u);
+    EXPECT_DOUBLE_EQ(out.altitude, 30000.0);
+    EXPECT_DOUBLE_EQ(out.speed, 500.0);
+    EXPECT_DOUBLE_EQ(out.heading, 45.0);
+    ASSERT_EQ(history.last("E1", 1, &out), 1u);
+    EXPECT_DOUBLE_EQ(out.lat, 15.0);
+    EXPECT_DOUBLE_EQ(out.lon, 25.0);
+}
+
+TEST(TrackHistoryTest, QueriesRunWhileRecording) {
+    TrackHistory history(TrackHistoryConfig{16, 4});
+    std::thread recorder([&history]() {
+        for (int i = 0; i < 20000; ++i) {
+            history.record(QString("PE%1").arg(i % 4), sample(i, i, 0.0));
+        }
+    });
+    TrackSample out[16];
+    for (int i = 0; i < 2000; ++i) {
+        const std::size_t copied = history.last("PE0", 16, out);
+        for (std::size_t j = 1; j < copied; ++j) {
+            ASSERT_LT(out[j - 1].time, out[j].time);
+        }
+    }
+    recorder.join();
+    EXPECT_EQ(history.size("PE3"), 16u);
+}
@@ -0,0 +1,411 @@
+#include "TrafficCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+/*!
+    \class TrafficCapture
+    \brief Records raw received frames to memory-mapped segment files.
+
+    Each segment is a fixed-size file, created sparse and mapped read-write, so
+    appending a frame is a bounds check and two memcpy calls under a mutex. The
+    segment header's record count and end offset are only advanced once a
+    record is complete, so a capture cut short by a crash reads back up to its
+    last whole frame. When a segment is full the next one is started.
+
+    Every segment keeps a sparse time index of up to kIndexEntries entries,
+    spread evenly over its data, which CaptureReader::seek() binary searches.
+    Closing trims the last segment to the records it holds.
+
+    NetworkImplementation::setCapture() records every frame the interface reads.
+*/
+
+static_assert(sizeof(CaptureSegmentHeader) == 128, "Capture header layout changed");
+static_assert(sizeof(CaptureIndexEntry) == 16, "Capture index layout changed");
+static_assert(sizeof(CaptureRecordHeader) == 16, "Capture record layout changed");
+
+namespace {
+constexpr const char* kSegmentPrefix = "capture-";
+constexpr const char* kSegmentSuffix = ".anicap";
+
+std::uint64_t paddedLength(std::uint64_t length) {
+    return (length + 7) & ~std::uint64_t(7);
+}
+
+// Returns true and sets number if name is a segment file name
+bool parseSegmentName(const std::string& name, std::uint32_t& number) {
+    const std::size_t prefix = std::strlen(kSegmentPrefix);
+    const std::size_t suffix = std::strlen(kSegmentSuffix);
+    if (name.size() <= prefix + suffix || name.compare(0, prefix, kSegmentPrefix) != 0
+        || name.compare(name.size() - suffix, suffix, kSegmentSuffix) != 0) {
+        return false;
+    }
+    const std::string digits = name.substr(prefix, name.size() - prefix - suffix);
+    if (digits.empty() || !std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return false;
+    }
+    number = static_cast<std::uint32_t>(std::stoul(digits));
+    return true;
+}
+
+std::int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+}
+
+/*!
+    \fn TrafficCapture::TrafficCapture(const std::string& directory, std::uint64_t segmentBytes)
+    \brief Creates the capture directory if needed and opens the first segment.
+    \param directory The directory to write segments to.
+    \param segmentBytes The size of each segment file, including its header and index.
+*/
+TrafficCapture::TrafficCapture(const std::string& directory, std::uint64_t segmentBytes)
+    : directory(directory), segmentBytes(segmentBytes) {
+    const std::uint64_t overhead = sizeof(CaptureSegmentHeader) + kIndexEntries * sizeof(CaptureIndexEntry);
+    if (segmentBytes <= overhead + sizeof(CaptureRecordHeader)) {
+        throw std::invalid_argument("Capture segments must be larger than " + std::to_string(overhead) + " bytes");
+    }
+    std::filesystem::create_directories(directory);
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        std::uint32_t number;
+        if (parseSegmentName(entry.path().filename().string(), number)) {
+            nextSegment = std::max(nextSegment, number + 1);
+        }
+    }
+    if (!openSegment()) {
+        throw std::runtime_error("Cannot create capture segment in " + directory);
+    }
+}
+
+/*!
+    \fn TrafficCapture::~TrafficCapture()
+    \brief Closes the capture, trimming the last segment.
+*/
+TrafficCapture::~TrafficCapture() {
+    close();
+}
+
+/*!
+    \fn std::string TrafficCapture::segmentName(std::uint32_t number)
+    \brief Returns the file name of a segment, such as capture-000003.anicap.
+*/
+std::string TrafficCapture::segmentName(std::uint32_t number) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%s%06u%s", kSegmentPrefix, number, kSegmentSuffix);
+    return name;
+}
+
+/*!
+    \fn bool TrafficCapture::append(const std::string& frame)
+    \brief Records a frame stamped with the current system time.
+    \param frame The frame, without its trailing newline.
+    \return True if the frame was stored, false if it is larger than a segment or the capture is closed.
+*/
+bool TrafficCapture::append(const std::string& frame) {
+    // Stamped under the lock, so timestamps in a segment never go backwards
+    std::lock_guard<std::mutex> lock(mutex);
+    return appendLocked(nowNs(), frame.data(), frame.size());
+}
+
+/*!
+    \fn bool TrafficCapture::append(std::int64_t timestampNs, const char* data, std::size_t size)
+    \brief Records a frame with a given timestamp.
+    \param timestampNs Nanoseconds since the epoch, which should not go backwards between calls.
+    \param data The frame bytes.
+    \param size The number of bytes.
+    \return True if the frame was stored, false if it is larger than a segment or the capture is closed.
+*/
+bool TrafficCapture::append(std::int64_t timestampNs, const char* data, std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return appendLocked(timestampNs, data, size);
+}
+
+bool TrafficCapture::appendLocked(std::int64_t timestampNs, const char* data, std::size_t size) {
+    const std::uint64_t recordBytes = sizeof(CaptureRecordHeader) + paddedLength(size);
+    if (!header || size > std::numeric_limits<std::uint32_t>::max()
+        || recordBytes > header->fileSize - header->dataBegin) {
+        ++dropped;
+        return false;
+    }
+    if (header->dataEnd + recordBytes > header->fileSize) {
+        closeSegment();
+        if (!openSegment()) {
+            ++dropped;
+            return false;
+        }
+    }
+
+    char* base = static_cast<char*>(region.get_address());
+    const std::uint64_t offset = header->dataEnd;
+    const CaptureRecordHeader record{timestampNs, static_cast<std::uint32_t>(size), 0};
+    std::memcpy(base + offset, &record, sizeof(record));
+    std::memcpy(base + offset + sizeof(record), data, size);
+
+    if (header->recordCount == 0) {
+        header->firstTimestampNs = timestampNs;
+    }
+    if (offset >= nextIndexOffset && header->indexCount < header->indexCapacity) {
+        auto* index = reinterpret_cast<CaptureIndexEntry*>(base + sizeof(CaptureSegmentHeader));
+        index[header->indexCount++] = {timestampNs, offset};
+        nextIndexOffset = offset + (header->fileSize - header->dataBegin) / header->indexCapacity;
+    }
+    header->lastTimestampNs = timestampNs;
+    header->recordCount++;
+    header->dataEnd = offset + recordBytes;
+    ++frames;
+    return true;
+}
+
+/*!
+    \fn void TrafficCapture::flush()
+    \brief Writes the current segment's mapped pages back to its file.
+*/
+void TrafficCapture::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (header) {
+        region.flush();
+    }
+}
+
+/*!
+    \fn void TrafficCapture::close()
+    \brief Trims and unmaps the current segment. Later appends are dropped. Safe to call more than once.
+*/
+void TrafficCapture::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closeSegment();
+}
+
+/*!
+    \fn std::uint64_t TrafficCapture::frameCount() const
+    \brief Returns the number of frames stored across every segment.
+*/
+std::uint64_t TrafficCapture::frameCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames;
+}
+
+/*!
+    \fn std::uint64_t TrafficCapture::droppedCount() const
+    \brief Returns the number of frames that could not be stored.
+*/
+std::uint64_t TrafficCapture::droppedCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped;
+}
+
+bool TrafficCapture::openSegment() {
+    segmentPath = (std::filesystem::path(directory) / segmentName(nextSegment++)).string();
+    try {
+        {
+            std::ofstream create(segmentPath, std::ios::binary | std::ios::trunc);
+            if (!create) {
+                return false;
+            }
+        }
+        // Sparse on most filesystems, pages are only allocated as they are written
+        std::filesystem::resize_file(segmentPath, segmentBytes);
+        boost::interprocess::file_mapping file(segmentPath.c_str(), boost::interprocess::read_write);
+        region = boost::interprocess::mapped_region(file, boost::interprocess::read_write);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    header = static_cast<CaptureSegmentHeader*>(region.get_address());
+    std::memset(header, 0, sizeof(CaptureSegmentHeader));
+    std::memcpy(header->magic, CaptureSegmentHeader::kMagic, sizeof(header->magic));
+    header->version = CaptureSegmentHeader::kVersion;
+    header->indexCapacity = kIndexEntries;
+    header->fileSize = segmentBytes;
+    header->dataBegin = sizeof(CaptureSegmentHeader) + kIndexEntries * sizeof(CaptureIndexEntry);
+    header->dataEnd = header->dataBegin;
+    nextIndexOffset = header->dataBegin;
+    return true;
+}
+
+void TrafficCapture::closeSegment() {
+    if (!header) {
+        return;
+    }
+    const std::uint64_t used = header->dataEnd;
+    header->fileSize = used;
+    region.flush();
+    region = boost::interprocess::mapped_region();
+    header = nullptr;
+    std::error_code ec;
+    std::filesystem::resize_file(segmentPath, used, ec);
+}
+
+/*!
+    \class CaptureReader
+    \brief Reads frames back from TrafficCapture segment files.
+
+    Segments are mapped read-only and frames are returned as views into the
+    mapping, so reading copies nothing. A directory is read in segment number
+    order, which is the order the frames were captured in.
+*/
+
+/*!
+    \fn CaptureReader::CaptureReader(const std::string& path)
+    \brief Opens a single segment file, or every segment in a directory.
+    \param path A segment file or a capture directory.
+*/
+CaptureReader::CaptureReader(const std::string& path) {
+    std::vector<std::pair<std::uint32_t, std::string>> paths;
+    if (std::filesystem::is_directory(path)) {
+        for (const auto& entry : std::filesystem::directory_iterator(path)) {
+            std::uint32_t number;
+            if (parseSegmentName(entry.path().filename().string(), number)) {
+                paths.emplace_back(number, entry.path().string());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+    } else {
+        paths.emplace_back(0, path);
+    }
+    if (paths.empty()) {
+        throw std::runtime_error("No capture segments in " + path);
+    }
+
+    for (const auto& [number, segmentPath] : paths) {
+        auto segment = std::make_unique<Segment>();
+        segment->path = segmentPath;
+        try {
+            segment->file = boost::interprocess::file_mapping(segmentPath.c_str(), boost::interprocess::read_only);
+            segment->region = boost::interprocess::mapped_region(segment->file, boost::interprocess::read_only);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Cannot map capture segment " + segmentPath + ": " + e.what());
+        }
+        const std::size_t size = segment->region.get_size();
+        segment->header = static_cast<const CaptureSegmentHeader*>(segment->region.get_address());
+        if (size < sizeof(CaptureSegmentHeader)
+            || std::memcmp(segment->header->magic, CaptureSegmentHeader::kMagic, sizeof(CaptureSegmentHeader::kMagic)) != 0
+            || segment->header->version != CaptureSegmentHeader::kVersion
+            || segment->header->dataEnd > size || segment->header->dataBegin > segment->header->dataEnd) {
+            throw std::runtime_error(segmentPath + " is not a capture segment");
+        }
+        segments.push_back(std::move(segment));
+    }
+}
+
+const char* CaptureReader::base(std::size_t segment) const {
+    return static_cast<const char*>(segments[segment]->region.get_address());
+}
+
+/*!
+    \fn bool CaptureReader::next(CapturedFrame& frame)
+    \brief Reads the next frame.
+    \param frame Set to the frame, its data stays valid while the reader exists.
+    \return True if a frame was read, false at the end of the capture.
+
+    Throws std::runtime_error if a record runs past the end of its segment.
+*/
+bool CaptureReader::next(CapturedFrame& frame) {
+    while (current < segments.size()) {
+        const CaptureSegmentHeader* header = segments[current]->header;
+        if (offset == 0) {
+            offset = header->dataBegin;
+        }
+        if (offset + sizeof(CaptureRecordHeader) <= header->dataEnd) {
+            CaptureRecordHeader record;
+            std::memcpy(&record, base(current) + offset, sizeof(record));
+            if (offset + sizeof(record) + record.length > header->dataEnd) {
+                throw std::runtime_error("Corrupt record in capture segment " + segments[current]->path);
+            }
+            frame.timestampNs = record.timestampNs;
+            frame.data = std::string_view(base(current) + offset + sizeof(record), record.length);
+            offset += sizeof(record) + paddedLength(record.length);
+            return true;
+        }
+        ++current;
+        offset = 0;
+    }
+    return false;
+}
+
+/*!
+    \fn void CaptureReader::seek(std::int64_t timestampNs)
+    \brief Positions the reader so next() returns the first frame received at or after a time.
+    \param timestampNs Nanoseconds since the epoch.
+
+    Finds the segment by its time range, binary searches its index for the
+    nearest earlier entry, and scans forward from there.
+*/
+void CaptureReader::seek(std::int64_t timestampNs) {
+    current = 0;
+    while (current < segments.size()
+           && (segments[current]->header->recordCount == 0 || segments[current]->header->lastTimestampNs < timestampNs)) {
+        ++current;
+    }
+    offset = 0;
+    if (current == segments.size()) {
+        return;
+    }
+
+    const CaptureSegmentHeader* header = segments[current]->header;
+    const auto* index = reinterpret_cast<const CaptureIndexEntry*>(base(current) + sizeof(CaptureSegmentHeader));
+    const CaptureIndexEntry* end = index + header->indexCount;
+    const CaptureIndexEntry* after = std::lower_bound(index, end, timestampNs,
+        [](const CaptureIndexEntry& entry, std::int64_t value) { return entry.timestampNs < value; });
+    offset = after == index ? header->dataBegin : (after - 1)->offset;
+
+    while (offset + sizeof(CaptureRecordHeader) <= header->dataEnd) {
+        CaptureRecordHeader record;
+        std::memcpy(&record, base(current) + offset, sizeof(record));
+        if (record.timestampNs >= timestampNs) {
+            return;
+        }
+        offset += sizeof(record) + paddedLength(record.length);
+    }
+}
+
+/*!
+    \fn void CaptureReader::rewind()
+    \brief Positions the reader before the first frame.
+*/
+void CaptureReader::rewind() {
+    current = 0;
+    offset = 0;
+}
+
+/*!
+    \fn std::int64_t CaptureReader::firstTimestamp() const
+    \brief Returns the receive time of the first frame, or 0 if the capture is empty.
+*/
+std::int64_t CaptureReader::firstTimestamp() const {
+    for (const auto& segment : segments) {
+        if (segment->header->recordCount > 0) {
+            return segment->header->firstTimestampNs;
+        }
+    }
+    return 0;
+}
+
+/*!
+    \fn std::int64_t CaptureReader::lastTimestamp() const
+    \brief Returns the receive time of the last frame, or 0 if the capture is empty.
+*/
+std::int64_t CaptureReader::lastTimestamp() const {
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        if ((*it)->header->recordCount > 0) {
+            return (*it)->header->lastTimestampNs;
+        }
+    }
+    return 0;
+}
+
+/*!
+    \fn std::uint64_t CaptureReader::frameCount() const
+    \brief Returns the number of frames in every segment.
+*/
+std::uint64_t CaptureReader::frameCount() const {
+    std::uint64_t count = 0;
+    for (const auto& segment : segments) {
+        count += segment->header->recordCount;
+    }
+    return count;
+}
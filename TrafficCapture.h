@@ -0,0 +1,120 @@
+#ifndef TRAFFICCAPTURE_H
+#define TRAFFICCAPTURE_H
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Layout shared by the writer and reader. A segment file is this header, then
+// indexCapacity index entries, then records of CaptureRecordHeader followed by
+// the frame bytes padded to 8 bytes.
+struct CaptureSegmentHeader {
+    static constexpr char kMagic[8] = {'A', 'N', 'I', 'C', 'A', 'P', '1', '\0'};
+    static constexpr std::uint32_t kVersion = 1;
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t indexCapacity;
+    std::uint64_t indexCount;
+    std::uint64_t fileSize;
+    std::uint64_t dataBegin;
+    // One past the last complete record, only advanced once a record is fully written
+    std::uint64_t dataEnd;
+    std::uint64_t recordCount;
+    std::int64_t firstTimestampNs;
+    std::int64_t lastTimestampNs;
+    char reserved[56];
+};
+
+struct CaptureIndexEntry {
+    std::int64_t timestampNs;
+    std::uint64_t offset;
+};
+
+struct CaptureRecordHeader {
+    std::int64_t timestampNs;
+    std::uint32_t length;
+    std::uint32_t reserved;
+};
+
+// Appends received frames with their receive time to memory-mapped segment files
+class TrafficCapture {
+public:
+    static constexpr std::uint64_t kDefaultSegmentBytes = 256ull << 20;
+    static constexpr std::uint32_t kIndexEntries = 4096;
+
+    // Segments are created in directory as capture-000000.anicap, capture-000001.anicap, ...
+    // numbered after any already there. Throws std::runtime_error if the first cannot be created.
+    explicit TrafficCapture(const std::string& directory, std::uint64_t segmentBytes = kDefaultSegmentBytes);
+    ~TrafficCapture();
+    TrafficCapture(const TrafficCapture&) = delete;
+    TrafficCapture& operator=(const TrafficCapture&) = delete;
+    // Record a frame, without its newline, received now. Returns false if it could not be stored.
+    bool append(const std::string& frame);
+    bool append(std::int64_t timestampNs, const char* data, std::size_t size);
+    // Write the mapped pages back to disk
+    void flush();
+    // Trim the last segment to its records and unmap it, later appends fail
+    void close();
+    std::uint64_t frameCount() const;
+    std::uint64_t droppedCount() const;
+    static std::string segmentName(std::uint32_t number);
+
+private:
+    bool appendLocked(std::int64_t timestampNs, const char* data, std::size_t size);
+    bool openSegment();
+    void closeSegment();
+
+    std::string directory;
+    std::uint64_t segmentBytes;
+    mutable std::mutex mutex;
+    std::uint32_t nextSegment = 0;
+    std::string segmentPath;
+    boost::interprocess::mapped_region region;
+    CaptureSegmentHeader* header = nullptr;
+    std::uint64_t nextIndexOffset = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t dropped = 0;
+};
+
+// A frame read back from a capture, data points into the mapped file
+struct CapturedFrame {
+    std::int64_t timestampNs = 0;
+    std::string_view data;
+};
+
+// Reads the frames of one segment file, or of every segment in a directory, in order
+class CaptureReader {
+public:
+    // Throws std::runtime_error if nothing can be opened or a segment is not a capture
+    explicit CaptureReader(const std::string& path);
+    // Read the next frame, returns false at the end of the capture
+    bool next(CapturedFrame& frame);
+    // Position before the first frame received at or after timestampNs, using the segment indexes
+    void seek(std::int64_t timestampNs);
+    void rewind();
+    std::int64_t firstTimestamp() const;
+    std::int64_t lastTimestamp() const;
+    std::uint64_t frameCount() const;
+    std::size_t segmentCount() const { return segments.size(); }
+
+private:
+    struct Segment {
+        std::string path;
+        boost::interprocess::file_mapping file;
+        boost::interprocess::mapped_region region;
+        const CaptureSegmentHeader* header = nullptr;
+    };
+    const char* base(std::size_t segment) const;
+
+    std::vector<std::unique_ptr<Segment>> segments;
+    std::size_t current = 0;
+    std::uint64_t offset = 0;
+};
+
+#endif // TRAFFICCAPTURE_H
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "TrafficCapture.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+// Header, a full index and a few kilobytes of records
+constexpr std::uint64_t kSmallSegment = sizeof(CaptureSegmentHeader)
+    + TrafficCapture::kIndexEntries * sizeof(CaptureIndexEntry) + 4096;
+
+class TrafficCaptureTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        directory = std::filesystem::temp_directory_path()
+            / ("ani-capture-" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        std::filesystem::remove_all(directory);
+    }
+    void TearDown() override {
+        std::filesystem::remove_all(directory);
+    }
+
+    std::filesystem::path directory;
+};
+
+std::string frameText(int i) {
+    return "{\"id\":\"PE" + std::to_string(i) + "\",\"lat\":" + std::to_string(i % 90) + "}";
+}
+}
+
+TEST_F(TrafficCaptureTest, FramesReadBackInOrderWithTheirTimestamps) {
+    {
+        TrafficCapture capture(directory.string());
+        for (int i = 0; i < 100; ++i) {
+            const std::string frame = frameText(i);
+            ASSERT_TRUE(capture.append(1000 + i, frame.data(), frame.size()));
+        }
+        EXPECT_TRUE(capture.append("live frame"));
+        EXPECT_EQ(capture.frameCount(), 101u);
+    }
+
+    CaptureReader reader(directory.string());
+    EXPECT_EQ(reader.segmentCount(), 1u);
+    EXPECT_EQ(reader.frameCount(), 101u);
+    EXPECT_EQ(reader.firstTimestamp(), 1000);
+    CapturedFrame frame;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(reader.next(frame));
+        EXPECT_EQ(frame.timestampNs, 1000 + i);
+        EXPECT_EQ(frame.data, frameText(i));
+    }
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.data, "live frame");
+    EXPECT_GT(frame.timestampNs, 1099);
+    EXPECT_FALSE(reader.next(frame));
+
+    reader.rewind();
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.data, frameText(0));
+}
+
+TEST_F(TrafficCaptureTest, FullSegmentsRollOverAndAreTrimmedOnClose) {
+    {
+        TrafficCapture capture(directory.string(), kSmallSegment);
+        for (int i = 0; i < 500; ++i) {
+            const std::string frame = frameText(i);
+            ASSERT_TRUE(capture.append(i, frame.data(), frame.size()));
+        }
+    }
+
+    CaptureReader reader(directory.string());
+    EXPECT_GT(reader.segmentCount(), 1u);
+    EXPECT_EQ(reader.frameCount(), 500u);
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        EXPECT_LE(std::filesystem::file_size(entry.path()), kSmallSegment);
+    }
+    CapturedFrame frame;
+    int count = 0;
+    while (reader.next(frame)) {
+        EXPECT_EQ(frame.timestampNs, count);
+        EXPECT_EQ(frame.data, frameText(count));
+        ++count;
+    }
+    EXPECT_EQ(count, 500);
+}
+
+TEST_F(TrafficCaptureTest, SeekFindsTheFirstFrameAtOrAfterATime) {
+    {
+        TrafficCapture capture(directory.string(), kSmallSegment);
+        for (int i = 0; i < 1000; ++i) {
+            const std::string frame = frameText(i);
+            capture.append(i * 10, frame.data(), frame.size());
+        }
+    }
+
+    CaptureReader reader(directory.string());
+    CapturedFrame frame;
+    for (std::int64_t target : {0, 5, 10, 4321, 7777, 9990}) {
+        reader.seek(target);
+        ASSERT_TRUE(reader.next(frame)) << target;
+        EXPECT_EQ(frame.timestampNs, (target + 9) / 10 * 10);
+        EXPECT_EQ(frame.data, frameText(static_cast<int>((target + 9) / 10)));
+    }
+    reader.seek(10000);
+    EXPECT_FALSE(reader.next(frame));
+}
+
+TEST_F(TrafficCaptureTest, ReopeningADirectoryAddsNewSegments) {
+    {
+        TrafficCapture capture(directory.string());
+        capture.append(1, "first", 5);
+    }
+    {
+        TrafficCapture capture(directory.string());
+        capture.append(2, "second", 6);
+    }
+    EXPECT_TRUE(std::filesystem::exists(directory / TrafficCapture::segmentName(0)));
+    EXPECT_TRUE(std::filesystem::exists(directory / TrafficCapture::segmentName(1)));
+
+    CaptureReader reader(directory.string());
+    CapturedFrame frame;
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.data, "first");
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.data, "second");
+    EXPECT_FALSE(reader.next(frame));
+
+    CaptureReader single((directory / TrafficCapture::segmentName(1)).string());
+    EXPECT_EQ(single.frameCount(), 1u);
+}
+
+TEST_F(TrafficCaptureTest, FramesLargerThanASegmentAreDropped) {
+    TrafficCapture capture(directory.string(), kSmallSegment);
+    const std::string huge(8192, 'x');
+    EXPECT_FALSE(capture.append(1, huge.data(), huge.size()));
+    EXPECT_TRUE(capture.append(2, "fits", 4));
+    capture.close();
+    EXPECT_FALSE(capture.append(3, "closed", 6));
+    EXPECT_EQ(capture.frameCount(), 1u);
+    EXPECT_EQ(capture.droppedCount(), 2u);
+}
+
+TEST(TrafficCaptureErrors, ReaderRejectsFilesThatAreNotCaptures) {
+    const auto path = std::filesystem::temp_directory_path() / "ani-not-a-capture.anicap";
+    {
+        std::ofstream file(path);
+        file << std::string(256, 'z');
+    }
+    EXPECT_THROW(CaptureReader reader(path.string()), std::runtime_error);
+    std::filesystem::remove(path);
+    EXPECT_THROW(CaptureReader reader((std::filesystem::temp_directory_path() / "ani-no-such-capture").string()),
+                 std::runtime_error);
+}
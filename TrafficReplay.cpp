@@ -0,0 +1,197 @@
+#include "TrafficReplay.h"
+#include "Logger.h"
+#include <QCommandLineParser>
+#include <cmath>
+#include <string>
+
+/*!
+    \class TrafficReplay
+    \brief Sends the frames of a capture through an AbstractNetworkInterface.
+
+    Frames are decoded with NetworkImplementation::decodeMessage() and sent
+    with the target's typed send function, so a capture can be replayed into
+    any implementation, not just a TCP one. Frames that do not decode, such
+    as malformed updates captured in the field, are sent unchanged with
+    sendBlob() so the receiver sees exactly what was recorded.
+
+    At speed N each frame is sent at its offset from the first replayed frame
+    divided by N, measured against the steady clock, so pacing errors do not
+    accumulate. At speed 0 frames are sent back to back.
+*/
+
+/*!
+    \fn TrafficReplay::TrafficReplay(CaptureReader& reader, AbstractNetworkInterface& target)
+    \brief Creates a replay of reader's frames into target, both must outlive it.
+*/
+TrafficReplay::TrafficReplay(CaptureReader& reader, AbstractNetworkInterface& target)
+    : reader(reader), target(target) {}
+
+/*!
+    \fn ReplayStats TrafficReplay::run(const ReplayOptions& options)
+    \brief Replays the frames in the options' window.
+    \param options The speed and the window of the capture to replay.
+    \return How many frames were replayed and how long it took.
+*/
+ReplayStats TrafficReplay::run(const ReplayOptions& options) {
+    stopping = false;
+    ReplayStats stats;
+    const std::int64_t first = reader.firstTimestamp();
+    const std::int64_t from = first + options.from.count();
+    const std::int64_t to = options.to.count() > reader.lastTimestamp() - first ? reader.lastTimestamp()
+                                                                               : first + options.to.count();
+    reader.seek(from);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::int64_t origin = -1;
+    CapturedFrame frame;
+    while (!stopping && reader.next(frame)) {
+        if (frame.timestampNs > to) {
+            break;
+        }
+        if (origin < 0) {
+            origin = frame.timestampNs;
+        }
+        if (options.speed > 0.0) {
+            const auto due = start + std::chrono::nanoseconds(static_cast<std::int64_t>(
+                std::llround((frame.timestampNs - origin) / options.speed)));
+            std::unique_lock<std::mutex> lock(mutex);
+            if (wake.wait_until(lock, due, [this]() { return stopping.load(); })) {
+                break;
+            }
+        }
+        ++stats.frames;
+        if (send(target, frame.data)) {
+            ++stats.sent;
+        } else {
+            ++stats.failed;
+        }
+    }
+    stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+/*!
+    \fn void TrafficReplay::stop()
+    \brief Makes run() return before its next frame. Safe to call from any thread.
+*/
+void TrafficReplay::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+}
+
+/*!
+    \fn bool TrafficReplay::send(AbstractNetworkInterface& target, std::string_view frame)
+    \brief Sends one captured frame with the send function for its kind.
+    \param target The interface to send through.
+    \param frame The frame, without its trailing newline.
+    \return True if the target reported the frame as sent.
+*/
+bool TrafficReplay::send(AbstractNetworkInterface& target, std::string_view frame) {
+    const std::string data(frame);
+    try {
+        NetworkMessage message;
+        try {
+            message = NetworkImplementation::decodeMessage(data);
+        } catch (const std::exception&) {
+            return target.sendBlob(data);
+        }
+        switch (message.kind) {
+        case NetworkMessage::Kind::PE:
+            return target.sendPE(message.pes.front());
+        case NetworkMessage::Kind::Emitter:
+            return target.sendEmitter(message.emitters.front());
+        case NetworkMessage::Kind::Setting: {
+            const auto& [type, id, setting, value] = message.setting;
+            return type == "PE_SETTING" ? target.sendPESetting(setting, id, value)
+                                        : target.sendEmitterSetting(setting, id, value);
+        }
+        case NetworkMessage::Kind::ComplexBlob:
+            return target.sendComplexBlob(message.pes.front(), message.emitters.front(), message.doubleMap);
+        case NetworkMessage::Kind::PEBatch:
+            return target.sendPEBatch(message.pes);
+        case NetworkMessage::Kind::EmitterBatch:
+            return target.sendEmitterBatch(message.emitters);
+        case NetworkMessage::Kind::Snapshot:
+            return target.sendSnapshot({message.sequence, message.pes, message.emitters});
+        case NetworkMessage::Kind::SettingBatch:
+            return target.sendSettingBatch(message.settings);
+        case NetworkMessage::Kind::Blob:
+            return target.sendBlob(message.blob);
+        }
+    } catch (const std::exception& e) {
+        ANI_LOG_ERROR("TrafficReplay", std::string("Failed to replay frame: ") + e.what());
+    }
+    return false;
+}
+
+/*!
+    \fn bool ReplayConfig::parse(const QStringList& arguments, ReplayConfig& config, QString& error, QString& helpText)
+    \brief Builds a replay configuration from the command line.
+    \param arguments The command line, including the program name.
+    \param config The configuration to fill in, options not given keep their defaults.
+    \param error Set to a description of the problem if parsing fails.
+    \param helpText Set to the usage text if --help was given.
+    \return True if the replay should start with config, false otherwise.
+*/
+bool ReplayConfig::parse(const QStringList& arguments, ReplayConfig& config, QString& error, QString& helpText) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a traffic capture to a relay or console at its recorded pace");
+    const QCommandLineOption helpOption = parser.addHelpOption();
+    const QCommandLineOption captureOption("capture", "Capture directory or segment file to replay.", "path");
+    const QCommandLineOption addressOption("address", "Address to send to.", "address");
+    const QCommandLineOption portOption("port", "Port to send to.", "port");
+    const QCommandLineOption speedOption("speed", "1 for the recorded pace, N for N times faster, or max.", "speed");
+    const QCommandLineOption fromOption("from", "Start this many seconds into the capture.", "seconds");
+    const QCommandLineOption toOption("to", "Stop this many seconds into the capture.", "seconds");
+    const QCommandLineOption infoOption("info", "Describe the capture instead of replaying it.");
+    parser.addOptions({captureOption, addressOption, portOption, speedOption, fromOption, toOption, infoOption});
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText();
+        return false;
+    }
+    if (parser.isSet(helpOption)) {
+        helpText = parser.helpText();
+        return false;
+    }
+
+    config.capture = parser.value(captureOption);
+    config.info = parser.isSet(infoOption);
+    if (config.capture.isEmpty()) {
+        error = "--capture is required";
+        return false;
+    }
+    if (parser.isSet(addressOption)) {
+        config.address = parser.value(addressOption);
+    }
+    bool ok = true;
+    if (parser.isSet(portOption)) {
+        config.port = parser.value(portOption).toUShort(&ok);
+    }
+    if (ok && parser.isSet(speedOption)) {
+        const QString speed = parser.value(speedOption);
+        config.options.speed = speed == "max" ? 0.0 : speed.toDouble(&ok);
+    }
+    if (ok && parser.isSet(fromOption)) {
+        config.options.from = std::chrono::nanoseconds(static_cast<std::int64_t>(parser.value(fromOption).toDouble(&ok) * 1e9));
+    }
+    if (ok && parser.isSet(toOption)) {
+        config.options.to = std::chrono::nanoseconds(static_cast<std::int64_t>(parser.value(toOption).toDouble(&ok) * 1e9));
+    }
+    if (!ok) {
+        error = "Port, speed and times must be numbers";
+        return false;
+    }
+    if (!config.info && config.port == 0) {
+        error = "--port is required to replay";
+        return false;
+    }
+    if (config.options.speed < 0.0 || config.options.from.count() < 0 || config.options.to < config.options.from) {
+        error = "Speed and times must not be negative, and --to must not be before --from";
+        return false;
+    }
+    return true;
+}
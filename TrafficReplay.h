@@ -0,0 +1,60 @@
+#ifndef TRAFFICREPLAY_H
+#define TRAFFICREPLAY_H
+
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include "AbstractNetworkInterface.h"
+#include "TrafficCapture.h"
+
+struct ReplayOptions {
+    // 1 replays at the captured pace, 2 twice as fast, 0 as fast as the target accepts
+    double speed = 1.0;
+    // Window to replay, as offsets from the first frame of the capture
+    std::chrono::nanoseconds from{0};
+    std::chrono::nanoseconds to = std::chrono::nanoseconds::max();
+};
+
+struct ReplayStats {
+    std::uint64_t frames = 0;
+    std::uint64_t sent = 0;
+    std::uint64_t failed = 0;
+    double elapsedSeconds = 0.0;
+};
+
+struct ReplayConfig {
+    // Capture directory or single segment file
+    QString capture;
+    QString address = "127.0.0.1";
+    unsigned short port = 0;
+    ReplayOptions options;
+    // Describe the capture instead of replaying it
+    bool info = false;
+    // Parse the command line, returns false with a message in error, or with helpText set if --help was given
+    static bool parse(const QStringList& arguments, ReplayConfig& config, QString& error, QString& helpText);
+};
+
+// Re-emits captured frames through an interface, paced by their receive times
+class TrafficReplay {
+public:
+    TrafficReplay(CaptureReader& reader, AbstractNetworkInterface& target);
+    // Replay the window in options, returns early if stop() is called from another thread
+    ReplayStats run(const ReplayOptions& options = ReplayOptions());
+    void stop();
+    // Send one frame with the target's function for its kind, frames that do not decode are sent as blobs
+    static bool send(AbstractNetworkInterface& target, std::string_view frame);
+
+private:
+    CaptureReader& reader;
+    AbstractNetworkInterface& target;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping{false};
+};
+
+#endif // TRAFFICREPLAY_H
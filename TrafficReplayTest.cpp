@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "TrafficReplay.h"
+#include <filesystem>
+#include <thread>
+
+class TrafficReplayTest : public ::testing::Test {
+protected:
+    std::unique_ptr<NetworkImplementation> server;
+    std::unique_ptr<NetworkImplementation> client;
+    std::filesystem::path directory;
+
+    void SetUp() override {
+        directory = std::filesystem::temp_directory_path()
+            / ("ani-replay-" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        std::filesystem::remove_all(directory);
+
+        server = std::make_unique<NetworkImplementation>();
+        client = std::make_unique<NetworkImplementation>();
+        boost::asio::io_context io_context;
+        boost::asio::ip::tcp::acceptor acceptor(io_context, boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        std::thread serverThread([&]() { acceptor.accept(*server->getSocket()); });
+        client->initialise("127.0.0.1", acceptor.local_endpoint().port());
+        serverThread.join();
+    }
+
+    void TearDown() override {
+        client->close();
+        server->close();
+        std::filesystem::remove_all(directory);
+    }
+
+    // Record one frame of every kind, spaced interval apart
+    void writeCapture(std::chrono::nanoseconds interval) {
+        const PE pe("Replayed", "F18", 10.0, 20.0, 30000.0, 500.0, "MED", "HIGH", false, false);
+        const Emitter emitter("E1", "Radar", "Search", 11.0, 21.0, 100.0, 200.0, false);
+        const std::string frames[] = {
+            MessageCodec::encodePE(pe),
+            MessageCodec::encodeEmitter(emitter),
+            MessageCodec::encodeSetting("PE_SETTING", "jam", "Replayed", 1),
+            MessageCodec::encodePEBatch({pe, pe}),
+            MessageCodec::encodeSnapshot({7, {pe}, {emitter}}),
+            "{\"id\":\"truncated",
+        };
+        TrafficCapture capture(directory.string());
+        std::int64_t timestamp = 1000000000;
+        for (const std::string& frame : frames) {
+            // Captures hold frames as read, without their newline
+            const std::size_t length = !frame.empty() && frame.back() == '\n' ? frame.size() - 1 : frame.size();
+            ASSERT_TRUE(capture.append(timestamp, frame.data(), length));
+            timestamp += interval.count();
+        }
+    }
+};
+
+TEST_F(TrafficReplayTest, EveryKindIsResentWithItsOwnSendFunction) {
+    writeCapture(std::chrono::milliseconds(100));
+    CaptureReader reader(directory.string());
+    const ReplayStats stats = TrafficReplay(reader, *client).run({0.0});
+    EXPECT_EQ(stats.frames, 6u);
+    EXPECT_EQ(stats.sent, 6u);
+    EXPECT_EQ(stats.failed, 0u);
+    // At maximum speed the 500 ms of recorded gaps are not waited for
+    EXPECT_LT(stats.elapsedSeconds, 0.4);
+
+    NetworkMessage message = server->receiveMessage();
+    ASSERT_EQ(message.kind, NetworkMessage::Kind::PE);
+    EXPECT_EQ(message.pes.front().id, "Replayed");
+    EXPECT_EQ(server->receiveMessage().kind, NetworkMessage::Kind::Emitter);
+    message = server->receiveMessage();
+    ASSERT_EQ(message.kind, NetworkMessage::Kind::Setting);
+    EXPECT_EQ(message.setting, std::make_tuple(std::string("PE_SETTING"), std::string("Replayed"), std::string("jam"), 1));
+    message = server->receiveMessage();
+    ASSERT_EQ(message.kind, NetworkMessage::Kind::PEBatch);
+    EXPECT_EQ(message.pes.size(), 2u);
+    message = server->receiveMessage();
+    ASSERT_EQ(message.kind, NetworkMessage::Kind::Snapshot);
+    EXPECT_EQ(message.sequence, 7u);
+    // Malformed frames are passed through untouched
+    EXPECT_EQ(server->receiveBlob().front(), "{\"id\":\"truncated");
+}
+
+TEST_F(TrafficReplayTest, FramesArePacedByTheirRecordedTimes) {
+    writeCapture(std::chrono::milliseconds(40));
+    CaptureReader reader(directory.string());
+
+    ReplayOptions options;
+    options.speed = 1.0;
+    ReplayStats stats = TrafficReplay(reader, *client).run(options);
+    EXPECT_EQ(stats.sent, 6u);
+    EXPECT_GE(stats.elapsedSeconds, 0.2);
+    EXPECT_LT(stats.elapsedSeconds, 0.6);
+
+    options.speed = 4.0;
+    stats = TrafficReplay(reader, *client).run(options);
+    EXPECT_EQ(stats.sent, 6u);
+    EXPECT_GE(stats.elapsedSeconds, 0.05);
+    EXPECT_LT(stats.elapsedSeconds, 0.2);
+}
+
+TEST_F(TrafficReplayTest, OnlyTheRequestedWindowIsReplayed) {
+    writeCapture(std::chrono::seconds(1));
+    CaptureReader reader(directory.string());
+
+    ReplayOptions options;
+    options.speed = 0.0;
+    options.from = std::chrono::seconds(1);
+    options.to = std::chrono::seconds(3);
+    const ReplayStats stats = TrafficReplay(reader, *client).run(options);
+    EXPECT_EQ(stats.frames, 3u);
+    EXPECT_EQ(server->receiveMessage().kind, NetworkMessage::Kind::Emitter);
+    EXPECT_EQ(server->receiveMessage().kind, NetworkMessage::Kind::Setting);
+    EXPECT_EQ(server->receiveMessage().kind, NetworkMessage::Kind::PEBatch);
+}
+
+TEST_F(TrafficReplayTest, StopEndsAReplayWaitingForItsNextFrame) {
+    writeCapture(std::chrono::seconds(10));
+    CaptureReader reader(directory.string());
+    TrafficReplay replay(reader, *client);
+    std::thread stopper([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        replay.stop();
+    });
+    const ReplayStats stats = replay.run();
+    stopper.join();
+    EXPECT_EQ(stats.frames, 1u);
+    EXPECT_LT(stats.elapsedSeconds, 5.0);
+}
+
+TEST_F(TrafficReplayTest, ReceivedFramesAreCaptured) {
+    {
+        auto capture = std::make_shared<TrafficCapture>(directory.string());
+        server->setCapture(capture);
+        ASSERT_TRUE(client->sendPESetting("jam", "Captured", 1));
+        ASSERT_TRUE(client->sendBlob("raw"));
+        server->receiveSetting();
+        server->receiveBlob();
+        server->setCapture(nullptr);
+    }
+
+    CaptureReader reader(directory.string());
+    EXPECT_EQ(reader.frameCount(), 2u);
+    CapturedFrame frame;
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(std::string(frame.data) + "\n", MessageCodec::encodeSetting("PE_SETTING", "jam", "Captured", 1));
+    ASSERT_TRUE(reader.next(frame));
+    EXPECT_EQ(frame.data, "raw");
+}
@@ -0,0 +1,340 @@
+#include "UpdateScheduler.h"
+#include <algorithm>
+#include <utility>
+
+/*!
+    \class UpdateScheduler
+    \brief Gives each PE and Emitter a share of a saturated link, weighted by priority and rate of change.
+
+    The link's capacity is estimated from the writes reported by recordWrite().
+    While writes return at once the link is keeping up and nothing is deferred.
+    Once they block for more than saturatedBusyShare of a rebalance interval the
+    socket buffer is full, writes complete at the link's rate, and the bytes
+    written over the time spent writing become the estimate. After that the
+    estimate grows by capacityGrowth per rebalance while writes stop blocking, so
+    budgets loosen again as the link recovers.
+
+    Every rebalanceInterval, targetUtilisation of the estimate is divided by
+    weighted max-min fairness. Entities whose recent demand fits their weighted
+    share keep their full rate, and the rest split what is left by weight. An
+    entity's weight is the weight of its priority, boosted by how far it has moved
+    from where a receiver would dead-reckon its last sent state, so manoeuvring
+    entities get more of the link than ones flying straight. Budgets are enforced
+    with a token bucket per entity.
+
+    Deferred updates are not queued, as each update carries the entity's full
+    state. Only the latest deferred state of each entity is kept, and takeDue()
+    hands it back once the entity's tokens cover it or maxInterval has passed
+    since its last sent update, so an entity's final state is sent even if no
+    further update arrives. An entity's first update, updates that change a
+    field a receiver cannot extrapolate, and updates maxInterval after the last
+    one sent are never deferred, so low-priority entities degrade to a slower
+    rate but do not go stale.
+*/
+
+namespace {
+// Share of the previous demand estimate kept at each rebalance
+constexpr double kDemandSmoothing = 0.5;
+// Keeps weights positive, so every entity gets some share
+constexpr double kMinWeight = 1e-3;
+
+double secondsBetween(DeadReckoning::Clock::time_point from, DeadReckoning::Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+}
+
+/*!
+    \fn UpdateScheduler::UpdateScheduler(const UpdateSchedulerConfig& config)
+    \brief Constructs a scheduler with no capacity estimate, so nothing is deferred until writes block.
+*/
+UpdateScheduler::UpdateScheduler(const UpdateSchedulerConfig& config)
+    : settings(config) {}
+
+/*!
+    \fn bool UpdateScheduler::shouldSendPE(const PE& pe, std::size_t frameBytes, DeadReckoning::Clock::time_point now)
+    \brief Decides whether a PE update fits the PE's budget.
+    \param pe The current PE state.
+    \param frameBytes The size of the encoded update.
+    \param now The time of the update.
+    \return True if the update should be written. The PE is then recorded as sent.
+*/
+bool UpdateScheduler::shouldSendPE(const PE& pe, std::size_t frameBytes, DeadReckoning::Clock::time_point now) {
+    return shouldSend(pes, pe, weightFor(pe.priority), frameBytes, now);
+}
+
+/*!
+    \fn bool UpdateScheduler::shouldSendEmitter(const Emitter& emitter, std::size_t frameBytes, DeadReckoning::Clock::time_point now)
+    \brief Decides whether an Emitter update fits the Emitter's budget.
+    \param emitter The current Emitter state.
+    \param frameBytes The size of the encoded update.
+    \param now The time of the update.
+    \return True if the update should be written. The Emitter is then recorded as sent.
+
+    The Emitter is weighted by the higher of its eaPriority and esPriority.
+*/
+bool UpdateScheduler::shouldSendEmitter(const Emitter& emitter, std::size_t frameBytes,
+                                        DeadReckoning::Clock::time_point now) {
+    const double weight = std::max(weightFor(emitter.eaPriority), weightFor(emitter.esPriority));
+    return shouldSend(emitters, emitter, weight, frameBytes, now);
+}
+
+/*!
+    \fn void UpdateScheduler::recordWrite(std::size_t bytes, std::chrono::nanoseconds elapsed, DeadReckoning::Clock::time_point now)
+    \brief Records a completed write, of any kind of frame, towards the capacity estimate.
+    \param bytes The bytes written.
+    \param elapsed How long the write took, including any time blocked on a full socket buffer.
+    \param now When the write completed.
+*/
+void UpdateScheduler::recordWrite(std::size_t bytes, std::chrono::nanoseconds elapsed,
+                                  DeadReckoning::Clock::time_point now) {
+    windowBytes += static_cast<double>(bytes);
+    windowBusy += elapsed;
+    maybeRebalance(now);
+}
+
+/*!
+    \fn bool UpdateScheduler::takeDue(DeadReckoning::Clock::time_point now, std::vector<PE>& pes, std::vector<Emitter>& emitters)
+    \brief Takes the deferred states that can now be sent.
+    \param now The current time.
+    \param pes Receives the PE states to write.
+    \param emitters Receives the Emitter states to write.
+    \return True if anything was taken.
+
+    A deferred state is due once its entity's tokens cover it, or once
+    maxInterval has passed since the entity's last sent update. Taken states
+    are recorded as sent, so the caller must write them. Deferred states are
+    only looked through once per flushInterval, so this is cheap to call on
+    every send.
+*/
+bool UpdateScheduler::takeDue(DeadReckoning::Clock::time_point now, std::vector<PE>& pes,
+                              std::vector<Emitter>& emitters) {
+    if (pending == 0 || now - flushedAt < settings.flushInterval) {
+        return false;
+    }
+    flushedAt = now;
+    maybeRebalance(now);
+    const std::size_t before = pes.size() + emitters.size();
+    takeDue(this->pes, now, pes);
+    takeDue(this->emitters, now, emitters);
+    return pes.size() + emitters.size() > before;
+}
+
+/*!
+    \fn double UpdateScheduler::peBudget(const QString& id) const
+    \brief Returns the PE's budget in bytes per second, kUnlimited if it is unconstrained or unknown.
+*/
+double UpdateScheduler::peBudget(const QString& id) const {
+    return budgetOf(pes, id);
+}
+
+/*!
+    \fn double UpdateScheduler::emitterBudget(const QString& id) const
+    \brief Returns the Emitter's budget in bytes per second, kUnlimited if it is unconstrained or unknown.
+*/
+double UpdateScheduler::emitterBudget(const QString& id) const {
+    return budgetOf(emitters, id);
+}
+
+/*!
+    \fn double UpdateScheduler::weightFor(const QString& priority) const
+    \brief Returns the configured weight of a priority value, before any boost for rate of change.
+*/
+double UpdateScheduler::weightFor(const QString& priority) const {
+    return std::max(settings.priorityWeights.value(priority, settings.defaultWeight), kMinWeight);
+}
+
+/*!
+    \fn void UpdateScheduler::reset()
+    \brief Forgets every entity and the capacity estimate.
+*/
+void UpdateScheduler::reset() {
+    pes = Tracks<PE>();
+    emitters = Tracks<Emitter>();
+    started = false;
+    pending = 0;
+    flushedAt = DeadReckoning::Clock::time_point();
+    windowBytes = 0.0;
+    windowBusy = std::chrono::nanoseconds(0);
+    capacity = 0.0;
+}
+
+template <typename Entity>
+bool UpdateScheduler::shouldSend(Tracks<Entity>& all, const Entity& entity, double priorityWeight,
+                                 std::size_t frameBytes, DeadReckoning::Clock::time_point now) {
+    maybeRebalance(now);
+    const double bytes = static_cast<double>(frameBytes);
+    auto found = all.index.constFind(entity.id);
+    if (found == all.index.constEnd()) {
+        Track<Entity> track(entity);
+        track.sentAt = now;
+        track.offeredAt = now;
+        track.refilledAt = now;
+        track.weight = priorityWeight;
+        track.windowWeight = priorityWeight;
+        track.offeredBytes = bytes;
+        all.index.insert(entity.id, static_cast<std::uint32_t>(all.tracks.size()));
+        all.tracks.push_back(std::move(track));
+        return true;
+    }
+    Track<Entity>& track = all.tracks[found.value()];
+    track.offeredAt = now;
+    track.offeredBytes += bytes;
+
+    double lat = track.last.lat;
+    double lon = track.last.lon;
+    DeadReckoning::extrapolate(lat, lon, track.last.speed, track.last.heading, secondsBetween(track.sentAt, now),
+                               settings.speedToMetresPerSecond);
+    const double error = DeadReckoning::distanceMetres(lat, lon, entity.lat, entity.lon);
+    const double boost = std::min(1.0 + error / settings.changeScaleMetres, std::max(settings.maxChangeBoost, 1.0));
+    track.windowWeight = std::max(track.windowWeight, priorityWeight * boost);
+
+    refill(track, bytes, now);
+    const bool send = track.budget == kUnlimited || track.tokens >= bytes || now - track.sentAt >= settings.maxInterval
+                      || !DeadReckoning::sameAttributes(track.last, entity);
+    if (!send) {
+        ++deferred;
+        if (!track.pending) {
+            track.pending = true;
+            ++pending;
+        }
+        track.latest = entity;
+        track.pendingBytes = bytes;
+        return false;
+    }
+    markSent(track, entity, bytes, now);
+    return true;
+}
+
+template <typename Entity>
+void UpdateScheduler::refill(Track<Entity>& track, double bytes, DeadReckoning::Clock::time_point now) {
+    if (track.budget != kUnlimited) {
+        // Unspent budget is kept for one rebalance interval, or one frame if that is less
+        const double interval = std::chrono::duration<double>(settings.rebalanceInterval).count();
+        const double burst = std::max(bytes, track.budget * interval);
+        track.tokens = std::min(burst, track.tokens + track.budget * secondsBetween(track.refilledAt, now));
+    }
+    track.refilledAt = now;
+}
+
+template <typename Entity>
+void UpdateScheduler::markSent(Track<Entity>& track, const Entity& entity, double bytes,
+                               DeadReckoning::Clock::time_point now) {
+    if (track.budget != kUnlimited) {
+        // Sends forced by the interval or a changed attribute can leave the bucket in debt
+        track.tokens -= bytes;
+    }
+    if (track.pending) {
+        // A newer state supersedes the deferred one
+        track.pending = false;
+        --pending;
+    }
+    track.last = entity;
+    track.sentAt = now;
+}
+
+template <typename Entity>
+void UpdateScheduler::takeDue(Tracks<Entity>& all, DeadReckoning::Clock::time_point now, std::vector<Entity>& due) {
+    for (Track<Entity>& track : all.tracks) {
+        if (!track.pending) {
+            continue;
+        }
+        refill(track, track.pendingBytes, now);
+        if (track.budget == kUnlimited || track.tokens >= track.pendingBytes || now - track.sentAt >= settings.maxInterval) {
+            due.push_back(track.latest);
+            markSent(track, track.latest, track.pendingBytes, now);
+        }
+    }
+}
+
+template <typename Entity>
+void UpdateScheduler::settle(Tracks<Entity>& all, double windowSeconds, DeadReckoning::Clock::time_point now,
+                             std::vector<Share>& shares) {
+    // Forget idle entities first, moving the last track into each gap, so shares can point into the tracks
+    for (std::size_t i = all.tracks.size(); i-- > 0;) {
+        if (now - all.tracks[i].offeredAt < settings.idleTimeout) {
+            continue;
+        }
+        all.index.remove(all.tracks[i].last.id);
+        if (all.tracks[i].pending) {
+            --pending;
+        }
+        if (i != all.tracks.size() - 1) {
+            all.tracks[i] = std::move(all.tracks.back());
+            all.index.insert(all.tracks[i].last.id, static_cast<std::uint32_t>(i));
+        }
+        all.tracks.pop_back();
+    }
+    for (Track<Entity>& track : all.tracks) {
+        track.demand = kDemandSmoothing * track.demand + (1.0 - kDemandSmoothing) * track.offeredBytes / windowSeconds;
+        track.offeredBytes = 0.0;
+        if (track.windowWeight > 0.0) {
+            track.weight = track.windowWeight;
+            track.windowWeight = 0.0;
+        }
+        shares.push_back(Share{track.demand, track.weight, &track.budget});
+    }
+}
+
+template <typename Entity>
+double UpdateScheduler::budgetOf(const Tracks<Entity>& all, const QString& id) {
+    auto found = all.index.constFind(id);
+    return found == all.index.constEnd() ? kUnlimited : all.tracks[found.value()].budget;
+}
+
+void UpdateScheduler::maybeRebalance(DeadReckoning::Clock::time_point now) {
+    if (!started) {
+        started = true;
+        windowStart = now;
+    } else if (now - windowStart >= settings.rebalanceInterval) {
+        rebalance(now);
+    }
+}
+
+void UpdateScheduler::rebalance(DeadReckoning::Clock::time_point now) {
+    const double window = secondsBetween(windowStart, now);
+    const double busy = std::chrono::duration<double>(windowBusy).count();
+    if (windowBytes > 0.0 && busy > 0.0) {
+        const double rate = windowBytes / busy;
+        if (busy >= settings.saturatedBusyShare * window) {
+            // Writes were waiting for the link, so they completed at its rate
+            capacity = rate;
+        } else if (capacity > 0.0) {
+            capacity = std::min(rate, capacity * settings.capacityGrowth);
+        }
+    }
+    windowStart = now;
+    windowBytes = 0.0;
+    windowBusy = std::chrono::nanoseconds(0);
+
+    std::vector<Share> shares;
+    shares.reserve(entityCount());
+    settle(pes, window, now, shares);
+    settle(emitters, window, now, shares);
+    if (capacity == 0.0) {
+        for (Share& share : shares) {
+            *share.budget = kUnlimited;
+        }
+        return;
+    }
+    // Entities whose demand fits their weighted share of what is left keep their full rate, the
+    // least demanding per unit of weight first, and the rest split the remainder by weight
+    std::sort(shares.begin(), shares.end(), [](const Share& a, const Share& b) {
+        return a.demand / a.weight < b.demand / b.weight;
+    });
+    double remaining = capacity * settings.targetUtilisation;
+    double remainingWeight = 0.0;
+    for (const Share& share : shares) {
+        remainingWeight += share.weight;
+    }
+    for (std::size_t i = 0; i < shares.size(); ++i) {
+        if (shares[i].demand > remaining * shares[i].weight / remainingWeight) {
+            for (std::size_t j = i; j < shares.size(); ++j) {
+                *shares[j].budget = remaining * shares[j].weight / remainingWeight;
+            }
+            break;
+        }
+        *shares[i].budget = kUnlimited;
+        remaining -= shares[i].demand;
+        remainingWeight -= shares[i].weight;
+    }
+}
@@ -0,0 +1,136 @@
+#ifndef UPDATESCHEDULER_H
+#define UPDATESCHEDULER_H
+
+#include <QHash>
+#include <QString>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "DeadReckoning.h"
+#include "pe.h"
+#include "emitter.h"
+
+struct UpdateSchedulerConfig {
+    // Share of the estimated link capacity handed out as update budgets, the rest is left for other frames
+    double targetUtilisation = 0.8;
+    // Budget weight of each priority value, any other value gets defaultWeight.
+    // An Emitter is weighted by the higher of its eaPriority and esPriority.
+    QHash<QString, double> priorityWeights{{"HIGH", 8.0}, {"MED", 3.0}, {"LOW", 1.0}};
+    double defaultWeight = 1.0;
+    // The weight is multiplied by 1 + error / changeScaleMetres, up to maxChangeBoost, where error is how far
+    // the entity is from where a receiver would extrapolate its last sent state
+    double changeScaleMetres = 100.0;
+    double maxChangeBoost = 4.0;
+    // Every entity is sent at least this often however busy the link is
+    std::chrono::milliseconds maxInterval{5000};
+    // How often the capacity estimate and budgets are recomputed
+    std::chrono::milliseconds rebalanceInterval{100};
+    // How often takeDue() looks through the deferred updates, calls in between return nothing
+    std::chrono::milliseconds flushInterval{10};
+    // The link counts as saturated once writes block for at least this share of a rebalance interval
+    double saturatedBusyShare = 0.5;
+    // Once writes stop blocking the capacity estimate grows by at most this factor per rebalance
+    double capacityGrowth = 1.05;
+    // Entities with no update for this long are forgotten
+    std::chrono::milliseconds idleTimeout{60000};
+    // Converts the speed field to metres per second when extrapolating the last sent state
+    double speedToMetresPerSecond = DeadReckoningConfig().speedToMetresPerSecond;
+};
+
+// Shares a saturated link between entities. The capacity is estimated from how long writes block,
+// and each entity gets a byte budget weighted by its priority and how fast it is changing. Updates
+// over budget are deferred, and the latest deferred state of each entity is handed back by takeDue()
+// once its budget allows or maxInterval has passed. Not thread-safe, NetworkImplementation calls it
+// with sendMutex held.
+class UpdateScheduler {
+public:
+    static constexpr double kUnlimited = std::numeric_limits<double>::infinity();
+
+    explicit UpdateScheduler(const UpdateSchedulerConfig& config = UpdateSchedulerConfig());
+    // True if an update encoded in frameBytes should be written now. The entity is then recorded as sent.
+    bool shouldSendPE(const PE& pe, std::size_t frameBytes, DeadReckoning::Clock::time_point now);
+    bool shouldSendEmitter(const Emitter& emitter, std::size_t frameBytes, DeadReckoning::Clock::time_point now);
+    // Report a completed write of any frame and how long it blocked for
+    void recordWrite(std::size_t bytes, std::chrono::nanoseconds elapsed, DeadReckoning::Clock::time_point now);
+    // Move the deferred states that are now due into pes and emitters, recording them as sent.
+    // The caller must write them. Returns false without looking if flushInterval has not passed.
+    bool takeDue(DeadReckoning::Clock::time_point now, std::vector<PE>& pes, std::vector<Emitter>& emitters);
+
+    // Estimated link capacity in bytes per second, 0 until writes have been seen to block
+    double capacityEstimate() const { return capacity; }
+    // Current budget of an entity in bytes per second, kUnlimited while its demand fits its share
+    double peBudget(const QString& id) const;
+    double emitterBudget(const QString& id) const;
+    double weightFor(const QString& priority) const;
+    std::size_t entityCount() const { return pes.tracks.size() + emitters.tracks.size(); }
+    // Updates deferred because their entity was over budget
+    std::size_t deferredCount() const { return deferred; }
+    // Entities whose latest state is deferred and not yet taken by takeDue()
+    std::size_t pendingCount() const { return pending; }
+    // Forget every entity and the capacity estimate, for example after a reconnect
+    void reset();
+    const UpdateSchedulerConfig& config() const { return settings; }
+
+private:
+    template <typename Entity>
+    struct Track {
+        explicit Track(const Entity& entity) : last(entity), latest(entity) {}
+        Entity last;  // Last sent state
+        Entity latest;  // Latest deferred state, waiting for takeDue() while pending is set
+        bool pending = false;
+        double pendingBytes = 0.0;
+        DeadReckoning::Clock::time_point sentAt;
+        DeadReckoning::Clock::time_point offeredAt;
+        DeadReckoning::Clock::time_point refilledAt;
+        double weight = 1.0;  // Used for the budgets until the next rebalance
+        double windowWeight = 0.0;  // Largest weight seen since the last rebalance
+        double tokens = 0.0;  // Bytes the entity may send before it is over budget
+        double budget = kUnlimited;  // Bytes per second
+        double demand = 0.0;  // Bytes per second offered, smoothed over rebalances
+        double offeredBytes = 0.0;  // Offered since the last rebalance
+    };
+    template <typename Entity>
+    struct Tracks {
+        std::vector<Track<Entity>> tracks;
+        QHash<QString, std::uint32_t> index;
+    };
+    // An entity's demand and weight for one rebalance, budget points back into its track
+    struct Share {
+        double demand;
+        double weight;
+        double* budget;
+    };
+
+    template <typename Entity>
+    bool shouldSend(Tracks<Entity>& all, const Entity& entity, double priorityWeight, std::size_t frameBytes,
+                    DeadReckoning::Clock::time_point now);
+    template <typename Entity>
+    void refill(Track<Entity>& track, double bytes, DeadReckoning::Clock::time_point now);
+    template <typename Entity>
+    void markSent(Track<Entity>& track, const Entity& entity, double bytes, DeadReckoning::Clock::time_point now);
+    template <typename Entity>
+    void takeDue(Tracks<Entity>& all, DeadReckoning::Clock::time_point now, std::vector<Entity>& due);
+    template <typename Entity>
+    void settle(Tracks<Entity>& all, double windowSeconds, DeadReckoning::Clock::time_point now,
+                std::vector<Share>& shares);
+    template <typename Entity>
+    static double budgetOf(const Tracks<Entity>& all, const QString& id);
+    void maybeRebalance(DeadReckoning::Clock::time_point now);
+    void rebalance(DeadReckoning::Clock::time_point now);
+
+    UpdateSchedulerConfig settings;
+    Tracks<PE> pes;
+    Tracks<Emitter> emitters;
+    // The current rebalance window and the writes completed in it
+    bool started = false;
+    DeadReckoning::Clock::time_point windowStart;
+    double windowBytes = 0.0;
+    std::chrono::nanoseconds windowBusy{0};
+    double capacity = 0.0;
+    std::size_t deferred = 0;
+    std::size_t pending = 0;
+    DeadReckoning::Clock::time_point flushedAt;
+};
+
+#endif // UPDATESCHEDULER_H
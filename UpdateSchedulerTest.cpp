@@ -0,0 +1,331 @@
+#include <gtest/gtest.h>
+#include "UpdateScheduler.h"
+#include "InMemoryNetworkInterface.h"
+#include <map>
+#include <thread>
+
+namespace {
+const DeadReckoning::Clock::time_point kStart{std::chrono::seconds(1000)};
+constexpr std::size_t kFrameBytes = 100;
+
+DeadReckoning::Clock::time_point at(int ms) {
+    return kStart + std::chrono::milliseconds(ms);
+}
+
+PE makePE(const QString& id, const QString& priority, double lat = 10.0) {
+    return PE(id, "F18", lat, 20.0, 30000.0, 0.0, "MED", priority, false, false);
+}
+
+// An update every periodMs, counting how many were offered and sent
+struct Source {
+    PE pe;
+    int periodMs;
+    int offered = 0;
+    int sent = 0;
+};
+
+// Runs the sources for durationMs in 10 ms ticks over a link whose buffer is always full, so every
+// write blocks for its bytes at bytesPerSecond. Counts start once warmupMs has passed.
+void run(UpdateScheduler& scheduler, std::vector<Source>& sources, double bytesPerSecond, int durationMs,
+         int warmupMs = 1000) {
+    for (int ms = 0; ms < durationMs; ms += 10) {
+        for (Source& source : sources) {
+            if (ms % source.periodMs != 0) {
+                continue;
+            }
+            const bool sent = scheduler.shouldSendPE(source.pe, kFrameBytes, at(ms));
+            if (sent) {
+                const auto elapsed = std::chrono::duration<double>(kFrameBytes / bytesPerSecond);
+                scheduler.recordWrite(kFrameBytes, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed), at(ms));
+            }
+            if (ms >= warmupMs) {
+                ++source.offered;
+                source.sent += sent ? 1 : 0;
+            }
+        }
+    }
+}
+}
+
+TEST(UpdateSchedulerTest, NothingIsDeferredWhileWritesKeepUp) {
+    UpdateScheduler scheduler;
+    const PE pe = makePE("PE1", "LOW");
+    for (int ms = 0; ms < 2000; ms += 5) {
+        ASSERT_TRUE(scheduler.shouldSendPE(pe, kFrameBytes, at(ms)));
+        scheduler.recordWrite(kFrameBytes, std::chrono::microseconds(1), at(ms));
+    }
+    EXPECT_EQ(scheduler.capacityEstimate(), 0.0);
+    EXPECT_EQ(scheduler.peBudget("PE1"), UpdateScheduler::kUnlimited);
+    EXPECT_EQ(scheduler.deferredCount(), 0u);
+}
+
+TEST(UpdateSchedulerTest, CapacityIsTheRateOfBlockingWrites) {
+    UpdateScheduler scheduler;
+    // 1000 bytes every 10 ms, each blocking for 10 ms, is a 100 kB/s link
+    for (int ms = 0; ms <= 100; ms += 10) {
+        scheduler.recordWrite(1000, std::chrono::milliseconds(10), at(ms));
+    }
+    EXPECT_NEAR(scheduler.capacityEstimate(), 100000.0, 1.0);
+
+    // Writes that return at once only let the estimate grow gradually
+    for (int ms = 110; ms <= 200; ms += 10) {
+        scheduler.recordWrite(1000, std::chrono::microseconds(1), at(ms));
+    }
+    EXPECT_NEAR(scheduler.capacityEstimate(), 105000.0, 1.0);
+
+    // A slower link is picked up within one rebalance
+    for (int ms = 210; ms <= 300; ms += 10) {
+        scheduler.recordWrite(500, std::chrono::milliseconds(10), at(ms));
+    }
+    EXPECT_NEAR(scheduler.capacityEstimate(), 50000.0, 1.0);
+}
+
+TEST(UpdateSchedulerTest, HighPriorityKeepsItsRateWhileLowPriorityDegrades) {
+    UpdateScheduler scheduler;
+    std::vector<Source> sources{{makePE("HIGH1", "HIGH"), 20}};
+    for (int i = 0; i < 3; ++i) {
+        sources.push_back(Source{makePE(QString("LOW%1").arg(i), "LOW"), 10});
+    }
+    // 5 kB/s of HIGH and 30 kB/s of LOW updates over a 20 kB/s link
+    run(scheduler, sources, 20000.0, 10000);
+
+    EXPECT_NEAR(scheduler.capacityEstimate(), 20000.0, 1.0);
+    EXPECT_EQ(scheduler.peBudget("HIGH1"), UpdateScheduler::kUnlimited);
+    EXPECT_EQ(sources[0].sent, sources[0].offered);
+    int sentBytes = sources[0].sent * static_cast<int>(kFrameBytes);
+    for (std::size_t i = 1; i < sources.size(); ++i) {
+        // The 16 kB/s budget less HIGH's 5 kB/s, split three ways
+        EXPECT_NEAR(scheduler.peBudget(sources[i].pe.id), 11000.0 / 3, 1.0);
+        EXPECT_GT(sources[i].sent, sources[i].offered / 4);
+        EXPECT_LT(sources[i].sent, sources[i].offered / 2);
+        sentBytes += sources[i].sent * static_cast<int>(kFrameBytes);
+    }
+    EXPECT_LT(sentBytes / 9.0, 20000.0 * scheduler.config().targetUtilisation * 1.05);
+    EXPECT_GT(scheduler.deferredCount(), 0u);
+}
+
+TEST(UpdateSchedulerTest, ManoeuvringEntitiesGetMoreOfTheLink) {
+    UpdateScheduler scheduler;
+    // Both stationary according to their speed, but one keeps moving about 330 m an update
+    PE steady = makePE("Steady", "MED");
+    PE moving = makePE("Moving", "MED");
+    int movingSent = 0;
+    int steadySent = 0;
+    for (int ms = 0; ms < 5000; ms += 10) {
+        moving.lat = 10.0 + ms / 10 * 0.003;
+        for (const PE* pe : {&steady, &moving}) {
+            if (scheduler.shouldSendPE(*pe, kFrameBytes, at(ms))) {
+                scheduler.recordWrite(kFrameBytes, std::chrono::milliseconds(10), at(ms));
+                (pe == &moving ? movingSent : steadySent) += ms >= 1000 ? 1 : 0;
+            }
+        }
+    }
+    EXPECT_GT(scheduler.peBudget("Moving"), 3.0 * scheduler.peBudget("Steady"));
+    EXPECT_GT(movingSent, 3 * steadySent);
+    EXPECT_GT(steadySent, 0);
+}
+
+TEST(UpdateSchedulerTest, EveryEntityIsSentWithinMaxInterval) {
+    UpdateSchedulerConfig config;
+    config.priorityWeights.insert("LOW", 0.001);
+    config.maxInterval = std::chrono::milliseconds(1000);
+    UpdateScheduler scheduler(config);
+    const PE high = makePE("HIGH1", "HIGH");
+    const PE low = makePE("LOW1", "LOW");
+    int lastSent = 0;
+    int longestGap = 0;
+    for (int ms = 0; ms < 10000; ms += 10) {
+        if (scheduler.shouldSendPE(high, kFrameBytes, at(ms))) {
+            scheduler.recordWrite(kFrameBytes, std::chrono::milliseconds(20), at(ms));
+        }
+        if (scheduler.shouldSendPE(low, kFrameBytes, at(ms))) {
+            scheduler.recordWrite(kFrameBytes, std::chrono::milliseconds(20), at(ms));
+            longestGap = std::max(longestGap, ms - lastSent);
+            lastSent = ms;
+        }
+    }
+    EXPECT_LT(scheduler.peBudget("LOW1"), 100.0);
+    EXPECT_GE(longestGap, 500);
+    EXPECT_LE(longestGap, 1000);
+}
+
+TEST(UpdateSchedulerTest, ChangedAttributesAreNeverDeferred) {
+    UpdateScheduler scheduler;
+    std::vector<Source> sources{{makePE("LOW1", "LOW"), 10}, {makePE("LOW2", "LOW"), 10}};
+    run(scheduler, sources, 5000.0, 2000);
+    ASSERT_LT(sources[0].sent, sources[0].offered);
+
+    PE jammed = sources[0].pe;
+    jammed.jam = true;
+    EXPECT_TRUE(scheduler.shouldSendPE(jammed, kFrameBytes, at(2000)));
+    EXPECT_FALSE(scheduler.shouldSendPE(jammed, kFrameBytes, at(2000)));
+}
+
+TEST(UpdateSchedulerTest, TheLatestDeferredStateIsTakenOnceItsBudgetAllows) {
+    UpdateScheduler scheduler;
+    std::vector<Source> sources{{makePE("LOW1", "LOW"), 10}, {makePE("LOW2", "LOW"), 10}};
+    run(scheduler, sources, 5000.0, 2000);
+    ASSERT_LT(sources[0].sent, sources[0].offered);
+
+    // Deferred twice in a row, only the newer state is kept
+    PE older = sources[0].pe;
+    older.lat = 11.0;
+    PE newer = sources[0].pe;
+    newer.lat = 12.0;
+    ASSERT_FALSE(scheduler.shouldSendPE(older, kFrameBytes, at(2000)));
+    ASSERT_FALSE(scheduler.shouldSendPE(newer, kFrameBytes, at(2000)));
+    EXPECT_EQ(scheduler.pendingCount(), 1u);
+
+    // No new update arrives, the state is still taken once tokens have built up
+    std::vector<PE> pes;
+    std::vector<Emitter> emitters;
+    int ms = 2000;
+    while (pes.empty() && ms < 3000) {
+        ms += 10;
+        scheduler.takeDue(at(ms), pes, emitters);
+    }
+    ASSERT_EQ(pes.size(), 1u);
+    EXPECT_DOUBLE_EQ(pes[0].lat, 12.0);
+    EXPECT_TRUE(emitters.empty());
+    EXPECT_LT(ms, 3000);
+    EXPECT_EQ(scheduler.pendingCount(), 0u);
+
+    // Taken states count as sent, so there is nothing left to take
+    pes.clear();
+    EXPECT_FALSE(scheduler.takeDue(at(5000), pes, emitters));
+    EXPECT_TRUE(pes.empty());
+}
+
+TEST(UpdateSchedulerTest, DeferredStatesAreTakenWithinMaxInterval) {
+    UpdateSchedulerConfig config;
+    config.priorityWeights.insert("LOW", 0.001);
+    config.maxInterval = std::chrono::milliseconds(1000);
+    UpdateScheduler scheduler(config);
+    const PE high = makePE("HIGH1", "HIGH");
+    PE low = makePE("LOW1", "LOW");
+    int lastSent = 0;
+    for (int ms = 0; ms < 3000; ms += 10) {
+        if (scheduler.shouldSendPE(high, kFrameBytes, at(ms))) {
+            scheduler.recordWrite(kFrameBytes, std::chrono::milliseconds(20), at(ms));
+        }
+        if (scheduler.shouldSendPE(low, kFrameBytes, at(ms))) {
+            scheduler.recordWrite(kFrameBytes, std::chrono::milliseconds(20), at(ms));
+            lastSent = ms;
+        }
+    }
+    ASSERT_LT(scheduler.peBudget("LOW1"), 100.0);
+
+    // LOW1's last update is deferred and it never updates again
+    low.lat = 15.0;
+    ASSERT_FALSE(scheduler.shouldSendPE(low, kFrameBytes, at(3000)));
+    std::vector<PE> pes;
+    std::vector<Emitter> emitters;
+    for (int ms = 3000; ms <= lastSent + 1000; ms += 10) {
+        if (scheduler.shouldSendPE(high, kFrameBytes, at(ms))) {
+            scheduler.recordWrite(kFrameBytes, std::chrono::milliseconds(20), at(ms));
+        }
+        scheduler.takeDue(at(ms), pes, emitters);
+    }
+    ASSERT_EQ(pes.size(), 1u);
+    EXPECT_EQ(pes[0].id, "LOW1");
+    EXPECT_DOUBLE_EQ(pes[0].lat, 15.0);
+}
+
+TEST(UpdateSchedulerTest, DeferredStatesAreOnlyLookedThroughOncePerFlushInterval) {
+    UpdateScheduler scheduler;
+    std::vector<Source> sources{{makePE("LOW1", "LOW"), 10}, {makePE("LOW2", "LOW"), 10}};
+    run(scheduler, sources, 5000.0, 2000);
+
+    std::vector<PE> pes;
+    std::vector<Emitter> emitters;
+    scheduler.takeDue(at(2000), pes, emitters);
+    // Spend whatever tokens are left, so the next update is deferred
+    while (scheduler.shouldSendPE(sources[0].pe, kFrameBytes, at(2000))) {
+    }
+    const std::size_t pending = scheduler.pendingCount();
+    ASSERT_GT(pending, 0u);
+    // Within flushInterval of the last look nothing is taken
+    EXPECT_FALSE(scheduler.takeDue(at(2000) + scheduler.config().flushInterval / 2, pes, emitters));
+    EXPECT_EQ(scheduler.pendingCount(), pending);
+
+    scheduler.reset();
+    EXPECT_EQ(scheduler.pendingCount(), 0u);
+}
+
+TEST(UpdateSchedulerTest, EmittersUseTheHigherOfTheirPriorities) {
+    UpdateScheduler scheduler;
+    EXPECT_EQ(scheduler.weightFor("HIGH"), 8.0);
+    EXPECT_EQ(scheduler.weightFor("UNKNOWN"), scheduler.config().defaultWeight);
+
+    const Emitter mixed("E1", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, true, "LOW", "HIGH");
+    const Emitter low("E2", "RadarType", "Category", 15.0, 25.0, 8000.0, 12000.0, true, "LOW", "LOW");
+    for (int ms = 0; ms < 3000; ms += 10) {
+        for (const Emitter* emitter : {&mixed, &low}) {
+            if (scheduler.shouldSendEmitter(*emitter, kFrameBytes, at(ms))) {
+                scheduler.recordWrite(kFrameBytes, std::chrono::milliseconds(10), at(ms));
+            }
+        }
+    }
+    EXPECT_NEAR(scheduler.emitterBudget("E1"), 8.0 * scheduler.emitterBudget("E2"), 1.0);
+}
+
+TEST(UpdateSchedulerTest, IdleEntitiesAreForgotten) {
+    UpdateSchedulerConfig config;
+    config.idleTimeout = std::chrono::milliseconds(500);
+    UpdateScheduler scheduler(config);
+    ASSERT_TRUE(scheduler.shouldSendPE(makePE("Gone", "LOW"), kFrameBytes, at(0)));
+    for (int ms = 0; ms < 1000; ms += 10) {
+        scheduler.shouldSendPE(makePE("Staying", "LOW"), kFrameBytes, at(ms));
+    }
+    EXPECT_EQ(scheduler.entityCount(), 1u);
+
+    scheduler.reset();
+    EXPECT_EQ(scheduler.entityCount(), 0u);
+    EXPECT_EQ(scheduler.capacityEstimate(), 0.0);
+}
+
+TEST(UpdateSchedulerTest, SaturatedLinkFavoursHighPriority) {
+    InMemoryLinkConfig link;
+    link.bytesPerSecond = 40000;
+    link.capacity = 4;
+    auto [client, server] = InMemoryNetworkInterface::createPair(link);
+    client->enableUpdateScheduling();
+
+    std::map<QString, int> received;
+    InMemoryNetworkInterface& peer = *server;
+    std::thread reader([&peer, &received]() {
+        try {
+            for (;;) {
+                ++received[peer.receivePE().id];
+            }
+        } catch (const std::exception&) {
+        }
+    });
+
+    // HIGH1 every 40 ms, while four LOW PEs are offered as fast as the sender can go
+    int highOffered = 0;
+    int lowOffered = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto nextHigh = start;
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1500)) {
+        if (std::chrono::steady_clock::now() >= nextHigh) {
+            EXPECT_TRUE(client->sendPE(makePE("HIGH1", "HIGH")));
+            ++highOffered;
+            nextHigh += std::chrono::milliseconds(40);
+        }
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_TRUE(client->sendPE(makePE(QString("LOW%1").arg(i), "LOW")));
+            ++lowOffered;
+        }
+    }
+    client->close();
+    reader.join();
+
+    EXPECT_GE(received["HIGH1"], highOffered * 9 / 10);
+    int lowReceived = 0;
+    for (int i = 0; i < 4; ++i) {
+        lowReceived += received[QString("LOW%1").arg(i)];
+    }
+    EXPECT_GT(lowReceived, 0);
+    EXPECT_LT(lowReceived, lowOffered / 2);
+}
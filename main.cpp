@@ -1,10 +1,33 @@
-#include <QCoreApplication>
-#include "AbstractNetworkInterface.h"
+#include <QStringList>
+#include <iostream>
+#include "RelayDaemon.h"
 
 int main (int argc, char *argv[]) {
-    QCoreApplication carterMessage(argc, argv);
-    NetworkImplementation ANI;
-    ANI.initialise("127.0.0.1", 3526);
-    ANI.close();
-    return carterMessage.exec();
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) {
+        arguments.append(QString::fromLocal8Bit(argv[i]));
+    }
+
+    RelayConfig config;
+    QString error;
+    QString helpText;
+    if (!RelayConfig::parse(arguments, config, error, helpText)) {
+        if (!helpText.isEmpty()) {
+            std::cout << helpText.toStdString();
+            return 0;
+        }
+        std::cerr << error.toStdString() << std::endl;
+        return 1;
+    }
+
+    Logger::setLevel(config.logLevel);
+    RelayDaemon relay(config);
+    try {
+        relay.start();
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to start relay: " << e.what() << std::endl;
+        return 1;
+    }
+    relay.run();
+    return 0;
 }